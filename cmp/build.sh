@@ -1,4 +1,14 @@
-g++-14 -std=c++11 -O1 ./cmp_avltree.cpp ../src/tds_avltree.c  -o cmp_avltree.exe
+g++-14 -std=c++11 -O1 ./cmp_avltree.cpp ../src/tds_avltree.c ../src/tds_pool.c ../src/tds_allocator.c -o cmp_avltree.exe
 g++-14 -std=c++11 -O1 -flto ./cmp_avltree.cpp -ltds  -o cmp_avltree_dy.exe
 g++-14 -std=c++11 -O1 -flto ./cmp_avltree.cpp /usr/local/lib/libtds_static.a  -o cmp_avltree_st.exe
 
+gcc -std=c11 -O2 -I../include ./cmp_hashfn.c ../src/ta_hash.c ../src/tds_allocator.c -o cmp_hashfn.exe
+gcc -std=c11 -O2 -I../include ./cmp_hashtbl_latency.c ../src/tds_hashtbl.c ../src/tds_array.c ../src/tds_arraylist.c ../src/tds_string.c ../src/ta_hash.c ../src/tds_allocator.c -o cmp_hashtbl_latency.exe
+gcc -std=c11 -O2 -I../include ./cmp_hashtbl_batch.c ../src/tds_hashtbl.c ../src/tds_array.c ../src/tds_arraylist.c ../src/tds_string.c ../src/ta_hash.c ../src/tds_allocator.c -o cmp_hashtbl_batch.exe
+gcc -std=c11 -O2 -I../include ./cmp_chashtbl.c ../src/tds_chashtbl.c ../src/tds_hashtbl.c ../src/tds_array.c ../src/tds_arraylist.c ../src/tds_string.c ../src/ta_hash.c ../src/tds_allocator.c -lpthread -o cmp_chashtbl.exe
+gcc -std=c11 -O2 -I../include ./cmp_hashtbl_robinhood.c ../src/tds_hashtbl.c ../src/tds_array.c ../src/tds_arraylist.c ../src/tds_string.c ../src/ta_hash.c ../src/tds_allocator.c -o cmp_hashtbl_robinhood.exe
+gcc -std=c11 -O2 -I../include ./cmp_cuckootbl.c ../src/tds_cuckootbl.c ../src/tds_hashtbl.c ../src/tds_array.c ../src/tds_arraylist.c ../src/tds_string.c ../src/ta_hash.c ../src/tds_allocator.c -o cmp_cuckootbl.exe
+gcc -std=c11 -O2 -I../include ./cmp_hashset.c ../src/tds_hashset.c ../src/tds_hashtbl.c ../src/tds_array.c ../src/tds_arraylist.c ../src/tds_string.c ../src/ta_hash.c ../src/tds_allocator.c -o cmp_hashset.exe
+gcc -std=c11 -O2 -I../include ./cmp_bitarray.c ../src/tds_bitarray.c ../src/tds_allocator.c -o cmp_bitarray.exe
+gcc -std=c11 -O2 -I../include ./cmp_roaring.c ../src/tds_roaring.c ../src/tds_bitarray.c ../src/tds_allocator.c -o cmp_roaring.exe
+gcc -std=c11 -O2 -I../include ./cmp_nbitsarray.c ../src/tds_nbitsarray.c ../src/tds_bitarray.c ../src/tds_allocator.c -o cmp_nbitsarray.exe
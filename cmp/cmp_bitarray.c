@@ -0,0 +1,128 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <tds/bitarray.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Throughput of the bulk AND of two bit arrays: a byte loop writing each byte
+ * with `memset` (the former implementation), `tds_bitarray_and` returning a
+ * new array, and `tds_bitarray_and_inplace`
+ *
+ * Latency of `tds_bitarray_rank1` and `tds_bitarray_select1` at random
+ * locations, with and without index
+ *
+ * Build with `-mavx2` (or `-march=native`) for the AVX2 kernel, and with
+ * `-Dtds_no_simd` for the portable loop.
+ *
+ * Usage: ./cmp_bitarray.exe [number of bits] [rounds]
+ */
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void and_bytes(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t nbyte)
+{
+	size_t idx = 0;
+
+	for (idx = 0; idx < nbyte; idx++) {
+		uint8_t c = a[idx] & b[idx];
+		memset(dst + idx, c, 1);
+	}
+}
+
+static void report(const char *name, double ns, size_t nbits, size_t rounds)
+{
+	printf("| %-24s | %10.3f | %8.2f |\n", name, ns / rounds / 1e6, (double) nbits * rounds / ns);
+}
+
+static void bench_rank_select(const tds_bitarray *arr, const tds_bitarray_index *index, size_t n)
+{
+	size_t nbits = tds_bitarray_capacity(arr);
+	size_t total = tds_bitarray_popcount(arr);
+	size_t idx = 0;
+	size_t sink = 0;
+	double start = 0;
+
+	start = now_ns();
+	for (idx = 0; idx < n; idx++)
+		sink += tds_bitarray_rank1(arr, index, (size_t) rand() % nbits);
+	printf("| rank1   | %-8s | %10.1f |\n", index ? "index" : "scan", (now_ns() - start) / n);
+	start = now_ns();
+	for (idx = 0; idx < n; idx++)
+		sink += tds_bitarray_select1(arr, index, (size_t) rand() % total);
+	printf("| select1 | %-8s | %10.1f |\n", index ? "index" : "scan", (now_ns() - start) / n);
+	if (0 == sink)
+		printf("(sink %zu)\n", sink);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t nbits = argc > 1 ? (size_t) atol(argv[1]) : (size_t) 1 << 24;
+	size_t rounds = argc > 2 ? (size_t) atol(argv[2]) : 50;
+	size_t nbyte = 0;
+	size_t idx = 0;
+	size_t sink = 0;
+	double start = 0;
+	tds_bitarray *a = tds_bitarray_force_create(nbits);
+	tds_bitarray *b = tds_bitarray_force_create(nbits);
+	tds_bitarray *c = tds_bitarray_force_create(nbits);
+	tds_bitarray_index *index = NULL;
+	uint8_t *pa = NULL;
+	uint8_t *pb = NULL;
+
+	nbits = tds_bitarray_capacity(a);
+	nbyte = nbits / 8;
+	pa = (uint8_t *) tds_bitarray_data(a);
+	pb = (uint8_t *) tds_bitarray_data(b);
+	for (idx = 0; idx < nbyte; idx++) {
+		pa[idx] = (uint8_t) rand();
+		pb[idx] = (uint8_t) rand();
+	}
+
+	printf("| %-24s | %10s | %8s |\n", "bulk and", "ms/round", "bits/ns");
+	printf("|--------------------------|------------|----------|\n");
+
+	start = now_ns();
+	for (idx = 0; idx < rounds; idx++) {
+		and_bytes((uint8_t *) tds_bitarray_data(c), pa, pb, nbyte);
+		sink += ((uint8_t *) tds_bitarray_data(c))[idx % nbyte];
+	}
+	report("byte loop + memset", now_ns() - start, nbits, rounds);
+
+	start = now_ns();
+	for (idx = 0; idx < rounds; idx++) {
+		tds_bitarray *r = tds_bitarray_and(a, b);
+		sink += ((uint8_t *) tds_bitarray_data(r))[idx % nbyte];
+		tds_bitarray_free(r);
+	}
+	report("tds_bitarray_and", now_ns() - start, nbits, rounds);
+
+	start = now_ns();
+	for (idx = 0; idx < rounds; idx++) {
+		tds_bitarray_and_inplace(c, b);
+		sink += ((uint8_t *) tds_bitarray_data(c))[idx % nbyte];
+	}
+	report("tds_bitarray_and_inplace", now_ns() - start, nbits, rounds);
+
+	printf("(sink %zu)\n\n", sink);
+
+	printf("| %-7s | %-8s | %10s |\n", "op", "", "ns/op");
+	printf("|---------|----------|------------|\n");
+	index = tds_bitarray_force_index_create(a);
+	bench_rank_select(a, index, 1000000);
+	bench_rank_select(a, NULL, 100);
+	tds_bitarray_index_free(index);
+
+	tds_bitarray_free(a);
+	tds_bitarray_free(b);
+	tds_bitarray_free(c);
+	return 0;
+}
@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <tds/chashtbl.h>
+#include <tds/hashtbl.h>
+#include <ta/hash.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Multi-threaded throughput of `tds_chashtbl` against a `tds_hashtbl`
+ * guarded by one global mutex
+ *
+ * Each thread runs random operations on a shared table prefilled with half
+ * of the key space, in three workloads:
+ *
+ * 	- read-heavy:  95% get,  5% set
+ * 	- mixed:       50% get, 25% set, 25% rm
+ * 	- write-heavy: 10% get, 45% set, 45% rm
+ *
+ * Usage: ./cmp_chashtbl.exe [max number of threads]
+ */
+
+#define nkeys        (1 << 20)
+#define nops         2000000  /* per thread */
+#define max_threads  64
+
+struct workload {
+	const char *__name;
+	unsigned __get;  /* percentages */
+	unsigned __set;
+};
+
+struct worker {
+	tds_chashtbl *__ctbl;
+	tds_hashtbl *__tbl;
+	pthread_mutex_t *__mutex;
+	const struct workload *__load;
+	uint64_t __seed;
+	size_t __sink;
+};
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *run(void *_arg)
+{
+	struct worker *w = (struct worker *) _arg;
+	size_t pair[2];
+	size_t idx = 0;
+
+	for (idx = 0; idx < nops; idx++) {
+		uint64_t r = ta_hash_u64(idx, w->__seed);
+		unsigned op = (unsigned) (r % 100);
+		size_t key = (size_t) ((r >> 8) % nkeys);
+
+		pair[0] = key;
+		pair[1] = idx;
+		if (NULL != w->__ctbl) {
+			if (op < w->__load->__get)
+				w->__sink += tds_chashtbl_get(w->__ctbl, &key, pair);
+			else if (op < w->__load->__get + w->__load->__set)
+				tds_chashtbl_force_set(w->__ctbl, pair);
+			else
+				tds_chashtbl_rm(w->__ctbl, &key);
+		} else {
+			pthread_mutex_lock(w->__mutex);
+			if (op < w->__load->__get)
+				w->__sink += NULL != tds_hashtbl_get(w->__tbl, &key);
+			else if (op < w->__load->__get + w->__load->__set)
+				tds_hashtbl_force_set(w->__tbl, pair);
+			else
+				tds_hashtbl_rm(w->__tbl, &key);
+			pthread_mutex_unlock(w->__mutex);
+		}
+	}
+	return NULL;
+}
+
+/* Return million operations per second
+ */
+static double bench(int concurrent, const struct workload *load, size_t nthreads)
+{
+	pthread_t threads[max_threads];
+	struct worker workers[max_threads];
+	pthread_mutex_t mutex;
+	tds_chashtbl *ctbl = NULL;
+	tds_hashtbl *tbl = NULL;
+	size_t pair[2];
+	size_t idx = 0;
+	double start = 0;
+
+	pthread_mutex_init(&mutex, NULL);
+	if (concurrent)
+		ctbl = tds_chashtbl_force_create(sizeof(pair), sizeof(size_t));
+	else
+		tbl = tds_hashtbl_force_create(sizeof(pair), sizeof(size_t));
+	for (idx = 0; idx < nkeys; idx += 2) {
+		pair[0] = idx;
+		pair[1] = idx;
+		if (concurrent)
+			tds_chashtbl_force_set(ctbl, pair);
+		else
+			tds_hashtbl_force_set(tbl, pair);
+	}
+
+	start = now_s();
+	for (idx = 0; idx < nthreads; idx++) {
+		workers[idx].__ctbl = ctbl;
+		workers[idx].__tbl = tbl;
+		workers[idx].__mutex = &mutex;
+		workers[idx].__load = load;
+		workers[idx].__seed = idx + 1;
+		workers[idx].__sink = 0;
+		pthread_create(threads + idx, NULL, run, workers + idx);
+	}
+	for (idx = 0; idx < nthreads; idx++)
+		pthread_join(threads[idx], NULL);
+	start = now_s() - start;
+
+	if (concurrent)
+		tds_chashtbl_free(ctbl);
+	else
+		tds_hashtbl_free(tbl);
+	pthread_mutex_destroy(&mutex);
+	return nthreads * nops / start * 1e-6;
+}
+
+int main(int argc, char **argv)
+{
+	struct workload loads[3] = {
+		{"read-heavy", 95, 5},
+		{"mixed", 50, 25},
+		{"write-heavy", 10, 45},
+	};
+	size_t max = 8;
+	size_t nthreads = 0;
+	int k = 0;
+
+	if (argc > 1)
+		max = (size_t) atol(argv[1]);
+	if (max > max_threads)
+		max = max_threads;
+
+	printf("million operations per second\n");
+	printf("| workload    | threads | hashtbl + mutex | chashtbl |\n");
+	printf("| ----------- | ------- | --------------- | -------- |\n");
+	for (k = 0; k < 3; k++) {
+		for (nthreads = 1; nthreads <= max; nthreads *= 2) {
+			printf("| %-11s | %7lu | %15.1f | %8.1f |\n", loads[k].__name,
+				(unsigned long) nthreads, bench(0, loads + k, nthreads),
+				bench(1, loads + k, nthreads));
+		}
+	}
+	return 0;
+}
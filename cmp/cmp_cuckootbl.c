@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <tds/cuckootbl.h>
+#include <tds/hashtbl.h>
+#include <ta/hash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Latency distribution of lookups (hits and misses) in `tds_hashtbl` and in
+ * `tds_cuckootbl` of 4 and 8 ways, each table is filled close to the load
+ * factor of its expansion (0.75, about 0.97 and 0.99)
+ *
+ * Keys are looked up in a random order. The timer itself costs a few tens of
+ * nanoseconds, the tails matter more than the means.
+ *
+ * Usage: ./cmp_cuckootbl.exe [log2 of the capacity]
+ */
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_double(const void *_a, const void *_b)
+{
+	double a = *(const double *) _a;
+	double b = *(const double *) _b;
+	return (a > b) - (a < b);
+}
+
+static void report(const char *name, const char *kind, double load, double *lat, size_t n)
+{
+	double total = 0;
+	size_t idx = 0;
+
+	for (idx = 0; idx < n; idx++)
+		total += lat[idx];
+	qsort(lat, n, sizeof(double), cmp_double);
+	printf("| %-11s | %-4s | %4.2f | %8.1f | %8.1f | %8.1f | %8.1f | %10.1f |\n", name, kind, load,
+		total / n, lat[n / 2], lat[(size_t) (n * 0.99)], lat[(size_t) (n * 0.999)], lat[n - 1]);
+}
+
+/* A random permutation of `n` keys from `base`
+ */
+static void shuffle(size_t *keys, size_t n, size_t base)
+{
+	size_t idx = 0;
+
+	for (idx = 0; idx < n; idx++)
+		keys[idx] = base + idx;
+	for (idx = n - 1; idx > 0; idx--) {
+		size_t other = (size_t) rand() % (idx + 1);
+		size_t tmp = keys[idx];
+		keys[idx] = keys[other];
+		keys[other] = tmp;
+	}
+}
+
+static void bench_hashtbl(size_t capacity, size_t *keys, double *lat)
+{
+	size_t n = (size_t) (0.74 * capacity);
+	size_t idx = 0;
+	size_t sink = 0;
+	size_t pair[2];
+	tds_hashtbl *tbl = tds_hashtbl_force_create_g(sizeof(pair), sizeof(size_t), capacity, NULL);
+
+	for (idx = 0; idx < n; idx++) {
+		pair[0] = idx;
+		pair[1] = idx;
+		tds_hashtbl_force_set(tbl, pair);
+	}
+	shuffle(keys, n, 0);
+	for (idx = 0; idx < n; idx++) {
+		double start = now_ns();
+		sink += NULL != tds_hashtbl_get(tbl, keys + idx);
+		lat[idx] = now_ns() - start;
+	}
+	report("hashtbl", "hit", tds_hashtbl_load_factor(tbl), lat, n);
+	shuffle(keys, n, n);
+	for (idx = 0; idx < n; idx++) {
+		double start = now_ns();
+		sink += NULL != tds_hashtbl_get(tbl, keys + idx);
+		lat[idx] = now_ns() - start;
+	}
+	report("hashtbl", "miss", tds_hashtbl_load_factor(tbl), lat, n);
+	if (sink == 42)  /* keep the loops */
+		printf(" ");
+	tds_hashtbl_free(tbl);
+}
+
+static void bench_cuckootbl(const char *name, int ways, double load, \
+	size_t capacity, size_t *keys, double *lat)
+{
+	size_t n = (size_t) (load * capacity);
+	size_t idx = 0;
+	size_t sink = 0;
+	size_t pair[2];
+	tds_cuckootbl *tbl = tds_cuckootbl_force_create_w(sizeof(pair), sizeof(size_t), \
+		capacity, ta_hash_wy, ways, NULL);
+
+	for (idx = 0; idx < n; idx++) {
+		pair[0] = idx;
+		pair[1] = idx;
+		tds_cuckootbl_force_set(tbl, pair);
+	}
+	shuffle(keys, n, 0);
+	for (idx = 0; idx < n; idx++) {
+		double start = now_ns();
+		sink += NULL != tds_cuckootbl_get(tbl, keys + idx);
+		lat[idx] = now_ns() - start;
+	}
+	report(name, "hit", tds_cuckootbl_load_factor(tbl), lat, n);
+	shuffle(keys, n, n);
+	for (idx = 0; idx < n; idx++) {
+		double start = now_ns();
+		sink += NULL != tds_cuckootbl_get(tbl, keys + idx);
+		lat[idx] = now_ns() - start;
+	}
+	report(name, "miss", tds_cuckootbl_load_factor(tbl), lat, n);
+	if (sink == 42)  /* keep the loops */
+		printf(" ");
+	tds_cuckootbl_free(tbl);
+}
+
+int main(int argc, char **argv)
+{
+	size_t capacity = (size_t) 1 << 22;
+	size_t *keys = NULL;
+	double *lat = NULL;
+
+	if (argc > 1)
+		capacity = (size_t) 1 << atoi(argv[1]);
+	keys = (size_t *) malloc(capacity * sizeof(size_t));
+	lat = (double *) malloc(capacity * sizeof(double));
+
+	printf("get latency (ns), capacity %lu\n", (unsigned long) capacity);
+	printf("| table       | get  | load |     mean |      p50 |      p99 |     p999 |        max |\n");
+	printf("| ----------- | ---- | ---- | -------- | -------- | -------- | -------- | ---------- |\n");
+	bench_hashtbl(capacity, keys, lat);
+	bench_cuckootbl("cuckoo 4way", 4, 0.95, capacity, keys, lat);
+	bench_cuckootbl("cuckoo 8way", 8, 0.98, capacity, keys, lat);
+	free(keys);
+	free(lat);
+	return 0;
+}
@@ -0,0 +1,88 @@
+#include <ta/hash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Compare the byte-wise polynomial hash (the former default of tds_hashtbl)
+ * with the word-at-a-time hash on keys of 16, 32 and 64 bytes
+ *
+ * 	- ns/key: time to hash one key
+ * 	- collisions: number of keys landing on an occupied bucket of a
+ * 	  power-of-two table under 50% load, as tds_hashtbl indexes by
+ * 	  `code % capacity`
+ */
+
+#define nkeys  4000000
+
+static void make_key(char *key, size_t keysize, size_t idx)
+{
+	memset(key, 0, keysize);
+	sprintf(key, "xxadrfh%lu", (unsigned long) idx);
+}
+
+static double bench_time(tds_fhash_t _f, uint64_t seed, const char *keys, size_t keysize)
+{
+	uint64_t sink = 0;
+	clock_t start, end;
+	size_t idx;
+
+	start = clock();
+	for (idx = 0; idx < nkeys; idx++)
+		sink ^= _f(keys + idx * keysize, keysize, seed);
+	end = clock();
+	if (sink == 42)  /* keep the loop */
+		printf(" ");
+	return 1e9 * (double) (end - start) / CLOCKS_PER_SEC / nkeys;
+}
+
+static size_t bench_collisions(tds_fhash_t _f, uint64_t seed, const char *keys, size_t keysize)
+{
+	size_t capacity = 16;
+	size_t conflicts = 0;
+	size_t idx;
+	unsigned char *used = NULL;
+
+	while (capacity < 2 * nkeys)
+		capacity *= 2;
+	used = (unsigned char *) calloc(capacity, 1);
+
+	for (idx = 0; idx < nkeys; idx++) {
+		uint64_t loc = _f(keys + idx * keysize, keysize, seed) % capacity;
+		if (used[loc])
+			conflicts++;
+		used[loc] = 1;
+	}
+	free(used);
+	return conflicts;
+}
+
+int main(void)
+{
+	size_t keysizes[3] = {16, 32, 64};
+	size_t k, idx;
+
+	printf("| keysize | hash        |  ns/key | collisions |\n");
+	printf("| ------- | ----------- | ------- | ---------- |\n");
+
+	for (k = 0; k < 3; k++) {
+		size_t keysize = keysizes[k];
+		char *keys = (char *) malloc(nkeys * keysize);
+
+		for (idx = 0; idx < nkeys; idx++)
+			make_key(keys + idx * keysize, keysize, idx);
+
+		printf("| %7lu | poly (367)  | %7.2f | %10lu |\n", (unsigned long) keysize,
+			bench_time(ta_hash_poly, ta_hash_poly_base, keys, keysize),
+			(unsigned long) bench_collisions(ta_hash_poly, ta_hash_poly_base, keys, keysize));
+		printf("| %7lu | poly (257)  | %7.2f | %10lu |\n", (unsigned long) keysize,
+			bench_time(ta_hash_poly, 257, keys, keysize),
+			(unsigned long) bench_collisions(ta_hash_poly, 257, keys, keysize));
+		printf("| %7lu | wy (seeded) | %7.2f | %10lu |\n", (unsigned long) keysize,
+			bench_time(ta_hash_wy, ta_hash_seed(), keys, keysize),
+			(unsigned long) bench_collisions(ta_hash_wy, ta_hash_seed(), keys, keysize));
+		free(keys);
+	}
+	return 0;
+}
@@ -0,0 +1,134 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <tds/hashset.h>
+#include <tds/hashtbl.h>
+#include <ta/hash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Insertion, membership and removal of 8-byte keys in `tds_hashset` and in a
+ * `tds_hashtbl` whose pairs are the keys alone (`pairsize == keysize`)
+ *
+ * The keys are inserted, looked up (present, then absent) and removed in a
+ * random order, so that most accesses miss the caches for large sets.
+ *
+ * Usage: ./cmp_hashset.exe [log2 of the number of keys]
+ */
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* `n` distinct keys in a random order
+ */
+static size_t *make_keys(size_t n, uint64_t seed)
+{
+	size_t *keys = (size_t *) malloc(n * sizeof(size_t));
+	size_t idx = 0;
+
+	if (NULL == keys) {
+		printf("Error ... make_keys\n");
+		exit(-1);
+	}
+	for (idx = 0; idx < n; idx++)
+		keys[idx] = ta_hash_u64(idx, seed);
+	for (idx = n - 1; idx > 0; idx--) {
+		size_t j = (size_t) (ta_hash_u64(idx, seed + 1) % (idx + 1));
+		size_t tmp = keys[idx];
+		keys[idx] = keys[j];
+		keys[j] = tmp;
+	}
+	return keys;
+}
+
+static void report(const char *name, double t_insert, double t_hit, double t_miss, double t_erase)
+{
+	printf("| %-7s | %9.1f | %7.1f | %7.1f | %8.1f |\n", name, t_insert, t_hit, t_miss, t_erase);
+}
+
+static void bench_hashset(const size_t *keys, const size_t *absent, size_t n)
+{
+	tds_hashset *set = tds_hashset_force_create(sizeof(size_t));
+	size_t idx = 0;
+	size_t sink = 0;
+	double start = 0;
+	double t_insert = 0, t_hit = 0, t_miss = 0, t_erase = 0;
+
+	start = now_ns();
+	for (idx = 0; idx < n; idx++)
+		tds_hashset_force_insert(set, keys + idx);
+	t_insert = (now_ns() - start) / n;
+	start = now_ns();
+	for (idx = n; idx > 0; idx--)
+		sink += tds_hashset_contains(set, keys + idx - 1);
+	t_hit = (now_ns() - start) / n;
+	start = now_ns();
+	for (idx = 0; idx < n; idx++)
+		sink += tds_hashset_contains(set, absent + idx);
+	t_miss = (now_ns() - start) / n;
+	start = now_ns();
+	for (idx = 0; idx < n; idx++)
+		sink += tds_hashset_erase(set, keys + idx);
+	t_erase = (now_ns() - start) / n;
+
+	report("hashset", t_insert, t_hit, t_miss, t_erase);
+	if (sink != 2 * n)
+		printf("Error ... bench_hashset\n");
+	tds_hashset_free(set);
+}
+
+static void bench_hashtbl(const size_t *keys, const size_t *absent, size_t n)
+{
+	tds_hashtbl *tbl = tds_hashtbl_force_create(sizeof(size_t), sizeof(size_t));
+	size_t idx = 0;
+	size_t sink = 0;
+	double start = 0;
+	double t_insert = 0, t_hit = 0, t_miss = 0, t_erase = 0;
+
+	start = now_ns();
+	for (idx = 0; idx < n; idx++)
+		tds_hashtbl_force_set(tbl, keys + idx);
+	t_insert = (now_ns() - start) / n;
+	start = now_ns();
+	for (idx = n; idx > 0; idx--)
+		sink += NULL != tds_hashtbl_get(tbl, keys + idx - 1);
+	t_hit = (now_ns() - start) / n;
+	start = now_ns();
+	for (idx = 0; idx < n; idx++)
+		sink += NULL != tds_hashtbl_get(tbl, absent + idx);
+	t_miss = (now_ns() - start) / n;
+	start = now_ns();
+	for (idx = 0; idx < n; idx++)
+		sink += tds_hashtbl_rm(tbl, keys + idx);
+	t_erase = (now_ns() - start) / n;
+
+	report("hashtbl", t_insert, t_hit, t_miss, t_erase);
+	if (sink != 2 * n)
+		printf("Error ... bench_hashtbl\n");
+	tds_hashtbl_free(tbl);
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = (size_t) 1 << 22;
+	size_t *keys = NULL;
+	size_t *absent = NULL;
+
+	if (argc > 1)
+		n = (size_t) 1 << atoi(argv[1]);
+	keys = make_keys(2 * n, 1);
+	absent = keys + n;  /* distinct from the first half */
+
+	printf("ns per operation, %lu keys of 8 bytes\n", (unsigned long) n);
+	printf("| set     | insert    | hit     | miss    | erase    |\n");
+	printf("| ------- | --------- | ------- | ------- | -------- |\n");
+	bench_hashset(keys, absent, n);
+	bench_hashtbl(keys, absent, n);
+	free(keys);
+	return 0;
+}
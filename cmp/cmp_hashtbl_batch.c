@@ -0,0 +1,92 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <tds/hashtbl.h>
+#include <ta/hash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Throughput of random lookups through `tds_hashtbl_get` against
+ * `tds_hashtbl_get_batch`, and of inserts through `tds_hashtbl_set` against
+ * `tds_hashtbl_set_batch`
+ *
+ * The default table (16M slots of 16-byte pairs) is much larger than the
+ * last level cache, so that single lookups wait on memory one by one.
+ *
+ * Usage: ./cmp_hashtbl_batch.exe [number of pairs]
+ */
+
+#define nbatch  1024  /* keys passed to each batched call */
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = 8000000;
+	size_t idx = 0;
+	size_t sink = 0;
+	size_t *pairs = NULL;
+	size_t *keys = NULL;
+	void *out[nbatch];
+	double start = 0;
+	double t_single = 0;
+	double t_batch = 0;
+	tds_hashtbl *tbl = NULL;
+
+	if (argc > 1)
+		n = (size_t) atol(argv[1]);
+	pairs = (size_t *) malloc(2 * n * sizeof(size_t));
+	keys = (size_t *) malloc(n * sizeof(size_t));
+	for (idx = 0; idx < n; idx++) {
+		pairs[2 * idx] = ta_hash_u64(idx, 0);  /* random order of keys */
+		pairs[2 * idx + 1] = idx;
+	}
+	for (idx = 0; idx < n; idx++)
+		keys[idx] = pairs[2 * ((ta_hash_u64(idx, 1) % n))];
+	printf("%lu pairs, million operations per second\n", (unsigned long) n);
+	printf("| operation | single | batch | speedup |\n");
+	printf("| --------- | ------ | ----- | ------- |\n");
+
+	/* set */
+	tbl = tds_hashtbl_force_create(2 * sizeof(size_t), sizeof(size_t));
+	start = now_s();
+	for (idx = 0; idx < n; idx++)
+		tds_hashtbl_force_set(tbl, pairs + 2 * idx);
+	t_single = now_s() - start;
+	tds_hashtbl_free(tbl);
+
+	tbl = tds_hashtbl_force_create(2 * sizeof(size_t), sizeof(size_t));
+	start = now_s();
+	for (idx = 0; idx < n; idx += nbatch)
+		tds_hashtbl_force_set_batch(tbl, pairs + 2 * idx, n - idx < nbatch ? n - idx : nbatch);
+	t_batch = now_s() - start;
+	printf("| set       | %6.1f | %5.1f | %6.2fx |\n", n / t_single * 1e-6, n / t_batch * 1e-6, t_single / t_batch);
+
+	/* get */
+	start = now_s();
+	for (idx = 0; idx < n; idx++)
+		sink += ((size_t *) tds_hashtbl_get(tbl, keys + idx))[1];
+	t_single = now_s() - start;
+
+	start = now_s();
+	for (idx = 0; idx < n; idx += nbatch) {
+		size_t nb = n - idx < nbatch ? n - idx : nbatch;
+		size_t k = 0;
+		tds_hashtbl_get_batch(tbl, keys + idx, nb, out);
+		for (k = 0; k < nb; k++)
+			sink -= ((size_t *) out[k])[1];
+	}
+	t_batch = now_s() - start;
+	printf("| get       | %6.1f | %5.1f | %6.2fx |\n", n / t_single * 1e-6, n / t_batch * 1e-6, t_single / t_batch);
+
+	tds_hashtbl_free(tbl);
+	free(pairs);
+	free(keys);
+	return 0 == sink ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <tds/hashtbl.h>
+#include <ta/hash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Latency distribution of `tds_hashtbl_set`, with and without the incremental
+ * resizing mode
+ *
+ * Usage: ./cmp_hashtbl_latency.exe [number of pairs]
+ */
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_double(const void *_a, const void *_b)
+{
+	double a = *(const double *) _a;
+	double b = *(const double *) _b;
+	return (a > b) - (a < b);
+}
+
+static void bench(const char *name, int mode, size_t n, double *lat)
+{
+	size_t idx = 0;
+	size_t pair[2];
+	double total = 0;
+	tds_hashtbl *tbl = tds_hashtbl_force_create_m(sizeof(pair), sizeof(size_t), 0, ta_hash_wy, mode, NULL);
+
+	for (idx = 0; idx < n; idx++) {
+		double start = 0;
+		pair[0] = idx;
+		pair[1] = idx;
+		start = now_ns();
+		tds_hashtbl_force_set(tbl, pair);
+		lat[idx] = now_ns() - start;
+		total += lat[idx];
+	}
+	qsort(lat, n, sizeof(double), cmp_double);
+	printf("| %-11s | %8.1f | %8.1f | %8.1f | %10.1f | %14.1f |\n", name,
+		total / n, lat[n / 2], lat[(size_t) (n * 0.99)],
+		lat[(size_t) (n * 0.999)], lat[n - 1]);
+	tds_hashtbl_free(tbl);
+}
+
+int main(int argc, char **argv)
+{
+	size_t n = 10000000;
+	double *lat = NULL;
+
+	if (argc > 1)
+		n = (size_t) atol(argv[1]);
+	lat = (double *) malloc(n * sizeof(double));
+
+	printf("set latency (ns) of %lu pairs\n", (unsigned long) n);
+	printf("| mode        |     mean |      p50 |      p99 |       p999 |            max |\n");
+	printf("| ----------- | -------- | -------- | -------- | ---------- | -------------- |\n");
+	bench("default", 0, n, lat);
+	bench("incremental", tds_hashtbl_mode_incremental, n, lat);
+	free(lat);
+	return 0;
+}
@@ -0,0 +1,95 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <tds/hashtbl.h>
+#include <ta/hash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Lookups of present and absent keys at high load, in the default (group
+ * probing) mode and the robin hood mode
+ *
+ * Both tables have the same capacity and are filled up to just below the
+ * load factor of their expansion (0.75 and 0.9), and then to the same load.
+ * With `-Dtds_hashtbl_with_stats`, the mean and longest probing sequences of
+ * the misses are printed as well (in groups of 16 slots).
+ *
+ * Usage: ./cmp_hashtbl_robinhood.exe [log2 of the capacity]
+ */
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Mean length of the recorded probing sequences, the last bin is counted as
+ * `tds_hashtbl_stats_nbins` groups
+ */
+static double mean_probe(const struct tds_hashtbl_stats *stats)
+{
+	double sum = 0;
+	int i = 0;
+
+	if (0 == stats->nlookups)
+		return 0;
+	for (i = 0; i < tds_hashtbl_stats_nbins; i++)
+		sum += (double) (i + 1) * stats->probe_hist[i];
+	return sum / stats->nlookups;
+}
+
+static void bench(const char *name, int mode, size_t capacity, double load)
+{
+	size_t n = (size_t) (load * capacity);
+	size_t idx = 0;
+	size_t sink = 0;
+	size_t pair[2];
+	double start = 0;
+	double t_hit = 0;
+	double t_miss = 0;
+	struct tds_hashtbl_stats stats;
+	tds_hashtbl *tbl = tds_hashtbl_force_create_m(sizeof(pair), sizeof(size_t), \
+		capacity, ta_hash_wy, mode, NULL);
+
+	for (idx = 0; idx < n; idx++) {
+		pair[0] = idx;
+		pair[1] = idx;
+		tds_hashtbl_force_set(tbl, pair);
+	}
+	start = now_ns();
+	for (idx = 0; idx < n; idx++)
+		sink += *(size_t *) tds_hashtbl_get(tbl, &idx);
+	t_hit = (now_ns() - start) / n;
+
+	tds_hashtbl_reset_stats(tbl);
+	start = now_ns();
+	for (idx = n; idx < 2 * n; idx++)
+		sink += NULL == tds_hashtbl_get(tbl, &idx);
+	t_miss = (now_ns() - start) / n;
+	tds_hashtbl_stats(tbl, &stats);
+
+	printf("| %-9s | %4.2f | %8lu | %7.1f | %8.1f | %10.2f | %9lu |\n", name,
+		tds_hashtbl_load_factor(tbl), (unsigned long) tds_hashtbl_capacity(tbl), t_hit, t_miss,
+		mean_probe(&stats),
+		(unsigned long) stats.max_probe);
+	if (sink == 42)  /* keep the loops */
+		printf(" ");
+	tds_hashtbl_free(tbl);
+}
+
+int main(int argc, char **argv)
+{
+	size_t capacity = (size_t) 1 << 22;
+
+	if (argc > 1)
+		capacity = (size_t) 1 << atoi(argv[1]);
+
+	printf("| mode      | load | capacity | hit ns  | miss ns  | miss probe | max probe |\n");
+	printf("| --------- | ---- | -------- | ------- | -------- | ---------- | --------- |\n");
+	bench("default", 0, capacity, 0.74);
+	bench("robinhood", tds_hashtbl_mode_robinhood, capacity, 0.74);
+	bench("robinhood", tds_hashtbl_mode_robinhood, capacity, 0.89);
+	return 0;
+}
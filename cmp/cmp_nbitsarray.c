@@ -0,0 +1,63 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <tds/nbitsarray.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Throughput of decoding a whole n-bits array into 32-bit integers, one
+ * `tds_nbitsarray_get` at a time and by `tds_nbitsarray_decode`, and the
+ * memory against a plain `uint32_t` array
+ *
+ * Build with `-mavx2` (or `-march=native`) for the AVX2 kernel, and with
+ * `-Dtds_no_simd` for the portable loop.
+ *
+ * Usage: ./cmp_nbitsarray.exe [number of values] [rounds]
+ */
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t n = argc > 1 ? (size_t) atol(argv[1]) : 1000000;
+	size_t rounds = argc > 2 ? (size_t) atol(argv[2]) : 20;
+	uint32_t *out = (uint32_t *) malloc(n * sizeof(uint32_t));
+	int nbits = 0;
+
+	printf("| nbits | bytes / value | get (Mvalues/s) | decode (Mvalues/s) |\n");
+	printf("|-------|---------------|-----------------|--------------------|\n");
+	for (nbits = 3; nbits <= 20; nbits++) {
+		tds_nbitsarray *arr = tds_nbitsarray_force_create_g(nbits, n, NULL);
+		uint32_t mask = ((uint32_t) 1 << nbits) - 1;
+		uint32_t sink = 0;
+		double get_ns = 0, decode_ns = 0, start = 0;
+		size_t idx = 0, r = 0;
+
+		for (idx = 0; idx < n; idx++)
+			tds_nbitsarray_force_pushback(arr, (uint32_t) rand() & mask);
+		start = now_ns();
+		for (r = 0; r < rounds; r++)
+			for (idx = 0; idx < n; idx++)
+				out[idx] = tds_nbitsarray_get(arr, idx);
+		get_ns = now_ns() - start;
+		sink += out[n / 2];
+		start = now_ns();
+		for (r = 0; r < rounds; r++)
+			tds_nbitsarray_decode(arr, 0, n, out);
+		decode_ns = now_ns() - start;
+		sink += out[n / 3];
+		printf("| %5d | %13.3f | %15.1f | %18.1f |%s\n", nbits,
+			(double) nbits / 8, 1e3 * n * rounds / get_ns, 1e3 * n * rounds / decode_ns,
+			sink == 0xFFFFFFFF ? " " : "");
+		tds_nbitsarray_free(arr);
+	}
+	free(out);
+	return 0;
+}
@@ -0,0 +1,95 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <tds/roaring.h>
+#include <tds/bitarray.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Memory and intersection time of `tds_roaring` against a dense
+ * `tds_bitarray` over the same universe, for random values of several
+ * densities, and for runs after `tds_roaring_optimize`
+ *
+ * Usage: ./cmp_roaring.exe [log2 of the universe, at most 32]
+ */
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint64_t rand64(void)
+{
+	return ((uint64_t) rand() << 42) ^ ((uint64_t) rand() << 21) ^ (uint64_t) rand();
+}
+
+/* `n` random values of the universe, or runs of 1000 values
+ */
+static void fill(tds_roaring *r, tds_bitarray *bits, uint64_t universe, size_t n, int runs)
+{
+	size_t idx = 0;
+
+	for (idx = 0; idx < n; idx++) {
+		uint64_t v = runs ? (rand64() % (universe / 1000)) * 1000 : rand64() % universe;
+		uint64_t end = runs ? v + 1000 : v + 1;
+
+		for (; v < end; v++) {
+			tds_roaring_force_add(r, (uint32_t) v);
+			tds_bitarray_set(bits, (size_t) v, 1);
+		}
+	}
+	if (runs)
+		tds_roaring_optimize(r);
+}
+
+static void bench(uint64_t universe, double density, int runs)
+{
+	size_t n = (size_t) (density * universe) / (runs ? 1000 : 1);
+	tds_roaring *r1 = tds_roaring_force_create();
+	tds_roaring *r2 = tds_roaring_force_create();
+	tds_roaring *r = NULL;
+	tds_bitarray *b1 = tds_bitarray_force_create((size_t) universe);
+	tds_bitarray *b2 = tds_bitarray_force_create((size_t) universe);
+	double t_roaring = 0;
+	double t_bitarray = 0;
+	double start = 0;
+
+	fill(r1, b1, universe, n, runs);
+	fill(r2, b2, universe, n, runs);
+
+	start = now_ns();
+	r = tds_roaring_and(r1, r2);
+	t_roaring = now_ns() - start;
+	start = now_ns();
+	tds_bitarray_and_inplace(b1, b2);
+	t_bitarray = now_ns() - start;
+
+	printf("| %-4s | %8.5f | %12llu | %12.2f | %12.2f | %10.3f | %10.3f |\n", runs ? "runs" : "rand",
+		density, (unsigned long long) tds_roaring_cardinality(r1),
+		tds_roaring_bytes(r1) / 1024.0, universe / 8 / 1024.0, t_roaring / 1e6, t_bitarray / 1e6);
+	tds_roaring_free(r);
+	tds_roaring_free(r1);
+	tds_roaring_free(r2);
+	tds_bitarray_free(b1);
+	tds_bitarray_free(b2);
+}
+
+int main(int argc, char *argv[])
+{
+	int log2 = argc > 1 ? atoi(argv[1]) : 28;
+	uint64_t universe = (uint64_t) 1 << log2;
+
+	printf("| %-4s | %8s | %12s | %12s | %12s | %10s | %10s |\n", "", "density", "values",
+		"roaring KB", "bitarray KB", "and ms", "bits and ms");
+	printf("|------|----------|--------------|--------------|--------------|------------|------------|\n");
+	bench(universe, 0.00001, 0);
+	bench(universe, 0.0001, 0);
+	bench(universe, 0.001, 0);
+	bench(universe, 0.1, 0);
+	bench(universe, 0.01, 1);
+	return 0;
+}
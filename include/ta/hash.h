@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#ifndef TA_HASH_H
+#define TA_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tds.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Hashing Algorithms
+ *
+ * Including the byte-wise polynomial hash and a word-at-a-time mixer. All of
+ * them match the signature `tds_fhash_t`, so that they can be plugged into
+ * hash based containers.
+ *****************************************************************************/
+
+/* The base used by the polynomial hash, see the table in `src/ta_hash.c`
+ */
+#define ta_hash_poly_base  367
+
+/* Polynomial hash that walks the key one byte at a time,
+ * 	code = (code + (p[i] + 1)) * base
+ *
+ * The `_seed` is used as the base, hence it should be a prime. The quality
+ * collapses for some bases (127, 257, 383, ...).
+ *
+ * Time: O(N) multiplications for a N-byte key
+ */
+uint64_t ta_hash_poly(const void *key, size_t len, uint64_t base);
+
+/* Word-at-a-time hash of the wyhash family. The key is consumed 8 or 16
+ * bytes per step and every step is folded by a 64x64 -> 128 bits multiply.
+ *
+ * Time: O(N/16) multiplications for a N-byte key
+ */
+uint64_t ta_hash_wy(const void *key, size_t len, uint64_t seed);
+
+/* Mix a single 64-bit integer, equivalent to hashing its 8 bytes but without
+ * reading memory
+ */
+uint64_t ta_hash_u64(uint64_t key, uint64_t seed);
+
+/* Return a random seed
+ *
+ * A random base is read once, from `/dev/urandom` when available, otherwise
+ * mixed from the clock and the stack address. Each seed mixes it with a
+ * process-wide atomic counter, without a system call. Thread-safe.
+ */
+uint64_t ta_hash_seed(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
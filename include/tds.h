@@ -5,6 +5,9 @@
 #ifndef TDS_H
 #define TDS_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -18,6 +21,14 @@ extern "C" {
  */
 typedef int tds_fcmp_t(const void *_a, const void *_b);
 
+/* Hashing function
+ *
+ * Assumption:
+ * 	- read exactly `_len` bytes from `_key`
+ * 	- equal keys and equal `_seed` give equal codes
+ */
+typedef uint64_t tds_fhash_t(const void *_key, size_t _len, uint64_t _seed);
+
 #define tds_ABS(a)  (((a) > 0) ? (a) : (-(a)))
 #define tds_MAX(a, b) (((a) > (b)) ? (a) : (b))
 #define tds_MIN(a, b) (((a) < (b)) ? (a) : (b))
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#ifndef TDS_ALLOCATOR_H
+#define TDS_ALLOCATOR_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Allocator
+ *
+ * The memory of a container comes from the allocator given to its `_create_g`
+ * (or `_create_h`) constructor, a NULL allocator being the C library
+ * (`malloc`, `realloc` and `free`). The other constructors use the C
+ * library.
+ *
+ * The allocator is referred to, not copied: it must outlive the containers
+ * created with it. Containers created by a container (the result of a set
+ * operation, a copy, the blocks of a deque, ...) use the same allocator. The
+ * allocator of a container shared by threads must be thread-safe.
+ *****************************************************************************/
+
+/* Allocation functions, `_ctx` is the `ctx` of the allocator
+ *
+ * 	- `tds_falloc_t` returns `_size` bytes aligned as `malloc` does, or
+ * 	  NULL on failure
+ * 	- `tds_frealloc_t` resizes the block `_ptr` of `_old_size` bytes as
+ * 	  `realloc` does, the block is kept on failure
+ * 	- `tds_ffree_t` releases the block `_ptr` of `_size` bytes
+ */
+typedef void *tds_falloc_t(void *_ctx, size_t _size);
+typedef void *tds_frealloc_t(void *_ctx, void *_ptr, size_t _old_size, size_t _new_size);
+typedef void tds_ffree_t(void *_ctx, void *_ptr, size_t _size);
+
+/* `frealloc` can be NULL: a block is resized by `falloc`, a copy and
+ * `ffree`. `ffree` can be NULL: the blocks are released by the owner of the
+ * allocator (an arena for instance) rather than one by one.
+ */
+typedef struct tds_allocator {
+	tds_falloc_t *falloc;
+	tds_frealloc_t *frealloc;
+	tds_ffree_t *ffree;
+	void *ctx;
+} tds_allocator;
+
+/* The C library allocator
+ */
+const tds_allocator *tds_allocator_libc(void);
+
+/* Allocate, resize and release through `alloc`, the C library if NULL
+ *
+ * `tds_allocator_calloc` returns zeroed bytes: with the C library, by
+ * `calloc`, so that large blocks come from fresh zero pages, which are not
+ * touched until they are used.
+ */
+void *tds_allocator_alloc(const tds_allocator *alloc, size_t size);
+void *tds_allocator_calloc(const tds_allocator *alloc, size_t size);
+void *tds_allocator_realloc(const tds_allocator *alloc, void *ptr, size_t old_size, size_t new_size);
+void tds_allocator_free(const tds_allocator *alloc, void *ptr, size_t size);
+
+/* Whether the blocks are released one by one, false if `ffree` is NULL: the
+ * containers then skip the walk over their nodes when they are freed
+ */
+int tds_allocator_frees(const tds_allocator *alloc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#ifndef TDS_ARENA_H
+#define TDS_ARENA_H
+
+#include <stddef.h>
+#include <tds/allocator.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Arena
+ *
+ * A bump allocator: blocks are cut one after the other from large chunks and
+ * are never released one by one, but all together by `tds_arena_reset` (or
+ * those allocated after a mark by `tds_arena_rewind`). For the containers
+ * of a short task (a request, a frame, a parse), which then cost no call to
+ * `malloc` per node, and no walk over their nodes when freed.
+ *
+ * `tds_arena_allocator` gives the arena as a `tds_allocator` (whose `ffree`
+ * is NULL) to the `_create_g` constructors. A container created in an arena
+ * must not be used after the arena is reset, rewound before the container
+ * was created, or freed; calling its `_free` is optional.
+ *
+ * Blocks are aligned as `malloc` does. The chunks come from the allocator
+ * given to `tds_arena_create_g`, and are kept by a reset or a rewind for the
+ * next allocations, until the arena is freed. An arena is not thread-safe.
+ *****************************************************************************/
+
+typedef struct tds_arena  tds_arena;
+
+/* A position in an arena, returned by `tds_arena_mark`
+ */
+typedef struct tds_arenamark {
+	void *__chunk;
+	size_t __used;
+} tds_arenamark;
+
+/* On failure, return NULL pointer
+ * `chunk_size` is the size of the chunks (larger blocks get a chunk of
+ * their own), the memory of the chunks comes from `alloc`, the C library if
+ * NULL (see `tds/allocator.h`)
+ */
+tds_arena *tds_arena_create(void);
+tds_arena *tds_arena_create_g(size_t chunk_size, const tds_allocator *alloc);
+
+/* On failure, exit the program
+ */
+tds_arena *tds_arena_force_create(void);
+tds_arena *tds_arena_force_create_g(size_t chunk_size, const tds_allocator *alloc);
+
+/* Release all chunks, and so every block of the arena
+ */
+void tds_arena_free(tds_arena *arena);
+
+/* The arena as an allocator, valid until the arena is freed
+ */
+const tds_allocator *tds_arena_allocator(tds_arena *arena);
+
+/* Allocate `size` bytes
+ * On failure, return NULL pointer
+ */
+void *tds_arena_alloc(tds_arena *arena, size_t size);
+
+/* Resize the block `ptr` of `old_size` bytes, in place if it is the last
+ * block allocated and its chunk has room
+ * On failure, return NULL pointer, the block is kept
+ */
+void *tds_arena_realloc(tds_arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+/* Mark & rewind
+ *
+ * `tds_arena_rewind` releases the blocks allocated after `mark` was taken.
+ * The marks taken after `mark` are no longer valid.
+ */
+tds_arenamark tds_arena_mark(const tds_arena *arena);
+void tds_arena_rewind(tds_arena *arena, tds_arenamark mark);
+
+/* Release every block, the chunks are kept
+ */
+void tds_arena_reset(tds_arena *arena);
+
+/* Statistics
+ *
+ * 	- `tds_arena_used`: bytes in the blocks, alignment included
+ * 	- `tds_arena_capacity`: bytes in the chunks, in use or kept
+ */
+size_t tds_arena_used(const tds_arena *arena);
+size_t tds_arena_capacity(const tds_arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,6 +6,7 @@
 #define TDS_ARRAY_H
 
 #include <stddef.h>
+#include <tds/allocator.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,6 +36,16 @@ void tds_array_force_resize(tds_array **arr, size_t new_capacity);
 
 void tds_array_free(tds_array *arr);
 
+/* The same with the memory of `alloc` (see `tds/allocator.h`)
+ *
+ * An array does not keep its allocator: an array created by
+ * `tds_array_create_g` must be resized and freed by `tds_array_resize_g` and
+ * `tds_array_free_g` with the same allocator.
+ */
+tds_array *tds_array_create_g(size_t elesize, size_t capacity, const tds_allocator *alloc);
+int tds_array_resize_g(tds_array **arr, size_t new_capacity, const tds_allocator *alloc);
+void tds_array_free_g(tds_array *arr, const tds_allocator *alloc);
+
 void * tds_array_data(const tds_array *arr);
 size_t tds_array_elesize(const tds_array *arr);
 size_t tds_array_capacity(const tds_array *arr);
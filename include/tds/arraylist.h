@@ -6,6 +6,7 @@
 #define TDS_ARRAYLIST_H
 
 #include <stddef.h>
+#include <tds/allocator.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,8 +29,9 @@ tds_arraylist *tds_arraylist_create(size_t elesize);
 /* On failure, return `NULL`
  * The initial capacity is at least `tds_arraylist_init_len`, greater
  * 	or equal to the input `capacity`
+ * The memory comes from `alloc`, the C library if NULL (see `tds/allocator.h`)
  */
-tds_arraylist *tds_arraylist_create_g(size_t elesize, size_t capacity);
+tds_arraylist *tds_arraylist_create_g(size_t elesize, size_t capacity, const tds_allocator *alloc);
 
 /* On failure, the program is stopped
  */
@@ -37,7 +39,7 @@ tds_arraylist *tds_arraylist_force_create(size_t elesize);
 
 /* On failure, the program is stopped
  */
-tds_arraylist *tds_arraylist_force_create_g(size_t elesize, size_t capacity);
+tds_arraylist *tds_arraylist_force_create_g(size_t elesize, size_t capacity, const tds_allocator *alloc);
 
 void tds_arraylist_free(tds_arraylist *list);
 
@@ -50,6 +52,11 @@ void tds_arraylist_set(tds_arraylist *list, size_t loc, const void *ele);
 void *tds_arraylist_getback(const tds_arraylist *list);
 void tds_arraylist_setback(tds_arraylist *list, const void *ele);
 
+/* Expand the capacity (by doubling) to hold at least `capacity` elements
+ * Return a bool indicating the success
+ */
+int tds_arraylist_reserve(tds_arraylist *list, size_t capacity);
+
 /* Shadow copy contents of the pointer `ele` into `list`
  * Return a bool indicating the success
  */
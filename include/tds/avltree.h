@@ -7,6 +7,7 @@
 
 #include <stddef.h>
 #include <tds.h>
+#include <tds/allocator.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,9 +23,22 @@ typedef struct tds_avltree  tds_avltree;
 typedef struct tds_avltreenode  tds_avltreeiter;
 
 tds_avltree *tds_avltree_create(size_t elesize);
-tds_avltree *tds_avltree_create_g(size_t elesize, size_t bufferlim);
+
+/* The memory comes from `alloc`, the C library if NULL (see `tds/allocator.h`)
+ * If `alloc` does not free (an arena), `tds_avltree_free` leaves the
+ * nodes to it and returns at once
+ *
+ * The nodes are allocated by slabs (see `tds/pool.h`), the nodes deleted are
+ * buffered for the next insertions. Above `bufferlim` buffered nodes, the
+ * slabs with no node in the tree are released.
+ */
+tds_avltree *tds_avltree_create_g(size_t elesize, size_t bufferlim, const tds_allocator *alloc);
 
 void tds_avltree_free(tds_avltree *tree);
+
+/* Release the slabs with no node in the tree, the buffered nodes of the
+ * other slabs are kept
+ */
 void tds_avltree_free_buffer(tds_avltree *tree);
 
 size_t tds_avltree_len(const tds_avltree *tree);
@@ -6,6 +6,7 @@
 #define TDS_BITARRAY_H
 
 #include <stddef.h>
+#include <tds/allocator.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,22 +17,40 @@ extern "C" {
  *
  * Bit array, also known as a bit vector or bitset, is a data structure that
  * compactly stores bits (binary values of 0 and 1)
+ *
+ * The bits are stored in 64-bit words: bit `i` is the bit `i % 64` (counted
+ * from the least significant) of the word `i / 64`. The capacity is a multiple
+ * of 64 and the bulk operations run on whole words, with SIMD when available.
+ *
+ * A bit array is not thread-safe, even for threads writing different bits of
+ * the same word: see `tds_cbitarray` for the concurrent bit array.
  *****************************************************************************/
 
 typedef struct tds_bitarray  tds_bitarray;
+typedef struct tds_bitarray_index  tds_bitarray_index;
+
+/* Visitor of a set bit at the location `_loc`, return 0 to stop the iteration
+ */
+typedef int tds_bitarray_fvisit_t(size_t _loc, void *_ctx);
 
 /* On failure, return NULL pointer
  * On success, the whole array initialized as 0
+ * The memory of `tds_bitarray_create_g` comes from `alloc`, the C library if
+ * NULL (see `tds/allocator.h`), so does the memory of its indexes
  */
 tds_bitarray *tds_bitarray_create(size_t capacity);
+tds_bitarray *tds_bitarray_create_g(size_t capacity, const tds_allocator *alloc);
 
 /* On failure, exit the program
  * On success, the whole array initialized as 0
  */
 tds_bitarray *tds_bitarray_force_create(size_t capacity);
+tds_bitarray *tds_bitarray_force_create_g(size_t capacity, const tds_allocator *alloc);
 
 void tds_bitarray_free(tds_bitarray *arr);
 
+/* The `tds_bitarray_capacity(arr) / 64` words of the array
+ */
 void *tds_bitarray_data(const tds_bitarray *arr);
 size_t tds_bitarray_capacity(const tds_bitarray *arr);
 void tds_bitarray_print(const tds_bitarray *arr);
@@ -48,14 +67,84 @@ int tds_bitarray_get(const tds_bitarray *arr, size_t loc);
  */
 void tds_bitarray_set(tds_bitarray *arr, size_t loc, int b);
 
+/* Bulk operations, the arrays must have the same capacity
+ *
+ * On failure, return NULL pointer
+ * On success, return a new array
+ */
 tds_bitarray *tds_bitarray_and(const tds_bitarray *arr1, const tds_bitarray *arr2);
 tds_bitarray *tds_bitarray_or(const tds_bitarray *arr1, const tds_bitarray *arr2);
 tds_bitarray *tds_bitarray_xor(const tds_bitarray *arr1, const tds_bitarray *arr2);
 tds_bitarray *tds_bitarray_not(const tds_bitarray *arr);
 
+/* In-place bulk operations, `dst = dst op src` without any allocation
+ */
+void tds_bitarray_and_inplace(tds_bitarray *dst, const tds_bitarray *src);
+void tds_bitarray_or_inplace(tds_bitarray *dst, const tds_bitarray *src);
+void tds_bitarray_xor_inplace(tds_bitarray *dst, const tds_bitarray *src);
+void tds_bitarray_not_inplace(tds_bitarray *arr);
+
+/* A larger `new_capacity` at least doubles the capacity, the new bits are 0
+ */
 int tds_bitarray_resize(tds_bitarray **arr, size_t new_capacity);
 void tds_bitarray_force_resize(tds_bitarray **arr, size_t new_capacity);
 
+/* Number of bits set
+ */
+size_t tds_bitarray_popcount(const tds_bitarray *arr);
+
+/* Rank/select index of an array, about 3% of its size
+ *
+ * The index holds the number of bits set before every block of 512 bits. It
+ * describes the array when it is created: after the array is modified, the
+ * index must be created again.
+ */
+tds_bitarray_index *tds_bitarray_index_create(const tds_bitarray *arr);
+tds_bitarray_index *tds_bitarray_force_index_create(const tds_bitarray *arr);
+void tds_bitarray_index_free(tds_bitarray_index *index);
+
+/* Rank & select, `index` is either NULL or an index of `arr`
+ *
+ * 	- rank1:   number of bits set before the location `loc`, in
+ * 	           [0, capacity]
+ * 	- select1: location of the `k`-th (from 0) bit set, or the capacity
+ * 	           if fewer bits are set
+ *
+ * Without index both scan the words from the start. With it, rank1 counts
+ * at most one block and select1 binary searches the block counts.
+ */
+size_t tds_bitarray_rank1(const tds_bitarray *arr, const tds_bitarray_index *index, size_t loc);
+size_t tds_bitarray_select1(const tds_bitarray *arr, const tds_bitarray_index *index, size_t k);
+
+/* Location of the first bit set (or unset) at or after `from`, or the
+ * capacity if there is none
+ *
+ * The set bits can be iterated by
+ *
+ * 	size_t loc;
+ * 	for (loc = tds_bitarray_find_next_set(arr, 0);
+ * 	     loc < tds_bitarray_capacity(arr);
+ * 	     loc = tds_bitarray_find_next_set(arr, loc + 1))
+ * 		...
+ */
+size_t tds_bitarray_find_next_set(const tds_bitarray *arr, size_t from);
+size_t tds_bitarray_find_next_unset(const tds_bitarray *arr, size_t from);
+
+/* Call `visit(loc, ctx)` on the set bits in increasing order until it returns
+ * 0, the array must not be modified by `visit`
+ */
+void tds_bitarray_foreach_set(const tds_bitarray *arr, tds_bitarray_fvisit_t *visit, void *ctx);
+
+/* Operations on the bits [from, to), `from` <= `to` <= capacity
+ *
+ * 	- set_range:   assign them as 1
+ * 	- clear_range: assign them as 0
+ * 	- count_range: number of them set
+ */
+void tds_bitarray_set_range(tds_bitarray *arr, size_t from, size_t to);
+void tds_bitarray_clear_range(tds_bitarray *arr, size_t from, size_t to);
+size_t tds_bitarray_count_range(const tds_bitarray *arr, size_t from, size_t to);
+
 #ifdef __cplusplus
 }
 #endif
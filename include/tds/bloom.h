@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#ifndef TDS_BLOOM_H
+#define TDS_BLOOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tds/allocator.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Blocked Bloom Filter
+ *
+ * A Bloom filter answers whether a key may have been inserted: "no" is
+ * always right, "maybe" is wrong with a small false positive probability.
+ * It is used to skip most lookups of absent keys before probing a table or
+ * going to disk.
+ *
+ * The bits are stored in a `tds_bitarray` cut into blocks of 64 bytes (one
+ * cache line). All `k` bits of a key are in one block, so that an insertion
+ * or a query touches a single cache line. The key is hashed once into 64
+ * bits, which select the block and derive the `k` bit positions.
+ *****************************************************************************/
+
+typedef struct tds_bloom  tds_bloom;
+
+/* Size of a block in bits
+ */
+#define tds_bloom_block_bits  512
+
+/* Sized for `nkeys` keys at the false positive probability `fpp`
+ *
+ * Note
+ * 	- the blocked layout costs a little accuracy: the actual probability
+ * 	  is somewhat above `fpp`, more so for `fpp` below 0.1%
+ * 	- the seed is fixed, so that filters of the same `nkeys` and `fpp`
+ * 	  can be merged by `tds_bloom_union`
+ */
+tds_bloom *tds_bloom_create(size_t nkeys, double fpp);
+tds_bloom *tds_bloom_force_create(size_t nkeys, double fpp);
+
+/* At least `nbits` bits (rounded up to whole blocks), `k` bits per key in
+ * [1, 16], the `seed` of the hash function, and the memory from `alloc`, the
+ * C library if NULL (see `tds/allocator.h`)
+ */
+tds_bloom *tds_bloom_create_g(size_t nbits, int k, uint64_t seed, const tds_allocator *alloc);
+tds_bloom *tds_bloom_force_create_g(size_t nbits, int k, uint64_t seed, const tds_allocator *alloc);
+
+void tds_bloom_free(tds_bloom *bloom);
+
+size_t tds_bloom_nbits(const tds_bloom *bloom);
+int tds_bloom_nhashes(const tds_bloom *bloom);
+
+/* Remove all keys
+ */
+void tds_bloom_clear(tds_bloom *bloom);
+
+/* Insert or query the key of `len` bytes
+ *
+ * `tds_bloom_query` returns 0 if the key was never inserted, 1 if it may
+ * have been
+ */
+void tds_bloom_insert(tds_bloom *bloom, const void *key, size_t len);
+int tds_bloom_query(const tds_bloom *bloom, const void *key, size_t len);
+
+/* Batched operations on `n` contiguous keys of `keysize` bytes, equivalent
+ * to calling `insert` or `query` on each key, but the blocks of several keys
+ * are prefetched at once
+ *
+ * The answer of the i-th key is assigned to `out[i]`.
+ */
+void tds_bloom_insert_batch(tds_bloom *bloom, const void *keys, size_t keysize, size_t n);
+void tds_bloom_query_batch(const tds_bloom *bloom, const void *keys, size_t keysize, size_t n, int *out);
+
+/* Merge the keys of `src` into `dst` by OR-ing the bits
+ * Return a bool indicating success, the filters must have the same number of
+ * bits, `k` and seed
+ */
+int tds_bloom_union(tds_bloom *dst, const tds_bloom *src);
+
+/* Serialized form
+ *
+ * 	- `tds_bloom_serialized_size` returns the bytes written by
+ * 	  `tds_bloom_serialize` into `buf`
+ * 	- `tds_bloom_deserialize` creates a filter from `len` bytes, or
+ * 	  returns NULL if they are not a serialized filter
+ * 	- the header is in native byte order, the bits are independent of
+ * 	  the machine
+ */
+size_t tds_bloom_serialized_size(const tds_bloom *bloom);
+void tds_bloom_serialize(const tds_bloom *bloom, void *buf);
+tds_bloom *tds_bloom_deserialize(const void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
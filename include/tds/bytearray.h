@@ -6,6 +6,8 @@
 #define TDS_BYTEARRAY_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <tds/allocator.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,9 +16,113 @@ extern "C" {
 /******************************************************************************
  * Byte Array
  *
+ * A growable buffer of bytes for building binary data (packets, file
+ * blocks, serialized forms). Unlike `tds_string`, the bytes are never
+ * scanned nor terminated, so that they may hold any value, `\0` included.
  *
+ * Integers are written and read byte by byte in the order asked for, the
+ * result is the same on every machine:
+ *
+ * 	- `_le` / `_be`: the lowest `nbytes` (1 to 8) bytes of the value,
+ * 	  little-endian / big-endian
+ * 	- `varint`: unsigned LEB128, 7 bits per byte with the lowest first, 1
+ * 	  to 10 bytes
+ * 	- `svarint`: a signed value mapped to the varint of its zigzag code
+ * 	  (0, -1, 1, -2, ... as 0, 1, 2, 3, ...)
+ *
+ * A slice (`tds_byteslice`) is a view of bytes owned by someone else: a byte
+ * array, or any buffer given to `tds_byteslice_make`. A slice of a byte
+ * array is valid until the array is modified by a call that may grow it.
  *****************************************************************************/
 
+typedef struct tds_bytearray  tds_bytearray;
+
+typedef struct tds_byteslice {
+	const unsigned char *data;
+	size_t len;
+} tds_byteslice;
+
+/* On failure, return NULL pointer
+ * The memory of `tds_bytearray_create_g` comes from `alloc`, the C library if
+ * NULL (see `tds/allocator.h`)
+ */
+tds_bytearray *tds_bytearray_create(void);
+tds_bytearray *tds_bytearray_create_g(size_t capacity, const tds_allocator *alloc);
+
+/* On failure, exit the program
+ */
+tds_bytearray *tds_bytearray_force_create(void);
+tds_bytearray *tds_bytearray_force_create_g(size_t capacity, const tds_allocator *alloc);
+
+void tds_bytearray_free(tds_bytearray *arr);
+
+/* Remove all bytes, the capacity is kept
+ */
+void tds_bytearray_clear(tds_bytearray *arr);
+
+size_t tds_bytearray_len(const tds_bytearray *arr);
+size_t tds_bytearray_capacity(const tds_bytearray *arr);
+unsigned char *tds_bytearray_data(const tds_bytearray *arr);
+
+/* Expand the capacity (by doubling) to hold at least `capacity` bytes
+ * Return a bool indicating the success
+ */
+int tds_bytearray_reserve(tds_bytearray *arr, size_t capacity);
+
+/* Append `n` bytes left uninitialized, to be written in place (by `fread`
+ * for instance)
+ * On failure, return NULL pointer
+ * On success, return the first of the new bytes
+ */
+unsigned char *tds_bytearray_extend(tds_bytearray *arr, size_t n);
+
+/* Appending
+ * Return a bool indicating the success
+ */
+int tds_bytearray_append(tds_bytearray *arr, const void *bytes, size_t n);
+int tds_bytearray_put_le(tds_bytearray *arr, uint64_t value, size_t nbytes);
+int tds_bytearray_put_be(tds_bytearray *arr, uint64_t value, size_t nbytes);
+int tds_bytearray_put_varint(tds_bytearray *arr, uint64_t value);
+int tds_bytearray_put_svarint(tds_bytearray *arr, int64_t value);
+
+/* On failure, exit the program
+ */
+unsigned char *tds_bytearray_force_extend(tds_bytearray *arr, size_t n);
+void tds_bytearray_force_append(tds_bytearray *arr, const void *bytes, size_t n);
+void tds_bytearray_force_put_le(tds_bytearray *arr, uint64_t value, size_t nbytes);
+void tds_bytearray_force_put_be(tds_bytearray *arr, uint64_t value, size_t nbytes);
+void tds_bytearray_force_put_varint(tds_bytearray *arr, uint64_t value);
+void tds_bytearray_force_put_svarint(tds_bytearray *arr, int64_t value);
+
+/* Overwrite the bytes [pos, pos + nbytes), which must be in the array (for a
+ * length field written before its contents, for instance)
+ */
+void tds_bytearray_set_le(tds_bytearray *arr, size_t pos, uint64_t value, size_t nbytes);
+void tds_bytearray_set_be(tds_bytearray *arr, size_t pos, uint64_t value, size_t nbytes);
+
+/* The bytes [pos, pos + n) of the array, `pos + n` <= len
+ */
+tds_byteslice tds_bytearray_slice(const tds_bytearray *arr, size_t pos, size_t n);
+
+/* Slices
+ *
+ * 	- `tds_byteslice_make` views the `len` bytes at `data`
+ * 	- `tds_byteslice_sub` views the bytes [pos, pos + n) of `s`
+ */
+tds_byteslice tds_byteslice_make(const void *data, size_t len);
+tds_byteslice tds_byteslice_sub(tds_byteslice s, size_t pos, size_t n);
+
+/* Reading the bytes of `s` from `pos`
+ *
+ * 	- `get_le` / `get_be` read `nbytes` bytes, `pos + nbytes` <= `s.len`
+ * 	- `get_varint` / `get_svarint` return the number of bytes read into
+ * 	  `value`, or 0 if the bytes from `pos` are not a varint (truncated,
+ * 	  longer than 10 bytes or above 64 bits)
+ */
+uint64_t tds_byteslice_get_le(tds_byteslice s, size_t pos, size_t nbytes);
+uint64_t tds_byteslice_get_be(tds_byteslice s, size_t pos, size_t nbytes);
+size_t tds_byteslice_get_varint(tds_byteslice s, size_t pos, uint64_t *value);
+size_t tds_byteslice_get_svarint(tds_byteslice s, size_t pos, int64_t *value);
 
 #ifdef __cplusplus
 }
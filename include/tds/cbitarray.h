@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#ifndef TDS_CBITARRAY_H
+#define TDS_CBITARRAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tds/allocator.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Concurrent Bit Array
+ *
+ * A bit array of the same layout as `tds_bitarray` (bit `i` is the bit
+ * `i % 64` of the word `i / 64`, the capacity is a multiple of 64) that can be
+ * shared by threads without external locking. Every word is atomic, so that
+ * threads writing any bits, the same word or not, never lose an update.
+ *
+ * Typical use is an occupancy bitmap of a shared pool: a thread reserves a
+ * slot by `tds_cbitarray_claim` and returns it by `tds_cbitarray_release`,
+ * both lock-free. Claiming takes the acquire order and releasing the release
+ * order, so that what a thread wrote into a slot before releasing it is seen
+ * by the next thread claiming it.
+ *****************************************************************************/
+
+typedef struct tds_cbitarray  tds_cbitarray;
+
+/* On failure, return NULL pointer
+ * On success, the whole array initialized as 0
+ *
+ * Creation and `tds_cbitarray_free` are not thread-safe
+ * The memory of `tds_cbitarray_create_g` comes from `alloc`, the C library if
+ * NULL (see `tds/allocator.h`)
+ */
+tds_cbitarray *tds_cbitarray_create(size_t capacity);
+tds_cbitarray *tds_cbitarray_create_g(size_t capacity, const tds_allocator *alloc);
+
+/* On failure, exit the program
+ */
+tds_cbitarray *tds_cbitarray_force_create(size_t capacity);
+tds_cbitarray *tds_cbitarray_force_create_g(size_t capacity, const tds_allocator *alloc);
+
+void tds_cbitarray_free(tds_cbitarray *arr);
+
+size_t tds_cbitarray_capacity(const tds_cbitarray *arr);
+
+/* Output is either 0 or 1
+ */
+int tds_cbitarray_get(const tds_cbitarray *arr, size_t loc);
+
+/* Input `b` is either 0 or 1
+ */
+void tds_cbitarray_set(tds_cbitarray *arr, size_t loc, int b);
+
+/* Set (clear) the bit at `loc` and return its former value
+ */
+int tds_cbitarray_test_and_set(tds_cbitarray *arr, size_t loc);
+int tds_cbitarray_test_and_clear(tds_cbitarray *arr, size_t loc);
+
+/* Whole-word operations on the word `iword` < capacity / 64
+ * Return the former word
+ */
+uint64_t tds_cbitarray_load_word(const tds_cbitarray *arr, size_t iword);
+uint64_t tds_cbitarray_fetch_or(tds_cbitarray *arr, size_t iword, uint64_t mask);
+uint64_t tds_cbitarray_fetch_and(tds_cbitarray *arr, size_t iword, uint64_t mask);
+
+/* Set a bit that was 0 and return its location, or the capacity if every bit
+ * is 1
+ *
+ * The search starts at the word of the last claim, so that a pool filling up
+ * does not scan its full prefix again. A thread that loses a bit to another
+ * thread moves to the next 0 of the same word.
+ */
+size_t tds_cbitarray_claim(tds_cbitarray *arr);
+
+/* Clear the bit at `loc`, which must be 1
+ */
+void tds_cbitarray_release(tds_cbitarray *arr, size_t loc);
+
+/* Number of bits set, exact only when no writer is running
+ */
+size_t tds_cbitarray_popcount(const tds_cbitarray *arr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
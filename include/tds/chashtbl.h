@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#ifndef TDS_CHASHTBL
+#define TDS_CHASHTBL
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tds.h>
+#include <tds/allocator.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Concurrent Hash Table
+ *
+ * A hash table of the same pair/keysize model as `tds_hashtbl` that can be
+ * shared by threads without external locking.
+ *
+ * The table is split into a fixed number of segments by the highest bits of
+ * the hash code. Each segment is an independent open-addressing table with
+ * a spin lock taken by writers (`set`, `rm`), so that writers of different
+ * segments never wait for each other.
+ *
+ * Readers (`get`, `contains`) take no lock and are lock-free: a reader never
+ * waits for a writer, even a preempted one, it only retries after a writer
+ * made progress: a write to the slot being read, or a new epoch (see below)
+ * while the reader registers. Each slot holds
+ * two copies of its pair and a version: a writer fills the copy that is not
+ * in use, then publishes it by bumping the version. All the words of the
+ * slots are atomics, so there is no data race for a race detector to report.
+ * In return a slot takes `2 * (8 + pairsize rounded up to 8) + 9` bytes.
+ *
+ * Deletion leaves a tombstone, so pairs never move while readers probe.
+ *
+ * Resizing is per segment and done by the writer that fills it, either to
+ * grow or to drop the tombstones: the pairs are copied into a new buffer
+ * while readers keep probing the old one, then the buffer pointer is
+ * swapped. Readers register in a per-segment counter of the current epoch,
+ * their only write to shared memory, and an old buffer is freed by a later writer once the readers of the epoch
+ * it was replaced in are gone.
+ *****************************************************************************/
+
+typedef struct tds_chashtbl  tds_chashtbl;
+
+/* The first `keysize` bytes of the pair struct must be hash-able
+ *
+ * Note
+ * 	- by default keys are hashed by `ta_hash_wy` (see `ta/hash.h`)
+ * 	- `_fhash` replaces the default hash function
+ * 	- creation and `tds_chashtbl_free` are not thread-safe
+ * 	- the memory comes from `alloc`, the C library if NULL (see
+ * 	  `tds/allocator.h`), which must be thread-safe: buffers are allocated
+ * 	  by the writers of any segment
+ */
+
+tds_chashtbl *tds_chashtbl_create_h(size_t pairsize, size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc);
+tds_chashtbl *tds_chashtbl_force_create_h(size_t pairsize, size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc);
+tds_chashtbl *tds_chashtbl_create_g(size_t pairsize, size_t keysize, size_t init_capacity, const tds_allocator *alloc);
+tds_chashtbl *tds_chashtbl_force_create_g(size_t pairsize, size_t keysize, size_t init_capacity, const tds_allocator *alloc);
+tds_chashtbl *tds_chashtbl_create(size_t pairsize, size_t keysize);
+tds_chashtbl *tds_chashtbl_force_create(size_t pairsize, size_t keysize);
+void tds_chashtbl_free(tds_chashtbl *tbl);
+
+/* Statistics, exact only when no writer is running
+ */
+size_t tds_chashtbl_usage(const tds_chashtbl *tbl);
+size_t tds_chashtbl_capacity(const tds_chashtbl *tbl);
+double tds_chashtbl_load_factor(const tds_chashtbl *tbl);
+
+/* Copy the pair of `key` into `pair`
+ * Return a boolean indicating whether the key is found
+ *
+ * Note
+ * 	- lock-free, see above: no lock is taken and writers are not waited for
+ * 	- the pair is copied since a pointer into the table could be
+ * 	  invalidated by a concurrent writer at any time
+ * 	- `pair` can be NULL to only test the membership
+ */
+int tds_chashtbl_get(const tds_chashtbl *tbl, const void *key, void *pair);
+
+/* Return a boolean
+ */
+int tds_chashtbl_contains(const tds_chashtbl *tbl, const void *key);
+
+/* Return a bool indicating success
+ *
+ * Note
+ * 	- the `pair` can be existing or new
+ */
+int tds_chashtbl_set(tds_chashtbl *tbl, const void *pair);
+
+/* On failure, exit the program
+ */
+void tds_chashtbl_force_set(tds_chashtbl *tbl, const void *pair);
+
+/* Remove the pair of `key`
+ * Return a boolean indicating whether the key was found
+ */
+int tds_chashtbl_rm(tds_chashtbl *tbl, const void *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
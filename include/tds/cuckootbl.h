@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#ifndef TDS_CUCKOOTBL
+#define TDS_CUCKOOTBL
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tds.h>
+#include <tds/allocator.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Cuckoo Hash Table
+ *
+ * A hash table of the same pair/keysize model as `tds_hashtbl` whose lookups
+ * have a bounded cost: a key can only be in one of its two buckets (or in a
+ * small stash), so that `get` reads at most two buckets whatever the load.
+ *
+ * 	- each bucket holds 4 or 8 slots (ways), their 1-byte fingerprints
+ * 	  first and then the pairs, in one contiguous block padded to whole
+ * 	  cache lines (64 bytes) and aligned to a cache line
+ * 	- the two buckets of a key are derived from the two halves of its 64-bit
+ * 	  hash code
+ * 	- an insertion into two full buckets searches, breadth first, the
+ * 	  shortest chain of pairs to move to their other bucket
+ * 	- a pair that finds no chain goes to the stash of 8 pairs, the table
+ * 	  is expanded when the stash is full
+ *
+ * Lookups are faster to bound than `tds_hashtbl`, insertions are slower at
+ * high load. The load factor reaches about 0.95 with 4 ways, 0.98 with 8.
+ *
+ * Cost of a `get` in cache lines
+ *
+ * 	- a bucket of at most 64 bytes (fingerprints padded to 8 bytes, then
+ * 	  4 pairs of up to 14 bytes or 8 pairs of up to 7 bytes) is one line,
+ * 	  and a `get` reads at most 2 lines while the stash is empty
+ * 	- a larger bucket takes whole lines, 128 bytes for 4 pairs of 16
+ * 	  bytes: a `get` reads the fingerprints of each bucket probed, then
+ * 	  the lines of the pairs whose fingerprint matches, usually 2 lines,
+ * 	  3 when the pair is in the second bucket
+ * 	- while the stash holds pairs, a miss also compares the key of each
+ * 	  one, that is up to 8 more pairs read from a separate block
+ *
+ * The padding costs memory when the pairs of a bucket just exceed a line:
+ * 72 bytes of data take 128.
+ *****************************************************************************/
+
+typedef struct tds_cuckootbl  tds_cuckootbl;
+
+/* The first `keysize` bytes of the pair struct must be hash-able
+ *
+ * Note
+ * 	- `ways` is 4 or 8, 4 by default
+ * 	- by default keys are hashed by `ta_hash_wy` (see `ta/hash.h`)
+ * 	- `_fhash` replaces the default hash function, it must spread the keys
+ * 	  over the whole 64-bit code: more than 2 * `ways` + 8 keys sharing
+ * 	  both buckets cannot be stored and `set` fails
+ * 	- each table draws a random seed that is passed to the hash function
+ * 	- the memory comes from `alloc`, the C library if NULL (see
+ * 	  `tds/allocator.h`); the other constructors use the C library
+ */
+tds_cuckootbl *tds_cuckootbl_create_w(size_t pairsize, size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, int ways, const tds_allocator *alloc);
+tds_cuckootbl *tds_cuckootbl_force_create_w(size_t pairsize, size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, int ways, const tds_allocator *alloc);
+tds_cuckootbl *tds_cuckootbl_create_h(size_t pairsize, size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc);
+tds_cuckootbl *tds_cuckootbl_force_create_h(size_t pairsize, size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc);
+tds_cuckootbl *tds_cuckootbl_create_g(size_t pairsize, size_t keysize, size_t init_capacity, const tds_allocator *alloc);
+tds_cuckootbl *tds_cuckootbl_force_create_g(size_t pairsize, size_t keysize, size_t init_capacity, const tds_allocator *alloc);
+tds_cuckootbl *tds_cuckootbl_create(size_t pairsize, size_t keysize);
+tds_cuckootbl *tds_cuckootbl_force_create(size_t pairsize, size_t keysize);
+
+void tds_cuckootbl_free(tds_cuckootbl *tbl);
+
+/* Statistics
+ *
+ * 	- the capacity is the number of slots in the buckets, the stash excluded
+ * 	- `tds_cuckootbl_stash_usage` is the number of pairs in the stash
+ */
+size_t tds_cuckootbl_usage(const tds_cuckootbl *tbl);
+size_t tds_cuckootbl_capacity(const tds_cuckootbl *tbl);
+double tds_cuckootbl_load_factor(const tds_cuckootbl *tbl);
+size_t tds_cuckootbl_stash_usage(const tds_cuckootbl *tbl);
+
+/* Get the value of an existing pair
+ * Return a NULL pointer if the key is not found
+ *
+ * Note: the pointer is invalidated by any later `set` or `rm`
+ */
+void *tds_cuckootbl_get(const tds_cuckootbl *tbl, const void *key);
+
+/* Return a boolean
+ */
+int tds_cuckootbl_contains(const tds_cuckootbl *tbl, const void *key);
+
+/* Return a bool indicating success
+ *
+ * Note
+ * 	- the `pair` can be existing or new
+ */
+int tds_cuckootbl_set(tds_cuckootbl *tbl, const void *pair);
+
+/* On failure, exit the program
+ */
+void tds_cuckootbl_force_set(tds_cuckootbl *tbl, const void *pair);
+
+/* Remove the pair of `key`
+ * Return a boolean indicating whether the key was found
+ */
+int tds_cuckootbl_rm(tds_cuckootbl *tbl, const void *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,6 +6,7 @@
 #define TDS_DEQUE_H
 
 #include <stddef.h>
+#include <tds/allocator.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,7 +23,16 @@ extern "C" {
 typedef struct tds_deque  tds_deque;
 
 tds_deque *tds_deque_create(size_t elesize);
-tds_deque *tds_deque_create_g(size_t elesize, size_t blk_capacity, size_t buffer_lim);
+
+/* The memory comes from `alloc`, the C library if NULL (see `tds/allocator.h`)
+ * If `alloc` does not free (an arena), `tds_deque_free` leaves the
+ * blocks to it and returns at once
+ *
+ * The blocks are allocated by slabs (see `tds/pool.h`), the empty blocks are
+ * buffered for the next insertions. Above `buffer_lim` buffered blocks, the
+ * slabs with no block in use are released.
+ */
+tds_deque *tds_deque_create_g(size_t elesize, size_t blk_capacity, size_t buffer_lim, const tds_allocator *alloc);
 tds_deque *tds_deque_force_create(size_t elesize);
 void tds_deque_free(tds_deque *q);
 
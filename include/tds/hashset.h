@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#ifndef TDS_HASHSET
+#define TDS_HASHSET
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tds.h>
+#include <tds/allocator.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Hash Set
+ *
+ * A set of fixed-size keys, the key-only counterpart of `tds_hashtbl`: no
+ * value is stored or copied, and keys of at most 8 bytes (integers, pointers,
+ * small structs) are stored in 64-bit words and compared as one word.
+ *
+ * Slots are probed linearly, each with a 1-byte tag holding 7 bits of the
+ * hash code that filters the key comparisons. Removal shifts the following
+ * keys back, so there is no tombstone.
+ *****************************************************************************/
+
+typedef struct tds_hashset  tds_hashset;
+
+/* The `keysize` bytes of the keys must be hash-able
+ *
+ * Note
+ * 	- by default keys are hashed by `ta_hash_wy` (see `ta/hash.h`)
+ * 	- `_fhash` replaces the default hash function
+ * 	- each set draws a random seed that is passed to the hash function
+ * 	- the memory comes from `alloc`, the C library if NULL (see
+ * 	  `tds/allocator.h`); the other constructors use the C library
+ */
+tds_hashset *tds_hashset_create_h(size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc);
+tds_hashset *tds_hashset_force_create_h(size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc);
+tds_hashset *tds_hashset_create_g(size_t keysize, size_t init_capacity, const tds_allocator *alloc);
+tds_hashset *tds_hashset_force_create_g(size_t keysize, size_t init_capacity, const tds_allocator *alloc);
+tds_hashset *tds_hashset_create(size_t keysize);
+tds_hashset *tds_hashset_force_create(size_t keysize);
+
+void tds_hashset_free(tds_hashset *set);
+
+size_t tds_hashset_usage(const tds_hashset *set);
+size_t tds_hashset_capacity(const tds_hashset *set);
+double tds_hashset_load_factor(const tds_hashset *set);
+
+/* Return a boolean
+ */
+int tds_hashset_contains(const tds_hashset *set, const void *key);
+
+/* Return a bool indicating success, inserting an existing key succeeds
+ */
+int tds_hashset_insert(tds_hashset *set, const void *key);
+
+/* On failure, exit the program
+ */
+void tds_hashset_force_insert(tds_hashset *set, const void *key);
+
+/* Remove `key`
+ * Return a boolean indicating whether the key was found
+ */
+int tds_hashset_erase(tds_hashset *set, const void *key);
+
+/* Set algebra, `dst` is updated in place and `src` is unchanged
+ *
+ * 	- union:        dst = dst | src, return a bool indicating success
+ * 	- intersection: dst = dst & src
+ * 	- difference:   dst = dst - src
+ *
+ * Both sets must have the same key size.
+ */
+int tds_hashset_union(tds_hashset *dst, const tds_hashset *src);
+void tds_hashset_intersection(tds_hashset *dst, const tds_hashset *src);
+void tds_hashset_difference(tds_hashset *dst, const tds_hashset *src);
+
+/* Iteration
+ *
+ * 	size_t loc = 0;
+ * 	const void *key;
+ * 	while (NULL != (key = tds_hashset_next(set, &loc)))
+ * 		...
+ *
+ * Return the next key from the slot `*loc`, NULL at the end, the order is
+ * unspecified. No key can be inserted or erased during the iteration.
+ */
+const void *tds_hashset_next(const tds_hashset *set, size_t *loc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
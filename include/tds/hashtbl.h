@@ -7,6 +7,10 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <tds.h>
+#include <tds/string.h>
+#include <tds/arraylist.h>
+#include <tds/allocator.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -24,11 +28,61 @@ extern "C" {
 
 typedef struct tds_hashtbl  tds_hashtbl;
 
+/* Modes of `tds_hashtbl_create_m`, can be combined by `|`
+ *
+ * 	- incremental: on expansion, the old slots are kept and migrated by
+ * 	  bounded steps in later `set`/`rm` (or `tds_hashtbl_migrate`), so
+ * 	  that no single operation rehashes the whole table
+ * 	- storehash: the 64-bit hash code of each pair is stored next to it,
+ * 	  so that resizing never hashes the keys again and probing compares
+ * 	  the code before the key bytes, at the cost of 8 bytes per slot
+ * 	- robinhood: slots are probed one by one instead of by groups, and an
+ * 	  insertion displaces the pairs that are closer to their home slot, so
+ * 	  that probing sequences have a low variance, a miss stops as early as
+ * 	  a hit, removals shift pairs back instead of leaving tombstones, and
+ * 	  the table is only expanded at the load factor 0.9 (0.75 otherwise);
+ * 	  pointers returned by `get` are invalidated by any `set` or `rm`
+ */
+#define tds_hashtbl_mode_incremental  0x1
+#define tds_hashtbl_mode_storehash    0x2
+#define tds_hashtbl_mode_robinhood    0x4
+
 /* The first `keysize` bytes of the pair struct must be hash-able
+ *
+ * Note
+ * 	- any key can be stored, including the one of all zero bytes
+ * 	- each slot owns a 1-byte control tag (empty, deleted or 7 bits of
+ * 	  the hash code); lookups scan 16 tags at a time (SSE2 when
+ * 	  available, scalar otherwise) before comparing any key
+ * 	- by default keys are hashed by `ta_hash_wy` (see `ta/hash.h`)
+ * 	- `_fhash` replaces the default hash function
+ * 	- each table draws a random seed that is passed to the hash function
+ * 	- the memory comes from `alloc`, the C library if NULL (see
+ * 	  `tds/allocator.h`); the other constructors use the C library
+ */
+
+/* String-key mode
+ *
+ * The keys are byte strings of any length. They are copied into a key arena
+ * owned by the table, and each slot stores a reference (offset and length)
+ * to its key followed by a value of `valsize` bytes. The hash codes are
+ * always stored (`tds_hashtbl_mode_storehash`), `mode` may add other modes.
+ *
+ * Such a table is only accessed by the `s` functions below, the other ones
+ * are for fixed-size keys. The slots and the key arena of `_s_g` come from
+ * `alloc`, as for `tds_hashtbl_create_m`.
  */
+tds_hashtbl *tds_hashtbl_create_s(size_t valsize, size_t init_capacity, int mode);
+tds_hashtbl *tds_hashtbl_force_create_s(size_t valsize, size_t init_capacity, int mode);
+tds_hashtbl *tds_hashtbl_create_s_g(size_t valsize, size_t init_capacity, int mode, const tds_allocator *alloc);
+tds_hashtbl *tds_hashtbl_force_create_s_g(size_t valsize, size_t init_capacity, int mode, const tds_allocator *alloc);
 
-tds_hashtbl *tds_hashtbl_create_g(size_t pairsize, size_t keysize, size_t init_capacity);
-tds_hashtbl *tds_hashtbl_force_create_g(size_t pairsize, size_t keysize, size_t init_capacity);
+tds_hashtbl *tds_hashtbl_create_m(size_t pairsize, size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, int mode, const tds_allocator *alloc);
+tds_hashtbl *tds_hashtbl_force_create_m(size_t pairsize, size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, int mode, const tds_allocator *alloc);
+tds_hashtbl *tds_hashtbl_create_h(size_t pairsize, size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc);
+tds_hashtbl *tds_hashtbl_force_create_h(size_t pairsize, size_t keysize, size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc);
+tds_hashtbl *tds_hashtbl_create_g(size_t pairsize, size_t keysize, size_t init_capacity, const tds_allocator *alloc);
+tds_hashtbl *tds_hashtbl_force_create_g(size_t pairsize, size_t keysize, size_t init_capacity, const tds_allocator *alloc);
 tds_hashtbl *tds_hashtbl_create(size_t pairsize, size_t keysize);
 tds_hashtbl *tds_hashtbl_force_create(size_t pairsize, size_t keysize);
 
@@ -38,6 +92,51 @@ size_t tds_hashtbl_usage(const tds_hashtbl *arr);
 size_t tds_hashtbl_capacity(const tds_hashtbl *arr);
 double tds_hashtbl_load_factor(const tds_hashtbl *arr);
 
+/* Number of deleted slots (tombstones) that are not reused yet
+ */
+size_t tds_hashtbl_tombstones(const tds_hashtbl *arr);
+uint64_t tds_hashtbl_seed(const tds_hashtbl *arr);
+
+/* Statistics
+ *
+ * The probe and resize-time counters are only collected when the library is
+ * built with the macro `tds_hashtbl_with_stats` defined (CMake option
+ * `TDS_HASHTBL_STATS`), they are 0 otherwise. Their cost is a few counter
+ * increments per lookup. Concurrent readers of one table may lose counts.
+ *
+ * `tds_hashtbl_reset_stats` zeroes the counters and `nresizes`.
+ */
+#define tds_hashtbl_stats_nbins  16
+
+struct tds_hashtbl_stats {
+	size_t usage;
+	size_t capacity;
+	size_t tombstones;
+	size_t bytes;           /* memory of the table, old slots and key arena included */
+	size_t nresizes;        /* rehashes: expansions, in place and compactions */
+	double resize_seconds;  /* CPU time spent moving pairs into new slots */
+	size_t nlookups;        /* probing sequences of get, set, rm, ... */
+	size_t max_probe;       /* the longest probing sequence, in groups of 16 slots
+	                         * (robin hood mode: 16 slots from the home slot) */
+	size_t probe_hist[tds_hashtbl_stats_nbins];  /* [i]: sequences of i + 1 groups, the
+	                                              * last bin counts the longer ones */
+};
+
+void tds_hashtbl_stats(const tds_hashtbl *tbl, struct tds_hashtbl_stats *stats);
+void tds_hashtbl_reset_stats(tds_hashtbl *tbl);
+
+/* Incremental resizing
+ *
+ * 	- `tds_hashtbl_migrating` returns a boolean
+ * 	- `tds_hashtbl_migration_progress` returns the ratio of old slots that
+ * 	  are migrated, 1 if not migrating
+ * 	- `tds_hashtbl_migrate` migrates at most `nslots` old slots and returns
+ * 	  the number of old slots left, 0 if the migration is finished
+ */
+int tds_hashtbl_migrating(const tds_hashtbl *arr);
+double tds_hashtbl_migration_progress(const tds_hashtbl *arr);
+size_t tds_hashtbl_migrate(tds_hashtbl *tbl, size_t nslots);
+
 /* Get the value of an existing pair
  * Return a NULL pointer if the ele is not found
  */
@@ -54,24 +153,132 @@ int tds_hashtbl_set(tds_hashtbl *tbl, const void *ele);
  */
 void tds_hashtbl_force_set(tds_hashtbl *tbl, const void *ele);
 
+/* Batched operations, equivalent to calling `get` or `set` on each key in
+ * order, but the home slots of several keys are prefetched at once to hide
+ * the memory latency on large tables
+ *
+ * 	- `keys` holds `n` contiguous keys of `keysize` bytes, the pointer to
+ * 	  the value of the i-th key (or NULL) is assigned to `out[i]`
+ * 	- `pairs` holds `n` contiguous pairs of `pairsize` bytes, on failure
+ * 	  the pairs before the failing one are already set
+ */
+void tds_hashtbl_get_batch(const tds_hashtbl *tbl, const void *keys, size_t n, void **out);
+int tds_hashtbl_set_batch(tds_hashtbl *tbl, const void *pairs, size_t n);
+void tds_hashtbl_force_set_batch(tds_hashtbl *tbl, const void *pairs, size_t n);
+
 /* Return a boolean
+ *
+ * Note: while migrating, `loc` may refer to the old slots
  */
 int tds_hashtbl_contains(const tds_hashtbl *tbl, const void *ele, size_t *loc);
 
 /* Remove an element from the `tbl`
  * Return a boolean indicating success.
+ *
+ * Note
+ * 	- the usage is decreased and the slot is reused by later `set`
+ * 	- when tombstones fill the table, the next `set` rehashes in place at
+ * 	  the same capacity instead of expanding
  */
 int tds_hashtbl_rm(tds_hashtbl *tbl, const void *pair);
 
+/* String-key mode operations, see `tds_hashtbl_create_s`
+ *
+ * 	- `sget` returns the pointer to the value of `key`, or NULL
+ * 	- `sset` copies `key` into the arena if it is new, then copies the
+ * 	  value, return a bool indicating success
+ * 	- `srm` returns a boolean indicating whether the key was found, the
+ * 	  arena space of removed keys is recycled when the arena is full or by
+ * 	  `tds_hashtbl_compact`
+ * 	- `key` must not point into the table itself
+ */
+void *tds_hashtbl_sget(const tds_hashtbl *tbl, const char *key, size_t len);
+void *tds_hashtbl_sget_tstr(const tds_hashtbl *tbl, const tds_string *key);
+int tds_hashtbl_scontains(const tds_hashtbl *tbl, const char *key, size_t len);
+int tds_hashtbl_sset(tds_hashtbl *tbl, const char *key, size_t len, const void *value);
+int tds_hashtbl_sset_tstr(tds_hashtbl *tbl, const tds_string *key, const void *value);
+void tds_hashtbl_force_sset(tds_hashtbl *tbl, const char *key, size_t len, const void *value);
+int tds_hashtbl_srm(tds_hashtbl *tbl, const char *key, size_t len);
+
+/* Iteration cursor, allocated by the caller
+ *
+ * 	tds_hashtbl_iter iter;
+ * 	void *pair;
+ * 	tds_hashtbl_iter_begin(tbl, &iter);
+ * 	while (NULL != (pair = tds_hashtbl_iter_next(tbl, &iter)))
+ * 		...
+ *
+ * Note
+ * 	- `tds_hashtbl_iter_next` returns the next live pair (the value in the
+ * 	  string-key mode), NULL at the end, the order is unspecified
+ * 	- `tds_hashtbl_iter_key` returns the key of the pair just returned and
+ * 	  assigns its length to `len` (can be NULL)
+ * 	- values can be changed through the returned pointers, but no pair
+ * 	  can be added during the iteration; removing the pair just returned
+ * 	  is allowed if the table is not migrating, in every mode (the pairs
+ * 	  moved back by a Robin Hood removal are still returned once)
+ */
+typedef struct tds_hashtbl_iter {
+	size_t __group;   /* the next group of tags to scan */
+	uint32_t __mask;  /* live slots of the current group not returned yet */
+	size_t __loc;     /* the slot returned last */
+	int __old;        /* scanning the old slots being migrated */
+	size_t __start;   /* Robin Hood mode: the empty slot the scan starts at */
+	size_t __usage;   /* Robin Hood mode: the pairs left at the last return */
+} tds_hashtbl_iter;
+
+void tds_hashtbl_iter_begin(const tds_hashtbl *tbl, tds_hashtbl_iter *iter);
+void *tds_hashtbl_iter_next(const tds_hashtbl *tbl, tds_hashtbl_iter *iter);
+const char *tds_hashtbl_iter_key(const tds_hashtbl *tbl, const tds_hashtbl_iter *iter, size_t *len);
+
+/* Append copies of all live pairs to `list`, whose element size must be the
+ * pair size (not available in the string-key mode)
+ * Return a bool indicating success
+ */
+int tds_hashtbl_export(const tds_hashtbl *tbl, tds_arraylist *list);
+
+/* Save the table into the file at `path`, an ongoing migration is finished
+ * first
+ * Return a bool indicating success
+ */
+int tds_hashtbl_save(tds_hashtbl *tbl, const char *path);
+
+/* Open a table saved by `tds_hashtbl_save` without deserializing it: the
+ * file is mapped read-only (read into memory on systems without `mmap`) and
+ * lookups are served from the mapping, so processes opening the same file
+ * share it through the page cache. On failure, return `NULL`
+ *
+ * Note
+ * 	- the table is read-only, `set`, `rm` and `compact` fail
+ * 	- `tds_hashtbl_free` unmaps the file
+ * 	- the hash function must be the one used when saving, `ta_hash_wy`
+ * 	  for `tds_hashtbl_open_mmap`
+ * 	- the file format is native (byte order and size of `size_t`)
+ * 	- opening reads the control tags once, and the key references in the
+ * 	  string-key mode: a file whose slots have no empty one, whose number
+ * 	  of pairs differs from its header, or whose keys lie outside its key
+ * 	  arena is rejected
+ */
+tds_hashtbl *tds_hashtbl_open_mmap(const char *path);
+tds_hashtbl *tds_hashtbl_open_mmap_h(const char *path, tds_fhash_t *_fhash);
+
+/* Drop all tombstones and shrink the capacity to the smallest power of 2
+ * that keeps the load under the threshold
+ * Return a boolean indicating success.
+ */
+int tds_hashtbl_compact(tds_hashtbl *tbl);
+
 /* Calculate the unique location for a given `ele` in Hash-table `tbl`
  *
  * Note
- * 	1. `_new_capacity` can be different from the current capacity of `tbl`
- * 		- `_new_capacity` == the capacity of `tbl` if you do not expand Hash-table
- * 		- `_new_capacity` > the capacity of `tbl` if you expand Hash-table and rehash keys
+ * 	1. `_new_capacity` must be the capacity of `tbl`, since the location
+ * 		depends on the control tags of the current slots (the old slots
+ * 		being migrated are not searched)
  * 	2. `state` return 0 or 1, indeicating whether the location has elements
  * 		- If the location is free (return 0), the location is for newly inserting elements
  * 		- If the location has elements (return 1), the location is for changing existing elements
+ * 	3. in the robin hood mode, a free location (return 0) is where the probing
+ * 		stopped and may hold a pair that the insertion would displace
  */
 size_t tds_hashtbl_getloc(const tds_hashtbl *tbl, const void *ele, size_t _new_capacity, int *state);
 
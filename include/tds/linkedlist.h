@@ -6,6 +6,7 @@
 #define TDS_LIST_H
 
 #include <stddef.h>
+#include <tds/allocator.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,10 +26,23 @@ typedef struct tds_linkedlist_node  tds_linkedlistiter;
 
 
 tds_linkedlist *tds_linkedlist_create(size_t elesize);
-tds_linkedlist *tds_linkedlist_create_g(size_t elesize, size_t buffer_limit);
-void tds_linkedlist_free_buffer(tds_linkedlist *list);
+
+/* The memory comes from `alloc`, the C library if NULL (see `tds/allocator.h`)
+ * If `alloc` does not free (an arena), `tds_linkedlist_free` leaves the
+ * nodes to it and returns at once
+ *
+ * The nodes are allocated by slabs (see `tds/pool.h`), the nodes removed are
+ * buffered for the next insertions. Above `buffer_limit` buffered nodes, the
+ * slabs with no node in the list are released.
+ */
+tds_linkedlist *tds_linkedlist_create_g(size_t elesize, size_t buffer_limit, const tds_allocator *alloc);
 void tds_linkedlist_free(tds_linkedlist *list);
 
+/* Release the slabs with no node in the list, the buffered nodes of the
+ * other slabs are kept
+ */
+void tds_linkedlist_free_buffer(tds_linkedlist *list);
+
 /* Pre-allocate the nodes that you need.
  * These pre-allocated noded will be stored in buffer
  */
@@ -6,6 +6,8 @@
 #define TDS_NBITSARRAY_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <tds/allocator.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -14,9 +16,65 @@ extern "C" {
 /******************************************************************************
  * N-Bits Array
  *
- * N-Bits Array is an extension of bit array
+ * N-Bits Array is an extension of bit array: a resizable array of unsigned
+ * integers of `nbits` bits each (1 to 32), packed one after another in the
+ * words of a `tds_bitarray`. The value `i` is the bits [i * nbits,
+ * (i + 1) * nbits) of the bit array, the lowest first, so that a value may
+ * span two words. It takes about `nbits / 8` bytes per value.
  *****************************************************************************/
 
+typedef struct tds_nbitsarray  tds_nbitsarray;
+
+/* On failure, return NULL pointer
+ * `nbits` is in [1, 32], the capacity is at least `capacity` values
+ * The memory of `tds_nbitsarray_create_g` comes from `alloc`, the C library if
+ * NULL (see `tds/allocator.h`)
+ */
+tds_nbitsarray *tds_nbitsarray_create_g(int nbits, size_t capacity, const tds_allocator *alloc);
+tds_nbitsarray *tds_nbitsarray_create(int nbits);
+
+/* On failure, exit the program
+ */
+tds_nbitsarray *tds_nbitsarray_force_create_g(int nbits, size_t capacity, const tds_allocator *alloc);
+tds_nbitsarray *tds_nbitsarray_force_create(int nbits);
+
+void tds_nbitsarray_free(tds_nbitsarray *arr);
+
+int tds_nbitsarray_nbits(const tds_nbitsarray *arr);
+size_t tds_nbitsarray_len(const tds_nbitsarray *arr);
+size_t tds_nbitsarray_capacity(const tds_nbitsarray *arr);
+
+/* Access the value at `loc` < len, a value set must fit `nbits` bits
+ */
+uint32_t tds_nbitsarray_get(const tds_nbitsarray *arr, size_t loc);
+void tds_nbitsarray_set(tds_nbitsarray *arr, size_t loc, uint32_t value);
+
+/* Expand the capacity (by doubling) to hold at least `capacity` values
+ * Return a bool indicating the success
+ */
+int tds_nbitsarray_reserve(tds_nbitsarray *arr, size_t capacity);
+
+/* Append one value, or the `n` values of `values`
+ * Return a bool indicating the success
+ */
+int tds_nbitsarray_pushback(tds_nbitsarray *arr, uint32_t value);
+int tds_nbitsarray_append(tds_nbitsarray *arr, const uint32_t *values, size_t n);
+
+/* On failure, exit the program
+ */
+void tds_nbitsarray_force_pushback(tds_nbitsarray *arr, uint32_t value);
+void tds_nbitsarray_force_append(tds_nbitsarray *arr, const uint32_t *values, size_t n);
+
+/* Remove all values, the capacity is kept
+ */
+void tds_nbitsarray_clear(tds_nbitsarray *arr);
+
+/* Decode the `n` values from `from` into `out`, `from + n` <= len
+ *
+ * Runs 8 values at a time with AVX2 (when the compiler targets it) for
+ * `nbits` up to 25, one at a time otherwise.
+ */
+void tds_nbitsarray_decode(const tds_nbitsarray *arr, size_t from, size_t n, uint32_t *out);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#ifndef TDS_POOL_H
+#define TDS_POOL_H
+
+#include <stddef.h>
+#include <tds/allocator.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Pool
+ *
+ * A pool of objects of one size (the nodes of a linked list or a tree, the
+ * blocks of a deque), allocated by slabs of `slab_len` objects. An object
+ * is taken from the free list of the objects put back, or else cut from the
+ * newest slab, so that objects taken one after the other are next to each
+ * other, and a slab costs one call to the allocator.
+ *
+ * The objects are aligned as `malloc` does. An object put back is linked by
+ * its first pointer, the rest of it is kept as is.
+ *
+ * A slab whose objects are all free is released by `tds_pool_trim`, and by
+ * `tds_pool_put` when more than `keep` objects are free. Freeing the pool
+ * releases every slab, without a walk over the objects.
+ *****************************************************************************/
+
+typedef struct tds_pool  tds_pool;
+
+/* On failure, return NULL pointer
+ *
+ * 	- `slab_len`: objects per slab, 0 for slabs of about a page
+ * 	- `keep`: free objects kept by `tds_pool_put`, `(size_t) -1` to never
+ * 	  release a slab but by `tds_pool_trim`
+ *
+ * The memory of `tds_pool_create_g` comes from `alloc`, the C library if
+ * NULL (see `tds/allocator.h`)
+ */
+tds_pool *tds_pool_create(size_t objsize);
+tds_pool *tds_pool_create_g(size_t objsize, size_t slab_len, size_t keep, const tds_allocator *alloc);
+
+/* On failure, exit the program
+ */
+tds_pool *tds_pool_force_create(size_t objsize);
+tds_pool *tds_pool_force_create_g(size_t objsize, size_t slab_len, size_t keep, const tds_allocator *alloc);
+
+void tds_pool_free(tds_pool *pool);
+
+/* Take an object
+ * On failure, return NULL pointer
+ */
+void *tds_pool_get(tds_pool *pool);
+
+/* Put back an object taken from `pool`
+ */
+void tds_pool_put(tds_pool *pool, void *obj);
+
+/* Release the slabs whose objects are all free
+ * Return the number of slabs released
+ */
+size_t tds_pool_trim(tds_pool *pool);
+
+/* Statistics
+ *
+ * 	- `tds_pool_len`: objects taken
+ * 	- `tds_pool_nfree`: objects put back, and not taken again
+ * 	- `tds_pool_nslab`: slabs allocated
+ */
+size_t tds_pool_len(const tds_pool *pool);
+size_t tds_pool_nfree(const tds_pool *pool);
+size_t tds_pool_nslab(const tds_pool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#ifndef TDS_ROARING_H
+#define TDS_ROARING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tds/allocator.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Roaring Bitmap
+ *
+ * A compressed set of 32-bit unsigned integers. The values are partitioned by
+ * their high 16 bits into chunks, and each chunk that holds a value has its
+ * own container of the low 16 bits:
+ *
+ * 	- array:  sorted values, for chunks of at most 4096 values
+ * 	- bitmap: a `tds_bitarray` of 65536 bits, for denser chunks
+ * 	- run:    sorted runs of consecutive values, see `tds_roaring_optimize`
+ *
+ * so that the memory follows the number of values rather than the universe.
+ * The bitmap containers run the set operations with the word kernels of
+ * `tds_bitarray`.
+ *****************************************************************************/
+
+typedef struct tds_roaring  tds_roaring;
+
+/* Visitor of a value, return 0 to stop the iteration
+ */
+typedef int tds_roaring_fvisit_t(uint32_t _value, void *_ctx);
+
+/* Returned by `tds_roaring_next` after the last value
+ */
+#define tds_roaring_end  ((uint64_t) 1 << 32)
+
+/* On failure, return NULL pointer
+ * On success, return an empty bitmap
+ * The memory of `tds_roaring_create_g` comes from `alloc`, the C library if
+ * NULL (see `tds/allocator.h`)
+ */
+tds_roaring *tds_roaring_create(void);
+tds_roaring *tds_roaring_create_g(const tds_allocator *alloc);
+
+/* On failure, exit the program
+ */
+tds_roaring *tds_roaring_force_create(void);
+tds_roaring *tds_roaring_force_create_g(const tds_allocator *alloc);
+
+void tds_roaring_free(tds_roaring *r);
+
+/* Number of values
+ */
+uint64_t tds_roaring_cardinality(const tds_roaring *r);
+
+/* Bytes allocated by the bitmap
+ */
+size_t tds_roaring_bytes(const tds_roaring *r);
+
+/* Return a boolean
+ */
+int tds_roaring_contains(const tds_roaring *r, uint32_t value);
+
+/* Return a bool indicating success, adding an existing value or removing an
+ * absent value succeeds
+ */
+int tds_roaring_add(tds_roaring *r, uint32_t value);
+int tds_roaring_remove(tds_roaring *r, uint32_t value);
+
+/* On failure, exit the program
+ */
+void tds_roaring_force_add(tds_roaring *r, uint32_t value);
+void tds_roaring_force_remove(tds_roaring *r, uint32_t value);
+
+/* Convert every container into its smallest kind, run containers included
+ * Return a bool indicating success, the bitmap is valid either way
+ *
+ * Call it once a bitmap is built: `tds_roaring_add` keeps arrays and bitmaps
+ * and decodes a run container before adding into it.
+ */
+int tds_roaring_optimize(tds_roaring *r);
+
+/* Set operations
+ *
+ * On failure, return NULL pointer
+ * On success, return a new bitmap
+ */
+tds_roaring *tds_roaring_and(const tds_roaring *r1, const tds_roaring *r2);
+tds_roaring *tds_roaring_or(const tds_roaring *r1, const tds_roaring *r2);
+tds_roaring *tds_roaring_xor(const tds_roaring *r1, const tds_roaring *r2);
+tds_roaring *tds_roaring_andnot(const tds_roaring *r1, const tds_roaring *r2);
+
+/* Iteration
+ *
+ * 	- next:    the smallest value at or after `from`, or `tds_roaring_end`
+ * 	- foreach: call `visit(value, ctx)` on the values in increasing order
+ * 	           until it returns 0, the bitmap must not be modified by
+ * 	           `visit`
+ *
+ * The values can be iterated by
+ *
+ * 	uint64_t v;
+ * 	for (v = tds_roaring_next(r, 0); v != tds_roaring_end; v = tds_roaring_next(r, v + 1))
+ * 		...
+ */
+uint64_t tds_roaring_next(const tds_roaring *r, uint64_t from);
+void tds_roaring_foreach(const tds_roaring *r, tds_roaring_fvisit_t *visit, void *ctx);
+
+/* Serialized form
+ *
+ * 	- `tds_roaring_serialized_size` returns the bytes written by
+ * 	  `tds_roaring_serialize` into `buf`
+ * 	- `tds_roaring_deserialize` creates a bitmap from `len` bytes, or
+ * 	  returns NULL if they are not a serialized bitmap
+ * 	- the integers are little-endian, the form is the same on every machine
+ *
+ * Layout: the magic "tdsroar1", the number of containers (4 bytes), a
+ * descriptor per container (key: 2 bytes, kind: 2 bytes, number of values,
+ * or runs for a run container: 4 bytes), then the containers one after
+ * another: the 2-byte values of an array, the 1024 8-byte words of a bitmap,
+ * the 2-byte pairs (start, length - 1) of a run container.
+ */
+size_t tds_roaring_serialized_size(const tds_roaring *r);
+void tds_roaring_serialize(const tds_roaring *r, void *buf);
+tds_roaring *tds_roaring_deserialize(const void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
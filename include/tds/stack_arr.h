@@ -21,9 +21,9 @@ extern "C" {
 typedef tds_arraylist  tds_stack_arr;
 
 tds_stack_arr *tds_stack_arr_create(size_t elesize);
-tds_stack_arr *tds_stack_arr_create_g(size_t elesize, size_t capacity);
+tds_stack_arr *tds_stack_arr_create_g(size_t elesize, size_t capacity, const tds_allocator *alloc);
 tds_stack_arr *tds_stack_arr_force_create(size_t elesize);
-tds_stack_arr *tds_stack_arr_force_create_g(size_t elesize, size_t capacity);
+tds_stack_arr *tds_stack_arr_force_create_g(size_t elesize, size_t capacity, const tds_allocator *alloc);
 
 void tds_stack_arr_free(tds_stack_arr *stk);
 
@@ -6,6 +6,7 @@
 #define TDS_STRING_H
 
 #include <stddef.h>
+#include <tds/allocator.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,10 +21,14 @@ extern "C" {
 typedef struct tds_string  tds_string;
 
 /* On failure, return a `NULL` pointer
+ *
+ * The memory of `tds_string_create_g` comes from `alloc`, the C library if
+ * NULL (see `tds/allocator.h`). Substrings and copies use the allocator of
+ * the string they come from.
  */
 
 tds_string *tds_string_create(void);
-tds_string *tds_string_create_g(size_t buffersize);
+tds_string *tds_string_create_g(size_t buffersize, const tds_allocator *alloc);
 tds_string *tds_string_create_from_cstr(const char *cstr, size_t n);
 tds_string *tds_string_create_substr(const tds_string *tstr, size_t pos, size_t n);
 tds_string *tds_string_create_substr2(const tds_string *tstr, size_t pos);
@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <ta/hash.h>
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+
+/* The secret of wyhash (final version), odd numbers with 32 bits set
+ */
+static const uint64_t __wyp[4] = {
+	0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+	0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull
+};
+
+
+/******************************************************************************
+ * Part 1. Polynomial hash
+ ******************************************************************************/
+
+uint64_t ta_hash_poly(const void *key, size_t len, uint64_t base)
+{
+	uint64_t code = 0;  /* hash code */
+	size_t i;
+	char *p = (char *) key;
+
+	for (i = 0; i < len; i++) {
+		code += (p[i] + 1);
+		code *= base;
+	}
+	return code;
+}
+
+/* Test results of 100,000,000 key-value pairs, counting the total conflictions
+ *
+ * Note:
+ * Load factor is around 20% - 40%. See `test/test_hashtbl.c`
+ *
+ * | prim |  1,000,000 |  10,000,000 |  100,000,000 |
+ * | ---- | ---------- | ----------- | ------------ |
+ * |  13  |    254,677 |   1,810,393 |              |
+ * |  17  |    282,561 |   1,825,637 |              |
+ * |  19  |    322,992 |   3,751,867 |              |
+ * |  23  |    568,471 |     891,815 |              |
+ * |  29  |    175,504 |   2,481,449 |              |
+ * |  31  |    689,364 |   3,956,252 |              |
+ * |  37  |    390,750 |   2,075,701 |              |
+ * |  41  |    282,088 |     858,399 |              |
+ * |  43  |    535,560 |   1,313,095 |              |
+ * |  47  |    288,020 |   2,274,344 |              |
+ * |  53  |    339,329 |   2,137,211 |              |
+ * |  59  |    278,367 |     957,101 |              |
+ * |  61  |    195,273 |   2,164,114 |              |
+ * |  67  |    349,482 |   4,487,439 |              |
+ * |  71  |    258,043 |   1,015,314 |              |
+ * |  73  |    819,659 |   2,520,886 |              |
+ * |  79  |    250,145 |     832,997 |              |
+ * |  83  |    132,799 |   1,127,806 |              |
+ * |  89  |    156,396 |   1,631,691 |              |
+ * |  97  |    538,955 |   3,089,063 |              |
+ * | 101  |    297,211 |     961,811 |              |
+ * | 103  |    189,988 |     918,970 |              |
+ * | 107  |    333,492 |   1,340,713 |              |
+ * | 109  |    743,002 |   1,513,836 |              |
+ * | 113  |    333,293 |   2,051,708 |              |
+ * | 127  | 14,386,873 |  47,066,592 |              |
+ * | 131  |    185,299 |   2,110,784 |              |
+ * | 137  |    229,833 |   1,324,296 |              |
+ * | 139  |    288,627 |   1,456,837 |              |
+ * | 149  |    542,476 |   1,843,235 |              |
+ * | 151  |    208,122 |     827,972 |              |
+ * | 157  |    227,202 |   1,832,950 |              |
+ * | 163  |    292,412 |   1,171,459 |              |
+ * | 167  |    291,104 |   1,448,417 |              |
+ * | 173  |    289,708 |   1,714,152 |              |
+ * | 179  |    280,400 |   2,496,113 |              |
+ * | 181  |    428,376 |   3,247,992 |              |
+ * | 191  |  2,541,637 |  15,165,678 |              |
+ * | 193  |  2,672,284 |  14,806,009 |              |
+ * | 197  |    147,151 |     870,027 |              |
+ * | 199  |    505,277 |   1,789,141 |              |
+ * | 211  |    893,109 |   2,066,069 |              |
+ * | 223  |    535,430 |   2,830,929 |              |
+ * | 227  |    196,969 |   1,114,904 |              |
+ * | 229  |    248,974 |   1,657,697 |              |
+ * | 233  |    268,220 |   1,383,649 |              |
+ * | 239  |    313,925 |   2,150,900 |              |
+ * | 241  |    401,029 |   1,680,264 |              |
+ * | 251  |    363,454 |   1,473,134 |              |
+ * | 257  | 22,719,070 | 464,954,344 |              |
+ * | 263  |    634,143 |   2,419,988 |              |
+ * | 269  |    227,019 |   1,817,864 |              |
+ * | 271  |    218,656 |   2,984,116 |              |
+ * | 277  |    326,324 |   1,093,931 |              |
+ * | 281  |    564,831 |   1,396,687 |              |
+ * | 283  |  1,184,666 |   2,537,050 |              |
+ * | 293  |    295,100 |   1,622,604 |              |
+ * | 307  |    311,510 |   1,104,937 |              |
+ * | 311  |    854,688 |   1,151,211 |              |
+ * | 313  |    185,325 |   3,609,561 |              |
+ * | 317  |    347,620 |     828,801 |              |
+ * | 331  |    258,504 |   1,967,779 |              |
+ * | 337  |    304,634 |   1,371,804 |              |
+ * | 347  |    340,222 |   1,958,599 |              |
+ * | 349  |    210,856 |     848,136 |              |
+ * | 353  |    477,158 |   2,062,634 |              |
+ * | 359  |    264,153 |   2,554,342 |              |
+ * | 367  |    122,435 |     641,442 |   17,126,217 |
+ * | 373  |    329,602 |   1,196,194 |              |
+ * | 379  |    319,964 |   1,227,605 |              |
+ * | 383  | 14,635,708 |  48,194,127 |              |
+ * | 389  |    296,223 |   1,838,127 |              |
+ * | 397  |    832,162 |   2,808,716 |              |
+ * | 401  |    651,589 |   1,586,482 |              |
+ * | 409  |    349,236 |   1,809,507 |              |
+ * | 419  |    326,571 |   3,044,083 |              |
+ * | 421  |    736,152 |   2,117,233 |              |
+ * | 431  |    213,512 |   1,867,724 |              |
+ * | 433  |    516,930 |   1,621,813 |              |
+ * | 439  |    215,614 |   1,668,819 |              |
+ * | 443  |    591,346 |   4,027,463 |              |
+ * | 449  |  2,443,250 |  15,437,502 |              |
+ * | 457  |    386,981 |   2,904,237 |              |
+ * | 461  |    587,353 |   1,354,406 |              |
+ * | 463  |    330,964 |   2,262,520 |              |
+ * | 467  |    228,730 |     621,561 |   24,177,312 |
+ * | 479  |    806,742 |   3,220,566 |              |
+ * | 487  |    393,394 |   2,060,740 |              |
+ * | 491  |    298,330 |     864,481 |              |
+ * | 499  |    452,754 |   7,978,167 |              |
+ * | 503  |    318,007 |   1,514,110 |              |
+ * | 509  |    304,624 |   1,586,846 |              |
+ */
+
+
+/******************************************************************************
+ * Part 2. Word-at-a-time hash
+ ******************************************************************************/
+
+/* 64x64 -> 128 bits multiplication, `*a` <- low bits and `*b` <- high bits
+ */
+static void __wymum(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+	__extension__ typedef unsigned __int128 uint128_t;
+	uint128_t r = *a;
+	r *= *b;
+	*a = (uint64_t) r;
+	*b = (uint64_t) (r >> 64);
+#else
+	uint64_t ha = *a >> 32, hb = *b >> 32;
+	uint64_t la = (uint32_t) *a, lb = (uint32_t) *b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32), c = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+	c += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static uint64_t __wymix(uint64_t a, uint64_t b)
+{
+	__wymum(&a, &b);
+	return a ^ b;
+}
+
+/* Read bytes as little endian integers, so that the codes do not depend on
+ * the platform
+ */
+static uint64_t __wyr8(const uint8_t *p)
+{
+	return (uint64_t) p[0] | ((uint64_t) p[1] << 8)
+	     | ((uint64_t) p[2] << 16) | ((uint64_t) p[3] << 24)
+	     | ((uint64_t) p[4] << 32) | ((uint64_t) p[5] << 40)
+	     | ((uint64_t) p[6] << 48) | ((uint64_t) p[7] << 56);
+}
+
+static uint64_t __wyr4(const uint8_t *p)
+{
+	return (uint64_t) p[0] | ((uint64_t) p[1] << 8)
+	     | ((uint64_t) p[2] << 16) | ((uint64_t) p[3] << 24);
+}
+
+/* Read 1, 2 or 3 bytes
+ */
+static uint64_t __wyr3(const uint8_t *p, size_t k)
+{
+	return ((uint64_t) p[0] << 16) | ((uint64_t) p[k >> 1] << 8) | p[k - 1];
+}
+
+uint64_t ta_hash_wy(const void *key, size_t len, uint64_t seed)
+{
+	const uint8_t *p = (const uint8_t *) key;
+	uint64_t a = 0, b = 0;
+
+	seed ^= __wymix(seed ^ __wyp[0], __wyp[1]);
+
+	if (len <= 16) {
+		if (len >= 4) {
+			a = (__wyr4(p) << 32) | __wyr4(p + ((len >> 3) << 2));
+			b = (__wyr4(p + len - 4) << 32) | __wyr4(p + len - 4 - ((len >> 3) << 2));
+		} else if (len > 0)
+			a = __wyr3(p, len);
+	} else {
+		size_t i = len;
+
+		if (i > 48) {  /* three independent lanes of 16 bytes */
+			uint64_t see1 = seed, see2 = seed;
+			do {
+				seed = __wymix(__wyr8(p) ^ __wyp[1], __wyr8(p + 8) ^ seed);
+				see1 = __wymix(__wyr8(p + 16) ^ __wyp[2], __wyr8(p + 24) ^ see1);
+				see2 = __wymix(__wyr8(p + 32) ^ __wyp[3], __wyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = __wymix(__wyr8(p) ^ __wyp[1], __wyr8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		/* the last 16 bytes, overlapping with the consumed ones */
+		a = __wyr8(p + i - 16);
+		b = __wyr8(p + i - 8);
+	}
+	a ^= __wyp[1];
+	b ^= seed;
+	__wymum(&a, &b);
+	return __wymix(a ^ __wyp[0] ^ len, b ^ __wyp[1]);
+}
+
+uint64_t ta_hash_u64(uint64_t key, uint64_t seed)
+{
+	seed ^= __wymix(seed ^ __wyp[0], __wyp[1]);
+	return __wymix(key ^ __wyp[1] ^ seed, (key >> 32 | key << 32) ^ __wyp[0]);
+}
+
+
+/******************************************************************************
+ * Part 3. Seed
+ ******************************************************************************/
+
+/* The random base of the seeds, read once by the first call, 0 until then
+ */
+static _Atomic uint64_t __seed_base = 0;
+static _Atomic uint64_t __seed_counter = 0;
+
+static uint64_t __seed_base_read(void)
+{
+	uint64_t base = 0;
+	FILE *fp = NULL;
+
+	if (NULL != (fp = fopen("/dev/urandom", "rb"))) {
+		if (1 != fread(&base, sizeof(base), 1, fp))
+			base = 0;
+		fclose(fp);
+	}
+	if (0 == base) {
+		base = __wymix((uint64_t) time(NULL) ^ __wyp[2], (uint64_t) clock() ^ __wyp[3]);
+		base = __wymix(base ^ (uint64_t) (size_t) &base, __wyp[1]);
+	}
+	return base | 1;  /* never 0, the value of an unread base */
+}
+
+/* Threads racing on the first call may each read a base, only the first
+ * one stored is used
+ */
+uint64_t ta_hash_seed(void)
+{
+	uint64_t base = atomic_load_explicit(&__seed_base, memory_order_acquire);
+	uint64_t count = 0;
+
+	if (0 == base) {
+		uint64_t expected = 0;
+
+		base = __seed_base_read();
+		if (!atomic_compare_exchange_strong_explicit(&__seed_base, &expected, base, \
+			memory_order_acq_rel, memory_order_acquire))
+			base = expected;
+	}
+	count = atomic_fetch_add_explicit(&__seed_counter, 1, memory_order_relaxed);
+	return __wymix(base ^ __wyp[0], count ^ __wyp[1]);
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <tds/allocator.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *__libc_alloc(void *ctx, size_t size)
+{
+	(void) ctx;
+	return malloc(size);
+}
+
+static void *__libc_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+	(void) ctx;
+	(void) old_size;
+	return realloc(ptr, new_size);
+}
+
+static void __libc_free(void *ctx, void *ptr, size_t size)
+{
+	(void) ctx;
+	(void) size;
+	free(ptr);
+}
+
+static const tds_allocator __tallocator_libc = {__libc_alloc, __libc_realloc, __libc_free, NULL};
+
+const tds_allocator *tds_allocator_libc(void)
+{
+	return &__tallocator_libc;
+}
+
+/* A NULL allocator calls the C library directly, so that the default
+ * containers pay no indirect call
+ */
+
+void *tds_allocator_alloc(const tds_allocator *alloc, size_t size)
+{
+	if (NULL == alloc)
+		return malloc(size);
+	assert(NULL != alloc->falloc);
+	return alloc->falloc(alloc->ctx, size);
+}
+
+void *tds_allocator_calloc(const tds_allocator *alloc, size_t size)
+{
+	void *ptr = NULL;
+
+	if (NULL == alloc || &__tallocator_libc == alloc)
+		return calloc(1, size);
+	if (NULL != (ptr = tds_allocator_alloc(alloc, size)))
+		memset(ptr, 0, size);
+	return ptr;
+}
+
+void *tds_allocator_realloc(const tds_allocator *alloc, void *ptr, size_t old_size, size_t new_size)
+{
+	void *new_ptr = NULL;
+
+	if (NULL == alloc)
+		return realloc(ptr, new_size);
+	if (NULL != alloc->frealloc)
+		return alloc->frealloc(alloc->ctx, ptr, old_size, new_size);
+	if (NULL == (new_ptr = tds_allocator_alloc(alloc, new_size)))
+		return NULL;
+	if (NULL != ptr) {
+		memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+		tds_allocator_free(alloc, ptr, old_size);
+	}
+	return new_ptr;
+}
+
+void tds_allocator_free(const tds_allocator *alloc, void *ptr, size_t size)
+{
+	if (NULL == alloc)
+		free(ptr);
+	else if (NULL != alloc->ffree && NULL != ptr)
+		alloc->ffree(alloc->ctx, ptr, size);
+}
+
+int tds_allocator_frees(const tds_allocator *alloc)
+{
+	return NULL == alloc || NULL != alloc->ffree;
+}
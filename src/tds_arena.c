@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <tds/arena.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define __tarena_chunk_size      (64 * 1024)
+#define __tarena_chunk_size_min  256
+#define __tarena_align           _Alignof(max_align_t)
+#define __tarena_round(size)     (((size) + __tarena_align - 1) & ~(__tarena_align - 1))
+#define __tarena_header          __tarena_round(sizeof(struct tds_arena_chunk))
+
+struct tds_arena_chunk {
+	struct tds_arena_chunk *__prev;  /* the chunk filled before, or the next kept one */
+	size_t __size;                   /* bytes after the header */
+	size_t __used_before;            /* bytes used in the chunks before */
+	/* the blocks follow the header */
+};
+
+struct tds_arena {
+	struct tds_arena_chunk *__chunk;  /* blocks are cut from this one, NULL if none */
+	size_t __used;                    /* bytes used in `__chunk` */
+	struct tds_arena_chunk *__kept;   /* chunks released by reset & rewind */
+	void *__last;                     /* the last block, resizable in place */
+
+	size_t __chunk_size;
+	size_t __capacity;
+	const tds_allocator *__chunk_alloc;
+	tds_allocator __alloc;  /* the arena as an allocator */
+};
+
+
+/******************************************************************************
+ * Part 1. Chunks
+ ******************************************************************************/
+
+static char *chunk_data(const struct tds_arena_chunk *chunk)
+{
+	return ((char *) chunk) + __tarena_header;
+}
+
+static void chunk_free(const tds_arena *arena, struct tds_arena_chunk *chunk)
+{
+	tds_allocator_free(arena->__chunk_alloc, chunk, __tarena_header + chunk->__size);
+}
+
+/* Make a chunk of at least `size` bytes the current one: the smallest kept
+ * chunk large enough (so that a chunk of a large block is left for the next
+ * large block), or a new chunk
+ * Return a bool indicating the success
+ */
+static int chunk_push(tds_arena *arena, size_t size)
+{
+	struct tds_arena_chunk **pos = NULL;
+	struct tds_arena_chunk **iter = &arena->__kept;
+	struct tds_arena_chunk *chunk = NULL;
+	size_t chunk_size = size > arena->__chunk_size ? size : arena->__chunk_size;
+
+	for (; NULL != *iter; iter = &(*iter)->__prev) {
+		if ((*iter)->__size >= size && (NULL == pos || (*iter)->__size < (*pos)->__size))
+			pos = iter;
+	}
+	if (NULL != pos) {
+		chunk = *pos;
+		*pos = chunk->__prev;
+	} else {
+		if (chunk_size > (size_t) -1 - __tarena_header)
+			return 0;
+		if (NULL == (chunk = (struct tds_arena_chunk *) tds_allocator_alloc( \
+			arena->__chunk_alloc, __tarena_header + chunk_size)))
+			return 0;
+		chunk->__size = chunk_size;
+		arena->__capacity += chunk_size;
+	}
+	chunk->__used_before = tds_arena_used(arena);
+	chunk->__prev = arena->__chunk;
+	arena->__chunk = chunk;
+	arena->__used = 0;
+	return 1;
+}
+
+
+/******************************************************************************
+ * Part 2. Creation & Free
+ ******************************************************************************/
+
+static void *__arena_falloc(void *ctx, size_t size)
+{
+	return tds_arena_alloc((tds_arena *) ctx, size);
+}
+
+static void *__arena_frealloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+	return tds_arena_realloc((tds_arena *) ctx, ptr, old_size, new_size);
+}
+
+tds_arena *tds_arena_create_g(size_t chunk_size, const tds_allocator *alloc)
+{
+	tds_arena *arena = NULL;
+
+	if (chunk_size < __tarena_chunk_size_min)
+		chunk_size = __tarena_chunk_size_min;
+	if (NULL == (arena = (tds_arena *) tds_allocator_alloc(alloc, sizeof(tds_arena)))) {
+		printf("Error ... tds_arena_create_g\n");
+		return NULL;
+	}
+	arena->__chunk = NULL;
+	arena->__used = 0;
+	arena->__kept = NULL;
+	arena->__last = NULL;
+	arena->__chunk_size = __tarena_round(chunk_size);
+	arena->__capacity = 0;
+	arena->__chunk_alloc = alloc;
+	arena->__alloc.falloc = __arena_falloc;
+	arena->__alloc.frealloc = __arena_frealloc;
+	arena->__alloc.ffree = NULL;
+	arena->__alloc.ctx = arena;
+	return arena;
+}
+
+tds_arena *tds_arena_create(void)
+{
+	return tds_arena_create_g(__tarena_chunk_size, NULL);
+}
+
+tds_arena *tds_arena_force_create_g(size_t chunk_size, const tds_allocator *alloc)
+{
+	tds_arena *arena = tds_arena_create_g(chunk_size, alloc);
+
+	if (NULL == arena) {
+		printf("Error ... tds_arena_force_create_g\n");
+		exit(-1);
+	}
+	return arena;
+}
+
+tds_arena *tds_arena_force_create(void)
+{
+	tds_arena *arena = tds_arena_create();
+
+	if (NULL == arena) {
+		printf("Error ... tds_arena_force_create\n");
+		exit(-1);
+	}
+	return arena;
+}
+
+void tds_arena_free(tds_arena *arena)
+{
+	assert(NULL != arena);
+	tds_arena_reset(arena);  /* all chunks are kept */
+	while (NULL != arena->__kept) {
+		struct tds_arena_chunk *chunk = arena->__kept;
+		arena->__kept = chunk->__prev;
+		chunk_free(arena, chunk);
+	}
+	tds_allocator_free(arena->__chunk_alloc, arena, sizeof(tds_arena));
+}
+
+const tds_allocator *tds_arena_allocator(tds_arena *arena)
+{
+	assert(NULL != arena);
+	return &arena->__alloc;
+}
+
+
+/******************************************************************************
+ * Part 3. Allocation
+ ******************************************************************************/
+
+void *tds_arena_alloc(tds_arena *arena, size_t size)
+{
+	void *ptr = NULL;
+	assert(NULL != arena);
+
+	if (size > (size_t) -1 - __tarena_align) {
+		printf("Error ... tds_arena_alloc\n");
+		return NULL;
+	}
+	size = 0 == size ? __tarena_align : __tarena_round(size);
+	if (NULL == arena->__chunk || size > arena->__chunk->__size - arena->__used) {
+		if (!chunk_push(arena, size)) {
+			printf("Error ... tds_arena_alloc\n");
+			return NULL;
+		}
+	}
+	ptr = chunk_data(arena->__chunk) + arena->__used;
+	arena->__used += size;
+	arena->__last = ptr;
+	return ptr;
+}
+
+void *tds_arena_realloc(tds_arena *arena, void *ptr, size_t old_size, size_t new_size)
+{
+	void *new_ptr = NULL;
+	assert(NULL != arena);
+
+	if (NULL == ptr)
+		return tds_arena_alloc(arena, new_size);
+	if (ptr == arena->__last && new_size <= (size_t) -1 - __tarena_align) {
+		size_t pos = (size_t) ((char *) ptr - chunk_data(arena->__chunk));
+		size_t size = 0 == new_size ? __tarena_align : __tarena_round(new_size);
+
+		if (size <= arena->__chunk->__size - pos) {
+			arena->__used = pos + size;
+			return ptr;
+		}
+	}
+	if (new_size <= old_size)
+		return ptr;
+	if (NULL == (new_ptr = tds_arena_alloc(arena, new_size))) {
+		printf("Error ... tds_arena_realloc\n");
+		return NULL;
+	}
+	memcpy(new_ptr, ptr, old_size);
+	return new_ptr;
+}
+
+
+/******************************************************************************
+ * Part 4. Mark, Rewind & Reset
+ ******************************************************************************/
+
+tds_arenamark tds_arena_mark(const tds_arena *arena)
+{
+	tds_arenamark mark;
+
+	assert(NULL != arena);
+	mark.__chunk = arena->__chunk;
+	mark.__used = arena->__used;
+	return mark;
+}
+
+void tds_arena_rewind(tds_arena *arena, tds_arenamark mark)
+{
+	assert(NULL != arena);
+
+	while (arena->__chunk != (struct tds_arena_chunk *) mark.__chunk) {
+		struct tds_arena_chunk *chunk = arena->__chunk;
+
+		assert(NULL != chunk);  /* else `mark` is not in the arena */
+		arena->__chunk = chunk->__prev;
+		chunk->__prev = arena->__kept;
+		arena->__kept = chunk;
+	}
+	assert(mark.__used <= (NULL == arena->__chunk ? 0 : arena->__chunk->__size));
+	arena->__used = mark.__used;
+	arena->__last = NULL;
+}
+
+void tds_arena_reset(tds_arena *arena)
+{
+	tds_arenamark mark;
+
+	mark.__chunk = NULL;
+	mark.__used = 0;
+	tds_arena_rewind(arena, mark);
+}
+
+size_t tds_arena_used(const tds_arena *arena)
+{
+	assert(NULL != arena);
+	if (NULL == arena->__chunk)
+		return 0;
+	return arena->__chunk->__used_before + arena->__used;
+}
+
+size_t tds_arena_capacity(const tds_arena *arena)
+{
+	assert(NULL != arena);
+	return arena->__capacity;
+}
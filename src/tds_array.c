@@ -18,22 +18,25 @@ struct tds_array {
 #define tds_array_basic_size  sizeof(tds_array)
 
 
-tds_array *tds_array_create(size_t elesize, size_t capacity)
+tds_array *tds_array_create_g(size_t elesize, size_t capacity, const tds_allocator *alloc)
 {
 	tds_array *arr = NULL;
-	size_t array_data_size = elesize * capacity;
-	size_t array_total_size = tds_array_basic_size + array_data_size;
+	size_t array_total_size = tds_array_basic_size + elesize * capacity;
 
-	if (NULL == (arr = (tds_array *) malloc(array_total_size))) {
-		printf("Error ... tds_array_create\n");
+	if (NULL == (arr = (tds_array *) tds_allocator_calloc(alloc, array_total_size))) {
+		printf("Error ... tds_array_create_g\n");
 		return NULL;
 	}
-	memset(tds_array_data(arr), 0, array_data_size);  /* initialization */
 	arr->__capacity = capacity;
 	arr->__elesize = elesize;
 	return arr;
 }
 
+tds_array *tds_array_create(size_t elesize, size_t capacity)
+{
+	return tds_array_create_g(elesize, capacity, NULL);
+}
+
 tds_array *tds_array_force_create(size_t elesize, size_t capacity)
 {
 	tds_array *arr = tds_array_create(elesize, capacity);
@@ -45,10 +48,15 @@ tds_array *tds_array_force_create(size_t elesize, size_t capacity)
 	return arr;
 }
 
-void tds_array_free(tds_array *arr)
+void tds_array_free_g(tds_array *arr, const tds_allocator *alloc)
 {
 	assert(NULL != arr);
-	free(arr);
+	tds_allocator_free(alloc, arr, tds_array_basic_size + arr->__elesize * arr->__capacity);
+}
+
+void tds_array_free(tds_array *arr)
+{
+	tds_array_free_g(arr, NULL);
 }
 
 void * tds_array_data(const tds_array *arr)
@@ -89,7 +97,7 @@ void tds_array_set(tds_array *arr, size_t loc, const void *ele)
 	memcpy(p + arr->__elesize * loc, ele, arr->__elesize);
 }
 
-int tds_array_resize(tds_array **arr, size_t new_capacity)
+int tds_array_resize_g(tds_array **arr, size_t new_capacity, const tds_allocator *alloc)
 {
 	tds_array *new_arr = NULL;
 	size_t new_arr_total_size = 0;
@@ -100,7 +108,8 @@ int tds_array_resize(tds_array **arr, size_t new_capacity)
 		return 1;  /* success, no need to realloc */
 	elesize = (*arr)->__elesize;
 	new_arr_total_size = tds_array_basic_size + elesize * new_capacity;
-	if (NULL == (new_arr = realloc(*arr, new_arr_total_size))) {
+	if (NULL == (new_arr = (tds_array *) tds_allocator_realloc(alloc, *arr, \
+		tds_array_basic_size + elesize * (*arr)->__capacity, new_arr_total_size))) {
 		printf("Error ... tds_array_resize\n");
 		return 0;  /* failure */
 	}
@@ -110,6 +119,11 @@ int tds_array_resize(tds_array **arr, size_t new_capacity)
 	return 1;
 }
 
+int tds_array_resize(tds_array **arr, size_t new_capacity)
+{
+	return tds_array_resize_g(arr, new_capacity, NULL);
+}
+
 void tds_array_force_resize(tds_array **arr, size_t new_capacity)
 {
 	if (!tds_array_resize(arr, new_capacity)) {
@@ -15,10 +15,11 @@
 struct tds_arraylist {
 	size_t __len;
 	tds_array *__data;  /* created by array construction function */
+	const tds_allocator *__alloc;
 };
 
 
-tds_arraylist *tds_arraylist_create_g(size_t elesize, size_t capacity)
+tds_arraylist *tds_arraylist_create_g(size_t elesize, size_t capacity, const tds_allocator *alloc)
 {
 	tds_arraylist *list = NULL;
 	size_t true_capacity = tds_arraylist_init_len;
@@ -27,27 +28,28 @@ tds_arraylist *tds_arraylist_create_g(size_t elesize, size_t capacity)
 
 	while (true_capacity < capacity)
 		true_capacity *= 2;
-	if (NULL == (list = (tds_arraylist *)malloc(sizeof(tds_arraylist)))) {
+	if (NULL == (list = (tds_arraylist *) tds_allocator_alloc(alloc, sizeof(tds_arraylist)))) {
 		printf("Error ... tds_arraylist_create_g\n");
 		return NULL;
 	}
-	if (NULL == (list->__data = tds_array_create(elesize, true_capacity))) {
-		free(list);
+	if (NULL == (list->__data = tds_array_create_g(elesize, true_capacity, alloc))) {
+		tds_allocator_free(alloc, list, sizeof(tds_arraylist));
 		printf("Error ... tds_arraylist_create_g\n");
 		return NULL;
 	}
 	list->__len = 0;
+	list->__alloc = alloc;
 	return list;
 }
 
 tds_arraylist *tds_arraylist_create(size_t elesize)
 {
-	return tds_arraylist_create_g(elesize, tds_arraylist_init_len);
+	return tds_arraylist_create_g(elesize, tds_arraylist_init_len, NULL);
 }
 
-tds_arraylist *tds_arraylist_force_create_g(size_t elesize, size_t capacity)
+tds_arraylist *tds_arraylist_force_create_g(size_t elesize, size_t capacity, const tds_allocator *alloc)
 {
-	tds_arraylist* re = tds_arraylist_create_g(elesize, capacity);
+	tds_arraylist* re = tds_arraylist_create_g(elesize, capacity, alloc);
 
 	if (NULL == re) {
 		printf("Error .. tds_arraylist_force_create_g\n");
@@ -58,14 +60,14 @@ tds_arraylist *tds_arraylist_force_create_g(size_t elesize, size_t capacity)
 
 tds_arraylist *tds_arraylist_force_create(size_t elesize)
 {
-	return tds_arraylist_force_create_g(elesize, tds_arraylist_init_len);
+	return tds_arraylist_force_create_g(elesize, tds_arraylist_init_len, NULL);
 }
 
 void tds_arraylist_free(tds_arraylist *list)
 {
 	assert(NULL != list);
-	tds_array_free(list->__data);
-	free(list);
+	tds_array_free_g(list->__data, list->__alloc);
+	tds_allocator_free(list->__alloc, list, sizeof(tds_arraylist));
 }
 
 
@@ -92,6 +94,26 @@ void tds_arraylist_set(tds_arraylist *list, size_t loc, const void *ele)
 }
 
 
+int tds_arraylist_reserve(tds_arraylist *list, size_t capacity)
+{
+	size_t new_capacity = 0;
+	tds_array *dta_arr = NULL;
+	assert(NULL != list);
+
+	if (capacity <= tds_arraylist_capacity(list))
+		return 1;  /* success, enough capacity */
+	new_capacity = tds_arraylist_capacity(list);
+	while (new_capacity < capacity)
+		new_capacity *= 2;
+	dta_arr = list->__data;
+	if (!tds_array_resize_g(&dta_arr, new_capacity, list->__alloc)) {
+		printf("Error ... tds_arraylist_reserve\n");
+		return 0;  /* failure */
+	}
+	list->__data = dta_arr;
+	return 1;
+}
+
 int tds_arraylist_pushback(tds_arraylist *list, const void *ele)
 {
 	assert(NULL != list);
@@ -104,7 +126,7 @@ int tds_arraylist_pushback(tds_arraylist *list, const void *ele)
 	} else {
 		tds_array *dta_arr = list->__data;
 
-		if (!tds_array_resize(&dta_arr, 2 * tds_arraylist_capacity(list))) {
+		if (!tds_array_resize_g(&dta_arr, 2 * tds_arraylist_capacity(list), list->__alloc)) {
 			printf("Error ... tds_arraylist_pushback\n");
 			return 0;  /* failure */
 		}
@@ -3,6 +3,7 @@
  * License: MIT <https://opensource.org/licenses/MIT>
  */
 #include <tds/avltree.h>
+#include <tds/pool.h>
 
 #include <assert.h>
 #include <stdio.h>
@@ -28,11 +29,10 @@ struct tds_avltree {
 	size_t __len;
 	size_t __elesize;
 
-	/* buffer */
-	/* buffer is a stack maintained by only `father` and `child_l` */
-	size_t __buffer_limit;
-	size_t __buffer_len;
-	struct tds_avltreenode *__buffer_head;
+	/* the nodes, and the buffer of the free ones */
+	tds_pool *__pool;
+
+	const tds_allocator *__alloc;
 };
 
 
@@ -44,10 +44,9 @@ struct tds_avltree {
 
 /* On failure, return a `NULL` pointer
  */
-static struct tds_avltreenode *node_create(size_t elesize)
+static struct tds_avltreenode *node_create(const tds_avltree *tree)
 {
-	size_t total_size = elesize + tds_avltreenode_basic_size;
-	struct tds_avltreenode *node = (struct tds_avltreenode *) malloc(total_size);
+	struct tds_avltreenode *node = (struct tds_avltreenode *) tds_pool_get(tree->__pool);
 
 	if (NULL == node) {
 		printf("Error ... node_create\n");
@@ -60,9 +59,9 @@ static struct tds_avltreenode *node_create(size_t elesize)
 	return node;
 }
 
-static void node_free(struct tds_avltreenode *node)
+static void node_free(const tds_avltree *tree, struct tds_avltreenode *node)
 {
-	free(node);
+	tds_pool_put(tree->__pool, node);
 }
 
 static void *node_data(const struct tds_avltreenode *node)
@@ -127,61 +126,19 @@ static int node_depth(const struct tds_avltreenode *node)
 }
 
 /******************************************************************************
- * Part 2: Binary tree related operations with buffer
+ * Part 2: Binary tree related operations
  *
- * The tree structure, statistics and buffer are all adjusted, only without
+ * The tree structure and statistics are both adjusted, only without
  * rotation (re-balancing) operations
  *****************************************************************************/
 
-static struct tds_avltreenode *buffer_pop(tds_avltree *tree)
-{
-	struct tds_avltreenode *buffer_head = NULL;
-	assert(NULL != tree);
-
-	if (NULL != tree->__buffer_head) {
-		buffer_head = tree->__buffer_head;
-		tree->__buffer_head = buffer_head->__child_l;
-		if (NULL != tree->__buffer_head)
-			tree->__buffer_head->__father = NULL;
-		tree->__buffer_len--;
-	}
-	return buffer_head;
-}
-
-/* Return a bool indicating success
- * If unsussessful, the `node` is unchanged
- */
-static int buffer_try_append( \
-	tds_avltree *tree, struct tds_avltreenode *node, int force_buffer)
-{
-	assert(NULL != tree);
-	assert(NULL != node);
-	assert(tree->__buffer_limit > 0);
-
-	if (tree->__buffer_len == tree->__buffer_limit) {
-		if (force_buffer) {
-			struct tds_avltreenode *head = buffer_pop(tree);
-			/* head is not `NULL` since `buffer_len` > 0 */
-			node_free(head);
-		} else
-			return 0;  /* failure */
-	}
-	node->__father = NULL;
-	node->__child_l = tree->__buffer_head;  /* could be NULL */
-	if (NULL != tree->__buffer_head)
-		tree->__buffer_head->__father = node;
-	tree->__buffer_head = node;
-	tree->__buffer_len++;
-	return 1;
-}
-
 /* Remove `node` from the binary tree
  *
  * Warning: we assume that `node` is in `tree`
  * Don't use this function any elsewhere!!!
  */
 static struct tds_avltreenode *binary_tree_rm_node( \
-	tds_avltree *tree, struct tds_avltreenode *node, int force_buffer)
+	tds_avltree *tree, struct tds_avltreenode *node)
 {
 	struct tds_avltreenode *c_l = NULL;
 	struct tds_avltreenode *c_r = NULL;
@@ -233,23 +190,16 @@ static struct tds_avltreenode *binary_tree_rm_node( \
 	} else {
 		int select_prev = node_depth(prev) > node_depth(next);
 		struct tds_avltreenode *selected = select_prev ? prev : next;
-		father = binary_tree_rm_node(tree, selected, 1);
 		/* NOTE: recursion
-		 * 	The `selected` is NOT being freed since it is buffered
-		 * 	Hence, its data is still reachable
+		 * 	The data of `selected` is copied before it is freed
 		 */
 		memcpy(node_data(node),node_data(selected), tree->__elesize);
-		return father;
+		return binary_tree_rm_node(tree, selected);
 	}
 	/* Adjust the tree statistics
 	 */
 	tree->__len--;
-	/*
-	 * Buffer or release the node
-	 */
-	if (0 == buffer_try_append(tree, node, force_buffer)) {
-		node_free(node);
-	}
+	node_free(tree, node);
 	return father;
 }
 
@@ -264,14 +214,9 @@ static struct tds_avltreenode *bintree_add_node_to( \
 	struct tds_avltreenode *the_node = NULL;
 	assert(NULL != tree);
 
-	if (tree->__buffer_len == 0)
-		the_node = node_create(tree->__elesize);
-	else  /* if there is node in buffer stack */
-		the_node = buffer_pop(tree);
-	if (NULL == the_node)
+	if (NULL == (the_node = node_create(tree)))
 		return NULL;
 	the_node->__father = father;
-	/* child_l, child_r, height are unchanged */
 
 	if (NULL != father) {
 		if (left)
@@ -287,96 +232,55 @@ static struct tds_avltreenode *bintree_add_node_to( \
 	return the_node;
 }
 
-/* Warning: the input `iter` must be `tree->__root_node`
- * Don't use this function any elsewhere!!!
- */
-static void bintree_clear(tds_avltree *tree, struct tds_avltreenode *iter, int force_buffer)
-{
-	if (NULL != iter) {
-		if (NULL == iter->__child_l && NULL == iter->__child_r)
-			binary_tree_rm_node(tree, iter, force_buffer);
-		else if (NULL != iter->__child_l && NULL == iter->__child_r) {
-			bintree_clear(tree, iter->__child_l, force_buffer);
-			binary_tree_rm_node(tree, iter, force_buffer);
-		} else if (NULL == iter->__child_l && NULL != iter->__child_r) {
-			bintree_clear(tree, iter->__child_r, force_buffer);
-			binary_tree_rm_node(tree, iter, force_buffer);
-		} else {
-			bintree_clear(tree, iter->__child_l, force_buffer);
-			bintree_clear(tree, iter->__child_r, force_buffer);
-			binary_tree_rm_node(tree, iter, force_buffer);
-		}
-	}
-}
-
-static void bintree_clear_fast(tds_avltree *tree, struct tds_avltreenode *iter)
-{
-	if (NULL != iter) {
-		if (NULL == iter->__child_l && NULL == iter->__child_r)
-			node_free(iter);
-		else if (NULL != iter->__child_l && NULL == iter->__child_r) {
-			bintree_clear_fast(tree, iter->__child_l);
-			node_free(iter);
-		} else if (NULL == iter->__child_l && NULL != iter->__child_r) {
-			bintree_clear_fast(tree, iter->__child_r);
-			node_free(iter);
-		} else {
-			bintree_clear_fast(tree, iter->__child_l);
-			bintree_clear_fast(tree, iter->__child_r);
-			node_free(iter);
-		}
-	}
-}
-
 /******************************************************************************
  * Part 3: AVL tree related operations
  *
  *****************************************************************************/
 
-tds_avltree *tds_avltree_create_g(size_t elesize, size_t bufferlim)
+tds_avltree *tds_avltree_create_g(size_t elesize, size_t bufferlim, const tds_allocator *alloc)
 {
 	tds_avltree *tree = NULL;
 
 	assert(elesize > 0);
 	assert(bufferlim > 0);
 
-	if (NULL == (tree = (tds_avltree *) malloc(sizeof(tds_avltree)))) {
+	if (NULL == (tree = (tds_avltree *) tds_allocator_alloc(alloc, sizeof(tds_avltree)))) {
+		printf("Error ... tds_avltree_create\n");
+		return NULL;
+	}
+	if (NULL == (tree->__pool = tds_pool_create_g(elesize + tds_avltreenode_basic_size, 0, \
+		bufferlim, alloc))) {
+		tds_allocator_free(alloc, tree, sizeof(tds_avltree));
 		printf("Error ... tds_avltree_create\n");
 		return NULL;
 	}
 	tree->__root_node = NULL;
 	tree->__len = 0;
 	tree->__elesize = elesize;
-	tree->__buffer_limit = bufferlim;
-	tree->__buffer_len = 0;
-	tree->__buffer_head = NULL;
+	tree->__alloc = alloc;
 	return tree;
 }
 
 tds_avltree *tds_avltree_create(size_t elesize)
 {
-	return tds_avltree_create_g(elesize, tds_avltree_buffer_limit);
+	return tds_avltree_create_g(elesize, tds_avltree_buffer_limit, NULL);
 }
 
 void tds_avltree_free_buffer(tds_avltree *tree)
 {
-	struct tds_avltreenode *buffer_node = tree->__buffer_head;
-	struct tds_avltreenode *buffer_node_freed = NULL;
 	assert(NULL != tree);
-	while (NULL != buffer_node) {
-		buffer_node_freed = buffer_node;
-		buffer_node = buffer_node->__child_l;
-		node_free(buffer_node_freed);
-	}
-	tree->__buffer_head = NULL;
+	tds_pool_trim(tree->__pool);
 }
 
+/* The nodes are released with their slabs, not one by one
+ */
 void tds_avltree_free(tds_avltree *tree)
 {
 	assert(NULL != tree);
-	bintree_clear_fast(tree, tree->__root_node);
-	tds_avltree_free_buffer(tree);
-	free(tree);
+	if (!tds_allocator_frees(tree->__alloc))
+		return;  /* the nodes go with the allocator (an arena) */
+	tds_pool_free(tree->__pool);
+	tds_allocator_free(tree->__alloc, tree, sizeof(tds_avltree));
 }
 
 size_t tds_avltree_len(const tds_avltree *tree)
@@ -646,16 +550,23 @@ static struct tds_avltreenode *avltree_rebalance(struct tds_avltreenode *node)
 	 *        c_r (1)    (-1) c_l         (1) c_l                   c_r (-1)
 	 *          \             /                 \                   /
 	 *          c_rr       c_ll                 c_lr             c_rl
-	 * Case 1: rota_l    Case 2: rota_r    Case 3: rota_r    Case 4: rota_l
+	 * Case 1: rota_l    Case 2: rota_r    Case 3: rota_l c_l, rota_r
+	 *                                     Case 4: rota_r c_r, rota_l
 	 */
 	int bfac_node = 0;
 	assert(NULL != node);
 	bfac_node = node_balace_factor(node);
 
-	if (bfac_node == 2)
+	if (bfac_node == 2) {
+		if (node_balace_factor(node->__child_r) < 0)
+			avltree_rotation_r(node->__child_r);
 		return avltree_rotation_l(node);
-	if (bfac_node == -2)
+	}
+	if (bfac_node == -2) {
+		if (node_balace_factor(node->__child_l) > 0)
+			avltree_rotation_l(node->__child_l);
 		return avltree_rotation_r(node);
+	}
 	return node;
 }
 
@@ -705,9 +616,7 @@ int tds_avltree_insert(tds_avltree *tree, void *ele, tds_fcmp_t _f)
 	return 1;
 }
 
-/* The deleted node is not released but forced to be buffered
- */
-int avltree_delete_g(tds_avltree *tree, void *key, tds_fcmp_t _f, int force_buffer)
+int tds_avltree_delete(tds_avltree *tree, void *key, tds_fcmp_t _f)
 {
 	struct tds_avltreenode *node = NULL;
 	struct tds_avltreenode *node_father = NULL;
@@ -721,7 +630,7 @@ int avltree_delete_g(tds_avltree *tree, void *key, tds_fcmp_t _f, int force_buff
 		printf("Error ... tds_avltree_delete\n");
 		return 0;  /* failure */
 	}
-	node_father = binary_tree_rm_node(tree, node, force_buffer);
+	node_father = binary_tree_rm_node(tree, node);
 	/*
 	 * Re-balancing
 	 * We start searching from `node_father`, the father of deleted node
@@ -736,8 +645,3 @@ int avltree_delete_g(tds_avltree *tree, void *key, tds_fcmp_t _f, int force_buff
 	}
 	return 1;
 }
-
-int tds_avltree_delete(tds_avltree *tree, void *key, tds_fcmp_t _f)
-{
-	return avltree_delete_g(tree, key, _f, 0);
-}
@@ -2,6 +2,7 @@
  * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
  * License: MIT <https://opensource.org/licenses/MIT>
  */
+#include <tds.h>
 #include <tds/bitarray.h>
 
 #include <assert.h>
@@ -10,31 +11,166 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* Bulk kernels: AVX2 when the compiler targets it (e.g. `-mavx2` or
+ * `-march=native`), otherwise SSE2 on x86, otherwise a loop over words.
+ * Defining `tds_no_simd` forces the portable loop.
+ */
+#if !defined(tds_no_simd) && defined(__AVX2__)
+#define __tbitarray_avx2
+#include <immintrin.h>
+#elif !defined(tds_no_simd) && (defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define __tbitarray_sse2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
 struct tds_bitarray
 {
-	size_t __nbyte;
-	/* `__nbyte` more spaces for data storage */
+	size_t __nword;
+	const tds_allocator *__alloc;
+	/* `__nword` 64-bit words for data storage */
 };
 
 #define tds_bitarray_basic_size  sizeof(tds_bitarray)
 
+#define __tbitarray_word_bits  64
 
-tds_bitarray *tds_bitarray_create(size_t capacity)
+/* Bulk operations
+ */
+#define __tbitarray_op_and  0
+#define __tbitarray_op_or   1
+#define __tbitarray_op_xor  2
+#define __tbitarray_op_not  3
+
+/* Rank/select index: a 64-bit count of the bits before each superblock, and a
+ * 16-bit count of the bits before each block, from the start of its superblock
+ */
+#define __tbitarray_block_words  8      /* 512 bits, one cache line */
+#define __tbitarray_super_bits   65536  /* the block counts fit 16 bits */
+#define __tbitarray_super_blocks (__tbitarray_super_bits / (__tbitarray_word_bits * __tbitarray_block_words))
+
+struct tds_bitarray_index
+{
+	size_t __nword;     /* words of the indexed array */
+	size_t __nblock;    /* one more than needed, for the end of the array */
+	size_t __nsuper;
+	size_t __total;     /* bits set */
+	uint64_t *__super;  /* `__nsuper` counts */
+	uint16_t *__block;  /* `__nblock` counts */
+	const tds_allocator *__alloc;  /* of the indexed array */
+};
+
+
+static uint64_t *__tds_bitarray_words(const tds_bitarray *arr)
+{
+	return (uint64_t *) tds_bitarray_data(arr);
+}
+
+/* Number of bits set, the `popcnt` instruction when the compiler targets it
+ * (e.g. `-mpopcnt` or `-march=native`)
+ */
+static int __popcount64(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	return (int) __popcnt64(word);
+#else
+	word = word - ((word >> 1) & 0x5555555555555555ULL);
+	word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+	word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int) ((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* Index of the lowest set bit, `word` != 0
+ */
+static int __ctz64(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long idx;
+	_BitScanForward64(&idx, word);
+	return (int) idx;
+#else
+	int idx = 0;
+
+	while (0 == (word & 1)) {
+		word >>= 1;
+		idx++;
+	}
+	return idx;
+#endif
+}
+
+/* The bits [lo, hi) of a word, 0 <= lo < hi <= 64
+ */
+static uint64_t __tds_bitarray_mask(size_t lo, size_t hi)
+{
+	return (~(uint64_t) 0 >> (__tbitarray_word_bits - (hi - lo))) << lo;
+}
+
+/* Index of the `k`-th (from 0) set bit of `word`, `k` < popcount(word)
+ */
+static int __select64(uint64_t word, size_t k)
+{
+#if defined(__BMI2__)
+	return __ctz64(_pdep_u64((uint64_t) 1 << k, word));
+#else
+	int base = 0;
+	int cnt = 0;
+
+	while (k >= (size_t) (cnt = __popcount64(word & 0xFF))) {  /* skip whole bytes */
+		k -= (size_t) cnt;
+		word >>= 8;
+		base += 8;
+	}
+	for (; k > 0; k--)
+		word &= word - 1;  /* clear the lowest set bit */
+	return base + __ctz64(word);
+#endif
+}
+
+tds_bitarray *tds_bitarray_create_g(size_t capacity, const tds_allocator *alloc)
 {
 	tds_bitarray *arr = NULL;
-	size_t nbyte = 1;
+	size_t nword = (capacity + __tbitarray_word_bits - 1) / __tbitarray_word_bits;
 	size_t bitarray_total_size = 0;
 
-	while (8 * nbyte < capacity)
-		nbyte++;
-	bitarray_total_size = tds_bitarray_basic_size + nbyte;
+	if (0 == nword)
+		nword = 1;
+	bitarray_total_size = tds_bitarray_basic_size + nword * sizeof(uint64_t);
 
-	if (NULL == (arr = (tds_bitarray *) malloc(bitarray_total_size))) {
-		printf("Error ... tds_array_create\n");
+	if (NULL == (arr = (tds_bitarray *) tds_allocator_alloc(alloc, bitarray_total_size))) {
+		printf("Error ... tds_bitarray_create_g\n");
 		return NULL;
 	}
-	arr->__nbyte = nbyte;
-	memset(tds_bitarray_data(arr), 0, nbyte);  /* initialize as 0 */
+	arr->__nword = nword;
+	arr->__alloc = alloc;
+	memset(tds_bitarray_data(arr), 0, nword * sizeof(uint64_t));  /* initialize as 0 */
+	return arr;
+}
+
+tds_bitarray *tds_bitarray_create(size_t capacity)
+{
+	return tds_bitarray_create_g(capacity, NULL);
+}
+
+tds_bitarray *tds_bitarray_force_create_g(size_t capacity, const tds_allocator *alloc)
+{
+	tds_bitarray *arr = tds_bitarray_create_g(capacity, alloc);
+
+	if (NULL == arr) {
+		printf("Error ... tds_bitarray_force_create_g\n");
+		exit(-1);
+	}
 	return arr;
 }
 
@@ -52,18 +188,15 @@ tds_bitarray *tds_bitarray_force_create(size_t capacity)
 void tds_bitarray_free(tds_bitarray *arr)
 {
 	assert(NULL != arr);
-	free(arr);
+	tds_allocator_free(arr->__alloc, arr, tds_bitarray_basic_size + arr->__nword * sizeof(uint64_t));
 }
 
 void tds_bitarray_init(tds_bitarray *arr, int b)
 {
-	size_t idx;
-
 	assert(NULL != arr);
 	assert(b == 0 || b == 1);
 
-	for (idx = 0; idx < tds_bitarray_capacity(arr); idx++)
-		tds_bitarray_set(arr, idx, b);
+	memset(tds_bitarray_data(arr), b ? 0xFF : 0, arr->__nword * sizeof(uint64_t));
 }
 
 
@@ -75,27 +208,17 @@ void *tds_bitarray_data(const tds_bitarray *arr)
 size_t tds_bitarray_capacity(const tds_bitarray *arr)
 {
 	assert(NULL != arr);
-	return 8 * arr->__nbyte;
-}
-
-static void __print_binary(unsigned char num)
-{
-	int i;
-
-	for (i = 7; i >= 0; i--) {
-		unsigned char bit = (num >> i) & 1;
-		printf("%u", bit);
-	}
-	printf(" ");
+	return __tbitarray_word_bits * arr->__nword;
 }
 
 void tds_bitarray_print(const tds_bitarray *arr)
 {
-	int i;
+	size_t idx;
 
-	for (i = 0; i < arr->__nbyte; i++) {
-		unsigned char *p = (unsigned char *) tds_bitarray_data(arr);
-		__print_binary(p[i]);
+	for (idx = 0; idx < tds_bitarray_capacity(arr); idx++) {
+		printf("%d", tds_bitarray_get(arr, idx));
+		if (7 == idx % 8)
+			printf(" ");
 	}
 	printf("\n");
 }
@@ -103,149 +226,193 @@ void tds_bitarray_print(const tds_bitarray *arr)
 
 int tds_bitarray_get(const tds_bitarray *arr, size_t loc)
 {
-	uint8_t fake_byte;  /* the unsigned char contains the bit */
-	uint8_t bit_loc;    /* the index of the bit */
-	size_t byte_loc;    /* the index of fake_byte */
-	uint8_t *p;         /* transform void* to unsigned char pointer */
+	uint64_t word;  /* the word containing the bit */
 
 	assert(NULL != arr);
-	assert(loc < 8 * arr->__nbyte);
+	assert(loc < tds_bitarray_capacity(arr));
 
-	byte_loc = loc / 8;
-	bit_loc = loc % 8;
-	p = (uint8_t *) tds_bitarray_data(arr);
-	fake_byte = p[byte_loc];
-
-	fake_byte <<= bit_loc;
-	fake_byte >>= 7;
-	return fake_byte;
+	word = __tds_bitarray_words(arr)[loc / __tbitarray_word_bits];
+	return (int) ((word >> (loc % __tbitarray_word_bits)) & 1);
 }
 
 void tds_bitarray_set(tds_bitarray *arr, size_t loc, int b)
 {
-	uint8_t fake_byte;  /* the unsigned char containing the bit */
-	uint8_t bit_loc;    /* the index of the bit */
-	size_t byte_loc;    /* the index of fake_byte */
-	uint8_t *p;         /* transform void* to unsigned char pointer */
+	uint64_t *word;  /* the word containing the bit */
+	uint64_t mask;   /* the bit in the word */
 
 	assert(NULL != arr);
-	assert(loc < 8 * arr->__nbyte);
+	assert(loc < tds_bitarray_capacity(arr));
 	assert(b == 0 || b == 1);
 
-	byte_loc = loc / 8;
-	bit_loc = loc % 8;
-	p = (uint8_t *) tds_bitarray_data(arr);
-	fake_byte = p[byte_loc];
-	fake_byte = (fake_byte & ~(1 << (7 - bit_loc))) | (b << (7 - bit_loc));
-	/* Assign the (7-bit_loc) bit of `fake_byte` as b (either 0 or 1)
+	word = __tds_bitarray_words(arr) + loc / __tbitarray_word_bits;
+	mask = (uint64_t) 1 << (loc % __tbitarray_word_bits);
+	*word = (*word & ~mask) | (((uint64_t) 0 - (uint64_t) b) & mask);
+	/* Assign the bit of `*word` as b (either 0 or 1)
 	 *
 	 * Note:
-	 * 	1. `x & ~(1 << n)` assign the n bit of x as 0
-	 * 	2. `x | (1 << n)` assign the n bit of x as 1
+	 * 	1. `x & ~mask` assign the bit of x as 0
+	 * 	2. `0 - b` is all ones if b is 1 and all zeros if b is 0
 	 */
-	memset(p + byte_loc, fake_byte, 1);
 }
 
-tds_bitarray *tds_bitarray_and(const tds_bitarray *arr1, const tds_bitarray *arr2)
+/* dst[i] = a[i] op b[i] for the `n` words, `b` is unused by not
+ *
+ * `dst` may be `a` or `b`, the loads of a vector precede its store.
+ */
+static void __tds_bitarray_bulk(uint64_t *dst, const uint64_t *a, const uint64_t *b, size_t n, int op)
 {
-	tds_bitarray *new_arr = NULL;
-	size_t idx;
+	size_t idx = 0;
+
+#if defined(__tbitarray_avx2)
+	const __m256i ones = _mm256_set1_epi32(-1);
+
+	for (; idx + 4 <= n; idx += 4) {
+		__m256i va = _mm256_loadu_si256((const __m256i *) (a + idx));
+		__m256i vb = __tbitarray_op_not == op ? ones : _mm256_loadu_si256((const __m256i *) (b + idx));
+		__m256i vc;
+
+		switch (op) {
+		case __tbitarray_op_and: vc = _mm256_and_si256(va, vb); break;
+		case __tbitarray_op_or:  vc = _mm256_or_si256(va, vb); break;
+		default:                 vc = _mm256_xor_si256(va, vb); break;  /* xor, not */
+		}
+		_mm256_storeu_si256((__m256i *) (dst + idx), vc);
+	}
+#elif defined(__tbitarray_sse2)
+	const __m128i ones = _mm_set1_epi32(-1);
+
+	for (; idx + 2 <= n; idx += 2) {
+		__m128i va = _mm_loadu_si128((const __m128i *) (a + idx));
+		__m128i vb = __tbitarray_op_not == op ? ones : _mm_loadu_si128((const __m128i *) (b + idx));
+		__m128i vc;
+
+		switch (op) {
+		case __tbitarray_op_and: vc = _mm_and_si128(va, vb); break;
+		case __tbitarray_op_or:  vc = _mm_or_si128(va, vb); break;
+		default:                 vc = _mm_xor_si128(va, vb); break;  /* xor, not */
+		}
+		_mm_storeu_si128((__m128i *) (dst + idx), vc);
+	}
+#endif
+	/* the remaining words, or all of them without SIMD */
+	switch (op) {
+	case __tbitarray_op_and:
+		for (; idx < n; idx++)
+			dst[idx] = a[idx] & b[idx];
+		break;
+	case __tbitarray_op_or:
+		for (; idx < n; idx++)
+			dst[idx] = a[idx] | b[idx];
+		break;
+	case __tbitarray_op_xor:
+		for (; idx < n; idx++)
+			dst[idx] = a[idx] ^ b[idx];
+		break;
+	default:
+		for (; idx < n; idx++)
+			dst[idx] = ~a[idx];
+		break;
+	}
+}
 
-	assert(NULL != arr1);
-	assert(NULL != arr2);
-	assert(arr1->__nbyte == arr2->__nbyte);
+static tds_bitarray *__tds_bitarray_bulk_new(const tds_bitarray *arr1, const tds_bitarray *arr2, int op)
+{
+	tds_bitarray *new_arr = NULL;
 
-	if (NULL == (new_arr = tds_bitarray_create(8 * arr1->__nbyte)))
+	if (NULL == (new_arr = tds_bitarray_create_g(tds_bitarray_capacity(arr1), arr1->__alloc)))
 		return NULL;  /* create failure */
-	for (idx = 0; idx < arr1->__nbyte; idx++) {
-		uint8_t *p = (uint8_t *) tds_bitarray_data(new_arr);
-		uint8_t c1 = ((unsigned char *) tds_bitarray_data(arr1)) [idx];
-		uint8_t c2 = ((unsigned char *) tds_bitarray_data(arr2)) [idx];
-		uint8_t c = c1 & c2;
-		memset(p + idx, c, 1);
-	}
+	__tds_bitarray_bulk(__tds_bitarray_words(new_arr), __tds_bitarray_words(arr1),
+		__tds_bitarray_words(arr2), arr1->__nword, op);
 	return new_arr;
 }
 
-tds_bitarray *tds_bitarray_or(const tds_bitarray *arr1, const tds_bitarray *arr2)
+tds_bitarray *tds_bitarray_and(const tds_bitarray *arr1, const tds_bitarray *arr2)
 {
-	tds_bitarray *new_arr = NULL;
-	size_t idx;
-
 	assert(NULL != arr1);
 	assert(NULL != arr2);
-	assert(arr1->__nbyte == arr2->__nbyte);
+	assert(arr1->__nword == arr2->__nword);
+	return __tds_bitarray_bulk_new(arr1, arr2, __tbitarray_op_and);
+}
 
-	if (NULL == (new_arr = tds_bitarray_create(8 * arr1->__nbyte)))
-		return NULL;  /* create failure */
-	for (idx = 0; idx < arr1->__nbyte; idx++) {
-		uint8_t *p = (uint8_t *) tds_bitarray_data(new_arr);
-		uint8_t c1 = ((unsigned char *) tds_bitarray_data(arr1)) [idx];
-		uint8_t c2 = ((unsigned char *) tds_bitarray_data(arr2)) [idx];
-		uint8_t c = c1 | c2;
-		memset(p + idx, c, 1);
-	}
-	return new_arr;
+tds_bitarray *tds_bitarray_or(const tds_bitarray *arr1, const tds_bitarray *arr2)
+{
+	assert(NULL != arr1);
+	assert(NULL != arr2);
+	assert(arr1->__nword == arr2->__nword);
+	return __tds_bitarray_bulk_new(arr1, arr2, __tbitarray_op_or);
 }
 
 tds_bitarray *tds_bitarray_xor(const tds_bitarray *arr1, const tds_bitarray *arr2)
 {
-	tds_bitarray *new_arr = NULL;
-	size_t idx;
-
 	assert(NULL != arr1);
 	assert(NULL != arr2);
-	assert(arr1->__nbyte == arr2->__nbyte);
-
-	if (NULL == (new_arr = tds_bitarray_create(8 * arr1->__nbyte)))
-		return NULL;  /* create failure */
-	for (idx = 0; idx < arr1->__nbyte; idx++) {
-		uint8_t *p = (uint8_t *) tds_bitarray_data(new_arr);
-		uint8_t c1 = ((unsigned char *) tds_bitarray_data(arr1)) [idx];
-		uint8_t c2 = ((unsigned char *) tds_bitarray_data(arr2)) [idx];
-		uint8_t c = c1 ^ c2;
-		memset(p + idx, c, 1);
-	}
-	return new_arr;
+	assert(arr1->__nword == arr2->__nword);
+	return __tds_bitarray_bulk_new(arr1, arr2, __tbitarray_op_xor);
 }
 
 tds_bitarray *tds_bitarray_not(const tds_bitarray *arr)
 {
-	tds_bitarray *new_arr = NULL;
-	size_t idx;
-
 	assert(NULL != arr);
+	return __tds_bitarray_bulk_new(arr, arr, __tbitarray_op_not);
+}
 
-	if (NULL == (new_arr = tds_bitarray_create(8 * arr->__nbyte)))
-		return NULL;  /* create failure */
-	for (idx = 0; idx < arr->__nbyte; idx++) {
-		uint8_t *p = (uint8_t *) tds_bitarray_data(new_arr);
-		uint8_t c1 = ((unsigned char *) tds_bitarray_data(arr)) [idx];
-		uint8_t c = ~c1;
-		memset(p + idx, c, 1);
-	}
-	return new_arr;
+void tds_bitarray_and_inplace(tds_bitarray *dst, const tds_bitarray *src)
+{
+	assert(NULL != dst);
+	assert(NULL != src);
+	assert(dst->__nword == src->__nword);
+	__tds_bitarray_bulk(__tds_bitarray_words(dst), __tds_bitarray_words(dst),
+		__tds_bitarray_words(src), dst->__nword, __tbitarray_op_and);
+}
+
+void tds_bitarray_or_inplace(tds_bitarray *dst, const tds_bitarray *src)
+{
+	assert(NULL != dst);
+	assert(NULL != src);
+	assert(dst->__nword == src->__nword);
+	__tds_bitarray_bulk(__tds_bitarray_words(dst), __tds_bitarray_words(dst),
+		__tds_bitarray_words(src), dst->__nword, __tbitarray_op_or);
+}
+
+void tds_bitarray_xor_inplace(tds_bitarray *dst, const tds_bitarray *src)
+{
+	assert(NULL != dst);
+	assert(NULL != src);
+	assert(dst->__nword == src->__nword);
+	__tds_bitarray_bulk(__tds_bitarray_words(dst), __tds_bitarray_words(dst),
+		__tds_bitarray_words(src), dst->__nword, __tbitarray_op_xor);
+}
+
+void tds_bitarray_not_inplace(tds_bitarray *arr)
+{
+	assert(NULL != arr);
+	__tds_bitarray_bulk(__tds_bitarray_words(arr), __tds_bitarray_words(arr),
+		__tds_bitarray_words(arr), arr->__nword, __tbitarray_op_not);
 }
 
 int tds_bitarray_resize(tds_bitarray **arr, size_t new_capacity)
 {
 	tds_bitarray *new_arr = NULL;
-	size_t new_nbyte = 0;
+	size_t old_nword = 0;
+	size_t new_nword = 0;
 	size_t new_total_size = 0;
 	assert(NULL != arr);
 	assert(NULL != *arr);
 
-	if (new_capacity <= 8 * (*arr)->__nbyte)
+	if (new_capacity <= tds_bitarray_capacity(*arr))
 		return 1;  /* success: no need to resize */
-	new_nbyte = (*arr)->__nbyte;
-	while (new_capacity > 8 * new_nbyte)  /* calculate the new number of bytes */
-		new_nbyte *= 2;
-	new_total_size = tds_bitarray_basic_size + new_nbyte;
-	if (NULL == (new_arr = realloc(*arr, new_total_size))) {
+	old_nword = (*arr)->__nword;
+	new_nword = old_nword;
+	while (new_capacity > __tbitarray_word_bits * new_nword)  /* calculate the new number of words */
+		new_nword *= 2;
+	new_total_size = tds_bitarray_basic_size + new_nword * sizeof(uint64_t);
+	if (NULL == (new_arr = (tds_bitarray *) tds_allocator_realloc((*arr)->__alloc, *arr, \
+		tds_bitarray_basic_size + old_nword * sizeof(uint64_t), new_total_size))) {
 		printf("Error ... tds_bitarray_resize\n");
 		return 0;  /* failure */
 	}
-	new_arr->__nbyte = new_nbyte;
+	new_arr->__nword = new_nword;
+	memset(__tds_bitarray_words(new_arr) + old_nword, 0, (new_nword - old_nword) * sizeof(uint64_t));
 	*arr = new_arr;
 	return 1;
 }
@@ -257,3 +424,279 @@ void tds_bitarray_force_resize(tds_bitarray **arr, size_t new_capacity)
 		exit(-1);
 	}
 }
+
+
+/******************************************************************************
+ * Popcount, rank & select
+ ******************************************************************************/
+
+size_t tds_bitarray_popcount(const tds_bitarray *arr)
+{
+	const uint64_t *words = NULL;
+	size_t count = 0;
+	size_t idx = 0;
+	assert(NULL != arr);
+
+	words = __tds_bitarray_words(arr);
+	for (idx = 0; idx < arr->__nword; idx++)
+		count += (size_t) __popcount64(words[idx]);
+	return count;
+}
+
+tds_bitarray_index *tds_bitarray_index_create(const tds_bitarray *arr)
+{
+	tds_bitarray_index *index = NULL;
+	const uint64_t *words = NULL;
+	size_t nblock = 0;
+	size_t nsuper = 0;
+	size_t count = 0;  /* bits before the current block */
+	size_t b = 0;
+	size_t idx = 0;
+	assert(NULL != arr);
+
+	nblock = arr->__nword / __tbitarray_block_words + 1;
+	nsuper = (nblock - 1) / __tbitarray_super_blocks + 1;
+	if (NULL == (index = (tds_bitarray_index *) tds_allocator_alloc(arr->__alloc, sizeof(tds_bitarray_index)
+		+ nsuper * sizeof(uint64_t) + nblock * sizeof(uint16_t)))) {
+		printf("Error ... tds_bitarray_index_create\n");
+		return NULL;
+	}
+	index->__nword = arr->__nword;
+	index->__nblock = nblock;
+	index->__nsuper = nsuper;
+	index->__alloc = arr->__alloc;
+	index->__super = (uint64_t *) (index + 1);
+	index->__block = (uint16_t *) (index->__super + nsuper);
+
+	words = __tds_bitarray_words(arr);
+	for (b = 0; b < nblock; b++) {
+		size_t end = tds_MIN((b + 1) * __tbitarray_block_words, arr->__nword);
+
+		if (0 == b % __tbitarray_super_blocks)
+			index->__super[b / __tbitarray_super_blocks] = (uint64_t) count;
+		index->__block[b] = (uint16_t) (count - index->__super[b / __tbitarray_super_blocks]);
+		for (idx = b * __tbitarray_block_words; idx < end; idx++)
+			count += (size_t) __popcount64(words[idx]);
+	}
+	index->__total = count;
+	return index;
+}
+
+tds_bitarray_index *tds_bitarray_force_index_create(const tds_bitarray *arr)
+{
+	tds_bitarray_index *index = tds_bitarray_index_create(arr);
+
+	if (NULL == index) {
+		printf("Error ... tds_bitarray_force_index_create\n");
+		exit(-1);
+	}
+	return index;
+}
+
+void tds_bitarray_index_free(tds_bitarray_index *index)
+{
+	assert(NULL != index);
+	tds_allocator_free(index->__alloc, index, sizeof(tds_bitarray_index)
+		+ index->__nsuper * sizeof(uint64_t) + index->__nblock * sizeof(uint16_t));
+}
+
+/* `count` plus the number of bits set in the words [from, w)
+ */
+static size_t __tds_bitarray_rank_words(const uint64_t *words, size_t from, size_t count, size_t w)
+{
+	for (; from < w; from++)
+		count += (size_t) __popcount64(words[from]);
+	return count;
+}
+
+size_t tds_bitarray_rank1(const tds_bitarray *arr, const tds_bitarray_index *index, size_t loc)
+{
+	const uint64_t *words = NULL;
+	size_t w = loc / __tbitarray_word_bits;
+	size_t count = 0;
+	assert(NULL != arr);
+	assert(loc <= tds_bitarray_capacity(arr));
+	assert(NULL == index || index->__nword == arr->__nword);
+
+	words = __tds_bitarray_words(arr);
+	if (NULL != index) {
+		size_t b = w / __tbitarray_block_words;
+
+		count = (size_t) index->__super[b / __tbitarray_super_blocks] + index->__block[b];
+		count = __tds_bitarray_rank_words(words, b * __tbitarray_block_words, count, w);
+	} else {
+		count = __tds_bitarray_rank_words(words, 0, 0, w);
+	}
+	if (0 != loc % __tbitarray_word_bits)
+		count += (size_t) __popcount64(words[w] << (__tbitarray_word_bits - loc % __tbitarray_word_bits));
+	return count;
+}
+
+size_t tds_bitarray_select1(const tds_bitarray *arr, const tds_bitarray_index *index, size_t k)
+{
+	const uint64_t *words = NULL;
+	size_t w = 0;
+	size_t count = 0;  /* bits before the word `w` */
+	assert(NULL != arr);
+	assert(NULL == index || index->__nword == arr->__nword);
+
+	words = __tds_bitarray_words(arr);
+	if (NULL != index) {
+		size_t lo = 0;
+		size_t hi = 0;
+
+		if (k >= index->__total)
+			return tds_bitarray_capacity(arr);
+		/* the last superblock, then the last block, starting at or before the bit */
+		lo = 0;
+		hi = index->__nsuper;
+		while (hi - lo > 1) {
+			size_t mid = lo + (hi - lo) / 2;
+
+			if (index->__super[mid] <= k)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		count = (size_t) index->__super[lo];
+		hi = tds_MIN((lo + 1) * __tbitarray_super_blocks, index->__nblock);
+		lo = lo * __tbitarray_super_blocks;
+		while (hi - lo > 1) {
+			size_t mid = lo + (hi - lo) / 2;
+
+			if (count + index->__block[mid] <= k)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		count += index->__block[lo];
+		w = lo * __tbitarray_block_words;
+	}
+	for (; w < arr->__nword; w++) {
+		size_t cnt = (size_t) __popcount64(words[w]);
+
+		if (k < count + cnt)
+			return w * __tbitarray_word_bits + (size_t) __select64(words[w], k - count);
+		count += cnt;
+	}
+	return tds_bitarray_capacity(arr);
+}
+
+
+/******************************************************************************
+ * Search, iteration & ranges
+ ******************************************************************************/
+
+/* First location at or after `from` whose bit differs from `b`
+ */
+static size_t __tds_bitarray_find(const tds_bitarray *arr, size_t from, int b)
+{
+	const uint64_t *words = NULL;
+	uint64_t flip = 0 == b ? 0 : ~(uint64_t) 0;  /* turns the bits searched into 1 */
+	uint64_t word = 0;
+	size_t w = from / __tbitarray_word_bits;
+	assert(NULL != arr);
+	assert(from <= tds_bitarray_capacity(arr));
+
+	if (w >= arr->__nword)
+		return tds_bitarray_capacity(arr);
+	words = __tds_bitarray_words(arr);
+	word = (words[w] ^ flip) & (~(uint64_t) 0 << (from % __tbitarray_word_bits));
+	while (0 == word) {
+		if (++w == arr->__nword)
+			return tds_bitarray_capacity(arr);
+		word = words[w] ^ flip;
+	}
+	return w * __tbitarray_word_bits + (size_t) __ctz64(word);
+}
+
+size_t tds_bitarray_find_next_set(const tds_bitarray *arr, size_t from)
+{
+	return __tds_bitarray_find(arr, from, 0);
+}
+
+size_t tds_bitarray_find_next_unset(const tds_bitarray *arr, size_t from)
+{
+	return __tds_bitarray_find(arr, from, 1);
+}
+
+void tds_bitarray_foreach_set(const tds_bitarray *arr, tds_bitarray_fvisit_t *visit, void *ctx)
+{
+	const uint64_t *words = NULL;
+	size_t w = 0;
+	assert(NULL != arr);
+	assert(NULL != visit);
+
+	words = __tds_bitarray_words(arr);
+	for (w = 0; w < arr->__nword; w++) {
+		uint64_t word = words[w];
+
+		while (0 != word) {
+			if (!visit(w * __tbitarray_word_bits + (size_t) __ctz64(word), ctx))
+				return;
+			word &= word - 1;  /* clear the lowest set bit */
+		}
+	}
+}
+
+/* Assign the bits [from, to) as `b`, the whole words by `memset`
+ */
+static void __tds_bitarray_fill(tds_bitarray *arr, size_t from, size_t to, int b)
+{
+	uint64_t *words = NULL;
+	size_t first = 0;  /* first word */
+	size_t last = 0;   /* last word */
+	uint64_t mask = 0;
+	assert(NULL != arr);
+	assert(from <= to && to <= tds_bitarray_capacity(arr));
+
+	if (from == to)
+		return;
+	words = __tds_bitarray_words(arr);
+	first = from / __tbitarray_word_bits;
+	last = (to - 1) / __tbitarray_word_bits;
+	if (first == last) {
+		mask = __tds_bitarray_mask(from % __tbitarray_word_bits, to - first * __tbitarray_word_bits);
+		words[first] = b ? words[first] | mask : words[first] & ~mask;
+		return;
+	}
+	mask = __tds_bitarray_mask(from % __tbitarray_word_bits, __tbitarray_word_bits);
+	words[first] = b ? words[first] | mask : words[first] & ~mask;
+	memset(words + first + 1, b ? 0xFF : 0, (last - first - 1) * sizeof(uint64_t));
+	mask = __tds_bitarray_mask(0, to - last * __tbitarray_word_bits);
+	words[last] = b ? words[last] | mask : words[last] & ~mask;
+}
+
+void tds_bitarray_set_range(tds_bitarray *arr, size_t from, size_t to)
+{
+	__tds_bitarray_fill(arr, from, to, 1);
+}
+
+void tds_bitarray_clear_range(tds_bitarray *arr, size_t from, size_t to)
+{
+	__tds_bitarray_fill(arr, from, to, 0);
+}
+
+size_t tds_bitarray_count_range(const tds_bitarray *arr, size_t from, size_t to)
+{
+	const uint64_t *words = NULL;
+	size_t first = 0;
+	size_t last = 0;
+	size_t count = 0;
+	assert(NULL != arr);
+	assert(from <= to && to <= tds_bitarray_capacity(arr));
+
+	if (from == to)
+		return 0;
+	words = __tds_bitarray_words(arr);
+	first = from / __tbitarray_word_bits;
+	last = (to - 1) / __tbitarray_word_bits;
+	if (first == last)
+		return (size_t) __popcount64(words[first]
+			& __tds_bitarray_mask(from % __tbitarray_word_bits, to - first * __tbitarray_word_bits));
+	count = (size_t) __popcount64(words[first]
+		& __tds_bitarray_mask(from % __tbitarray_word_bits, __tbitarray_word_bits));
+	count = __tds_bitarray_rank_words(words, first + 1, count, last);
+	return count + (size_t) __popcount64(words[last]
+		& __tds_bitarray_mask(0, to - last * __tbitarray_word_bits));
+}
@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <tds.h>
+#include <tds/bloom.h>
+#include <tds/bitarray.h>
+#include <ta/hash.h>
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define __tbloom_prefetch(p)  __builtin_prefetch(p)
+#else
+#define __tbloom_prefetch(p)  ((void) (p))
+#endif
+
+#define __tbloom_block_bytes  (tds_bloom_block_bits / 8)
+#define __tbloom_max_k        16
+#define __tbloom_batch        16  /* keys in flight in batched operations */
+#define __tbloom_seed         0x9E3779B97F4A7C15ULL  /* of `tds_bloom_create` */
+
+/* Serialized form: the header, then the blocks
+ */
+#define __tbloom_magic    "tdsbloom"
+#define __tbloom_version  1
+
+struct __tbloom_header {
+	char __magic[8];
+	uint32_t __version;
+	uint32_t __k;
+	uint64_t __nblocks;
+	uint64_t __seed;
+};
+
+/* The bit array holds one more block than used, so that the blocks can start
+ * at a 64-byte boundary of its storage
+ */
+struct tds_bloom {
+	tds_bitarray *__bits;
+	uint8_t *__blocks;  /* first aligned byte of `__bits` */
+	size_t __nblocks;
+	int __k;
+	uint64_t __seed;
+	const tds_allocator *__alloc;
+};
+
+
+/******************************************************************************
+ * Part 1. Bits of a key
+ *
+ * Bit `i` of a block is the bit `7 - i % 8` of its byte `i / 8`, so that the
+ * serialized bits do not depend on the byte order of the machine.
+ ******************************************************************************/
+
+static uint64_t __tds_bloom_code(const tds_bloom *bloom, const void *key, size_t len)
+{
+	return ta_hash_wy(key, len, bloom->__seed);
+}
+
+/* The block is selected by the high 32 bits of the code, scaled to the number
+ * of blocks without division
+ */
+static uint8_t *__tds_bloom_block(const tds_bloom *bloom, uint64_t code)
+{
+	size_t b = (size_t) (((code >> 32) * (uint64_t) bloom->__nblocks) >> 32);
+	return bloom->__blocks + b * __tbloom_block_bytes;
+}
+
+/* Assign the `k` bit positions of `code` in its block to `pos`, 9 bits each
+ * out of the remixed code, remixed again every 7 positions
+ */
+static void __tds_bloom_positions(const tds_bloom *bloom, uint64_t code, size_t *pos)
+{
+	uint64_t bits = 0;
+	int i = 0;
+
+	for (i = 0; i < bloom->__k; i++) {
+		if (0 == i % 7)
+			bits = ta_hash_u64(code, (uint64_t) i);
+		pos[i] = (size_t) (bits & (tds_bloom_block_bits - 1));
+		bits >>= 9;
+	}
+}
+
+static void __tds_bloom_insert_code(tds_bloom *bloom, uint64_t code)
+{
+	uint8_t *block = __tds_bloom_block(bloom, code);
+	size_t pos[__tbloom_max_k];
+	int i = 0;
+
+	__tds_bloom_positions(bloom, code, pos);
+	for (i = 0; i < bloom->__k; i++)
+		block[pos[i] / 8] |= (uint8_t) (0x80 >> (pos[i] % 8));
+}
+
+static int __tds_bloom_query_code(const tds_bloom *bloom, uint64_t code)
+{
+	const uint8_t *block = __tds_bloom_block(bloom, code);
+	size_t pos[__tbloom_max_k];
+	int i = 0;
+
+	__tds_bloom_positions(bloom, code, pos);
+	for (i = 0; i < bloom->__k; i++) {
+		if (0 == (block[pos[i] / 8] & (0x80 >> (pos[i] % 8))))
+			return 0;
+	}
+	return 1;
+}
+
+
+/******************************************************************************
+ * Part 2. Creation & Free
+ ******************************************************************************/
+
+tds_bloom *tds_bloom_create_g(size_t nbits, int k, uint64_t seed, const tds_allocator *alloc)
+{
+	tds_bloom *bloom = NULL;
+	size_t nblocks = (nbits + tds_bloom_block_bits - 1) / tds_bloom_block_bits;
+	uintptr_t data = 0;
+	assert(1 <= k && k <= __tbloom_max_k);
+
+	if (0 == nblocks)
+		nblocks = 1;
+	assert(nblocks <= UINT32_MAX);
+	if (NULL == (bloom = (tds_bloom *) tds_allocator_alloc(alloc, sizeof(tds_bloom)))) {
+		printf("Error ... tds_bloom_create_g\n");
+		return NULL;
+	}
+	if (NULL == (bloom->__bits = tds_bitarray_create_g((nblocks + 1) * tds_bloom_block_bits, alloc))) {
+		tds_allocator_free(alloc, bloom, sizeof(tds_bloom));
+		printf("Error ... tds_bloom_create_g\n");
+		return NULL;
+	}
+	data = (uintptr_t) tds_bitarray_data(bloom->__bits);
+	bloom->__blocks = (uint8_t *) tds_bitarray_data(bloom->__bits) \
+		+ ((__tbloom_block_bytes - data % __tbloom_block_bytes) % __tbloom_block_bytes);
+	bloom->__nblocks = nblocks;
+	bloom->__k = k;
+	bloom->__seed = seed;
+	bloom->__alloc = alloc;
+	return bloom;
+}
+
+/* m = -n ln(p) / ln(2)^2 bits and k = m / n ln(2)
+ */
+tds_bloom *tds_bloom_create(size_t nkeys, double fpp)
+{
+	double nbits = 0;
+	int k = 0;
+	assert(0 < fpp && fpp < 1);
+
+	if (0 == nkeys)
+		nkeys = 1;
+	nbits = -(double) nkeys * log(fpp) / (log(2) * log(2));
+	k = (int) (nbits / nkeys * log(2) + 0.5);
+	k = tds_MAX(1, tds_MIN(k, __tbloom_max_k));
+	return tds_bloom_create_g((size_t) nbits, k, __tbloom_seed, NULL);
+}
+
+tds_bloom *tds_bloom_force_create_g(size_t nbits, int k, uint64_t seed, const tds_allocator *alloc)
+{
+	tds_bloom *bloom = NULL;
+
+	if (NULL == (bloom = tds_bloom_create_g(nbits, k, seed, alloc))) {
+		printf("Error ... tds_bloom_force_create_g\n");
+		exit(-1);
+	}
+	return bloom;
+}
+
+tds_bloom *tds_bloom_force_create(size_t nkeys, double fpp)
+{
+	tds_bloom *bloom = NULL;
+
+	if (NULL == (bloom = tds_bloom_create(nkeys, fpp))) {
+		printf("Error ... tds_bloom_force_create\n");
+		exit(-1);
+	}
+	return bloom;
+}
+
+void tds_bloom_free(tds_bloom *bloom)
+{
+	assert(NULL != bloom);
+	tds_bitarray_free(bloom->__bits);
+	tds_allocator_free(bloom->__alloc, bloom, sizeof(tds_bloom));
+}
+
+size_t tds_bloom_nbits(const tds_bloom *bloom)
+{
+	assert(NULL != bloom);
+	return bloom->__nblocks * tds_bloom_block_bits;
+}
+
+int tds_bloom_nhashes(const tds_bloom *bloom)
+{
+	assert(NULL != bloom);
+	return bloom->__k;
+}
+
+void tds_bloom_clear(tds_bloom *bloom)
+{
+	assert(NULL != bloom);
+	memset(bloom->__blocks, 0, bloom->__nblocks * __tbloom_block_bytes);
+}
+
+
+/******************************************************************************
+ * Part 3. Insert & Query
+ ******************************************************************************/
+
+void tds_bloom_insert(tds_bloom *bloom, const void *key, size_t len)
+{
+	assert(NULL != bloom);
+	assert(NULL != key || 0 == len);
+	__tds_bloom_insert_code(bloom, __tds_bloom_code(bloom, key, len));
+}
+
+int tds_bloom_query(const tds_bloom *bloom, const void *key, size_t len)
+{
+	assert(NULL != bloom);
+	assert(NULL != key || 0 == len);
+	return __tds_bloom_query_code(bloom, __tds_bloom_code(bloom, key, len));
+}
+
+/* Keys are processed by blocks of `__tbloom_batch`, all of them hashed and
+ * their blocks prefetched before any is resolved
+ */
+void tds_bloom_insert_batch(tds_bloom *bloom, const void *keys, size_t keysize, size_t n)
+{
+	uint64_t codes[__tbloom_batch];
+	const char *key_p = (const char *) keys;
+	size_t start = 0;
+	size_t idx = 0;
+	assert(NULL != bloom);
+	assert(NULL != keys || 0 == n);
+
+	for (start = 0; start < n; start += __tbloom_batch) {
+		size_t nb = n - start < __tbloom_batch ? n - start : __tbloom_batch;
+
+		for (idx = 0; idx < nb; idx++) {
+			codes[idx] = __tds_bloom_code(bloom, key_p + (start + idx) * keysize, keysize);
+			__tbloom_prefetch(__tds_bloom_block(bloom, codes[idx]));
+		}
+		for (idx = 0; idx < nb; idx++)
+			__tds_bloom_insert_code(bloom, codes[idx]);
+	}
+}
+
+void tds_bloom_query_batch(const tds_bloom *bloom, const void *keys, size_t keysize, size_t n, int *out)
+{
+	uint64_t codes[__tbloom_batch];
+	const char *key_p = (const char *) keys;
+	size_t start = 0;
+	size_t idx = 0;
+	assert(NULL != bloom);
+	assert(NULL != keys || 0 == n);
+	assert(NULL != out || 0 == n);
+
+	for (start = 0; start < n; start += __tbloom_batch) {
+		size_t nb = n - start < __tbloom_batch ? n - start : __tbloom_batch;
+
+		for (idx = 0; idx < nb; idx++) {
+			codes[idx] = __tds_bloom_code(bloom, key_p + (start + idx) * keysize, keysize);
+			__tbloom_prefetch(__tds_bloom_block(bloom, codes[idx]));
+		}
+		for (idx = 0; idx < nb; idx++)
+			out[start + idx] = __tds_bloom_query_code(bloom, codes[idx]);
+	}
+}
+
+int tds_bloom_union(tds_bloom *dst, const tds_bloom *src)
+{
+	const uint8_t *src_p = NULL;
+	uint8_t *dst_p = NULL;
+	size_t nbytes = 0;
+	size_t idx = 0;
+	assert(NULL != dst);
+	assert(NULL != src);
+
+	if (dst->__nblocks != src->__nblocks || dst->__k != src->__k || dst->__seed != src->__seed) {
+		printf("Error ... tds_bloom_union\n");
+		return 0;
+	}
+	dst_p = dst->__blocks;
+	src_p = src->__blocks;
+	nbytes = dst->__nblocks * __tbloom_block_bytes;
+	for (idx = 0; idx < nbytes; idx++)
+		dst_p[idx] |= src_p[idx];
+	return 1;
+}
+
+
+/******************************************************************************
+ * Part 4. Serialization
+ ******************************************************************************/
+
+size_t tds_bloom_serialized_size(const tds_bloom *bloom)
+{
+	assert(NULL != bloom);
+	return sizeof(struct __tbloom_header) + bloom->__nblocks * __tbloom_block_bytes;
+}
+
+void tds_bloom_serialize(const tds_bloom *bloom, void *buf)
+{
+	struct __tbloom_header head;
+	assert(NULL != bloom);
+	assert(NULL != buf);
+
+	memcpy(head.__magic, __tbloom_magic, sizeof(head.__magic));
+	head.__version = __tbloom_version;
+	head.__k = (uint32_t) bloom->__k;
+	head.__nblocks = (uint64_t) bloom->__nblocks;
+	head.__seed = bloom->__seed;
+	memcpy(buf, &head, sizeof(head));
+	memcpy((char *) buf + sizeof(head), bloom->__blocks, bloom->__nblocks * __tbloom_block_bytes);
+}
+
+tds_bloom *tds_bloom_deserialize(const void *buf, size_t len)
+{
+	struct __tbloom_header head;
+	tds_bloom *bloom = NULL;
+	assert(NULL != buf);
+
+	if (len < sizeof(head)) {
+		printf("Error ... tds_bloom_deserialize\n");
+		return NULL;
+	}
+	memcpy(&head, buf, sizeof(head));
+	if (0 != memcmp(head.__magic, __tbloom_magic, sizeof(head.__magic))
+	 || __tbloom_version != head.__version
+	 || head.__k < 1 || head.__k > __tbloom_max_k
+	 || head.__nblocks < 1 || head.__nblocks > UINT32_MAX
+	 || (len - sizeof(head)) / __tbloom_block_bytes != head.__nblocks
+	 || (len - sizeof(head)) % __tbloom_block_bytes != 0) {
+		printf("Error ... tds_bloom_deserialize\n");
+		return NULL;
+	}
+	if (NULL == (bloom = tds_bloom_create_g((size_t) head.__nblocks * tds_bloom_block_bits, \
+		(int) head.__k, head.__seed, NULL))) {
+		printf("Error ... tds_bloom_deserialize\n");
+		return NULL;
+	}
+	memcpy(bloom->__blocks, (const char *) buf + sizeof(head), bloom->__nblocks * __tbloom_block_bytes);
+	return bloom;
+}
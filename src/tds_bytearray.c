@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <tds/bytearray.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define __tbytearray_init_capacity  16
+#define __tbytearray_varint_max     10  /* bytes of a 64-bit varint */
+
+struct tds_bytearray
+{
+	unsigned char *__data;  /* created by the allocator */
+	size_t __len;
+	size_t __capacity;
+	const tds_allocator *__alloc;
+};
+
+
+/******************************************************************************
+ * Part 1. Creation & Free
+ ******************************************************************************/
+
+tds_bytearray *tds_bytearray_create_g(size_t capacity, const tds_allocator *alloc)
+{
+	tds_bytearray *arr = NULL;
+
+	if (capacity < __tbytearray_init_capacity)
+		capacity = __tbytearray_init_capacity;
+	if (NULL == (arr = (tds_bytearray *) tds_allocator_alloc(alloc, sizeof(tds_bytearray)))) {
+		printf("Error ... tds_bytearray_create_g\n");
+		return NULL;
+	}
+	if (NULL == (arr->__data = (unsigned char *) tds_allocator_alloc(alloc, capacity))) {
+		tds_allocator_free(alloc, arr, sizeof(tds_bytearray));
+		printf("Error ... tds_bytearray_create_g\n");
+		return NULL;
+	}
+	arr->__len = 0;
+	arr->__capacity = capacity;
+	arr->__alloc = alloc;
+	return arr;
+}
+
+tds_bytearray *tds_bytearray_create(void)
+{
+	return tds_bytearray_create_g(__tbytearray_init_capacity, NULL);
+}
+
+tds_bytearray *tds_bytearray_force_create_g(size_t capacity, const tds_allocator *alloc)
+{
+	tds_bytearray *arr = tds_bytearray_create_g(capacity, alloc);
+
+	if (NULL == arr) {
+		printf("Error ... tds_bytearray_force_create_g\n");
+		exit(-1);
+	}
+	return arr;
+}
+
+tds_bytearray *tds_bytearray_force_create(void)
+{
+	tds_bytearray *arr = tds_bytearray_create();
+
+	if (NULL == arr) {
+		printf("Error ... tds_bytearray_force_create\n");
+		exit(-1);
+	}
+	return arr;
+}
+
+void tds_bytearray_free(tds_bytearray *arr)
+{
+	assert(NULL != arr);
+	tds_allocator_free(arr->__alloc, arr->__data, arr->__capacity);
+	tds_allocator_free(arr->__alloc, arr, sizeof(tds_bytearray));
+}
+
+void tds_bytearray_clear(tds_bytearray *arr)
+{
+	assert(NULL != arr);
+	arr->__len = 0;
+}
+
+size_t tds_bytearray_len(const tds_bytearray *arr)
+{
+	assert(NULL != arr);
+	return arr->__len;
+}
+
+size_t tds_bytearray_capacity(const tds_bytearray *arr)
+{
+	assert(NULL != arr);
+	return arr->__capacity;
+}
+
+unsigned char *tds_bytearray_data(const tds_bytearray *arr)
+{
+	assert(NULL != arr);
+	return arr->__data;
+}
+
+
+/******************************************************************************
+ * Part 2. Writing
+ ******************************************************************************/
+
+int tds_bytearray_reserve(tds_bytearray *arr, size_t capacity)
+{
+	unsigned char *data = NULL;
+	size_t new_capacity = 0;
+	assert(NULL != arr);
+
+	if (capacity <= arr->__capacity)
+		return 1;
+	new_capacity = arr->__capacity;
+	while (new_capacity < capacity) {
+		if (new_capacity > (size_t) -1 / 2) {  /* doubling overflows */
+			new_capacity = capacity;
+			break;
+		}
+		new_capacity *= 2;
+	}
+	if (NULL == (data = (unsigned char *) tds_allocator_realloc(arr->__alloc, arr->__data, \
+		arr->__capacity, new_capacity))) {
+		printf("Error ... tds_bytearray_reserve\n");
+		return 0;
+	}
+	arr->__data = data;
+	arr->__capacity = new_capacity;
+	return 1;
+}
+
+unsigned char *tds_bytearray_extend(tds_bytearray *arr, size_t n)
+{
+	unsigned char *bytes = NULL;
+	assert(NULL != arr);
+
+	if (n > (size_t) -1 - arr->__len || !tds_bytearray_reserve(arr, arr->__len + n)) {
+		printf("Error ... tds_bytearray_extend\n");
+		return NULL;
+	}
+	bytes = arr->__data + arr->__len;
+	arr->__len += n;
+	return bytes;
+}
+
+int tds_bytearray_append(tds_bytearray *arr, const void *bytes, size_t n)
+{
+	unsigned char *dst = NULL;
+	assert(NULL != bytes || 0 == n);
+
+	if (NULL == (dst = tds_bytearray_extend(arr, n)))
+		return 0;
+	if (n > 0)
+		memcpy(dst, bytes, n);
+	return 1;
+}
+
+static void __tds_bytearray_write_le(unsigned char *dst, uint64_t value, size_t nbytes)
+{
+	size_t idx = 0;
+
+	for (idx = 0; idx < nbytes; idx++) {
+		dst[idx] = (unsigned char) value;
+		value >>= 8;
+	}
+}
+
+static void __tds_bytearray_write_be(unsigned char *dst, uint64_t value, size_t nbytes)
+{
+	size_t idx = nbytes;
+
+	while (idx > 0) {
+		dst[--idx] = (unsigned char) value;
+		value >>= 8;
+	}
+}
+
+int tds_bytearray_put_le(tds_bytearray *arr, uint64_t value, size_t nbytes)
+{
+	unsigned char *dst = NULL;
+	assert(1 <= nbytes && nbytes <= 8);
+
+	if (NULL == (dst = tds_bytearray_extend(arr, nbytes)))
+		return 0;
+	__tds_bytearray_write_le(dst, value, nbytes);
+	return 1;
+}
+
+int tds_bytearray_put_be(tds_bytearray *arr, uint64_t value, size_t nbytes)
+{
+	unsigned char *dst = NULL;
+	assert(1 <= nbytes && nbytes <= 8);
+
+	if (NULL == (dst = tds_bytearray_extend(arr, nbytes)))
+		return 0;
+	__tds_bytearray_write_be(dst, value, nbytes);
+	return 1;
+}
+
+int tds_bytearray_put_varint(tds_bytearray *arr, uint64_t value)
+{
+	unsigned char *dst = NULL;
+	size_t n = 0;
+	assert(NULL != arr);
+
+	if (!tds_bytearray_reserve(arr, arr->__len + __tbytearray_varint_max)) {
+		printf("Error ... tds_bytearray_put_varint\n");
+		return 0;
+	}
+	dst = arr->__data + arr->__len;
+	while (value >= 0x80) {
+		dst[n++] = (unsigned char) (value | 0x80);
+		value >>= 7;
+	}
+	dst[n++] = (unsigned char) value;
+	arr->__len += n;
+	return 1;
+}
+
+int tds_bytearray_put_svarint(tds_bytearray *arr, int64_t value)
+{
+	uint64_t u = (uint64_t) value;
+
+	return tds_bytearray_put_varint(arr, (u << 1) ^ (0 - (u >> 63)));
+}
+
+unsigned char *tds_bytearray_force_extend(tds_bytearray *arr, size_t n)
+{
+	unsigned char *bytes = tds_bytearray_extend(arr, n);
+
+	if (NULL == bytes) {
+		printf("Error ... tds_bytearray_force_extend\n");
+		exit(-1);
+	}
+	return bytes;
+}
+
+void tds_bytearray_force_append(tds_bytearray *arr, const void *bytes, size_t n)
+{
+	if (!tds_bytearray_append(arr, bytes, n)) {
+		printf("Error ... tds_bytearray_force_append\n");
+		exit(-1);
+	}
+}
+
+void tds_bytearray_force_put_le(tds_bytearray *arr, uint64_t value, size_t nbytes)
+{
+	if (!tds_bytearray_put_le(arr, value, nbytes)) {
+		printf("Error ... tds_bytearray_force_put_le\n");
+		exit(-1);
+	}
+}
+
+void tds_bytearray_force_put_be(tds_bytearray *arr, uint64_t value, size_t nbytes)
+{
+	if (!tds_bytearray_put_be(arr, value, nbytes)) {
+		printf("Error ... tds_bytearray_force_put_be\n");
+		exit(-1);
+	}
+}
+
+void tds_bytearray_force_put_varint(tds_bytearray *arr, uint64_t value)
+{
+	if (!tds_bytearray_put_varint(arr, value)) {
+		printf("Error ... tds_bytearray_force_put_varint\n");
+		exit(-1);
+	}
+}
+
+void tds_bytearray_force_put_svarint(tds_bytearray *arr, int64_t value)
+{
+	if (!tds_bytearray_put_svarint(arr, value)) {
+		printf("Error ... tds_bytearray_force_put_svarint\n");
+		exit(-1);
+	}
+}
+
+void tds_bytearray_set_le(tds_bytearray *arr, size_t pos, uint64_t value, size_t nbytes)
+{
+	assert(NULL != arr);
+	assert(1 <= nbytes && nbytes <= 8);
+	assert(pos <= arr->__len && nbytes <= arr->__len - pos);
+	__tds_bytearray_write_le(arr->__data + pos, value, nbytes);
+}
+
+void tds_bytearray_set_be(tds_bytearray *arr, size_t pos, uint64_t value, size_t nbytes)
+{
+	assert(NULL != arr);
+	assert(1 <= nbytes && nbytes <= 8);
+	assert(pos <= arr->__len && nbytes <= arr->__len - pos);
+	__tds_bytearray_write_be(arr->__data + pos, value, nbytes);
+}
+
+
+/******************************************************************************
+ * Part 3. Slices & Reading
+ ******************************************************************************/
+
+tds_byteslice tds_bytearray_slice(const tds_bytearray *arr, size_t pos, size_t n)
+{
+	assert(NULL != arr);
+	return tds_byteslice_sub(tds_byteslice_make(arr->__data, arr->__len), pos, n);
+}
+
+tds_byteslice tds_byteslice_make(const void *data, size_t len)
+{
+	tds_byteslice s;
+
+	assert(NULL != data || 0 == len);
+	s.data = (const unsigned char *) data;
+	s.len = len;
+	return s;
+}
+
+tds_byteslice tds_byteslice_sub(tds_byteslice s, size_t pos, size_t n)
+{
+	tds_byteslice sub;
+
+	assert(pos <= s.len && n <= s.len - pos);
+	sub.data = s.data + pos;
+	sub.len = n;
+	return sub;
+}
+
+uint64_t tds_byteslice_get_le(tds_byteslice s, size_t pos, size_t nbytes)
+{
+	uint64_t value = 0;
+	size_t idx = nbytes;
+
+	assert(1 <= nbytes && nbytes <= 8);
+	assert(pos <= s.len && nbytes <= s.len - pos);
+	while (idx > 0)
+		value = (value << 8) | s.data[pos + --idx];
+	return value;
+}
+
+uint64_t tds_byteslice_get_be(tds_byteslice s, size_t pos, size_t nbytes)
+{
+	uint64_t value = 0;
+	size_t idx = 0;
+
+	assert(1 <= nbytes && nbytes <= 8);
+	assert(pos <= s.len && nbytes <= s.len - pos);
+	for (idx = 0; idx < nbytes; idx++)
+		value = (value << 8) | s.data[pos + idx];
+	return value;
+}
+
+size_t tds_byteslice_get_varint(tds_byteslice s, size_t pos, uint64_t *value)
+{
+	uint64_t v = 0;
+	size_t n = 0;
+
+	assert(NULL != value);
+	assert(pos <= s.len);
+	for (n = 0; n < __tbytearray_varint_max && pos + n < s.len; n++) {
+		unsigned char byte = s.data[pos + n];
+
+		if (__tbytearray_varint_max - 1 == n && byte > 1)  /* above 64 bits */
+			return 0;
+		v |= (uint64_t) (byte & 0x7F) << (7 * n);
+		if (0 == (byte & 0x80)) {
+			*value = v;
+			return n + 1;
+		}
+	}
+	return 0;
+}
+
+size_t tds_byteslice_get_svarint(tds_byteslice s, size_t pos, int64_t *value)
+{
+	uint64_t u = 0;
+	size_t n = tds_byteslice_get_varint(s, pos, &u);
+
+	assert(NULL != value);
+	if (n > 0)
+		*value = (int64_t) ((u >> 1) ^ (0 - (u & 1)));
+	return n;
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <tds/cbitarray.h>
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define __tcbitarray_word_bits  64
+
+struct tds_cbitarray {
+	size_t __nword;
+	_Atomic uint64_t *__words;
+	const tds_allocator *__alloc;
+	char __pad[64];          /* keep the hint off the line of `__words` */
+	atomic_size_t __hint;    /* word of the last claim */
+};
+
+/* Index of the lowest set bit, `word` != 0
+ */
+static int __ctz64(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long idx;
+	_BitScanForward64(&idx, word);
+	return (int) idx;
+#else
+	int idx = 0;
+
+	while (0 == (word & 1)) {
+		word >>= 1;
+		idx++;
+	}
+	return idx;
+#endif
+}
+
+static int __popcount64(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	return (int) __popcnt64(word);
+#else
+	word = word - ((word >> 1) & 0x5555555555555555ULL);
+	word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+	word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int) ((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+#define __bit_of(loc)  ((uint64_t) 1 << ((loc) % __tcbitarray_word_bits))
+
+
+/******************************************************************************
+ * Part 1. Creation & Free
+ ******************************************************************************/
+
+tds_cbitarray *tds_cbitarray_create_g(size_t capacity, const tds_allocator *alloc)
+{
+	tds_cbitarray *arr = NULL;
+	size_t nword = (capacity + __tcbitarray_word_bits - 1) / __tcbitarray_word_bits;
+	size_t idx = 0;
+
+	if (0 == nword)
+		nword = 1;
+	if (NULL == (arr = (tds_cbitarray *) tds_allocator_alloc(alloc, sizeof(tds_cbitarray)))) {
+		printf("Error ... tds_cbitarray_create_g\n");
+		return NULL;
+	}
+	if (NULL == (arr->__words = (_Atomic uint64_t *) tds_allocator_alloc(alloc, nword * sizeof(_Atomic uint64_t)))) {
+		tds_allocator_free(alloc, arr, sizeof(tds_cbitarray));
+		printf("Error ... tds_cbitarray_create_g\n");
+		return NULL;
+	}
+	arr->__nword = nword;
+	arr->__alloc = alloc;
+	for (idx = 0; idx < nword; idx++)
+		atomic_init(&arr->__words[idx], 0);
+	atomic_init(&arr->__hint, 0);
+	return arr;
+}
+
+tds_cbitarray *tds_cbitarray_create(size_t capacity)
+{
+	return tds_cbitarray_create_g(capacity, NULL);
+}
+
+tds_cbitarray *tds_cbitarray_force_create_g(size_t capacity, const tds_allocator *alloc)
+{
+	tds_cbitarray *arr = tds_cbitarray_create_g(capacity, alloc);
+
+	if (NULL == arr) {
+		printf("Error ... tds_cbitarray_force_create_g\n");
+		exit(-1);
+	}
+	return arr;
+}
+
+tds_cbitarray *tds_cbitarray_force_create(size_t capacity)
+{
+	tds_cbitarray *arr = tds_cbitarray_create(capacity);
+
+	if (NULL == arr) {
+		printf("Error ... tds_cbitarray_force_create\n");
+		exit(-1);
+	}
+	return arr;
+}
+
+void tds_cbitarray_free(tds_cbitarray *arr)
+{
+	assert(NULL != arr);
+	tds_allocator_free(arr->__alloc, (void *) arr->__words, arr->__nword * sizeof(_Atomic uint64_t));
+	tds_allocator_free(arr->__alloc, arr, sizeof(tds_cbitarray));
+}
+
+size_t tds_cbitarray_capacity(const tds_cbitarray *arr)
+{
+	assert(NULL != arr);
+	return arr->__nword * __tcbitarray_word_bits;
+}
+
+
+/******************************************************************************
+ * Part 2. Bits & Words
+ ******************************************************************************/
+
+int tds_cbitarray_get(const tds_cbitarray *arr, size_t loc)
+{
+	assert(NULL != arr);
+	assert(loc < tds_cbitarray_capacity(arr));
+	return 0 != (atomic_load_explicit(&arr->__words[loc / __tcbitarray_word_bits], memory_order_acquire)
+		& __bit_of(loc));
+}
+
+void tds_cbitarray_set(tds_cbitarray *arr, size_t loc, int b)
+{
+	assert(NULL != arr);
+	assert(loc < tds_cbitarray_capacity(arr));
+
+	if (b)
+		atomic_fetch_or_explicit(&arr->__words[loc / __tcbitarray_word_bits], __bit_of(loc),
+			memory_order_release);
+	else
+		atomic_fetch_and_explicit(&arr->__words[loc / __tcbitarray_word_bits], ~__bit_of(loc),
+			memory_order_release);
+}
+
+int tds_cbitarray_test_and_set(tds_cbitarray *arr, size_t loc)
+{
+	assert(NULL != arr);
+	assert(loc < tds_cbitarray_capacity(arr));
+	return 0 != (atomic_fetch_or_explicit(&arr->__words[loc / __tcbitarray_word_bits], __bit_of(loc),
+		memory_order_acq_rel) & __bit_of(loc));
+}
+
+int tds_cbitarray_test_and_clear(tds_cbitarray *arr, size_t loc)
+{
+	assert(NULL != arr);
+	assert(loc < tds_cbitarray_capacity(arr));
+	return 0 != (atomic_fetch_and_explicit(&arr->__words[loc / __tcbitarray_word_bits], ~__bit_of(loc),
+		memory_order_acq_rel) & __bit_of(loc));
+}
+
+uint64_t tds_cbitarray_load_word(const tds_cbitarray *arr, size_t iword)
+{
+	assert(NULL != arr);
+	assert(iword < arr->__nword);
+	return atomic_load_explicit(&arr->__words[iword], memory_order_acquire);
+}
+
+uint64_t tds_cbitarray_fetch_or(tds_cbitarray *arr, size_t iword, uint64_t mask)
+{
+	assert(NULL != arr);
+	assert(iword < arr->__nword);
+	return atomic_fetch_or_explicit(&arr->__words[iword], mask, memory_order_acq_rel);
+}
+
+uint64_t tds_cbitarray_fetch_and(tds_cbitarray *arr, size_t iword, uint64_t mask)
+{
+	assert(NULL != arr);
+	assert(iword < arr->__nword);
+	return atomic_fetch_and_explicit(&arr->__words[iword], mask, memory_order_acq_rel);
+}
+
+size_t tds_cbitarray_popcount(const tds_cbitarray *arr)
+{
+	size_t count = 0;
+	size_t idx = 0;
+	assert(NULL != arr);
+
+	for (idx = 0; idx < arr->__nword; idx++)
+		count += (size_t) __popcount64(atomic_load_explicit(&arr->__words[idx], memory_order_relaxed));
+	return count;
+}
+
+
+/******************************************************************************
+ * Part 3. Claim & Release
+ *
+ * A claim reads a word, picks its lowest 0 and sets it by `fetch_or`: the bit
+ * is won iff it was 0 in the word returned. Otherwise another thread took it
+ * in between, and the returned word, being newer, gives the next 0 to try.
+ * Every failed attempt means another thread won a bit, so claims are
+ * lock-free.
+ ******************************************************************************/
+
+size_t tds_cbitarray_claim(tds_cbitarray *arr)
+{
+	size_t start = 0;
+	size_t n = 0;
+	assert(NULL != arr);
+
+	start = atomic_load_explicit(&arr->__hint, memory_order_relaxed);
+	for (n = 0; n < arr->__nword; n++) {
+		size_t iword = start + n < arr->__nword ? start + n : start + n - arr->__nword;
+		uint64_t word = atomic_load_explicit(&arr->__words[iword], memory_order_relaxed);
+
+		while (~word != 0) {
+			int ibit = __ctz64(~word);
+			uint64_t bit = (uint64_t) 1 << ibit;
+
+			word = atomic_fetch_or_explicit(&arr->__words[iword], bit, memory_order_acquire);
+			if (0 == (word & bit)) {
+				if (iword != start)
+					atomic_store_explicit(&arr->__hint, iword, memory_order_relaxed);
+				return iword * __tcbitarray_word_bits + (size_t) ibit;
+			}
+		}
+	}
+	return tds_cbitarray_capacity(arr);
+}
+
+void tds_cbitarray_release(tds_cbitarray *arr, size_t loc)
+{
+	uint64_t old = 0;
+	assert(NULL != arr);
+	assert(loc < tds_cbitarray_capacity(arr));
+
+	old = atomic_fetch_and_explicit(&arr->__words[loc / __tcbitarray_word_bits], ~__bit_of(loc),
+		memory_order_release);
+	assert(0 != (old & __bit_of(loc)));
+	(void) old;
+}
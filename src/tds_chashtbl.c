@@ -0,0 +1,689 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <tds/chashtbl.h>
+#include <ta/hash.h>
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define __tchashtbl_pause()  _mm_pause()
+#else
+#define __tchashtbl_pause()  ((void) 0)
+#endif
+
+#if defined(_WIN32)
+#include <windows.h>
+#define __tchashtbl_yield()  SwitchToThread()
+#else
+#include <sched.h>
+#define __tchashtbl_yield()  sched_yield()
+#endif
+
+#define __tchashtbl_nsegs_bits      6   /* 64 segments */
+#define __tchashtbl_nsegs           (1 << __tchashtbl_nsegs_bits)
+#define __tchashtbl_seg_capacity    16  /* minimal capacity of a segment */
+#define __tchashtbl_load_threshold  0.75
+#define __tchashtbl_ctrl_empty      ((uint8_t) 0x80)
+#define __tchashtbl_ctrl_deleted    ((uint8_t) 0xFE)
+#define __tchashtbl_spin            64  /* spins before yielding the CPU */
+#define __tchashtbl_line            64  /* cache line */
+
+/* The segment is selected by the highest bits of the hash code, the slot by
+ * the lower bits (h1), the control tag holds the lowest 7 bits (h2)
+ */
+#define __seg_of(code)  ((size_t) ((code) >> (64 - __tchashtbl_nsegs_bits)))
+#define __h1(code)      ((size_t) ((code) >> 7))
+#define __h2(code)      ((uint8_t) ((code) & 0x7F))
+
+/* The version of a slot counts its writes in the high bits, the lowest bit
+ * tells whether the slot holds a pair, and the parity of the count selects
+ * the copy holding it
+ */
+#define __ver_live(ver)        ((ver) & 1)
+#define __ver_copy(ver)        (((ver) >> 1) & 1)
+#define __ver_next(ver, live)  (((((ver) >> 1) + 1) << 1) | (live))
+
+/* A buffer of slots, allocated in one block
+ *
+ * 	[struct __tchashtbl_buf][slots][ctrl]
+ *
+ * A slot is a version followed by two copies of `__nwords` words: the hash
+ * code, then the pair. A writer fills the copy that readers do not use, then
+ * publishes it by the version. All of them are atomics: readers load them
+ * while writers store them. The version and the copies are adjacent, so
+ * that a hit usually costs the cache lines of the tag and of the slot.
+ */
+struct __tchashtbl_buf {
+	size_t __capacity;                 /* power of 2 */
+	size_t __nwords;
+	struct __tchashtbl_buf *__retired; /* next buffer waiting to be freed */
+	_Atomic uint64_t *__slots;
+	_Atomic uint8_t *__ctrl;
+};
+
+/* Two cache lines per segment: the first one is written by writers only,
+ * the second one by readers only, so that the writers of two segments never
+ * share a line and readers do not slow down the lock
+ *
+ * The buffers replaced by a resize are retired in the list of the current
+ * epoch, and freed once no reader that could still see them is inside the
+ * segment. A reader registers in the counter of the epoch it entered, and
+ * the epoch is only advanced when the readers of the epoch before are gone.
+ */
+struct __tchashtbl_seg {
+	_Alignas(__tchashtbl_line) atomic_flag __lock;  /* taken by writers */
+	atomic_size_t __epoch;
+	struct __tchashtbl_buf *_Atomic __buf;
+	atomic_size_t __usage;
+	atomic_size_t __capacity;
+	size_t __ntombs;                                 /* under the lock */
+	struct __tchashtbl_buf *__retired[2];            /* under the lock */
+	_Alignas(__tchashtbl_line) atomic_size_t __readers[2];
+};
+
+/* The segments are allocated with a cache line of slack, and `__segs` is
+ * aligned in that block: the allocator only aligns as `malloc` does
+ */
+#define __tchashtbl_segs_size  (__tchashtbl_nsegs * sizeof(struct __tchashtbl_seg) + __tchashtbl_line - 1)
+
+struct tds_chashtbl {
+	struct __tchashtbl_seg *__segs;
+	void *__segs_block;
+	size_t __pairsize;
+	size_t __keysize;
+	tds_fhash_t *__fhash;
+	uint64_t __seed;
+	const tds_allocator *__alloc;  /* shared by the writers of all segments */
+};
+
+
+/******************************************************************************
+ * Part 1. Buffers
+ ******************************************************************************/
+
+static size_t __buf_size(size_t pairsize, size_t capacity)
+{
+	size_t head = (sizeof(struct __tchashtbl_buf) + 15) / 16 * 16;
+	size_t nwords = 1 + (pairsize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	return head + capacity * (1 + 2 * nwords) * sizeof(uint64_t) + capacity;
+}
+
+/* The version of the slot `loc`, and the words of its copy `copy`
+ */
+static _Atomic uint64_t *__buf_ver(const struct __tchashtbl_buf *buf, size_t loc)
+{
+	return buf->__slots + loc * (1 + 2 * buf->__nwords);
+}
+
+static _Atomic uint64_t *__buf_copy(const struct __tchashtbl_buf *buf, size_t loc, size_t copy)
+{
+	return __buf_ver(buf, loc) + 1 + copy * buf->__nwords;
+}
+
+static struct __tchashtbl_buf *__buf_create(size_t pairsize, size_t capacity, const tds_allocator *alloc)
+{
+	size_t head = (sizeof(struct __tchashtbl_buf) + 15) / 16 * 16;
+	size_t nwords = 1 + (pairsize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+	struct __tchashtbl_buf *buf = NULL;
+	char *block = NULL;
+	size_t idx = 0;
+
+	block = (char *) tds_allocator_alloc(alloc, __buf_size(pairsize, capacity));
+	if (NULL == block)
+		return NULL;
+	buf = (struct __tchashtbl_buf *) block;
+	buf->__capacity = capacity;
+	buf->__nwords = nwords;
+	buf->__retired = NULL;
+	buf->__slots = (_Atomic uint64_t *) (block + head);
+	buf->__ctrl = (_Atomic uint8_t *) (buf->__slots + capacity * (1 + 2 * nwords));
+	for (idx = 0; idx < capacity; idx++) {
+		atomic_init(__buf_ver(buf, idx), 0);
+		atomic_init(buf->__ctrl + idx, __tchashtbl_ctrl_empty);
+	}
+	return buf;
+}
+
+static void __buf_free(struct __tchashtbl_buf *buf, size_t pairsize, const tds_allocator *alloc)
+{
+	while (NULL != buf) {
+		struct __tchashtbl_buf *retired = buf->__retired;
+		tds_allocator_free(alloc, buf, __buf_size(pairsize, buf->__capacity));
+		buf = retired;
+	}
+}
+
+/* Word-wise copies between the atomics and plain bytes, the last word is
+ * zero-padded
+ */
+static void __words_load(const _Atomic uint64_t *words, void *bytes, size_t nbytes)
+{
+	size_t idx = 0;
+
+	for (idx = 0; idx * sizeof(uint64_t) < nbytes; idx++) {
+		uint64_t word = atomic_load_explicit(words + idx, memory_order_relaxed);
+		size_t len = nbytes - idx * sizeof(uint64_t);
+
+		memcpy((char *) bytes + idx * sizeof(uint64_t), &word, len < sizeof(uint64_t) ? len : sizeof(uint64_t));
+	}
+}
+
+static void __words_store(_Atomic uint64_t *words, const void *bytes, size_t nbytes)
+{
+	size_t idx = 0;
+
+	for (idx = 0; idx * sizeof(uint64_t) < nbytes; idx++) {
+		uint64_t word = 0;
+		size_t len = nbytes - idx * sizeof(uint64_t);
+
+		memcpy(&word, (const char *) bytes + idx * sizeof(uint64_t), len < sizeof(uint64_t) ? len : sizeof(uint64_t));
+		atomic_store_explicit(words + idx, word, memory_order_relaxed);
+	}
+}
+
+static int __words_equal(const _Atomic uint64_t *words, const void *bytes, size_t nbytes)
+{
+	size_t idx = 0;
+
+	for (idx = 0; idx * sizeof(uint64_t) < nbytes; idx++) {
+		uint64_t word = atomic_load_explicit(words + idx, memory_order_relaxed);
+		size_t len = nbytes - idx * sizeof(uint64_t);
+
+		if (0 != memcmp(&word, (const char *) bytes + idx * sizeof(uint64_t), len < sizeof(uint64_t) ? len : sizeof(uint64_t)))
+			return 0;
+	}
+	return 1;
+}
+
+/* The lookup of readers, lock-free
+ *
+ * Pairs never move inside a buffer, and a slot never gets empty again, so
+ * the probing only needs each slot to be read consistently: its current copy
+ * is read between two loads of its version, and read again if a writer
+ * published a new copy meanwhile. The copy being filled by a writer is never
+ * the one read, hence a reader does not wait for a writer, it only retries
+ * after a write completed.
+ */
+static int __buf_read(const struct __tchashtbl_buf *buf, size_t pairsize, \
+	size_t keysize, const void *key, uint64_t code, void *pair)
+{
+	size_t mask = buf->__capacity - 1;
+	size_t i = __h1(code) & mask;
+	size_t step = 0;
+	uint8_t h2 = __h2(code);
+
+	for (step = 0; step < buf->__capacity; step++) {
+		uint8_t tag = atomic_load_explicit(buf->__ctrl + i, memory_order_relaxed);
+		int found = 0;
+
+		if (__tchashtbl_ctrl_empty == tag)
+			return 0;
+		while (h2 == tag) {
+			uint64_t ver = atomic_load_explicit(__buf_ver(buf, i), memory_order_acquire);
+			const _Atomic uint64_t *copy = __buf_copy(buf, i, __ver_copy(ver));
+
+			found = __ver_live(ver)
+			     && code == atomic_load_explicit(copy, memory_order_relaxed)
+			     && __words_equal(copy + 1, key, keysize);
+			if (found && NULL != pair)
+				__words_load(copy + 1, pair, pairsize);
+			atomic_thread_fence(memory_order_acquire);
+			if (ver == atomic_load_explicit(__buf_ver(buf, i), memory_order_relaxed))
+				break;
+		}
+		if (found)
+			return 1;
+		i = (i + 1) & mask;
+	}
+	return 0;
+}
+
+/* The lookup of writers, called under the segment lock
+ * On success, return 1 and assign the location to `loc`
+ * On failure, return 0 and assign to `loc` the first tombstone, else the
+ * first empty slot, on the probing path
+ */
+static int __buf_find(const struct __tchashtbl_buf *buf, size_t keysize, \
+	const void *key, uint64_t code, size_t *loc)
+{
+	size_t mask = buf->__capacity - 1;
+	size_t i = __h1(code) & mask;
+	size_t step = 0;
+	uint8_t h2 = __h2(code);
+
+	*loc = (size_t) -1;
+	for (step = 0; step < buf->__capacity; step++) {
+		uint8_t tag = atomic_load_explicit(buf->__ctrl + i, memory_order_relaxed);
+
+		if (__tchashtbl_ctrl_empty == tag) {
+			if ((size_t) -1 == *loc)
+				*loc = i;
+			return 0;
+		}
+		if (__tchashtbl_ctrl_deleted == tag) {
+			if ((size_t) -1 == *loc)
+				*loc = i;
+		} else if (h2 == tag) {
+			uint64_t ver = atomic_load_explicit(__buf_ver(buf, i), memory_order_relaxed);
+			const _Atomic uint64_t *copy = __buf_copy(buf, i, __ver_copy(ver));
+
+			if (code == atomic_load_explicit(copy, memory_order_relaxed)
+			 && __words_equal(copy + 1, key, keysize)) {
+				*loc = i;
+				return 1;
+			}
+		}
+		i = (i + 1) & mask;
+	}
+	return 0;
+}
+
+/* Write `pair` in the slot `loc`, new or holding the same key
+ *
+ * The tag is set first and the version last: a reader that sees the new
+ * version also sees the tag.
+ */
+static void __buf_put(struct __tchashtbl_buf *buf, size_t pairsize, \
+	size_t loc, const void *pair, uint64_t code)
+{
+	uint64_t ver = atomic_load_explicit(__buf_ver(buf, loc), memory_order_relaxed);
+	uint64_t next = __ver_next(ver, 1);
+	_Atomic uint64_t *copy = __buf_copy(buf, loc, __ver_copy(next));
+
+	atomic_store_explicit(buf->__ctrl + loc, __h2(code), memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(copy, code, memory_order_relaxed);
+	__words_store(copy + 1, pair, pairsize);
+	atomic_store_explicit(__buf_ver(buf, loc), next, memory_order_release);
+}
+
+/* Leave a tombstone at `loc`: the following pairs of the cluster stay where
+ * readers look for them
+ */
+static void __buf_erase(struct __tchashtbl_buf *buf, size_t loc)
+{
+	uint64_t ver = atomic_load_explicit(__buf_ver(buf, loc), memory_order_relaxed);
+
+	atomic_store_explicit(__buf_ver(buf, loc), __ver_next(ver, 0), memory_order_release);
+	atomic_store_explicit(buf->__ctrl + loc, __tchashtbl_ctrl_deleted, memory_order_relaxed);
+}
+
+/* Copy the pairs of `buf` into a new buffer of `capacity`, without the
+ * tombstones
+ */
+static struct __tchashtbl_buf *__buf_rebuild(const struct __tchashtbl_buf *buf, \
+	size_t pairsize, size_t capacity, const tds_allocator *alloc)
+{
+	struct __tchashtbl_buf *new_buf = NULL;
+	size_t mask = capacity - 1;
+	size_t idx = 0;
+
+	if (NULL == (new_buf = __buf_create(pairsize, capacity, alloc)))
+		return NULL;
+	for (idx = 0; idx < buf->__capacity; idx++) {
+		uint8_t tag = atomic_load_explicit(buf->__ctrl + idx, memory_order_relaxed);
+		uint64_t ver = atomic_load_explicit(__buf_ver(buf, idx), memory_order_relaxed);
+		const _Atomic uint64_t *copy = __buf_copy(buf, idx, __ver_copy(ver));
+		_Atomic uint64_t *new_copy = NULL;
+		size_t loc = 0;
+		size_t word = 0;
+
+		if (__tchashtbl_ctrl_empty == tag || __tchashtbl_ctrl_deleted == tag)
+			continue;
+		loc = __h1(atomic_load_explicit(copy, memory_order_relaxed)) & mask;
+		while (__tchashtbl_ctrl_empty != atomic_load_explicit(new_buf->__ctrl + loc, memory_order_relaxed))
+			loc = (loc + 1) & mask;
+		new_copy = __buf_copy(new_buf, loc, 0);
+		for (word = 0; word < buf->__nwords; word++)
+			atomic_store_explicit(new_copy + word, \
+				atomic_load_explicit(copy + word, memory_order_relaxed), memory_order_relaxed);
+		atomic_store_explicit(__buf_ver(new_buf, loc), 1, memory_order_relaxed);
+		atomic_store_explicit(new_buf->__ctrl + loc, tag, memory_order_relaxed);
+	}
+	return new_buf;
+}
+
+
+/******************************************************************************
+ * Part 2. Segment lock & epochs
+ ******************************************************************************/
+
+static void __seg_lock(struct __tchashtbl_seg *seg)
+{
+	size_t nspins = 0;
+
+	while (atomic_flag_test_and_set_explicit(&seg->__lock, memory_order_acquire)) {
+		if (++nspins < __tchashtbl_spin)
+			__tchashtbl_pause();
+		else
+			__tchashtbl_yield();
+	}
+}
+
+static void __seg_unlock(struct __tchashtbl_seg *seg)
+{
+	atomic_flag_clear_explicit(&seg->__lock, memory_order_release);
+}
+
+/* Register a reader in the counter of the current epoch
+ * Return the epoch, to be given back to `__seg_leave`
+ *
+ * If the epoch advanced between the load and the registration, the reader
+ * could be counted in the epoch a writer just found empty, so it registers
+ * again: this only happens after a writer made progress.
+ */
+static size_t __seg_enter(struct __tchashtbl_seg *seg)
+{
+	for (;;) {
+		size_t epoch = atomic_load(&seg->__epoch);
+
+		atomic_fetch_add(seg->__readers + (epoch & 1), 1);
+		if (epoch == atomic_load(&seg->__epoch))
+			return epoch;
+		atomic_fetch_sub_explicit(seg->__readers + (epoch & 1), 1, memory_order_release);
+	}
+}
+
+static void __seg_leave(struct __tchashtbl_seg *seg, size_t epoch)
+{
+	atomic_fetch_sub_explicit(seg->__readers + (epoch & 1), 1, memory_order_release);
+}
+
+/* Called by the lock holder once `buf` is no longer the buffer of the segment
+ */
+static void __seg_retire(struct __tchashtbl_seg *seg, struct __tchashtbl_buf *buf)
+{
+	size_t epoch = atomic_load_explicit(&seg->__epoch, memory_order_relaxed);
+
+	buf->__retired = seg->__retired[epoch & 1];
+	seg->__retired[epoch & 1] = buf;
+}
+
+/* Called by the lock holder, free the buffers retired in the epoch before the
+ * current one if its readers are gone, and advance the epoch
+ *
+ * Readers of the current epoch entered after these buffers were replaced,
+ * and the readers of the epoch before were the last ones that could see
+ * them: since the epoch only advances when they are gone, no older reader is
+ * left.
+ */
+static void __seg_reclaim(struct __tchashtbl_seg *seg, size_t pairsize, const tds_allocator *alloc)
+{
+	size_t epoch = atomic_load_explicit(&seg->__epoch, memory_order_relaxed);
+
+	if (NULL == seg->__retired[0] && NULL == seg->__retired[1])
+		return;
+	if (0 != atomic_load(seg->__readers + ((epoch + 1) & 1)))
+		return;
+	__buf_free(seg->__retired[(epoch + 1) & 1], pairsize, alloc);
+	seg->__retired[(epoch + 1) & 1] = NULL;
+	atomic_store(&seg->__epoch, epoch + 1);
+}
+
+
+/******************************************************************************
+ * Part 3. Creation & Free
+ ******************************************************************************/
+
+tds_chashtbl *tds_chashtbl_create_h(size_t pairsize, size_t keysize, \
+	size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc)
+{
+	size_t capacity = __tchashtbl_seg_capacity;
+	tds_chashtbl *tbl = NULL;
+	size_t idx = 0;
+	assert(keysize <= pairsize);
+	assert(NULL != _fhash);
+	while (capacity * __tchashtbl_nsegs < init_capacity)
+		capacity *= 2;
+
+	if (NULL == (tbl = (tds_chashtbl *) tds_allocator_alloc(alloc, sizeof(tds_chashtbl)))) {
+		printf("Error ... tds_chashtbl_create_h\n");
+		return NULL;
+	}
+	if (NULL == (tbl->__segs_block = tds_allocator_alloc(alloc, __tchashtbl_segs_size))) {
+		tds_allocator_free(alloc, tbl, sizeof(tds_chashtbl));
+		printf("Error ... tds_chashtbl_create_h\n");
+		return NULL;
+	}
+	tbl->__segs = (struct __tchashtbl_seg *) (((uintptr_t) tbl->__segs_block \
+		+ __tchashtbl_line - 1) & ~(uintptr_t) (__tchashtbl_line - 1));
+	for (idx = 0; idx < __tchashtbl_nsegs; idx++) {
+		struct __tchashtbl_seg *seg = tbl->__segs + idx;
+		struct __tchashtbl_buf *buf = __buf_create(pairsize, capacity, alloc);
+
+		if (NULL == buf) {
+			while (idx-- > 0)
+				__buf_free(atomic_load(&tbl->__segs[idx].__buf), pairsize, alloc);
+			tds_allocator_free(alloc, tbl->__segs_block, __tchashtbl_segs_size);
+			tds_allocator_free(alloc, tbl, sizeof(tds_chashtbl));
+			printf("Error ... tds_chashtbl_create_h\n");
+			return NULL;
+		}
+		atomic_flag_clear(&seg->__lock);
+		atomic_init(&seg->__epoch, 0);
+		atomic_init(&seg->__buf, buf);
+		atomic_init(&seg->__usage, 0);
+		atomic_init(&seg->__capacity, capacity);
+		seg->__ntombs = 0;
+		seg->__retired[0] = NULL;
+		seg->__retired[1] = NULL;
+		atomic_init(seg->__readers + 0, 0);
+		atomic_init(seg->__readers + 1, 0);
+	}
+	tbl->__pairsize = pairsize;
+	tbl->__keysize = keysize;
+	tbl->__fhash = _fhash;
+	tbl->__seed = ta_hash_seed();
+	tbl->__alloc = alloc;
+	return tbl;
+}
+
+tds_chashtbl *tds_chashtbl_create_g(size_t pairsize, size_t keysize, \
+	size_t init_capacity, const tds_allocator *alloc)
+{
+	return tds_chashtbl_create_h(pairsize, keysize, init_capacity, ta_hash_wy, alloc);
+}
+
+tds_chashtbl *tds_chashtbl_create(size_t pairsize, size_t keysize)
+{
+	return tds_chashtbl_create_g(pairsize, keysize, 0, NULL);
+}
+
+tds_chashtbl *tds_chashtbl_force_create_h(size_t pairsize, size_t keysize, \
+	size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc)
+{
+	tds_chashtbl *tbl = NULL;
+
+	if (NULL == (tbl = tds_chashtbl_create_h(pairsize, keysize, init_capacity, _fhash, alloc))) {
+		printf("Error ... tds_chashtbl_force_create_h\n");
+		exit(-1);
+	}
+	return tbl;
+}
+
+tds_chashtbl *tds_chashtbl_force_create_g(size_t pairsize, size_t keysize, \
+	size_t init_capacity, const tds_allocator *alloc)
+{
+	tds_chashtbl *tbl = NULL;
+
+	if (NULL == (tbl = tds_chashtbl_create_g(pairsize, keysize, init_capacity, alloc))) {
+		printf("Error ... tds_chashtbl_force_create_g\n");
+		exit(-1);
+	}
+	return tbl;
+}
+
+tds_chashtbl *tds_chashtbl_force_create(size_t pairsize, size_t keysize)
+{
+	return tds_chashtbl_force_create_g(pairsize, keysize, 0, NULL);
+}
+
+void tds_chashtbl_free(tds_chashtbl *tbl)
+{
+	size_t idx = 0;
+	assert(NULL != tbl);
+
+	for (idx = 0; idx < __tchashtbl_nsegs; idx++) {
+		struct __tchashtbl_seg *seg = tbl->__segs + idx;
+
+		__buf_free(atomic_load(&seg->__buf), tbl->__pairsize, tbl->__alloc);
+		__buf_free(seg->__retired[0], tbl->__pairsize, tbl->__alloc);
+		__buf_free(seg->__retired[1], tbl->__pairsize, tbl->__alloc);
+	}
+	tds_allocator_free(tbl->__alloc, tbl->__segs_block, __tchashtbl_segs_size);
+	tds_allocator_free(tbl->__alloc, tbl, sizeof(tds_chashtbl));
+}
+
+
+/******************************************************************************
+ * Part 4. Statistics
+ ******************************************************************************/
+
+size_t tds_chashtbl_usage(const tds_chashtbl *tbl)
+{
+	size_t usage = 0;
+	size_t idx = 0;
+	assert(NULL != tbl);
+
+	for (idx = 0; idx < __tchashtbl_nsegs; idx++)
+		usage += atomic_load_explicit(&tbl->__segs[idx].__usage, memory_order_relaxed);
+	return usage;
+}
+
+size_t tds_chashtbl_capacity(const tds_chashtbl *tbl)
+{
+	size_t capacity = 0;
+	size_t idx = 0;
+	assert(NULL != tbl);
+
+	for (idx = 0; idx < __tchashtbl_nsegs; idx++)
+		capacity += atomic_load_explicit(&tbl->__segs[idx].__capacity, memory_order_relaxed);
+	return capacity;
+}
+
+double tds_chashtbl_load_factor(const tds_chashtbl *tbl)
+{
+	return ((double) tds_chashtbl_usage(tbl)) / ((double) tds_chashtbl_capacity(tbl));
+}
+
+
+/******************************************************************************
+ * Part 5. Operations
+ ******************************************************************************/
+
+int tds_chashtbl_get(const tds_chashtbl *tbl, const void *key, void *pair)
+{
+	uint64_t code = 0;
+	struct __tchashtbl_seg *seg = NULL;
+	size_t epoch = 0;
+	int found = 0;
+	assert(NULL != tbl);
+	assert(NULL != key);
+	code = tbl->__fhash(key, tbl->__keysize, tbl->__seed);
+	seg = tbl->__segs + __seg_of(code);
+
+	epoch = __seg_enter(seg);
+	found = __buf_read(atomic_load_explicit(&seg->__buf, memory_order_acquire), \
+		tbl->__pairsize, tbl->__keysize, key, code, pair);
+	__seg_leave(seg, epoch);
+	return found;
+}
+
+int tds_chashtbl_contains(const tds_chashtbl *tbl, const void *key)
+{
+	return tds_chashtbl_get(tbl, key, NULL);
+}
+
+int tds_chashtbl_set(tds_chashtbl *tbl, const void *pair)
+{
+	uint64_t code = 0;
+	struct __tchashtbl_seg *seg = NULL;
+	struct __tchashtbl_buf *buf = NULL;
+	size_t usage = 0;
+	size_t loc = 0;
+	assert(NULL != tbl);
+	assert(NULL != pair);
+	code = tbl->__fhash(pair, tbl->__keysize, tbl->__seed);
+	seg = tbl->__segs + __seg_of(code);
+
+	__seg_lock(seg);
+	buf = atomic_load_explicit(&seg->__buf, memory_order_relaxed);
+	usage = atomic_load_explicit(&seg->__usage, memory_order_relaxed);
+
+	if (__buf_find(buf, tbl->__keysize, pair, code, &loc)) {
+		__buf_put(buf, tbl->__pairsize, loc, pair, code);
+		__seg_unlock(seg);
+		return 1;
+	}
+	if (__tchashtbl_ctrl_deleted == atomic_load_explicit(buf->__ctrl + loc, memory_order_relaxed)) {
+		seg->__ntombs--;
+	} else if (usage + seg->__ntombs + 1 > __tchashtbl_load_threshold * buf->__capacity) {
+		/* grow, or only drop the tombstones if they fill half of the room;
+		 * readers keep probing the old buffer while the new one is built
+		 */
+		size_t capacity = buf->__capacity;
+		struct __tchashtbl_buf *new_buf = NULL;
+
+		if (usage + 1 > __tchashtbl_load_threshold * capacity / 2)
+			capacity *= 2;
+		if (NULL == (new_buf = __buf_rebuild(buf, tbl->__pairsize, capacity, tbl->__alloc))) {
+			__seg_unlock(seg);
+			printf("Error ... tds_chashtbl_set\n");
+			return 0;
+		}
+		atomic_store_explicit(&seg->__buf, new_buf, memory_order_release);
+		atomic_store_explicit(&seg->__capacity, capacity, memory_order_relaxed);
+		seg->__ntombs = 0;
+		__seg_retire(seg, buf);
+		buf = new_buf;
+		__buf_find(buf, tbl->__keysize, pair, code, &loc);
+	}
+	__buf_put(buf, tbl->__pairsize, loc, pair, code);
+	atomic_store_explicit(&seg->__usage, usage + 1, memory_order_relaxed);
+	__seg_reclaim(seg, tbl->__pairsize, tbl->__alloc);
+	__seg_unlock(seg);
+	return 1;
+}
+
+void tds_chashtbl_force_set(tds_chashtbl *tbl, const void *pair)
+{
+	if (!tds_chashtbl_set(tbl, pair)) {
+		printf("Error ... tds_chashtbl_force_set\n");
+		exit(-1);
+	}
+}
+
+int tds_chashtbl_rm(tds_chashtbl *tbl, const void *key)
+{
+	uint64_t code = 0;
+	struct __tchashtbl_seg *seg = NULL;
+	struct __tchashtbl_buf *buf = NULL;
+	size_t loc = 0;
+	assert(NULL != tbl);
+	assert(NULL != key);
+	code = tbl->__fhash(key, tbl->__keysize, tbl->__seed);
+	seg = tbl->__segs + __seg_of(code);
+
+	__seg_lock(seg);
+	buf = atomic_load_explicit(&seg->__buf, memory_order_relaxed);
+	if (!__buf_find(buf, tbl->__keysize, key, code, &loc)) {
+		__seg_unlock(seg);
+		return 0;
+	}
+	__buf_erase(buf, loc);
+	seg->__ntombs++;
+	atomic_store_explicit(&seg->__usage, \
+		atomic_load_explicit(&seg->__usage, memory_order_relaxed) - 1, memory_order_relaxed);
+	__seg_reclaim(seg, tbl->__pairsize, tbl->__alloc);
+	__seg_unlock(seg);
+	return 1;
+}
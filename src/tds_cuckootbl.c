@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <tds/cuckootbl.h>
+#include <tds/array.h>
+#include <ta/hash.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define __tcuckootbl_init_capacity  16
+#define __tcuckootbl_ways           4
+#define __tcuckootbl_stash_size     8    /* pairs of the stash */
+#define __tcuckootbl_bfs_nodes      256  /* buckets visited by one insertion */
+#define __tcuckootbl_max_sparsity   64   /* slots per pair beyond which the
+                                          * hash is deemed to collide */
+#define __tcuckootbl_line           64   /* cache line */
+
+/* Fingerprint of a key, 0 marks an empty slot
+ */
+#define __fp(code)  ((uint8_t) ((code) >> 56 | 1))
+
+/* The buckets and stash of a table
+ *
+ * Each element of `__buckets` is one bucket, padded to whole cache lines:
+ *
+ * 	[fingerprints, `ways` bytes padded to 8][pairs, `ways` * pairsize][pad]
+ *
+ * The array has one more element than buckets, so that the buckets can
+ * start at `__base`, the first address aligned to a cache line in it: a
+ * bucket then spans no more lines than its size requires.
+ */
+struct tds_cuckootbl_store {
+	tds_array *__buckets;
+	char *__base;
+	size_t __nbuckets;
+	tds_array *__stash;
+	size_t __nstash;
+};
+
+struct tds_cuckootbl {
+	struct tds_cuckootbl_store __store;
+	size_t __pairsize;
+	size_t __keysize;
+	size_t __ways;
+	size_t __tagsize;      /* bytes of the fingerprints of a bucket */
+	size_t __bucketsize;   /* bytes of a bucket, a multiple of the cache line */
+	size_t __usage;        /* number of pairs, the stash included */
+	tds_fhash_t *__fhash;  /* hash function of keys */
+	uint64_t __seed;       /* random per table, passed to `__fhash` */
+	const tds_allocator *__alloc;
+};
+
+/* A bucket visited by the breadth-first search of an insertion, the pair at
+ * `__slot` of the parent bucket would move into it
+ */
+struct __tcuckootbl_node {
+	size_t __bucket;
+	int __parent;
+	int __slot;
+};
+
+
+/******************************************************************************
+ * Part 1. Buckets
+ ******************************************************************************/
+
+static uint64_t __tds_cuckootbl_code(const tds_cuckootbl *tbl, const void *key)
+{
+	return tbl->__fhash(key, tbl->__keysize, tbl->__seed);
+}
+
+/* The two distinct buckets of `code`, from the low and the high halves
+ */
+static void __tds_cuckootbl_buckets(const struct tds_cuckootbl_store *store, \
+	uint64_t code, size_t *b1, size_t *b2)
+{
+	size_t mask = store->__nbuckets - 1;
+
+	*b1 = (size_t) code & mask;
+	*b2 = (size_t) (code >> 32) & mask;
+	if (*b2 == *b1)
+		*b2 = *b1 ^ 1;
+}
+
+static uint8_t *__bucket_tags(const tds_cuckootbl *tbl, const struct tds_cuckootbl_store *store, size_t b)
+{
+	return (uint8_t *) (store->__base + b * tbl->__bucketsize);
+}
+
+static char *__bucket_pair(const tds_cuckootbl *tbl, \
+	const struct tds_cuckootbl_store *store, size_t b, size_t slot)
+{
+	return store->__base + b * tbl->__bucketsize + tbl->__tagsize + slot * tbl->__pairsize;
+}
+
+/* Return the slot of `key` in the bucket `b`, or -1
+ */
+static int __bucket_find(const tds_cuckootbl *tbl, const struct tds_cuckootbl_store *store, \
+	size_t b, const void *key, uint8_t fp)
+{
+	const uint8_t *tags = __bucket_tags(tbl, store, b);
+	size_t slot = 0;
+
+	for (slot = 0; slot < tbl->__ways; slot++) {
+		if (tags[slot] == fp
+		 && 0 == memcmp(key, __bucket_pair(tbl, store, b, slot), tbl->__keysize))
+			return (int) slot;
+	}
+	return -1;
+}
+
+/* Return the first empty slot of the bucket `b`, or -1
+ */
+static int __bucket_free_slot(const tds_cuckootbl *tbl, const struct tds_cuckootbl_store *store, size_t b)
+{
+	const uint8_t *tags = __bucket_tags(tbl, store, b);
+	size_t slot = 0;
+
+	for (slot = 0; slot < tbl->__ways; slot++) {
+		if (0 == tags[slot])
+			return (int) slot;
+	}
+	return -1;
+}
+
+static void __bucket_put(const tds_cuckootbl *tbl, struct tds_cuckootbl_store *store, \
+	size_t b, int slot, const void *pair, uint64_t code)
+{
+	__bucket_tags(tbl, store, b)[slot] = __fp(code);
+	memcpy(__bucket_pair(tbl, store, b, slot), pair, tbl->__pairsize);
+}
+
+/* Move the pair from slot `from_slot` of bucket `from` into the empty slot
+ * `to_slot` of bucket `to`
+ */
+static void __bucket_move(const tds_cuckootbl *tbl, struct tds_cuckootbl_store *store, \
+	size_t from, int from_slot, size_t to, int to_slot)
+{
+	uint8_t *from_tags = __bucket_tags(tbl, store, from);
+
+	__bucket_tags(tbl, store, to)[to_slot] = from_tags[from_slot];
+	memcpy(__bucket_pair(tbl, store, to, to_slot), \
+		__bucket_pair(tbl, store, from, from_slot), tbl->__pairsize);
+	from_tags[from_slot] = 0;
+}
+
+static int __store_create(const tds_cuckootbl *tbl, struct tds_cuckootbl_store *store, size_t nbuckets)
+{
+	uintptr_t data = 0;
+
+	if (NULL == (store->__buckets = tds_array_create_g(tbl->__bucketsize, nbuckets + 1, tbl->__alloc)))
+		return 0;
+	if (NULL == (store->__stash = tds_array_create_g(tbl->__pairsize, __tcuckootbl_stash_size, tbl->__alloc))) {
+		tds_array_free_g(store->__buckets, tbl->__alloc);
+		return 0;
+	}
+	data = (uintptr_t) tds_array_data(store->__buckets);
+	store->__base = (char *) ((data + __tcuckootbl_line - 1) & ~(uintptr_t) (__tcuckootbl_line - 1));
+	store->__nbuckets = nbuckets;
+	memset(store->__base, 0, tbl->__bucketsize * nbuckets);
+	store->__nstash = 0;
+	return 1;
+}
+
+static void __store_free(const tds_cuckootbl *tbl, struct tds_cuckootbl_store *store)
+{
+	tds_array_free_g(store->__buckets, tbl->__alloc);
+	tds_array_free_g(store->__stash, tbl->__alloc);
+	store->__buckets = NULL;
+	store->__base = NULL;
+	store->__nbuckets = 0;
+	store->__stash = NULL;
+	store->__nstash = 0;
+}
+
+/* Search the shortest chain of pairs that frees a slot in a bucket of `code`
+ * and put `pair` there
+ * Return a boolean, the store is unchanged on failure
+ *
+ * Buckets are visited at most once, so that the moves of a chain never
+ * interfere.
+ */
+static int __store_place(const tds_cuckootbl *tbl, struct tds_cuckootbl_store *store, \
+	const void *pair, uint64_t code)
+{
+	struct __tcuckootbl_node queue[__tcuckootbl_bfs_nodes];
+	size_t b1 = 0, b2 = 0;
+	int head = 0;
+	int tail = 0;
+	int slot = 0;
+
+	__tds_cuckootbl_buckets(store, code, &b1, &b2);
+	if (-1 != (slot = __bucket_free_slot(tbl, store, b1))) {
+		__bucket_put(tbl, store, b1, slot, pair, code);
+		return 1;
+	}
+	if (-1 != (slot = __bucket_free_slot(tbl, store, b2))) {
+		__bucket_put(tbl, store, b2, slot, pair, code);
+		return 1;
+	}
+	queue[0].__bucket = b1;
+	queue[0].__parent = -1;
+	queue[1].__bucket = b2;
+	queue[1].__parent = -1;
+	tail = 2;
+
+	for (head = 0; head < tail; head++) {
+		size_t b = queue[head].__bucket;
+		size_t s = 0;
+
+		for (s = 0; s < tbl->__ways; s++) {
+			size_t c1 = 0, c2 = 0, alt = 0;
+			int cur = head;
+			int idx = 0;
+
+			__tds_cuckootbl_buckets(store, \
+				__tds_cuckootbl_code(tbl, __bucket_pair(tbl, store, b, s)), &c1, &c2);
+			alt = b == c1 ? c2 : c1;
+			if (-1 != (slot = __bucket_free_slot(tbl, store, alt))) {
+				/* move the chain from its end, each move frees the slot
+				 * taken by the next one */
+				__bucket_move(tbl, store, b, (int) s, alt, slot);
+				slot = (int) s;
+				while (-1 != queue[cur].__parent) {
+					int parent = queue[cur].__parent;
+					__bucket_move(tbl, store, queue[parent].__bucket, \
+						queue[cur].__slot, queue[cur].__bucket, slot);
+					slot = queue[cur].__slot;
+					cur = parent;
+				}
+				__bucket_put(tbl, store, queue[cur].__bucket, slot, pair, code);
+				return 1;
+			}
+			if (tail == __tcuckootbl_bfs_nodes)
+				continue;
+			for (idx = 0; idx < tail && queue[idx].__bucket != alt; idx++)
+				;
+			if (idx < tail)
+				continue;  /* already visited */
+			queue[tail].__bucket = alt;
+			queue[tail].__parent = head;
+			queue[tail].__slot = (int) s;
+			tail++;
+		}
+	}
+	return 0;
+}
+
+/* Put a pair whose key is known to be absent, into a bucket or the stash
+ * Return a boolean
+ */
+static int __store_insert_new(const tds_cuckootbl *tbl, struct tds_cuckootbl_store *store, \
+	const void *pair, uint64_t code)
+{
+	if (__store_place(tbl, store, pair, code))
+		return 1;
+	if (store->__nstash == __tcuckootbl_stash_size)
+		return 0;
+	tds_array_set(store->__stash, store->__nstash++, pair);
+	return 1;
+}
+
+
+/******************************************************************************
+ * Part 2. Creation, Resize & Free
+ ******************************************************************************/
+
+tds_cuckootbl *tds_cuckootbl_create_w(size_t pairsize, size_t keysize, \
+	size_t init_capacity, tds_fhash_t *_fhash, int ways, const tds_allocator *alloc)
+{
+	size_t nbuckets = 2;
+	tds_cuckootbl *tbl = NULL;
+	assert(keysize <= pairsize);
+	assert(NULL != _fhash);
+	assert(4 == ways || 8 == ways);
+	while (nbuckets * ways < init_capacity)
+		nbuckets *= 2;
+	if (NULL == (tbl = (tds_cuckootbl *) tds_allocator_alloc(alloc, sizeof(tds_cuckootbl)))) {
+		printf("Error ... tds_cuckootbl_create_w\n");
+		return NULL;
+	}
+	tbl->__pairsize = pairsize;
+	tbl->__keysize = keysize;
+	tbl->__ways = (size_t) ways;
+	tbl->__tagsize = ((size_t) ways + 7) / 8 * 8;
+	tbl->__bucketsize = (tbl->__tagsize + (size_t) ways * pairsize + __tcuckootbl_line - 1) \
+		/ __tcuckootbl_line * __tcuckootbl_line;
+	tbl->__usage = 0;
+	tbl->__fhash = _fhash;
+	tbl->__seed = ta_hash_seed();
+	tbl->__alloc = alloc;
+	if (!__store_create(tbl, &tbl->__store, nbuckets)) {
+		tds_allocator_free(alloc, tbl, sizeof(tds_cuckootbl));
+		printf("Error ... tds_cuckootbl_create_w\n");
+		return NULL;
+	}
+	return tbl;
+}
+
+tds_cuckootbl *tds_cuckootbl_create_h(size_t pairsize, size_t keysize, \
+	size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc)
+{
+	return tds_cuckootbl_create_w(pairsize, keysize, init_capacity, _fhash, __tcuckootbl_ways, alloc);
+}
+
+tds_cuckootbl *tds_cuckootbl_create_g(size_t pairsize, size_t keysize, \
+	size_t init_capacity, const tds_allocator *alloc)
+{
+	return tds_cuckootbl_create_h(pairsize, keysize, init_capacity, ta_hash_wy, alloc);
+}
+
+tds_cuckootbl *tds_cuckootbl_create(size_t pairsize, size_t keysize)
+{
+	return tds_cuckootbl_create_g(pairsize, keysize, __tcuckootbl_init_capacity, NULL);
+}
+
+tds_cuckootbl *tds_cuckootbl_force_create_w(size_t pairsize, size_t keysize, \
+	size_t init_capacity, tds_fhash_t *_fhash, int ways, const tds_allocator *alloc)
+{
+	tds_cuckootbl *tbl = NULL;
+
+	if (NULL == (tbl = tds_cuckootbl_create_w(pairsize, keysize, init_capacity, _fhash, ways, alloc))) {
+		printf("Error ... tds_cuckootbl_force_create_w\n");
+		exit(-1);
+	}
+	return tbl;
+}
+
+tds_cuckootbl *tds_cuckootbl_force_create_h(size_t pairsize, size_t keysize, \
+	size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc)
+{
+	tds_cuckootbl *tbl = NULL;
+
+	if (NULL == (tbl = tds_cuckootbl_create_h(pairsize, keysize, init_capacity, _fhash, alloc))) {
+		printf("Error ... tds_cuckootbl_force_create_h\n");
+		exit(-1);
+	}
+	return tbl;
+}
+
+tds_cuckootbl *tds_cuckootbl_force_create_g(size_t pairsize, size_t keysize, \
+	size_t init_capacity, const tds_allocator *alloc)
+{
+	tds_cuckootbl *tbl = NULL;
+
+	if (NULL == (tbl = tds_cuckootbl_create_g(pairsize, keysize, init_capacity, alloc))) {
+		printf("Error ... tds_cuckootbl_force_create_g\n");
+		exit(-1);
+	}
+	return tbl;
+}
+
+tds_cuckootbl *tds_cuckootbl_force_create(size_t pairsize, size_t keysize)
+{
+	return tds_cuckootbl_force_create_g(pairsize, keysize, __tcuckootbl_init_capacity, NULL);
+}
+
+/* Move all pairs into a new store of at least twice the buckets, doubling
+ * again while some pair does not fit
+ */
+static int __tds_cuckootbl_expand(tds_cuckootbl *tbl)
+{
+	struct tds_cuckootbl_store *old = &tbl->__store;
+	struct tds_cuckootbl_store store;
+	size_t nbuckets = old->__nbuckets;
+
+	for (;;) {
+		size_t b = 0;
+		size_t idx = 0;
+		int ok = 1;
+
+		nbuckets *= 2;
+		if (nbuckets * tbl->__ways > __tcuckootbl_max_sparsity * (tbl->__usage + 1))
+			return 0;  /* the keys collide, whatever the capacity */
+		if (!__store_create(tbl, &store, nbuckets))
+			return 0;
+		for (b = 0; ok && b < old->__nbuckets; b++) {
+			const uint8_t *tags = __bucket_tags(tbl, old, b);
+			size_t slot = 0;
+
+			for (slot = 0; ok && slot < tbl->__ways; slot++) {
+				const char *pair = __bucket_pair(tbl, old, b, slot);
+				if (0 != tags[slot])
+					ok = __store_insert_new(tbl, &store, pair, __tds_cuckootbl_code(tbl, pair));
+			}
+		}
+		for (idx = 0; ok && idx < old->__nstash; idx++) {
+			const void *pair = tds_array_get(old->__stash, idx);
+			ok = __store_insert_new(tbl, &store, pair, __tds_cuckootbl_code(tbl, pair));
+		}
+		if (ok)
+			break;
+		__store_free(tbl, &store);
+	}
+	__store_free(tbl, old);
+	tbl->__store = store;
+	return 1;
+}
+
+void tds_cuckootbl_free(tds_cuckootbl *tbl)
+{
+	assert(NULL != tbl);
+	__store_free(tbl, &tbl->__store);
+	tds_allocator_free(tbl->__alloc, tbl, sizeof(tds_cuckootbl));
+}
+
+
+/******************************************************************************
+ * Part 3. Statistics
+ ******************************************************************************/
+
+size_t tds_cuckootbl_usage(const tds_cuckootbl *tbl)
+{
+	assert(NULL != tbl);
+	return tbl->__usage;
+}
+
+size_t tds_cuckootbl_capacity(const tds_cuckootbl *tbl)
+{
+	assert(NULL != tbl);
+	return tbl->__store.__nbuckets * tbl->__ways;
+}
+
+double tds_cuckootbl_load_factor(const tds_cuckootbl *tbl)
+{
+	assert(NULL != tbl);
+	return ((double) tds_cuckootbl_usage(tbl)) / ((double) tds_cuckootbl_capacity(tbl));
+}
+
+size_t tds_cuckootbl_stash_usage(const tds_cuckootbl *tbl)
+{
+	assert(NULL != tbl);
+	return tbl->__store.__nstash;
+}
+
+
+/******************************************************************************
+ * Part 4. Search, Get, Set and Delete
+ ******************************************************************************/
+
+/* Return the pair of `key` in the buckets or the stash, or NULL
+ * `stash_loc` is assigned the location in the stash, -1 if in a bucket
+ */
+static char *__tds_cuckootbl_find(const tds_cuckootbl *tbl, const void *key, \
+	uint64_t code, size_t *b, int *slot, int *stash_loc)
+{
+	const struct tds_cuckootbl_store *store = &tbl->__store;
+	size_t b1 = 0, b2 = 0;
+	size_t idx = 0;
+
+	__tds_cuckootbl_buckets(store, code, &b1, &b2);
+	*stash_loc = -1;
+	if (-1 != (*slot = __bucket_find(tbl, store, b1, key, __fp(code)))) {
+		*b = b1;
+		return __bucket_pair(tbl, store, b1, *slot);
+	}
+	if (-1 != (*slot = __bucket_find(tbl, store, b2, key, __fp(code)))) {
+		*b = b2;
+		return __bucket_pair(tbl, store, b2, *slot);
+	}
+	for (idx = 0; idx < store->__nstash; idx++) {
+		char *pair = (char *) tds_array_get(store->__stash, idx);
+		if (0 == memcmp(key, pair, tbl->__keysize)) {
+			*stash_loc = (int) idx;
+			return pair;
+		}
+	}
+	return NULL;
+}
+
+void *tds_cuckootbl_get(const tds_cuckootbl *tbl, const void *key)
+{
+	size_t b = 0;
+	int slot = 0;
+	int stash_loc = 0;
+	assert(NULL != tbl);
+	assert(NULL != key);
+	return __tds_cuckootbl_find(tbl, key, __tds_cuckootbl_code(tbl, key), &b, &slot, &stash_loc);
+}
+
+int tds_cuckootbl_contains(const tds_cuckootbl *tbl, const void *key)
+{
+	return NULL != tds_cuckootbl_get(tbl, key);
+}
+
+int tds_cuckootbl_set(tds_cuckootbl *tbl, const void *pair)
+{
+	uint64_t code = 0;
+	char *existing = NULL;
+	size_t b = 0;
+	int slot = 0;
+	int stash_loc = 0;
+	assert(NULL != tbl);
+	assert(NULL != pair);
+	code = __tds_cuckootbl_code(tbl, pair);
+
+	if (NULL != (existing = __tds_cuckootbl_find(tbl, pair, code, &b, &slot, &stash_loc))) {
+		memcpy(existing, pair, tbl->__pairsize);
+		return 1;
+	}
+	while (!__store_insert_new(tbl, &tbl->__store, pair, code)) {
+		if (!__tds_cuckootbl_expand(tbl)) {
+			printf("Error ... tds_cuckootbl_set\n");
+			return 0;  /* failure */
+		}
+	}
+	tbl->__usage++;
+	return 1;  /* success */
+}
+
+void tds_cuckootbl_force_set(tds_cuckootbl *tbl, const void *pair)
+{
+	if (!tds_cuckootbl_set(tbl, pair)) {
+		printf("Error ... tds_cuckootbl_force_set\n");
+		exit(-1);
+	}
+}
+
+int tds_cuckootbl_rm(tds_cuckootbl *tbl, const void *key)
+{
+	struct tds_cuckootbl_store *store = NULL;
+	size_t b = 0;
+	int slot = 0;
+	int stash_loc = 0;
+	assert(NULL != tbl);
+	assert(NULL != key);
+	store = &tbl->__store;
+
+	if (NULL == __tds_cuckootbl_find(tbl, key, __tds_cuckootbl_code(tbl, key), &b, &slot, &stash_loc))
+		return 0;
+	if (-1 == stash_loc)
+		__bucket_tags(tbl, store, b)[slot] = 0;
+	else {  /* the last pair of the stash fills the hole */
+		store->__nstash--;
+		if ((size_t) stash_loc != store->__nstash)
+			tds_array_set(store->__stash, (size_t) stash_loc, \
+				tds_array_get(store->__stash, store->__nstash));
+	}
+	tbl->__usage--;
+	return 1;
+}
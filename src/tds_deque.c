@@ -4,6 +4,7 @@
  */
 #include <tds/deque.h>
 #include <tds/linkedlist.h>
+#include <tds/pool.h>
 
 #include <assert.h>
 #include <stdio.h>
@@ -24,9 +25,11 @@ struct tds_deque_blk {
 
 struct tds_deque {
 	tds_linkedlist *__blk_list;  /* created by linkedlist construction fn, containing blk pointers */
+	tds_pool *__blk_pool;        /* the blocks, and the buffer of the free ones */
 
 	size_t __blk_capacity;  /* the capacity of each block */
 	size_t __elesize;
+	const tds_allocator *__alloc;
 };
 
 /******************************************************************************
@@ -34,27 +37,25 @@ struct tds_deque {
  *
  *****************************************************************************/
 
-static struct tds_deque_blk *blk_create( \
-		size_t elesize, size_t blk_capacity, int front_aligned)
+static struct tds_deque_blk *blk_create(const tds_deque *q, int front_aligned)
 {
-	size_t total_size = tds_blk_basic_size + elesize * blk_capacity;
 	struct tds_deque_blk *blk = NULL;
 
-	assert(elesize > 0);
-	assert(blk_capacity > 0);
+	assert(q->__elesize > 0);
+	assert(q->__blk_capacity > 0);
 
-	if (NULL == (blk = (struct tds_deque_blk *) malloc(total_size))) {
+	if (NULL == (blk = (struct tds_deque_blk *) tds_pool_get(q->__blk_pool))) {
 		printf("Error ... blk_create\n");
 		return NULL;
 	}
-	blk->__head_loc = front_aligned ? 0 : blk_capacity;
+	blk->__head_loc = front_aligned ? 0 : q->__blk_capacity;
 	blk->__len = 0;
 	return blk;
 }
 
-static void blk_free(struct tds_deque_blk *blk)
+static void blk_free(const tds_deque *q, struct tds_deque_blk *blk)
 {
-	free(blk);
+	tds_pool_put(q->__blk_pool, blk);
 }
 
 static void *blk_data(const struct tds_deque_blk *blk)
@@ -111,7 +112,8 @@ static void *blk_pop_back(struct tds_deque_blk *blk, size_t elesize)
  *
  *****************************************************************************/
 
-tds_deque *tds_deque_create_g(size_t elesize, size_t blk_capacity, size_t buffer_lim)
+tds_deque *tds_deque_create_g(size_t elesize, size_t blk_capacity, size_t buffer_lim, \
+	const tds_allocator *alloc)
 {
 	tds_deque *deq = NULL;
 	size_t real_blk_capacity = tds_dequq_default_blk_capacity;
@@ -123,18 +125,26 @@ tds_deque *tds_deque_create_g(size_t elesize, size_t blk_capacity, size_t buffer
 		real_blk_capacity *= 2;
 	while (real_buffer_limit < buffer_lim)
 		real_buffer_limit *= 2;
-	if (NULL == (deq = (tds_deque *) malloc(sizeof(tds_deque)))) {
+	if (NULL == (deq = (tds_deque *) tds_allocator_alloc(alloc, sizeof(tds_deque)))) {
 		printf("Error ... tds_deque_create_g\n");
 		return NULL;
 	}
 	if (NULL == (deq->__blk_list = tds_linkedlist_create_g(
-					sizeof(struct tds_deque_blk *), real_buffer_limit))) {
-		free(deq);
+					sizeof(struct tds_deque_blk *), real_buffer_limit, alloc))) {
+		tds_allocator_free(alloc, deq, sizeof(tds_deque));
+		printf("Error ... tds_deque_create_g\n");
+		return NULL;
+	}
+	if (NULL == (deq->__blk_pool = tds_pool_create_g( \
+		tds_blk_basic_size + elesize * real_blk_capacity, 0, real_buffer_limit, alloc))) {
+		tds_linkedlist_free(deq->__blk_list);
+		tds_allocator_free(alloc, deq, sizeof(tds_deque));
 		printf("Error ... tds_deque_create_g\n");
 		return NULL;
 	}
 	deq->__elesize = elesize;
 	deq->__blk_capacity = real_blk_capacity;
+	deq->__alloc = alloc;
 	return deq;
 }
 
@@ -142,7 +152,7 @@ tds_deque *tds_deque_create(size_t elesize)
 {
 	return tds_deque_create_g(elesize,\
 			tds_dequq_default_blk_capacity,
-			tds_dequq_default_buffer_limit);
+			tds_dequq_default_buffer_limit, NULL);
 }
 
 tds_deque *tds_deque_force_create(size_t elesize)
@@ -156,20 +166,16 @@ tds_deque *tds_deque_force_create(size_t elesize)
 	return deq;
 }
 
+/* The blocks are released with their slabs, not one by one
+ */
 void tds_deque_free(tds_deque *q)
 {
-	tds_linkedlistiter *iter;
-	struct tds_deque_blk *blk;
 	assert(NULL != q);
-
-	iter = tds_linkedlistiter_head(q->__blk_list);
-	while (NULL != iter) {
-		blk = *(struct tds_deque_blk **) tds_linkedlistiter_data(iter);
-		blk_free(blk);
-		iter = tds_linkedlistiter_next(iter);
-	}
+	if (!tds_allocator_frees(q->__alloc))
+		return;  /* the blocks go with the allocator (an arena) */
+	tds_pool_free(q->__blk_pool);
 	tds_linkedlist_free(q->__blk_list);
-	free(q);
+	tds_allocator_free(q->__alloc, q, sizeof(tds_deque));
 }
 
 size_t tds_deque_nblks(const tds_deque * q)
@@ -180,12 +186,12 @@ size_t tds_deque_nblks(const tds_deque * q)
 
 static int deq_push_front_new_blk(tds_deque *q)
 {
-	struct tds_deque_blk *newblk = blk_create(q->__elesize, q->__blk_capacity, 0);
+	struct tds_deque_blk *newblk = blk_create(q, 0);
 
 	if (NULL == newblk)
 		return 0;  /* failure */
 	if (0 == tds_linkedlist_pushfront(q->__blk_list, &newblk)) {
-		blk_free(newblk);
+		blk_free(q, newblk);
 		printf("Error ... deq_push_front_new_blk\n");
 		return 0;  /* failure */
 	}
@@ -194,12 +200,12 @@ static int deq_push_front_new_blk(tds_deque *q)
 
 static int deq_push_back_new_blk(tds_deque *q)
 {
-	struct tds_deque_blk *newblk = blk_create(q->__elesize, q->__blk_capacity, 1);
+	struct tds_deque_blk *newblk = blk_create(q, 1);
 
 	if (NULL == newblk)
 		return 0;  /* failure */
 	if (0 == tds_linkedlist_pushback(q->__blk_list, &newblk)) {
-		blk_free(newblk);
+		blk_free(q, newblk);
 		printf("Error ... deq_push_back_new_blk\n");
 		return 0;  /* failure */
 	}
@@ -281,6 +287,7 @@ void *tds_deque_popfront(tds_deque *q)
 
 	if (front_blk->__head_loc == q->__blk_capacity) {
 		tds_linkedlist_popfront(q->__blk_list);
+		blk_free(q, front_blk);  /* empty */
 		return tds_deque_popfront(q);
 	} else
 		return blk_pop_front(front_blk, q->__elesize);
@@ -301,6 +308,7 @@ void *tds_deque_popback(tds_deque *q)
 
 	if (back_blk->__head_loc + back_blk->__len == 0) {
 		tds_linkedlist_popback(q->__blk_list);
+		blk_free(q, back_blk);  /* empty */
 		return tds_deque_popback(q);
 	} else
 		return blk_pop_back(back_blk, q->__elesize);
@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <tds/hashset.h>
+#include <tds/array.h>
+#include <ta/hash.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define __thashset_init_capacity   16
+#define __thashset_load_threshold  0.75
+
+/* Control tags, one byte per slot
+ *
+ * 	- full:  0b1xxxxxxx, the lowest 7 bits of the hash code
+ * 	- empty: 0, so that the zeroed memory of a new array is all empty
+ */
+#define __thashset_ctrl_empty  ((uint8_t) 0)
+#define __h1(code)  ((size_t) ((code) >> 7))
+#define __h2(code)  ((uint8_t) ((code) | 0x80))
+
+struct tds_hashset {
+	tds_array *__ctrl;     /* 1-byte tags */
+	tds_array *__keys;     /* keys, or 64-bit words if `__word` */
+	size_t __keysize;
+	size_t __usage;
+	int __word;            /* `keysize` <= 8, keys are compared as words */
+	tds_fhash_t *__fhash;  /* hash function of keys */
+	uint64_t __seed;       /* random per set, passed to `__fhash` */
+	const tds_allocator *__alloc;
+};
+
+
+/******************************************************************************
+ * Part 1. Slots
+ ******************************************************************************/
+
+/* The key zero-extended into a word, 0 if the keys are not words
+ *
+ * The stored word has the same first `keysize` bytes as the key, so both
+ * hash the same.
+ */
+static uint64_t __tds_hashset_word(const tds_hashset *set, const void *key)
+{
+	uint64_t word = 0;
+
+	if (set->__word)
+		memcpy(&word, key, set->__keysize);
+	return word;
+}
+
+static uint64_t __tds_hashset_code(const tds_hashset *set, const void *key)
+{
+	return set->__fhash(key, set->__keysize, set->__seed);
+}
+
+static uint8_t *__ctrl_data(const tds_hashset *set)
+{
+	return (uint8_t *) tds_array_data(set->__ctrl);
+}
+
+/* Search `key` of hash `code` (and `word` if `__word`)
+ * Return a boolean, `loc` is assigned the slot of the key, or the empty slot
+ * ending the probing
+ */
+static int __tds_hashset_find(const tds_hashset *set, const void *key, \
+	uint64_t code, uint64_t word, size_t *loc)
+{
+	const uint8_t *tags = __ctrl_data(set);
+	size_t mask = tds_array_capacity(set->__ctrl) - 1;
+	size_t i = __h1(code) & mask;
+	uint8_t h2 = __h2(code);
+
+	if (set->__word) {
+		const uint64_t *words = (const uint64_t *) tds_array_data(set->__keys);
+
+		for (; __thashset_ctrl_empty != tags[i]; i = (i + 1) & mask) {
+			if (h2 == tags[i] && word == words[i]) {
+				*loc = i;
+				return 1;
+			}
+		}
+	} else {
+		for (; __thashset_ctrl_empty != tags[i]; i = (i + 1) & mask) {
+			if (h2 == tags[i]
+			 && 0 == memcmp(key, tds_array_get(set->__keys, i), set->__keysize)) {
+				*loc = i;
+				return 1;
+			}
+		}
+	}
+	*loc = i;
+	return 0;
+}
+
+static void __tds_hashset_put(tds_hashset *set, size_t loc, const void *key, uint64_t code)
+{
+	__ctrl_data(set)[loc] = __h2(code);
+	if (set->__word)
+		((uint64_t *) tds_array_data(set->__keys))[loc] = __tds_hashset_word(set, key);
+	else
+		tds_array_set(set->__keys, loc, key);
+}
+
+/* Remove the key at `loc` and shift back the following keys whose home slot
+ * is not after the hole
+ */
+static void __tds_hashset_erase_at(tds_hashset *set, size_t loc)
+{
+	uint8_t *tags = __ctrl_data(set);
+	size_t mask = tds_array_capacity(set->__ctrl) - 1;
+	size_t next = (loc + 1) & mask;
+
+	for (; __thashset_ctrl_empty != tags[next]; next = (next + 1) & mask) {
+		const void *key = tds_array_get(set->__keys, next);
+		size_t home = __h1(__tds_hashset_code(set, key)) & mask;
+
+		if (((next - home) & mask) < ((next - loc) & mask))
+			continue;  /* the key would be out of its probing range */
+		tags[loc] = tags[next];
+		tds_array_set(set->__keys, loc, key);
+		loc = next;
+	}
+	tags[loc] = __thashset_ctrl_empty;
+}
+
+/* Move all keys into new slots of `new_capacity`
+ */
+static int __tds_hashset_resize(tds_hashset *set, size_t new_capacity)
+{
+	tds_array *old_ctrl = set->__ctrl;
+	tds_array *old_keys = set->__keys;
+	const uint8_t *old_tags = __ctrl_data(set);
+	size_t idx = 0;
+
+	assert(new_capacity > set->__usage);
+	if (NULL == (set->__ctrl = tds_array_create_g(1, new_capacity, set->__alloc))) {
+		set->__ctrl = old_ctrl;
+		return 0;
+	}
+	if (NULL == (set->__keys = tds_array_create_g(tds_array_elesize(old_keys), new_capacity, set->__alloc))) {
+		tds_array_free_g(set->__ctrl, set->__alloc);
+		set->__ctrl = old_ctrl;
+		set->__keys = old_keys;
+		return 0;
+	}
+	for (idx = 0; idx < tds_array_capacity(old_ctrl); idx++) {
+		const void *key = NULL;
+		uint64_t code = 0;
+		size_t loc = 0;
+
+		if (__thashset_ctrl_empty == old_tags[idx])
+			continue;
+		key = tds_array_get(old_keys, idx);
+		code = __tds_hashset_code(set, key);
+		__tds_hashset_find(set, key, code, __tds_hashset_word(set, key), &loc);
+		__tds_hashset_put(set, loc, key, code);
+	}
+	tds_array_free_g(old_ctrl, set->__alloc);
+	tds_array_free_g(old_keys, set->__alloc);
+	return 1;
+}
+
+
+/******************************************************************************
+ * Part 2. Creation & Free
+ ******************************************************************************/
+
+tds_hashset *tds_hashset_create_h(size_t keysize, size_t init_capacity, \
+	tds_fhash_t *_fhash, const tds_allocator *alloc)
+{
+	size_t capacity = __thashset_init_capacity;
+	tds_hashset *set = NULL;
+	assert(0 < keysize);
+	assert(NULL != _fhash);
+	while (capacity < init_capacity)
+		capacity *= 2;
+	if (NULL == (set = (tds_hashset *) tds_allocator_alloc(alloc, sizeof(tds_hashset)))) {
+		printf("Error ... tds_hashset_create_h\n");
+		return NULL;
+	}
+	set->__keysize = keysize;
+	set->__usage = 0;
+	set->__word = keysize <= sizeof(uint64_t);
+	set->__fhash = _fhash;
+	set->__seed = ta_hash_seed();
+	set->__alloc = alloc;
+	if (NULL == (set->__ctrl = tds_array_create_g(1, capacity, alloc))) {
+		tds_allocator_free(alloc, set, sizeof(tds_hashset));
+		printf("Error ... tds_hashset_create_h\n");
+		return NULL;
+	}
+	if (NULL == (set->__keys = tds_array_create_g(set->__word ? sizeof(uint64_t) : keysize, capacity, alloc))) {
+		tds_array_free_g(set->__ctrl, alloc);
+		tds_allocator_free(alloc, set, sizeof(tds_hashset));
+		printf("Error ... tds_hashset_create_h\n");
+		return NULL;
+	}
+	return set;
+}
+
+tds_hashset *tds_hashset_create_g(size_t keysize, size_t init_capacity, const tds_allocator *alloc)
+{
+	return tds_hashset_create_h(keysize, init_capacity, ta_hash_wy, alloc);
+}
+
+tds_hashset *tds_hashset_create(size_t keysize)
+{
+	return tds_hashset_create_g(keysize, __thashset_init_capacity, NULL);
+}
+
+tds_hashset *tds_hashset_force_create_h(size_t keysize, size_t init_capacity, \
+	tds_fhash_t *_fhash, const tds_allocator *alloc)
+{
+	tds_hashset *set = NULL;
+
+	if (NULL == (set = tds_hashset_create_h(keysize, init_capacity, _fhash, alloc))) {
+		printf("Error ... tds_hashset_force_create_h\n");
+		exit(-1);
+	}
+	return set;
+}
+
+tds_hashset *tds_hashset_force_create_g(size_t keysize, size_t init_capacity, const tds_allocator *alloc)
+{
+	tds_hashset *set = NULL;
+
+	if (NULL == (set = tds_hashset_create_g(keysize, init_capacity, alloc))) {
+		printf("Error ... tds_hashset_force_create_g\n");
+		exit(-1);
+	}
+	return set;
+}
+
+tds_hashset *tds_hashset_force_create(size_t keysize)
+{
+	return tds_hashset_force_create_g(keysize, __thashset_init_capacity, NULL);
+}
+
+void tds_hashset_free(tds_hashset *set)
+{
+	assert(NULL != set);
+	tds_array_free_g(set->__ctrl, set->__alloc);
+	tds_array_free_g(set->__keys, set->__alloc);
+	tds_allocator_free(set->__alloc, set, sizeof(tds_hashset));
+}
+
+size_t tds_hashset_usage(const tds_hashset *set)
+{
+	assert(NULL != set);
+	return set->__usage;
+}
+
+size_t tds_hashset_capacity(const tds_hashset *set)
+{
+	assert(NULL != set);
+	return tds_array_capacity(set->__ctrl);
+}
+
+double tds_hashset_load_factor(const tds_hashset *set)
+{
+	assert(NULL != set);
+	return ((double) tds_hashset_usage(set)) / ((double) tds_hashset_capacity(set));
+}
+
+
+/******************************************************************************
+ * Part 3. Membership, Insert and Erase
+ ******************************************************************************/
+
+int tds_hashset_contains(const tds_hashset *set, const void *key)
+{
+	size_t loc = 0;
+	assert(NULL != set);
+	assert(NULL != key);
+	return __tds_hashset_find(set, key, __tds_hashset_code(set, key), \
+		__tds_hashset_word(set, key), &loc);
+}
+
+int tds_hashset_insert(tds_hashset *set, const void *key)
+{
+	size_t loc = 0;
+	uint64_t code = 0;
+	assert(NULL != set);
+	assert(NULL != key);
+	code = __tds_hashset_code(set, key);
+
+	if (__tds_hashset_find(set, key, code, __tds_hashset_word(set, key), &loc))
+		return 1;  /* existing */
+	__tds_hashset_put(set, loc, key, code);
+	set->__usage++;
+	if ((double) set->__usage >= __thashset_load_threshold * tds_hashset_capacity(set)
+	 && !__tds_hashset_resize(set, 2 * tds_hashset_capacity(set))) {
+		printf("Error ... tds_hashset_insert\n");
+		return 0;  /* failure */
+	}
+	return 1;  /* success */
+}
+
+void tds_hashset_force_insert(tds_hashset *set, const void *key)
+{
+	if (!tds_hashset_insert(set, key)) {
+		printf("Error ... tds_hashset_force_insert\n");
+		exit(-1);
+	}
+}
+
+int tds_hashset_erase(tds_hashset *set, const void *key)
+{
+	size_t loc = 0;
+	assert(NULL != set);
+	assert(NULL != key);
+
+	if (!__tds_hashset_find(set, key, __tds_hashset_code(set, key), \
+		__tds_hashset_word(set, key), &loc))
+		return 0;
+	__tds_hashset_erase_at(set, loc);
+	set->__usage--;
+	return 1;
+}
+
+const void *tds_hashset_next(const tds_hashset *set, size_t *loc)
+{
+	const uint8_t *tags = NULL;
+	size_t capacity = 0;
+	assert(NULL != set);
+	assert(NULL != loc);
+	tags = __ctrl_data(set);
+	capacity = tds_array_capacity(set->__ctrl);
+
+	while (*loc < capacity && __thashset_ctrl_empty == tags[*loc])
+		(*loc)++;
+	if (*loc == capacity)
+		return NULL;
+	return tds_array_get(set->__keys, (*loc)++);
+}
+
+
+/******************************************************************************
+ * Part 4. Set Algebra
+ ******************************************************************************/
+
+int tds_hashset_union(tds_hashset *dst, const tds_hashset *src)
+{
+	size_t capacity = 0;
+	size_t loc = 0;
+	const void *key = NULL;
+	assert(NULL != dst);
+	assert(NULL != src);
+	assert(dst->__keysize == src->__keysize);
+
+	/* one resize for the worst case, no key of `src` in `dst` */
+	capacity = tds_hashset_capacity(dst);
+	while ((double) (dst->__usage + src->__usage) >= __thashset_load_threshold * capacity)
+		capacity *= 2;
+	if (capacity != tds_hashset_capacity(dst) && !__tds_hashset_resize(dst, capacity)) {
+		printf("Error ... tds_hashset_union\n");
+		return 0;
+	}
+	while (NULL != (key = tds_hashset_next(src, &loc)))
+		tds_hashset_insert(dst, key);  /* never expands */
+	return 1;
+}
+
+/* Keep the keys of `dst` whose membership in `src` is `keep_found`
+ *
+ * The slot just cleared is examined again, as the shift may have moved an
+ * unvisited key into it. Keys moved from the beginning of the slots to the
+ * end (wrapping around) were already kept and are examined again harmlessly.
+ */
+static void __tds_hashset_filter(tds_hashset *dst, const tds_hashset *src, int keep_found)
+{
+	const uint8_t *tags = __ctrl_data(dst);
+	size_t capacity = tds_hashset_capacity(dst);
+	size_t loc = 0;
+
+	while (loc < capacity) {
+		if (__thashset_ctrl_empty != tags[loc]
+		 && keep_found != tds_hashset_contains(src, tds_array_get(dst->__keys, loc))) {
+			__tds_hashset_erase_at(dst, loc);
+			dst->__usage--;
+		} else
+			loc++;
+	}
+}
+
+void tds_hashset_intersection(tds_hashset *dst, const tds_hashset *src)
+{
+	assert(NULL != dst);
+	assert(NULL != src);
+	assert(dst->__keysize == src->__keysize);
+	__tds_hashset_filter(dst, src, 1);
+}
+
+void tds_hashset_difference(tds_hashset *dst, const tds_hashset *src)
+{
+	size_t loc = 0;
+	const void *key = NULL;
+	assert(NULL != dst);
+	assert(NULL != src);
+	assert(dst->__keysize == src->__keysize);
+
+	if (dst->__usage <= src->__usage) {
+		__tds_hashset_filter(dst, src, 0);
+		return;
+	}
+	while (NULL != (key = tds_hashset_next(src, &loc)))  /* the smaller one */
+		tds_hashset_erase(dst, key);
+}
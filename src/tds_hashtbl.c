@@ -4,22 +4,145 @@
  */
 #include <tds/hashtbl.h>
 #include <tds/array.h>
-#include <tds/bitarray.h>
+#include <tds/arraylist.h>
+#include <tds/string.h>
+#include <ta/hash.h>
 
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef tds_hashtbl_with_stats
+#include <time.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define __thashtbl_mmap
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if !defined(tds_no_simd) && (defined(__SSE2__) || defined(_M_X64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define __thashtbl_sse2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define __thashtbl_prefetch(p)  __builtin_prefetch(p)
+#elif defined(_MSC_VER) && defined(__thashtbl_sse2)
+#define __thashtbl_prefetch(p)  _mm_prefetch((const char *) (p), _MM_HINT_T0)
+#else
+#define __thashtbl_prefetch(p)  ((void) (p))
+#endif
+
 #define __thashtbl_init_capacity   16
 #define __thashtbl_load_threshold  0.75
-#define __thashtbl_default_base    367
+#define __thashtbl_rh_load_threshold  0.9  /* robin hood mode */
+#define __thashtbl_migrate_step    16  /* old slots moved by each set/rm */
+#define __thashtbl_batch           16  /* keys in flight in batched operations */
+#define __thashtbl_arena_capacity  256 /* initial bytes of the key arena */
+
+/* Control tags, one byte per slot
+ *
+ * 	- full:    0b0xxxxxxx, the lowest 7 bits of the hash code (h2)
+ * 	- empty:   0b10000000
+ * 	- deleted: 0b11111110
+ *
+ * Slots are probed by groups of `__thashtbl_group_width` tags. A group is
+ * compared against h2 at once, and only the matched slots touch the pairs.
+ */
+#define __thashtbl_group_width     16
+#define __thashtbl_ctrl_empty      ((uint8_t) 0x80)
+#define __thashtbl_ctrl_deleted    ((uint8_t) 0xFE)
+
+/* Robin Hood mode
+ *
+ * Slots are probed one by one from the home slot `h1 % capacity`, and the tag
+ * of a full slot is its distance to the home slot, saturated at
+ * `__thashtbl_rh_dist_max`, instead of h2. An insertion takes the slot of any
+ * pair closer to its home and carries that pair on, so that
+ * 	- a lookup stops at the first pair closer to its home than the key
+ * 	  would be, misses are about as short as hits
+ * 	- a removal shifts the following pairs back by one slot, leaving no
+ * 	  tombstone
+ *
+ * The old slots of an incremental migration only lose pairs, they take
+ * tombstones as in the default mode.
+ */
+#define __thashtbl_rh_dist_max     ((uint8_t) 0x7F)
+
+/* One generation of slots, all created by array construction function
+ */
+struct tds_hashtbl_slots {
+	tds_array *__ctrl;     /* 1-byte tags */
+	tds_array *__pairs;
+	tds_array *__codes;    /* 64-bit hash codes, `NULL` if not stored */
+};
 
 struct tds_hashtbl {
-	tds_bitarray *__mark_delete;  /* created by bitarray construction function */
-	tds_array *__pairs;           /* created by array construction function */
+	struct tds_hashtbl_slots __slots;
 	size_t __keysize;
-	size_t __usage;
+	size_t __usage;        /* number of live pairs, including the old slots */
+	size_t __tombs;        /* number of deleted tags */
+	tds_fhash_t *__fhash;  /* hash function of keys */
+	uint64_t __seed;       /* random per table, passed to `__fhash` */
+	int __mode;
+	tds_array *__swap;     /* 2 pairs carried by robin hood insertions, `NULL`
+	                        * in other modes */
+
+	/* incremental resizing: the old slots being migrated, `__ctrl` is
+	 * `NULL` if not migrating */
+	struct tds_hashtbl_slots __old;
+	size_t __old_usage;    /* number of live pairs in the old slots */
+	size_t __migrate_loc;  /* the next old slot to migrate */
+
+	/* string-key mode: the keys are copied into `__arena`, `NULL` in other
+	 * modes */
+	tds_array *__arena;
+	size_t __arena_len;      /* bytes used, including removed keys */
+	size_t __arena_garbage;  /* bytes of removed keys */
+
+	/* opened by `tds_hashtbl_open_mmap`: the arrays point into the mapped
+	 * file and the table is read-only, `NULL` in other cases */
+	void *__map;
+	size_t __map_len;
+
+	size_t __nresizes;
+	struct __thashtbl_counters *__counters;  /* `NULL` without the statistics */
+	const tds_allocator *__alloc;            /* `NULL` if mapped */
+};
+
+/* Counters of `tds_hashtbl_with_stats`, allocated apart from the table so
+ * that `const` lookups can update them
+ */
+struct __thashtbl_counters {
+	size_t __nlookups;
+	size_t __max_probe;
+	size_t __hist[tds_hashtbl_stats_nbins];
+	double __resize_seconds;
+};
+
+/* String-key mode
+ *
+ * 	- a stored pair is a `__thashtbl_sref` to the key arena followed by
+ * 	  the value
+ * 	- the key passed to the slot functions is a `__thashtbl_skey`
+ */
+struct __thashtbl_sref {
+	size_t __off;
+	size_t __len;
+};
+
+struct __thashtbl_skey {
+	const char *__ptr;
+	size_t __len;
 };
 
 
@@ -27,376 +150,1765 @@ struct tds_hashtbl {
  * Part 1. Hash related
  ******************************************************************************/
 
-/* Core Hash algorithm
+/* Hash the first `keysize` bytes of `key` with the table's function and seed
  */
-uint64_t __tds_hashtbl_code_fn(const void *key, size_t keysize, uint64_t base)
+static uint64_t __tds_hashtbl_code(const tds_hashtbl *tbl, const void *key)
 {
-	uint64_t code = 0;  /* hash code */
-	size_t i;
-	char *p = (char *) key;
+	return tbl->__fhash(key, tbl->__keysize, tbl->__seed);
+}
 
-	for (i = 0; i < keysize; i++) {
-		code += (p[i] + 1);
-		code *= base;
-	}
-	return code;
+/* Compare the key of a stored `pair` with a `key` passed by the user
+ */
+static int __tds_hashtbl_key_eq(const tds_hashtbl *tbl, const void *pair, const void *key)
+{
+	const struct __thashtbl_sref *sref = NULL;
+	const struct __thashtbl_skey *skey = NULL;
+
+	if (NULL == tbl->__arena)
+		return 0 == memcmp(key, pair, tbl->__keysize);
+	sref = (const struct __thashtbl_sref *) pair;
+	skey = (const struct __thashtbl_skey *) key;
+	return sref->__len == skey->__len && (0 == skey->__len || 0 == memcmp(skey->__ptr, \
+		(const char *) tds_array_data(tbl->__arena) + sref->__off, skey->__len));
 }
 
-/* Test results of 100,000,000 key-value pairs, counting the total conflictions
- *
- * Note:
- * Load factor is around 20% - 40%. See `test/test_hashtbl.c`
- *
- * | prim |  1,000,000 |  10,000,000 |  100,000,000 |
- * | ---- | ---------- | ----------- | ------------ |
- * |  13  |    254,677 |   1,810,393 |              |
- * |  17  |    282,561 |   1,825,637 |              |
- * |  19  |    322,992 |   3,751,867 |              |
- * |  23  |    568,471 |     891,815 |              |
- * |  29  |    175,504 |   2,481,449 |              |
- * |  31  |    689,364 |   3,956,252 |              |
- * |  37  |    390,750 |   2,075,701 |              |
- * |  41  |    282,088 |     858,399 |              |
- * |  43  |    535,560 |   1,313,095 |              |
- * |  47  |    288,020 |   2,274,344 |              |
- * |  53  |    339,329 |   2,137,211 |              |
- * |  59  |    278,367 |     957,101 |              |
- * |  61  |    195,273 |   2,164,114 |              |
- * |  67  |    349,482 |   4,487,439 |              |
- * |  71  |    258,043 |   1,015,314 |              |
- * |  73  |    819,659 |   2,520,886 |              |
- * |  79  |    250,145 |     832,997 |              |
- * |  83  |    132,799 |   1,127,806 |              |
- * |  89  |    156,396 |   1,631,691 |              |
- * |  97  |    538,955 |   3,089,063 |              |
- * | 101  |    297,211 |     961,811 |              |
- * | 103  |    189,988 |     918,970 |              |
- * | 107  |    333,492 |   1,340,713 |              |
- * | 109  |    743,002 |   1,513,836 |              |
- * | 113  |    333,293 |   2,051,708 |              |
- * | 127  | 14,386,873 |  47,066,592 |              |
- * | 131  |    185,299 |   2,110,784 |              |
- * | 137  |    229,833 |   1,324,296 |              |
- * | 139  |    288,627 |   1,456,837 |              |
- * | 149  |    542,476 |   1,843,235 |              |
- * | 151  |    208,122 |     827,972 |              |
- * | 157  |    227,202 |   1,832,950 |              |
- * | 163  |    292,412 |   1,171,459 |              |
- * | 167  |    291,104 |   1,448,417 |              |
- * | 173  |    289,708 |   1,714,152 |              |
- * | 179  |    280,400 |   2,496,113 |              |
- * | 181  |    428,376 |   3,247,992 |              |
- * | 191  |  2,541,637 |  15,165,678 |              |
- * | 193  |  2,672,284 |  14,806,009 |              |
- * | 197  |    147,151 |     870,027 |              |
- * | 199  |    505,277 |   1,789,141 |              |
- * | 211  |    893,109 |   2,066,069 |              |
- * | 223  |    535,430 |   2,830,929 |              |
- * | 227  |    196,969 |   1,114,904 |              |
- * | 229  |    248,974 |   1,657,697 |              |
- * | 233  |    268,220 |   1,383,649 |              |
- * | 239  |    313,925 |   2,150,900 |              |
- * | 241  |    401,029 |   1,680,264 |              |
- * | 251  |    363,454 |   1,473,134 |              |
- * | 257  | 22,719,070 | 464,954,344 |              |
- * | 263  |    634,143 |   2,419,988 |              |
- * | 269  |    227,019 |   1,817,864 |              |
- * | 271  |    218,656 |   2,984,116 |              |
- * | 277  |    326,324 |   1,093,931 |              |
- * | 281  |    564,831 |   1,396,687 |              |
- * | 283  |  1,184,666 |   2,537,050 |              |
- * | 293  |    295,100 |   1,622,604 |              |
- * | 307  |    311,510 |   1,104,937 |              |
- * | 311  |    854,688 |   1,151,211 |              |
- * | 313  |    185,325 |   3,609,561 |              |
- * | 317  |    347,620 |     828,801 |              |
- * | 331  |    258,504 |   1,967,779 |              |
- * | 337  |    304,634 |   1,371,804 |              |
- * | 347  |    340,222 |   1,958,599 |              |
- * | 349  |    210,856 |     848,136 |              |
- * | 353  |    477,158 |   2,062,634 |              |
- * | 359  |    264,153 |   2,554,342 |              |
- * | 367  |    122,435 |     641,442 |   17,126,217 |
- * | 373  |    329,602 |   1,196,194 |              |
- * | 379  |    319,964 |   1,227,605 |              |
- * | 383  | 14,635,708 |  48,194,127 |              |
- * | 389  |    296,223 |   1,838,127 |              |
- * | 397  |    832,162 |   2,808,716 |              |
- * | 401  |    651,589 |   1,586,482 |              |
- * | 409  |    349,236 |   1,809,507 |              |
- * | 419  |    326,571 |   3,044,083 |              |
- * | 421  |    736,152 |   2,117,233 |              |
- * | 431  |    213,512 |   1,867,724 |              |
- * | 433  |    516,930 |   1,621,813 |              |
- * | 439  |    215,614 |   1,668,819 |              |
- * | 443  |    591,346 |   4,027,463 |              |
- * | 449  |  2,443,250 |  15,437,502 |              |
- * | 457  |    386,981 |   2,904,237 |              |
- * | 461  |    587,353 |   1,354,406 |              |
- * | 463  |    330,964 |   2,262,520 |              |
- * | 467  |    228,730 |     621,561 |   24,177,312 |
- * | 479  |    806,742 |   3,220,566 |              |
- * | 487  |    393,394 |   2,060,740 |              |
- * | 491  |    298,330 |     864,481 |              |
- * | 499  |    452,754 |   7,978,167 |              |
- * | 503  |    318,007 |   1,514,110 |              |
- * | 509  |    304,624 |   1,586,846 |              |
- */
-
-#ifdef __tds_debug
-size_t __n_conflicts = 0;
-
-size_t __tds_hashtbl_get_n_conflicts(const tds_hashtbl *tbl)
-{
-	return __n_conflicts;
-}
-
-void __tds_hashtbl_reset_n_conflicts(tds_hashtbl *tbl)
-{
-	__n_conflicts = 0;
+/* h1 selects the first group to probe, h2 is stored in the control tag
+ */
+#define __h1(code)  ((size_t) ((code) >> 7))
+#define __h2(code)  ((uint8_t) ((code) & 0x7F))
+
+#ifdef tds_hashtbl_with_stats
+/* Record a probing sequence of `ngroups` groups
+ */
+static void __tds_hashtbl_record_probe(const tds_hashtbl *tbl, size_t ngroups)
+{
+	struct __thashtbl_counters *counters = tbl->__counters;
+
+	if (NULL == counters)
+		return;
+	counters->__nlookups++;
+	counters->__hist[(ngroups < tds_hashtbl_stats_nbins ? ngroups : tds_hashtbl_stats_nbins) - 1]++;
+	if (ngroups > counters->__max_probe)
+		counters->__max_probe = ngroups;
 }
+#define __thashtbl_record_probe(tbl, ngroups)  __tds_hashtbl_record_probe(tbl, ngroups)
+#else
+#define __thashtbl_record_probe(tbl, ngroups)  ((void) 0)
 #endif
 
 
 /******************************************************************************
- * Part 2. Creation, Resize & Free
+ * Part 2. Group of control tags
+ *
+ * Each function returns a bit mask, the i-th bit is set if the i-th tag of
+ * the group is selected
  ******************************************************************************/
 
-tds_hashtbl *tds_hashtbl_create_g(size_t pairsize, size_t keysize, size_t init_capacity)
+static uint32_t __group_match(const uint8_t *group, uint8_t h2)
 {
-	size_t capacity = __thashtbl_init_capacity;
-	tds_hashtbl *tbl = NULL;
-	assert(keysize <= pairsize);
-	while (capacity < init_capacity)
-		capacity *= 2;
-	if (NULL == (tbl = (tds_hashtbl *) malloc(sizeof(tds_hashtbl)))) {
-		printf("Error ... tds_hashtbl_create_g\n");
-		return NULL;
+#ifdef __thashtbl_sse2
+	__m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+	return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) h2)));
+#else
+	uint32_t mask = 0;
+	int i;
+
+	for (i = 0; i < __thashtbl_group_width; i++)
+		mask |= (uint32_t) (group[i] == h2) << i;
+	return mask;
+#endif
+}
+
+static uint32_t __group_match_empty(const uint8_t *group)
+{
+	return __group_match(group, __thashtbl_ctrl_empty);
+}
+
+/* Both empty and deleted tags have the highest bit set
+ */
+static uint32_t __group_match_empty_or_deleted(const uint8_t *group)
+{
+#ifdef __thashtbl_sse2
+	return (uint32_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+#else
+	uint32_t mask = 0;
+	int i;
+
+	for (i = 0; i < __thashtbl_group_width; i++)
+		mask |= (uint32_t) (group[i] >> 7) << i;
+	return mask;
+#endif
+}
+
+static uint32_t __group_match_full(const uint8_t *group)
+{
+	return ~__group_match_empty_or_deleted(group) & ((1u << __thashtbl_group_width) - 1);
+}
+
+/* Index of the lowest set bit, `mask` != 0
+ */
+static int __ctz(uint32_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+	unsigned long idx;
+	_BitScanForward(&idx, mask);
+	return (int) idx;
+#else
+	int idx = 0;
+
+	while (0 == (mask & 1)) {
+		mask >>= 1;
+		idx++;
 	}
-	if (NULL == (tbl->__pairs = tds_array_create(pairsize, capacity))) {
-		free(tbl);
-		printf("Error ... tds_hashtbl_create_g\n");
-		return NULL;
+	return idx;
+#endif
+}
+
+
+/******************************************************************************
+ * Part 3. Slots
+ *
+ * Groups are probed in a triangular sequence `g, g+1, g+3, g+6, ...` which
+ * visits every group once since the number of groups is a power of 2.
+ ******************************************************************************/
+
+static uint8_t *__ctrl_data(const tds_array *ctrl)
+{
+	return (uint8_t *) tds_array_data(ctrl);
+}
+
+static uint64_t *__codes_data(const tds_array *codes)
+{
+	return (uint64_t *) tds_array_data(codes);
+}
+
+/* Bytes of an array, its header included
+ */
+static size_t __array_image_size(const tds_array *arr)
+{
+	return (size_t) ((const char *) tds_array_data(arr) - (const char *) arr) \
+		+ tds_array_elesize(arr) * tds_array_capacity(arr);
+}
+
+/* Tag of a robin hood slot at `dist` from its home
+ */
+static uint8_t __rh_tag(size_t dist)
+{
+	return dist < __thashtbl_rh_dist_max ? (uint8_t) dist : __thashtbl_rh_dist_max;
+}
+
+/* Distance of the full slot `i` to its home slot
+ */
+static size_t __rh_dist(const tds_hashtbl *tbl, const struct tds_hashtbl_slots *slots, size_t i)
+{
+	uint8_t tag = __ctrl_data(slots->__ctrl)[i];
+	uint64_t code = 0;
+
+	if (tag < __thashtbl_rh_dist_max)
+		return tag;
+	/* saturated, only in very long clusters */
+	if (NULL != slots->__codes)
+		code = __codes_data(slots->__codes)[i];
+	else
+		code = __tds_hashtbl_code(tbl, tds_array_get(slots->__pairs, i));
+	return (i - __h1(code)) & (tds_array_capacity(slots->__ctrl) - 1);
+}
+
+static void __rh_put(struct tds_hashtbl_slots *slots, size_t loc, \
+	const void *pair, uint64_t code, size_t dist)
+{
+	__ctrl_data(slots->__ctrl)[loc] = __rh_tag(dist);
+	tds_array_set(slots->__pairs, loc, pair);
+	if (NULL != slots->__codes)
+		__codes_data(slots->__codes)[loc] = code;
+}
+
+/* Robin hood version of `__slots_find`, on failure `loc` is where the probing
+ * stopped
+ */
+static int __rh_find(const tds_hashtbl *tbl, const struct tds_hashtbl_slots *slots, \
+	const void *key, uint64_t code, size_t *loc)
+{
+	const uint8_t *tags = __ctrl_data(slots->__ctrl);
+	const uint64_t *codes = NULL;
+	size_t mask = tds_array_capacity(slots->__ctrl) - 1;
+	size_t i = __h1(code) & mask;
+	size_t dist = 0;
+
+	if (NULL != slots->__codes)
+		codes = __codes_data(slots->__codes);
+
+	for (dist = 0; dist <= mask; dist++) {
+		uint8_t tag = tags[i];
+
+		if (__thashtbl_ctrl_empty == tag || tag < __rh_tag(dist)) {
+			__thashtbl_record_probe(tbl, dist / __thashtbl_group_width + 1);
+			*loc = i;
+			return 0;  /* not found */
+		}
+		/* only the pairs of the same home slot are at the same distance,
+		 * deleted tags (old slots) are passed over */
+		if (tag == __rh_tag(dist)
+		 && (NULL == codes || code == codes[i])
+		 && __tds_hashtbl_key_eq(tbl, tds_array_get(slots->__pairs, i), key)) {
+			__thashtbl_record_probe(tbl, dist / __thashtbl_group_width + 1);
+			*loc = i;
+			return 1;  /* found */
+		}
+		i = (i + 1) & mask;
 	}
-	if (NULL == (tbl->__mark_delete = tds_bitarray_create(capacity))) {
-		tds_array_free(tbl->__pairs);
-		free(tbl);
-		printf("Error ... tds_hashtbl_create_g\n");
-		return NULL;
+	assert(0);  /* unreachable: the load factor keeps empty slots */
+	return 0;
+}
+
+/* Put a pair whose key is known to be absent, displacing the pairs closer to
+ * their home slots
+ *
+ * `pair` may be the first scratch pair of `tbl->__swap`.
+ */
+static void __rh_insert(tds_hashtbl *tbl, struct tds_hashtbl_slots *slots, \
+	const void *pair, uint64_t code)
+{
+	const uint8_t *tags = __ctrl_data(slots->__ctrl);
+	size_t mask = tds_array_capacity(slots->__ctrl) - 1;
+	size_t pairsize = tds_array_elesize(slots->__pairs);
+	size_t i = __h1(code) & mask;
+	size_t dist = 0;
+	char *carry = (char *) tds_array_get(tbl->__swap, 0);
+	char *spare = (char *) tds_array_get(tbl->__swap, 1);
+
+	if (carry != pair)
+		memcpy(carry, pair, pairsize);
+	for (;;) {
+		size_t resident = 0;
+
+		if (tags[i] & 0x80) {  /* empty, the current slots have no tombstone */
+			__rh_put(slots, i, carry, code, dist);
+			return;
+		}
+		if ((resident = __rh_dist(tbl, slots, i)) < dist) {
+			char *tmp = spare;
+			uint64_t resident_code = 0;
+
+			if (NULL != slots->__codes)
+				resident_code = __codes_data(slots->__codes)[i];
+			memcpy(spare, tds_array_get(slots->__pairs, i), pairsize);
+			__rh_put(slots, i, carry, code, dist);
+			spare = carry;
+			carry = tmp;
+			code = resident_code;
+			dist = resident;
+		}
+		i = (i + 1) & mask;
+		dist++;
 	}
-	tbl->__keysize = keysize;
-	tbl->__usage = 0;
-	return tbl;
 }
 
-tds_hashtbl *tds_hashtbl_create(size_t pairsize, size_t keysize)
+/* Remove the pair at `loc` and shift the following pairs back until an empty
+ * slot or a pair at its home
+ */
+static void __rh_erase(const tds_hashtbl *tbl, struct tds_hashtbl_slots *slots, size_t loc)
 {
-	return tds_hashtbl_create_g(pairsize, keysize, __thashtbl_init_capacity);
+	uint8_t *tags = __ctrl_data(slots->__ctrl);
+	size_t mask = tds_array_capacity(slots->__ctrl) - 1;
+	size_t next = (loc + 1) & mask;
+	size_t dist = 0;
+
+	while (0 == (tags[next] & 0x80) && 0 != (dist = __rh_dist(tbl, slots, next))) {
+		tags[loc] = __rh_tag(dist - 1);
+		tds_array_set(slots->__pairs, loc, tds_array_get(slots->__pairs, next));
+		if (NULL != slots->__codes)
+			__codes_data(slots->__codes)[loc] = __codes_data(slots->__codes)[next];
+		loc = next;
+		next = (next + 1) & mask;
+	}
+	tags[loc] = __thashtbl_ctrl_empty;
 }
 
-tds_hashtbl *tds_hashtbl_force_create_g(size_t pairsize, size_t keysize, size_t init_capacity)
+/* Search `key` in the slots
+ * On success, return 1 and assign the location to `loc`
+ * On failure, return 0 and assign the first empty or deleted location on the
+ * 	probing sequence to `loc`, so that tombstones are reused
+ *
+ * With stored hash codes, the full code is compared before the key bytes.
+ */
+static int __slots_find(const tds_hashtbl *tbl, const struct tds_hashtbl_slots *slots, \
+	const void *key, uint64_t code, size_t *loc)
 {
-	tds_hashtbl *tbl = NULL;
+	const uint8_t *tags = __ctrl_data(slots->__ctrl);
+	const uint64_t *codes = NULL;
+	size_t ngroups = tds_array_capacity(slots->__ctrl) / __thashtbl_group_width;
+	size_t g = __h1(code) & (ngroups - 1);
+	size_t probe = 0;
+	size_t free_loc = (size_t) -1;
+	uint8_t h2 = __h2(code);
 
-	if (NULL == (tbl = tds_hashtbl_create_g(pairsize, keysize, init_capacity))) {
-		printf("Error ... tds_hashtbl_force_create_g\n");
-		exit(-1);
+	if (tbl->__mode & tds_hashtbl_mode_robinhood)
+		return __rh_find(tbl, slots, key, code, loc);
+	if (NULL != slots->__codes)
+		codes = __codes_data(slots->__codes);
+
+	for (probe = 0; probe < ngroups; probe++) {
+		const uint8_t *group = tags + g * __thashtbl_group_width;
+		uint32_t mask = __group_match(group, h2);
+
+		while (0 != mask) {
+			size_t i = g * __thashtbl_group_width + __ctz(mask);
+			if ((NULL == codes || code == codes[i])
+			 && __tds_hashtbl_key_eq(tbl, tds_array_get(slots->__pairs, i), key)) {
+				__thashtbl_record_probe(tbl, probe + 1);
+				*loc = i;
+				return 1;  /* found */
+			}
+			mask &= mask - 1;
+		}
+		if ((size_t) -1 == free_loc
+		 && 0 != (mask = __group_match_empty_or_deleted(group)))
+			free_loc = g * __thashtbl_group_width + __ctz(mask);
+		if (0 != __group_match_empty(group)) {
+			__thashtbl_record_probe(tbl, probe + 1);
+			*loc = free_loc;
+			return 0;  /* not found, `loc` is free */
+		}
+		g = (g + probe + 1) & (ngroups - 1);
 	}
-	return tbl;
+	assert(0);  /* unreachable: the load factor keeps empty slots */
+	return 0;
 }
 
-tds_hashtbl *tds_hashtbl_force_create(size_t pairsize, size_t keysize)
+/* Fill the slot at `loc` with `pair`, which is NULL if already written
+ */
+static void __slots_put(struct tds_hashtbl_slots *slots, size_t loc, \
+	const void *pair, uint64_t code)
 {
-	return tds_hashtbl_force_create_g(pairsize, keysize, __thashtbl_init_capacity);
+	__ctrl_data(slots->__ctrl)[loc] = __h2(code);
+	if (NULL != pair)
+		tds_array_set(slots->__pairs, loc, pair);
+	if (NULL != slots->__codes)
+		__codes_data(slots->__codes)[loc] = code;
 }
 
-static int __is_empty(const tds_hashtbl *tbl, size_t loc)
+/* Issue prefetches for the home group of `code`
+ *
+ * 	- `match` = 0: the control tags and the first pair of the group
+ * 	- `match` = 1: the pair of the first tag matching h2, the tags should
+ * 	  have been prefetched earlier
+ *
+ * In the robin hood mode, the home slot replaces the home group and there is
+ * nothing to match.
+ */
+static void __slots_prefetch(const tds_hashtbl *tbl, \
+	const struct tds_hashtbl_slots *slots, uint64_t code, int match)
 {
-	size_t idx = 0;
-	size_t keysize = tds_array_elesize(tbl->__pairs);
-	unsigned char *pair = (unsigned char *) tds_array_get(tbl->__pairs, loc);
+	const uint8_t *tags = __ctrl_data(slots->__ctrl);
+	size_t ngroups = tds_array_capacity(slots->__ctrl) / __thashtbl_group_width;
+	size_t first = (__h1(code) & (ngroups - 1)) * __thashtbl_group_width;
 
-	for (idx = 0; idx < keysize; idx++) {
-		if (pair[idx] != 0)
-			return 0;
+	if (tbl->__mode & tds_hashtbl_mode_robinhood) {
+		if (match)
+			return;
+		first = __h1(code) & (tds_array_capacity(slots->__ctrl) - 1);
+	}
+	if (!match) {
+		__thashtbl_prefetch(tags + first);
+		__thashtbl_prefetch(tds_array_get(slots->__pairs, first));
+		if (NULL != slots->__codes)
+			__thashtbl_prefetch(__codes_data(slots->__codes) + first);
+	} else {
+		uint32_t mask = __group_match(tags + first, __h2(code));
+		if (0 != mask)
+			__thashtbl_prefetch(tds_array_get(slots->__pairs, first + __ctz(mask)));
 	}
-	return 1;
 }
 
-int __tds_hashtbl_try_expand(tds_hashtbl *tbl)
+/* Put a pair whose key is known to be absent
+ */
+static void __slots_insert_new(tds_hashtbl *tbl, struct tds_hashtbl_slots *slots, \
+	const void *pair, uint64_t code)
 {
-	size_t pairsize = 0;
-	size_t new_capacity = 0;
-	size_t idx = 0;
-	tds_bitarray *new_delete_marker = NULL;
-	tds_array *new_pairs = NULL;
-	tds_hashtbl new_table;
+	const uint8_t *tags = __ctrl_data(slots->__ctrl);
+	size_t ngroups = tds_array_capacity(slots->__ctrl) / __thashtbl_group_width;
+	size_t g = __h1(code) & (ngroups - 1);
+	size_t probe = 0;
 
-	assert(NULL != tbl);
+	if (tbl->__mode & tds_hashtbl_mode_robinhood) {
+		__rh_insert(tbl, slots, pair, code);
+		return;
+	}
+	for (probe = 0; probe < ngroups; probe++) {
+		uint32_t mask = __group_match_empty(tags + g * __thashtbl_group_width);
 
-	if (tds_hashtbl_load_factor(tbl) < __thashtbl_load_threshold)
-		return 1;  /* success, no need to resize */
-	pairsize = tds_array_elesize(tbl->__pairs);
-	new_capacity = 2 * tds_hashtbl_capacity(tbl);
+		if (0 != mask) {
+			__slots_put(slots, g * __thashtbl_group_width + __ctz(mask), pair, code);
+			return;
+		}
+		g = (g + probe + 1) & (ngroups - 1);
+	}
+	assert(0);  /* unreachable: the load factor keeps empty slots */
+}
 
-	if (NULL == (new_delete_marker = tds_bitarray_create(new_capacity))) {
-		printf("Error .. __tds_hashtbl_try_expand\n");
-		return 0;
+/* Remove the pair at `loc`
+ *
+ * If the group of `loc` still has an empty tag, no probing sequence has ever
+ * passed through this group, so the tag can be emptied directly. Otherwise
+ * it becomes a tombstone.
+ *
+ * Return a boolean indicating whether a tombstone is left
+ */
+static int __slots_erase(const tds_hashtbl *tbl, struct tds_hashtbl_slots *slots, size_t loc)
+{
+	uint8_t *tags = __ctrl_data(slots->__ctrl);
+
+	if (tbl->__mode & tds_hashtbl_mode_robinhood) {
+		if (slots == &tbl->__slots) {
+			__rh_erase(tbl, slots, loc);
+			return 0;
+		}
+		tags[loc] = __thashtbl_ctrl_deleted;  /* old slots being migrated */
+		return 1;
 	}
-	if (NULL == (new_pairs = tds_array_create(pairsize, new_capacity))) {
-		printf("Error .. __tds_hashtbl_try_expand\n");
+	if (0 != __group_match_empty(tags + loc / __thashtbl_group_width * __thashtbl_group_width)) {
+		tags[loc] = __thashtbl_ctrl_empty;
 		return 0;
 	}
-	tds_bitarray_init(new_delete_marker, 0);
-	new_table.__pairs = new_pairs;
-	new_table.__mark_delete = new_delete_marker;
-	new_table.__keysize = tbl->__keysize;
-	new_table.__usage = 0;
+	tags[loc] = __thashtbl_ctrl_deleted;
+	return 1;
+}
 
-	/* searching old hashtable, rehash keys */
-	for (idx = 0; idx < tds_hashtbl_capacity(tbl); idx++) {
-		if (__is_empty(tbl, idx))  /* not used */
-			continue;
-		if (tds_bitarray_get(tbl->__mark_delete, idx))  /* deleted */
-			continue;
-		tds_hashtbl_set(&new_table, tds_array_get(tbl->__pairs, idx));
+/* On success, all tags are empty
+ */
+static int __slots_create(struct tds_hashtbl_slots *slots, \
+	size_t pairsize, size_t capacity, int store_codes, const tds_allocator *alloc)
+{
+	slots->__codes = NULL;
+	if (NULL == (slots->__ctrl = tds_array_create_g(1, capacity, alloc)))
+		return 0;
+	if (NULL == (slots->__pairs = tds_array_create_g(pairsize, capacity, alloc))) {
+		tds_array_free_g(slots->__ctrl, alloc);
+		return 0;
 	}
-	tds_array_free(tbl->__pairs);
-	tds_bitarray_free(tbl->__mark_delete);
-
-	tbl->__pairs = new_pairs;
-	tbl->__mark_delete = new_delete_marker;
+	if (store_codes
+	 && NULL == (slots->__codes = tds_array_create_g(sizeof(uint64_t), capacity, alloc))) {
+		tds_array_free_g(slots->__pairs, alloc);
+		tds_array_free_g(slots->__ctrl, alloc);
+		return 0;
+	}
+	memset(tds_array_data(slots->__ctrl), __thashtbl_ctrl_empty, capacity);
 	return 1;
 }
 
-void tds_hashtbl_free(tds_hashtbl *tbl)
+static void __slots_free(struct tds_hashtbl_slots *slots, const tds_allocator *alloc)
 {
-	assert(NULL != tbl);
-	tds_bitarray_free(tbl->__mark_delete);
-	tds_array_free(tbl->__pairs);
-	free(tbl);
+	tds_array_free_g(slots->__ctrl, alloc);
+	tds_array_free_g(slots->__pairs, alloc);
+	if (NULL != slots->__codes)
+		tds_array_free_g(slots->__codes, alloc);
+	slots->__ctrl = NULL;
+	slots->__pairs = NULL;
+	slots->__codes = NULL;
 }
 
 
 /******************************************************************************
- * Part 3. Statistics
+ * Part 4. Creation, Resize & Free
  ******************************************************************************/
 
-size_t tds_hashtbl_usage(const tds_hashtbl *tbl)
+tds_hashtbl *tds_hashtbl_create_m(size_t pairsize, size_t keysize, \
+	size_t init_capacity, tds_fhash_t *_fhash, int mode, const tds_allocator *alloc)
 {
-	assert(NULL != tbl);
-	return tbl->__usage;
+	size_t capacity = __thashtbl_init_capacity;
+	tds_hashtbl *tbl = NULL;
+	assert(keysize <= pairsize);
+	assert(NULL != _fhash);
+	while (capacity < init_capacity)
+		capacity *= 2;
+	if (NULL == (tbl = (tds_hashtbl *) tds_allocator_alloc(alloc, sizeof(tds_hashtbl)))) {
+		printf("Error ... tds_hashtbl_create_m\n");
+		return NULL;
+	}
+	if (!__slots_create(&tbl->__slots, pairsize, capacity, mode & tds_hashtbl_mode_storehash, alloc)) {
+		tds_allocator_free(alloc, tbl, sizeof(tds_hashtbl));
+		printf("Error ... tds_hashtbl_create_m\n");
+		return NULL;
+	}
+	tbl->__keysize = keysize;
+	tbl->__usage = 0;
+	tbl->__tombs = 0;
+	tbl->__fhash = _fhash;
+	tbl->__seed = ta_hash_seed();
+	tbl->__mode = mode;
+	tbl->__swap = NULL;
+	tbl->__old.__ctrl = NULL;
+	tbl->__old_usage = 0;
+	tbl->__migrate_loc = 0;
+	tbl->__arena = NULL;
+	tbl->__arena_len = 0;
+	tbl->__arena_garbage = 0;
+	tbl->__map = NULL;
+	tbl->__map_len = 0;
+	tbl->__nresizes = 0;
+	tbl->__counters = NULL;
+	tbl->__alloc = alloc;
+	if ((mode & tds_hashtbl_mode_robinhood)
+	 && NULL == (tbl->__swap = tds_array_create_g(pairsize, 2, alloc))) {
+		tds_hashtbl_free(tbl);
+		printf("Error ... tds_hashtbl_create_m\n");
+		return NULL;
+	}
+#ifdef tds_hashtbl_with_stats
+	if (NULL == (tbl->__counters = (struct __thashtbl_counters *) \
+		tds_allocator_calloc(alloc, sizeof(struct __thashtbl_counters)))) {
+		tds_hashtbl_free(tbl);
+		printf("Error ... tds_hashtbl_create_m\n");
+		return NULL;
+	}
+#endif
+	return tbl;
 }
 
-size_t tds_hashtbl_capacity(const tds_hashtbl *tbl)
+tds_hashtbl *tds_hashtbl_create_s_g(size_t valsize, size_t init_capacity, \
+	int mode, const tds_allocator *alloc)
 {
-	assert(NULL != tbl);
-	return tds_array_capacity(tbl->__pairs);
+	tds_hashtbl *tbl = NULL;
+
+	tbl = tds_hashtbl_create_m(sizeof(struct __thashtbl_sref) + valsize, 0, \
+		init_capacity, ta_hash_wy, mode | tds_hashtbl_mode_storehash, alloc);
+	if (NULL == tbl) {
+		printf("Error ... tds_hashtbl_create_s_g\n");
+		return NULL;
+	}
+	if (NULL == (tbl->__arena = tds_array_create_g(1, __thashtbl_arena_capacity, tbl->__alloc))) {
+		tds_hashtbl_free(tbl);
+		printf("Error ... tds_hashtbl_create_s_g\n");
+		return NULL;
+	}
+	return tbl;
 }
 
-double tds_hashtbl_load_factor(const tds_hashtbl *tbl)
+tds_hashtbl *tds_hashtbl_create_s(size_t valsize, size_t init_capacity, int mode)
 {
-	assert(NULL != tbl);
-	return ((double) tds_hashtbl_usage(tbl)) / ((double) tds_hashtbl_capacity(tbl));
+	return tds_hashtbl_create_s_g(valsize, init_capacity, mode, NULL);
 }
 
+tds_hashtbl *tds_hashtbl_create_h(size_t pairsize, size_t keysize, \
+	size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc)
+{
+	return tds_hashtbl_create_m(pairsize, keysize, init_capacity, _fhash, 0, alloc);
+}
 
-/******************************************************************************
- * Part 4. Search, Get, Set and Delete
- ******************************************************************************/
-
-/* Return
- * 	location `loc` that is either free or used
- * 	state = 0 if loc is free
- * 	state = 1 if loc is used
- */
-size_t tds_hashtbl_getloc( \
-	const tds_hashtbl *tbl, const void *key, size_t _new_capacity, int *state)
+tds_hashtbl *tds_hashtbl_create_g(size_t pairsize, size_t keysize, \
+	size_t init_capacity, const tds_allocator *alloc)
 {
-	long explorer_1 = 0;
-	long explorer_2 = 1;
-	size_t keysize = 0, code = 0, loc = 0;
-	assert(NULL != tbl);
-	assert(NULL != key);
-	assert(NULL != state);
-	assert(_new_capacity >= tds_array_capacity(tbl->__pairs));
-	keysize = tbl->__keysize;
-	code = __tds_hashtbl_code_fn(key, keysize, __thashtbl_default_base);
-	loc = code % _new_capacity;
-SEARCH:
-	loc = (code + explorer_1 * explorer_1 * explorer_2) % _new_capacity;
-
-	if (__is_empty(tbl, loc)) {
-		*state = 0;  /* loc is free for storage */
-		return loc;
-	} else if (0 == memcmp(key, tds_array_get(tbl->__pairs, loc), keysize)) {
-		*state = 1;  /* loc is used */
-		return loc;
-	} else {
-		if (explorer_2 > 0)
-			explorer_1++;
-		explorer_2 *= -1;
-#ifdef __tds_debug
-		__n_conflicts++;
-#endif
-		goto SEARCH;
-	}
+	return tds_hashtbl_create_h(pairsize, keysize, init_capacity, ta_hash_wy, alloc);
 }
 
-int tds_hashtbl_contains(const tds_hashtbl *tbl, const void *key, size_t *loc)
+tds_hashtbl *tds_hashtbl_create(size_t pairsize, size_t keysize)
 {
-	size_t old_capacity = tds_hashtbl_capacity(tbl);
-	int occupied = 0;
-	*loc = tds_hashtbl_getloc(tbl, key, old_capacity, &occupied);
-	if (!occupied)
-		return 0;
-	if (tds_bitarray_get(tbl->__mark_delete, *loc))
-		return 0;
-	return 1;
+	return tds_hashtbl_create_g(pairsize, keysize, __thashtbl_init_capacity, NULL);
 }
 
-void *tds_hashtbl_get(const tds_hashtbl *tbl, const void *key)
+tds_hashtbl *tds_hashtbl_force_create_g(size_t pairsize, size_t keysize, \
+	size_t init_capacity, const tds_allocator *alloc)
 {
-	size_t old_capacity = tds_hashtbl_capacity(tbl);
-	int occupied = 0;
-	size_t loc = tds_hashtbl_getloc(tbl, key, old_capacity, &occupied);
-	if (!occupied)  /* the location is free */
-		return NULL;
-	if (tds_bitarray_get(tbl->__mark_delete, loc))  /* the location has been deleted */
-		return NULL;
-	return tds_array_get(tbl->__pairs, loc);
+	tds_hashtbl *tbl = NULL;
+
+	if (NULL == (tbl = tds_hashtbl_create_g(pairsize, keysize, init_capacity, alloc))) {
+		printf("Error ... tds_hashtbl_force_create_g\n");
+		exit(-1);
+	}
+	return tbl;
 }
 
-int tds_hashtbl_set(tds_hashtbl *tbl, const void *pair)
+tds_hashtbl *tds_hashtbl_force_create_h(size_t pairsize, size_t keysize, \
+	size_t init_capacity, tds_fhash_t *_fhash, const tds_allocator *alloc)
 {
-	size_t old_capacity = tds_hashtbl_capacity(tbl);
-	int occupied = 0;
-	size_t loc = tds_hashtbl_getloc(tbl, pair, old_capacity, &occupied);
-	if (!occupied)  /* the location is originally avaliable */
-		tbl->__usage++;
-	tds_array_set(tbl->__pairs, loc, pair);
+	tds_hashtbl *tbl = NULL;
 
-	if(!__tds_hashtbl_try_expand(tbl)) {
-		printf("Error ... tds_hashtbl_set\n");
-		return 0;  /* failure */
+	if (NULL == (tbl = tds_hashtbl_create_h(pairsize, keysize, init_capacity, _fhash, alloc))) {
+		printf("Error ... tds_hashtbl_force_create_h\n");
+		exit(-1);
 	}
-	return 1;  /* success */
+	return tbl;
 }
 
-void tds_hashtbl_force_set(tds_hashtbl *tbl, const void *pair)
+tds_hashtbl *tds_hashtbl_force_create_m(size_t pairsize, size_t keysize, \
+	size_t init_capacity, tds_fhash_t *_fhash, int mode, const tds_allocator *alloc)
 {
-	if (!tds_hashtbl_set(tbl, pair)) {
-		printf("Error ... tds_hashtbl_force_set\n");
+	tds_hashtbl *tbl = NULL;
+
+	if (NULL == (tbl = tds_hashtbl_create_m(pairsize, keysize, init_capacity, _fhash, mode, alloc))) {
+		printf("Error ... tds_hashtbl_force_create_m\n");
 		exit(-1);
 	}
+	return tbl;
 }
 
-int tds_hashtbl_rm(tds_hashtbl *tbl, const void *key)
+tds_hashtbl *tds_hashtbl_force_create_s_g(size_t valsize, size_t init_capacity, \
+	int mode, const tds_allocator *alloc)
 {
-	size_t loc = 0;
+	tds_hashtbl *tbl = NULL;
 
-	if (!tds_hashtbl_contains(tbl, key, &loc))
-		return 0;
-	tds_bitarray_set(tbl->__mark_delete, loc, 1);
+	if (NULL == (tbl = tds_hashtbl_create_s_g(valsize, init_capacity, mode, alloc))) {
+		printf("Error ... tds_hashtbl_force_create_s_g\n");
+		exit(-1);
+	}
+	return tbl;
+}
+
+tds_hashtbl *tds_hashtbl_force_create_s(size_t valsize, size_t init_capacity, int mode)
+{
+	tds_hashtbl *tbl = NULL;
+
+	if (NULL == (tbl = tds_hashtbl_create_s(valsize, init_capacity, mode))) {
+		printf("Error ... tds_hashtbl_force_create_s\n");
+		exit(-1);
+	}
+	return tbl;
+}
+
+tds_hashtbl *tds_hashtbl_force_create(size_t pairsize, size_t keysize)
+{
+	return tds_hashtbl_force_create_g(pairsize, keysize, __thashtbl_init_capacity, NULL);
+}
+
+size_t tds_hashtbl_migrate(tds_hashtbl *tbl, size_t nslots)
+{
+	size_t old_capacity = 0;
+	size_t idx = 0;
+	uint8_t *tags = NULL;
+#ifdef tds_hashtbl_with_stats
+	clock_t start = 0;
+#endif
+	assert(NULL != tbl);
+
+	if (NULL == tbl->__old.__ctrl)
+		return 0;  /* not migrating */
+#ifdef tds_hashtbl_with_stats
+	start = clock();
+#endif
+	old_capacity = tds_array_capacity(tbl->__old.__ctrl);
+	tags = __ctrl_data(tbl->__old.__ctrl);
+
+	for (idx = 0; idx < nslots && tbl->__migrate_loc < old_capacity; idx++) {
+		size_t loc = tbl->__migrate_loc++;
+		const void *pair = NULL;
+		uint64_t code = 0;
+		if (tags[loc] & 0x80)  /* empty or deleted */
+			continue;
+		pair = tds_array_get(tbl->__old.__pairs, loc);
+		if (NULL != tbl->__old.__codes)  /* no need to rehash the key */
+			code = __codes_data(tbl->__old.__codes)[loc];
+		else
+			code = __tds_hashtbl_code(tbl, pair);
+		__slots_insert_new(tbl, &tbl->__slots, pair, code);
+		/* the stale copy must not be found after the pair is removed from
+		 * the new slots, a tombstone keeps the probing sequences */
+		tags[loc] = __thashtbl_ctrl_deleted;
+		tbl->__old_usage--;
+	}
+#ifdef tds_hashtbl_with_stats
+	if (NULL != tbl->__counters)
+		tbl->__counters->__resize_seconds += (double) (clock() - start) / CLOCKS_PER_SEC;
+#endif
+	if (tbl->__migrate_loc < old_capacity)
+		return old_capacity - tbl->__migrate_loc;
+	assert(0 == tbl->__old_usage);
+	__slots_free(&tbl->__old, tbl->__alloc);
+	tbl->__migrate_loc = 0;
+	return 0;
+}
+
+/* Replace the slots with empty ones of `new_capacity`, the live pairs are
+ * left in the old slots and migrated later by `tds_hashtbl_migrate`
+ */
+static int __tds_hashtbl_start_migration(tds_hashtbl *tbl, size_t new_capacity)
+{
+	struct tds_hashtbl_slots new_slots;
+
+	assert(NULL != tbl);
+	assert(NULL == tbl->__old.__ctrl);
+
+	if (!__slots_create(&new_slots, tds_array_elesize(tbl->__slots.__pairs), \
+		new_capacity, NULL != tbl->__slots.__codes, tbl->__alloc)) {
+		printf("Error .. __tds_hashtbl_start_migration\n");
+		return 0;
+	}
+	tbl->__nresizes++;
+	tbl->__old = tbl->__slots;
+	tbl->__old_usage = tbl->__usage;
+	tbl->__migrate_loc = 0;
+	tbl->__slots = new_slots;
+	tbl->__tombs = 0;
+	return 1;
+}
+
+/* Move all live pairs into new slots of `new_capacity`, tombstones are dropped
+ */
+static int __tds_hashtbl_rehash(tds_hashtbl *tbl, size_t new_capacity)
+{
+	assert(NULL != tbl);
+	assert(new_capacity > tbl->__usage);
+
+	tds_hashtbl_migrate(tbl, (size_t) -1);  /* finish the ongoing migration */
+	if (!__tds_hashtbl_start_migration(tbl, new_capacity)) {
+		printf("Error .. __tds_hashtbl_rehash\n");
+		return 0;
+	}
+	tds_hashtbl_migrate(tbl, (size_t) -1);
+	return 1;
+}
+
+/* Maximal load factor of the current slots
+ */
+static double __tds_hashtbl_threshold(const tds_hashtbl *tbl)
+{
+	if (tbl->__mode & tds_hashtbl_mode_robinhood)
+		return __thashtbl_rh_load_threshold;
+	return __thashtbl_load_threshold;
+}
+
+/* Tags that are not empty (live or deleted) count for the load. When the
+ * load reaches the threshold
+ * 	- if live pairs alone fill less than half of the threshold, the
+ * 	  tombstones are the problem: rehash in place at the same capacity
+ * 	- otherwise double the capacity
+ *
+ * In the incremental mode, the rehashing is only started here.
+ */
+int __tds_hashtbl_try_expand(tds_hashtbl *tbl)
+{
+	size_t capacity = 0;
+	size_t new_capacity = 0;
+	double threshold = 0;
+	assert(NULL != tbl);
+	capacity = tds_hashtbl_capacity(tbl);
+	threshold = __tds_hashtbl_threshold(tbl);
+
+	if ((double) (tbl->__usage - tbl->__old_usage + tbl->__tombs) \
+		< threshold * capacity)
+		return 1;  /* success, no need to resize */
+	/* the new slots are full before the migration ends, which only happens
+	 * with heavy deletions, finish it at once */
+	tds_hashtbl_migrate(tbl, (size_t) -1);
+
+	if ((double) tbl->__usage < threshold * capacity / 2)
+		new_capacity = capacity;
+	else
+		new_capacity = 2 * capacity;
+	if (tbl->__mode & tds_hashtbl_mode_incremental)
+		return __tds_hashtbl_start_migration(tbl, new_capacity);
+	return __tds_hashtbl_rehash(tbl, new_capacity);
+}
+
+/* Copy the live keys of `slots` into `arena` from `*len` and update their
+ * references
+ */
+static void __tds_hashtbl_repack_slots(struct tds_hashtbl_slots *slots, \
+	const char *old_arena, char *arena, size_t *len)
+{
+	const uint8_t *tags = NULL;
+	size_t idx = 0;
+
+	if (NULL == slots->__ctrl)
+		return;
+	tags = __ctrl_data(slots->__ctrl);
+	for (idx = 0; idx < tds_array_capacity(slots->__ctrl); idx++) {
+		struct __thashtbl_sref *sref = NULL;
+
+		if (tags[idx] & 0x80)  /* empty or deleted */
+			continue;
+		sref = (struct __thashtbl_sref *) tds_array_get(slots->__pairs, idx);
+		memcpy(arena + *len, old_arena + sref->__off, sref->__len);
+		sref->__off = *len;
+		*len += sref->__len;
+	}
+}
+
+/* Drop the removed keys from the arena, whose capacity becomes the smallest
+ * power of 2 holding the live keys and `nextra` more bytes
+ */
+static int __tds_hashtbl_repack_arena(tds_hashtbl *tbl, size_t nextra)
+{
+	size_t live = tbl->__arena_len - tbl->__arena_garbage;
+	size_t capacity = __thashtbl_arena_capacity;
+	size_t len = 0;
+	tds_array *arena = NULL;
+
+	while (capacity < live + nextra)
+		capacity *= 2;
+	if (NULL == (arena = tds_array_create_g(1, capacity, tbl->__alloc)))
+		return 0;
+	__tds_hashtbl_repack_slots(&tbl->__slots, (const char *) tds_array_data(tbl->__arena), \
+		(char *) tds_array_data(arena), &len);
+	__tds_hashtbl_repack_slots(&tbl->__old, (const char *) tds_array_data(tbl->__arena), \
+		(char *) tds_array_data(arena), &len);
+	assert(len == live);
+	tds_array_free_g(tbl->__arena, tbl->__alloc);
+	tbl->__arena = arena;
+	tbl->__arena_len = len;
+	tbl->__arena_garbage = 0;
+	return 1;
+}
+
+/* Copy `len` bytes of `key` at the end of the arena, the arena is repacked
+ * instead of expanded when removed keys take half of it
+ */
+static int __tds_hashtbl_arena_append(tds_hashtbl *tbl, const char *key, \
+	size_t len, struct __thashtbl_sref *sref)
+{
+	size_t capacity = tds_array_capacity(tbl->__arena);
+
+	if (tbl->__arena_len + len > capacity) {
+		if (2 * tbl->__arena_garbage >= tbl->__arena_len) {
+			if (!__tds_hashtbl_repack_arena(tbl, len))
+				return 0;
+		} else {
+			while (capacity < tbl->__arena_len + len)
+				capacity *= 2;
+			if (!tds_array_resize_g(&tbl->__arena, capacity, tbl->__alloc))
+				return 0;
+		}
+	}
+	if (0 != len)
+		memcpy((char *) tds_array_data(tbl->__arena) + tbl->__arena_len, key, len);
+	sref->__off = tbl->__arena_len;
+	sref->__len = len;
+	tbl->__arena_len += len;
 	return 1;
 }
+
+int tds_hashtbl_compact(tds_hashtbl *tbl)
+{
+	size_t capacity = __thashtbl_init_capacity;
+	assert(NULL != tbl);
+	if (NULL != tbl->__map) {  /* read-only */
+		printf("Error ... tds_hashtbl_compact\n");
+		return 0;
+	}
+
+	while ((double) tbl->__usage >= __tds_hashtbl_threshold(tbl) * capacity)
+		capacity *= 2;
+	if (!__tds_hashtbl_rehash(tbl, capacity))
+		return 0;
+	if (NULL != tbl->__arena)
+		return __tds_hashtbl_repack_arena(tbl, 0);
+	return 1;
+}
+
+static void __tds_hashtbl_unmap(tds_hashtbl *tbl);
+
+void tds_hashtbl_free(tds_hashtbl *tbl)
+{
+	assert(NULL != tbl);
+	if (NULL != tbl->__counters)
+		tds_allocator_free(tbl->__alloc, tbl->__counters, sizeof(struct __thashtbl_counters));
+	if (NULL != tbl->__swap)
+		tds_array_free_g(tbl->__swap, tbl->__alloc);
+	if (NULL != tbl->__map) {
+		__tds_hashtbl_unmap(tbl);
+		free(tbl);
+		return;
+	}
+	if (NULL != tbl->__old.__ctrl)
+		__slots_free(&tbl->__old, tbl->__alloc);
+	__slots_free(&tbl->__slots, tbl->__alloc);
+	if (NULL != tbl->__arena)
+		tds_array_free_g(tbl->__arena, tbl->__alloc);
+	tds_allocator_free(tbl->__alloc, tbl, sizeof(tds_hashtbl));
+}
+
+
+/******************************************************************************
+ * Part 5. Statistics
+ ******************************************************************************/
+
+size_t tds_hashtbl_usage(const tds_hashtbl *tbl)
+{
+	assert(NULL != tbl);
+	return tbl->__usage;
+}
+
+size_t tds_hashtbl_capacity(const tds_hashtbl *tbl)
+{
+	assert(NULL != tbl);
+	return tds_array_capacity(tbl->__slots.__pairs);
+}
+
+double tds_hashtbl_load_factor(const tds_hashtbl *tbl)
+{
+	assert(NULL != tbl);
+	return ((double) tds_hashtbl_usage(tbl)) / ((double) tds_hashtbl_capacity(tbl));
+}
+
+size_t tds_hashtbl_tombstones(const tds_hashtbl *tbl)
+{
+	assert(NULL != tbl);
+	return tbl->__tombs;
+}
+
+int tds_hashtbl_migrating(const tds_hashtbl *tbl)
+{
+	assert(NULL != tbl);
+	return NULL != tbl->__old.__ctrl;
+}
+
+double tds_hashtbl_migration_progress(const tds_hashtbl *tbl)
+{
+	assert(NULL != tbl);
+	if (NULL == tbl->__old.__ctrl)
+		return 1.0;
+	return ((double) tbl->__migrate_loc) / ((double) tds_array_capacity(tbl->__old.__ctrl));
+}
+
+uint64_t tds_hashtbl_seed(const tds_hashtbl *tbl)
+{
+	assert(NULL != tbl);
+	return tbl->__seed;
+}
+
+
+static size_t __slots_bytes(const struct tds_hashtbl_slots *slots)
+{
+	size_t bytes = 0;
+
+	if (NULL == slots->__ctrl)
+		return 0;
+	bytes += __array_image_size(slots->__ctrl) + __array_image_size(slots->__pairs);
+	if (NULL != slots->__codes)
+		bytes += __array_image_size(slots->__codes);
+	return bytes;
+}
+
+void tds_hashtbl_stats(const tds_hashtbl *tbl, struct tds_hashtbl_stats *stats)
+{
+	assert(NULL != tbl);
+	assert(NULL != stats);
+
+	memset(stats, 0, sizeof(struct tds_hashtbl_stats));
+	stats->usage = tbl->__usage;
+	stats->capacity = tds_hashtbl_capacity(tbl);
+	stats->tombstones = tbl->__tombs;
+	stats->nresizes = tbl->__nresizes;
+	stats->bytes = sizeof(tds_hashtbl) + __slots_bytes(&tbl->__slots) + __slots_bytes(&tbl->__old);
+	if (NULL != tbl->__arena)
+		stats->bytes += __array_image_size(tbl->__arena);
+	if (NULL != tbl->__swap)
+		stats->bytes += __array_image_size(tbl->__swap);
+	if (NULL != tbl->__map)
+		stats->bytes = sizeof(tds_hashtbl) + tbl->__map_len;
+	if (NULL != tbl->__counters) {
+		stats->bytes += sizeof(struct __thashtbl_counters);
+		stats->resize_seconds = tbl->__counters->__resize_seconds;
+		stats->nlookups = tbl->__counters->__nlookups;
+		stats->max_probe = tbl->__counters->__max_probe;
+		memcpy(stats->probe_hist, tbl->__counters->__hist, sizeof(stats->probe_hist));
+	}
+}
+
+void tds_hashtbl_reset_stats(tds_hashtbl *tbl)
+{
+	assert(NULL != tbl);
+	tbl->__nresizes = 0;
+	if (NULL != tbl->__counters)
+		memset(tbl->__counters, 0, sizeof(struct __thashtbl_counters));
+}
+
+
+/******************************************************************************
+ * Part 6. Search, Get, Set and Delete
+ ******************************************************************************/
+
+/* Return
+ * 	location `loc` that is either free or used
+ * 	state = 0 if loc is free
+ * 	state = 1 if loc is used
+ */
+size_t tds_hashtbl_getloc( \
+	const tds_hashtbl *tbl, const void *key, size_t _new_capacity, int *state)
+{
+	size_t loc = 0;
+	(void) _new_capacity;
+	assert(NULL != tbl);
+	assert(NULL == tbl->__arena);
+	assert(NULL != key);
+	assert(NULL != state);
+	assert(_new_capacity == tds_hashtbl_capacity(tbl));
+	*state = __slots_find(tbl, &tbl->__slots, key, __tds_hashtbl_code(tbl, key), &loc);
+	return loc;
+}
+
+/* Search the current slots, then the old slots being migrated
+ * Return the slots containing `key`, or `NULL` if not found
+ */
+static const struct tds_hashtbl_slots *__tds_hashtbl_find( \
+	const tds_hashtbl *tbl, const void *key, uint64_t code, size_t *loc)
+{
+	if (__slots_find(tbl, &tbl->__slots, key, code, loc))
+		return &tbl->__slots;
+	if (NULL != tbl->__old.__ctrl
+	 && __slots_find(tbl, &tbl->__old, key, code, loc))
+		return &tbl->__old;
+	return NULL;
+}
+
+int tds_hashtbl_contains(const tds_hashtbl *tbl, const void *key, size_t *loc)
+{
+	assert(NULL != tbl);
+	assert(NULL == tbl->__arena);
+	assert(NULL != key);
+	return NULL != __tds_hashtbl_find(tbl, key, __tds_hashtbl_code(tbl, key), loc);
+}
+
+void *tds_hashtbl_get(const tds_hashtbl *tbl, const void *key)
+{
+	size_t loc = 0;
+	const struct tds_hashtbl_slots *slots = NULL;
+	assert(NULL != tbl);
+	assert(NULL == tbl->__arena);
+	assert(NULL != key);
+
+	if (NULL == (slots = __tds_hashtbl_find(tbl, key, __tds_hashtbl_code(tbl, key), &loc)))
+		return NULL;  /* the key is not found */
+	return tds_array_get(slots->__pairs, loc);
+}
+
+/* Set a pair whose hash code is known
+ */
+static int __tds_hashtbl_set_code(tds_hashtbl *tbl, const void *pair, uint64_t code)
+{
+	size_t loc = 0;
+	tds_hashtbl_migrate(tbl, __thashtbl_migrate_step);
+
+	if (__slots_find(tbl, &tbl->__slots, pair, code, &loc))
+		tds_array_set(tbl->__slots.__pairs, loc, pair);
+	else {
+		size_t old_loc = 0;
+
+		if (NULL != tbl->__old.__ctrl
+		 && __slots_find(tbl, &tbl->__old, pair, code, &old_loc)) {
+			/* not migrated yet, update it in place */
+			tds_array_set(tbl->__old.__pairs, old_loc, pair);
+			return 1;
+		}
+		if (tbl->__mode & tds_hashtbl_mode_robinhood)
+			__slots_insert_new(tbl, &tbl->__slots, pair, code);
+		else {
+			/* the location is originally avaliable */
+			if (__thashtbl_ctrl_deleted == __ctrl_data(tbl->__slots.__ctrl)[loc])
+				tbl->__tombs--;  /* reuse a tombstone */
+			__slots_put(&tbl->__slots, loc, pair, code);
+		}
+		tbl->__usage++;
+	}
+	return __tds_hashtbl_try_expand(tbl);
+}
+
+int tds_hashtbl_set(tds_hashtbl *tbl, const void *pair)
+{
+	assert(NULL != tbl);
+	assert(NULL == tbl->__arena);
+	assert(NULL != pair);
+	if (NULL != tbl->__map) {  /* read-only */
+		printf("Error ... tds_hashtbl_set\n");
+		return 0;
+	}
+
+	if(!__tds_hashtbl_set_code(tbl, pair, __tds_hashtbl_code(tbl, pair))) {
+		printf("Error ... tds_hashtbl_set\n");
+		return 0;  /* failure */
+	}
+	return 1;  /* success */
+}
+
+void tds_hashtbl_force_set(tds_hashtbl *tbl, const void *pair)
+{
+	if (!tds_hashtbl_set(tbl, pair)) {
+		printf("Error ... tds_hashtbl_force_set\n");
+		exit(-1);
+	}
+}
+
+/* Keys are processed by blocks of `__thashtbl_batch`. All keys of a block are
+ * hashed and their home groups prefetched before any of them is resolved, so
+ * that the cache misses of independent keys overlap.
+ */
+void tds_hashtbl_get_batch(const tds_hashtbl *tbl, const void *keys, size_t n, void **out)
+{
+	uint64_t codes[__thashtbl_batch];
+	const char *key_p = (const char *) keys;
+	size_t start = 0;
+	size_t idx = 0;
+	assert(NULL != tbl);
+	assert(NULL == tbl->__arena);
+	assert(NULL != keys || 0 == n);
+	assert(NULL != out || 0 == n);
+
+	for (start = 0; start < n; start += __thashtbl_batch) {
+		size_t nb = n - start < __thashtbl_batch ? n - start : __thashtbl_batch;
+
+		for (idx = 0; idx < nb; idx++) {
+			codes[idx] = __tds_hashtbl_code(tbl, key_p + (start + idx) * tbl->__keysize);
+			__slots_prefetch(tbl, &tbl->__slots, codes[idx], 0);
+		}
+		for (idx = 0; idx < nb; idx++)
+			__slots_prefetch(tbl, &tbl->__slots, codes[idx], 1);
+		for (idx = 0; idx < nb; idx++) {
+			size_t loc = 0;
+			const struct tds_hashtbl_slots *slots = __tds_hashtbl_find(tbl, \
+				key_p + (start + idx) * tbl->__keysize, codes[idx], &loc);
+			out[start + idx] = NULL == slots ? NULL : tds_array_get(slots->__pairs, loc);
+		}
+	}
+}
+
+int tds_hashtbl_set_batch(tds_hashtbl *tbl, const void *pairs, size_t n)
+{
+	uint64_t codes[__thashtbl_batch];
+	const char *pair_p = (const char *) pairs;
+	size_t pairsize = 0;
+	size_t start = 0;
+	size_t idx = 0;
+	assert(NULL != tbl);
+	assert(NULL == tbl->__arena);
+	assert(NULL != pairs || 0 == n);
+	pairsize = tds_array_elesize(tbl->__slots.__pairs);
+	if (NULL != tbl->__map) {  /* read-only */
+		printf("Error ... tds_hashtbl_set_batch\n");
+		return 0;
+	}
+
+	for (start = 0; start < n; start += __thashtbl_batch) {
+		size_t nb = n - start < __thashtbl_batch ? n - start : __thashtbl_batch;
+
+		/* an expansion inside the block only makes some prefetches useless */
+		for (idx = 0; idx < nb; idx++) {
+			codes[idx] = __tds_hashtbl_code(tbl, pair_p + (start + idx) * pairsize);
+			__slots_prefetch(tbl, &tbl->__slots, codes[idx], 0);
+		}
+		for (idx = 0; idx < nb; idx++) {
+			if (!__tds_hashtbl_set_code(tbl, pair_p + (start + idx) * pairsize, codes[idx])) {
+				printf("Error ... tds_hashtbl_set_batch\n");
+				return 0;  /* failure */
+			}
+		}
+	}
+	return 1;  /* success */
+}
+
+void tds_hashtbl_force_set_batch(tds_hashtbl *tbl, const void *pairs, size_t n)
+{
+	if (!tds_hashtbl_set_batch(tbl, pairs, n)) {
+		printf("Error ... tds_hashtbl_force_set_batch\n");
+		exit(-1);
+	}
+}
+
+int tds_hashtbl_rm(tds_hashtbl *tbl, const void *key)
+{
+	size_t loc = 0;
+	uint64_t code = 0;
+	assert(NULL != tbl);
+	assert(NULL == tbl->__arena);
+	assert(NULL != key);
+	if (NULL != tbl->__map) {  /* read-only */
+		printf("Error ... tds_hashtbl_rm\n");
+		return 0;
+	}
+	tds_hashtbl_migrate(tbl, __thashtbl_migrate_step);
+	code = __tds_hashtbl_code(tbl, key);
+
+	if (__slots_find(tbl, &tbl->__slots, key, code, &loc))
+		tbl->__tombs += __slots_erase(tbl, &tbl->__slots, loc);
+	else if (NULL != tbl->__old.__ctrl
+	      && __slots_find(tbl, &tbl->__old, key, code, &loc)) {
+		__slots_erase(tbl, &tbl->__old, loc);
+		tbl->__old_usage--;
+	} else
+		return 0;
+	tbl->__usage--;
+	return 1;
+}
+
+
+/******************************************************************************
+ * Part 7. String-key mode
+ ******************************************************************************/
+
+static uint64_t __tds_hashtbl_scode(const tds_hashtbl *tbl, const struct __thashtbl_skey *skey)
+{
+	return tbl->__fhash(skey->__ptr, skey->__len, tbl->__seed);
+}
+
+void *tds_hashtbl_sget(const tds_hashtbl *tbl, const char *key, size_t len)
+{
+	struct __thashtbl_skey skey;
+	const struct tds_hashtbl_slots *slots = NULL;
+	size_t loc = 0;
+	assert(NULL != tbl);
+	assert(NULL != tbl->__arena);
+	assert(NULL != key || 0 == len);
+	skey.__ptr = key;
+	skey.__len = len;
+
+	if (NULL == (slots = __tds_hashtbl_find(tbl, &skey, __tds_hashtbl_scode(tbl, &skey), &loc)))
+		return NULL;  /* the key is not found */
+	return (char *) tds_array_get(slots->__pairs, loc) + sizeof(struct __thashtbl_sref);
+}
+
+void *tds_hashtbl_sget_tstr(const tds_hashtbl *tbl, const tds_string *key)
+{
+	assert(NULL != key);
+	return tds_hashtbl_sget(tbl, tds_string_cstr(key), tds_string_len(key));
+}
+
+int tds_hashtbl_scontains(const tds_hashtbl *tbl, const char *key, size_t len)
+{
+	return NULL != tds_hashtbl_sget(tbl, key, len);
+}
+
+int tds_hashtbl_sset(tds_hashtbl *tbl, const char *key, size_t len, const void *value)
+{
+	struct __thashtbl_skey skey;
+	struct __thashtbl_sref sref;
+	size_t valsize = 0;
+	size_t loc = 0;
+	uint64_t code = 0;
+	char *pair = NULL;
+	assert(NULL != tbl);
+	assert(NULL != tbl->__arena);
+	assert(NULL != key || 0 == len);
+	assert(NULL != value);
+	if (NULL != tbl->__map) {  /* read-only */
+		printf("Error ... tds_hashtbl_sset\n");
+		return 0;
+	}
+	tds_hashtbl_migrate(tbl, __thashtbl_migrate_step);
+	skey.__ptr = key;
+	skey.__len = len;
+	code = __tds_hashtbl_scode(tbl, &skey);
+	valsize = tds_array_elesize(tbl->__slots.__pairs) - sizeof(struct __thashtbl_sref);
+
+	if (__slots_find(tbl, &tbl->__slots, &skey, code, &loc)) {
+		pair = (char *) tds_array_get(tbl->__slots.__pairs, loc);
+		memcpy(pair + sizeof(struct __thashtbl_sref), value, valsize);
+		return 1;
+	}
+	if (NULL != tbl->__old.__ctrl) {
+		size_t old_loc = 0;
+
+		if (__slots_find(tbl, &tbl->__old, &skey, code, &old_loc)) {
+			pair = (char *) tds_array_get(tbl->__old.__pairs, old_loc);
+			memcpy(pair + sizeof(struct __thashtbl_sref), value, valsize);
+			return 1;
+		}
+	}
+	if (!__tds_hashtbl_arena_append(tbl, key, len, &sref)) {
+		printf("Error ... tds_hashtbl_sset\n");
+		return 0;
+	}
+	if (tbl->__mode & tds_hashtbl_mode_robinhood) {
+		/* the pair is built aside, then carried by the insertion */
+		pair = (char *) tds_array_get(tbl->__swap, 0);
+		memcpy(pair, &sref, sizeof(struct __thashtbl_sref));
+		memcpy(pair + sizeof(struct __thashtbl_sref), value, valsize);
+		__slots_insert_new(tbl, &tbl->__slots, pair, code);
+	} else {
+		if (__thashtbl_ctrl_deleted == __ctrl_data(tbl->__slots.__ctrl)[loc])
+			tbl->__tombs--;  /* reuse a tombstone */
+		pair = (char *) tds_array_get(tbl->__slots.__pairs, loc);
+		memcpy(pair, &sref, sizeof(struct __thashtbl_sref));
+		memcpy(pair + sizeof(struct __thashtbl_sref), value, valsize);
+		__slots_put(&tbl->__slots, loc, NULL, code);
+	}
+	tbl->__usage++;
+
+	if(!__tds_hashtbl_try_expand(tbl)) {
+		printf("Error ... tds_hashtbl_sset\n");
+		return 0;
+	}
+	return 1;
+}
+
+int tds_hashtbl_sset_tstr(tds_hashtbl *tbl, const tds_string *key, const void *value)
+{
+	assert(NULL != key);
+	return tds_hashtbl_sset(tbl, tds_string_cstr(key), tds_string_len(key), value);
+}
+
+void tds_hashtbl_force_sset(tds_hashtbl *tbl, const char *key, size_t len, const void *value)
+{
+	if (!tds_hashtbl_sset(tbl, key, len, value)) {
+		printf("Error ... tds_hashtbl_force_sset\n");
+		exit(-1);
+	}
+}
+
+int tds_hashtbl_srm(tds_hashtbl *tbl, const char *key, size_t len)
+{
+	struct __thashtbl_skey skey;
+	size_t loc = 0;
+	uint64_t code = 0;
+	assert(NULL != tbl);
+	assert(NULL != tbl->__arena);
+	assert(NULL != key || 0 == len);
+	if (NULL != tbl->__map) {  /* read-only */
+		printf("Error ... tds_hashtbl_srm\n");
+		return 0;
+	}
+	tds_hashtbl_migrate(tbl, __thashtbl_migrate_step);
+	skey.__ptr = key;
+	skey.__len = len;
+	code = __tds_hashtbl_scode(tbl, &skey);
+
+	if (__slots_find(tbl, &tbl->__slots, &skey, code, &loc))
+		tbl->__tombs += __slots_erase(tbl, &tbl->__slots, loc);
+	else if (NULL != tbl->__old.__ctrl
+	      && __slots_find(tbl, &tbl->__old, &skey, code, &loc)) {
+		__slots_erase(tbl, &tbl->__old, loc);
+		tbl->__old_usage--;
+	} else
+		return 0;
+	tbl->__arena_garbage += len;
+	tbl->__usage--;
+	return 1;
+}
+
+
+/******************************************************************************
+ * Part 8. Iteration
+ ******************************************************************************/
+
+void tds_hashtbl_iter_begin(const tds_hashtbl *tbl, tds_hashtbl_iter *iter)
+{
+	assert(NULL != tbl);
+	assert(NULL != iter);
+	iter->__group = 0;
+	iter->__mask = 0;
+	iter->__loc = 0;
+	iter->__old = 0;
+	iter->__start = 0;
+	iter->__usage = tbl->__usage;
+	if ((tbl->__mode & tds_hashtbl_mode_robinhood) && NULL != tbl->__slots.__ctrl) {
+		const uint8_t *tags = __ctrl_data(tbl->__slots.__ctrl);
+
+		while (0 == (tags[iter->__start] & 0x80))  /* the load factor keeps empty slots */
+			iter->__start++;
+	}
+}
+
+/* Robin Hood mode: the current slots are scanned one by one from an empty
+ * slot. Removing the pair just returned shifts the following pairs back by
+ * one slot, the shift stopping before an empty slot, so that it never
+ * crosses the start: only the slot just returned can receive a pair not
+ * returned yet, which is checked again when one pair less is left.
+ */
+static void *__rh_iter_next(const tds_hashtbl *tbl, tds_hashtbl_iter *iter)
+{
+	const uint8_t *tags = __ctrl_data(tbl->__slots.__ctrl);
+	size_t capacity = tds_array_capacity(tbl->__slots.__ctrl);
+	size_t loc = iter->__loc;
+
+	if (iter->__group > 0 && tbl->__usage + 1 == iter->__usage && 0 == (tags[loc] & 0x80)) {
+		iter->__usage = tbl->__usage;
+		return tds_array_get(tbl->__slots.__pairs, loc);
+	}
+	while (iter->__group < capacity) {
+		loc = (iter->__start + iter->__group++) & (capacity - 1);
+		if (0 == (tags[loc] & 0x80)) {
+			iter->__loc = loc;
+			iter->__usage = tbl->__usage;
+			return tds_array_get(tbl->__slots.__pairs, loc);
+		}
+	}
+	return NULL;
+}
+
+/* The current slots are scanned first, then the old slots if migrating.
+ * Whole groups of empty or deleted tags are skipped by one group match.
+ */
+void *tds_hashtbl_iter_next(const tds_hashtbl *tbl, tds_hashtbl_iter *iter)
+{
+	assert(NULL != tbl);
+	assert(NULL != iter);
+
+	for (;;) {
+		const struct tds_hashtbl_slots *slots = iter->__old ? &tbl->__old : &tbl->__slots;
+		const uint8_t *tags = NULL;
+		size_t ngroups = 0;
+
+		if (NULL == slots->__ctrl)
+			return NULL;  /* not migrating, no old slots */
+		if (!iter->__old && (tbl->__mode & tds_hashtbl_mode_robinhood)) {
+			char *pair = (char *) __rh_iter_next(tbl, iter);
+
+			if (NULL != pair)
+				return NULL != tbl->__arena ? pair + sizeof(struct __thashtbl_sref) : pair;
+			iter->__old = 1;
+			iter->__group = 0;
+			continue;
+		}
+		tags = __ctrl_data(slots->__ctrl);
+		ngroups = tds_array_capacity(slots->__ctrl) / __thashtbl_group_width;
+
+		while (0 == iter->__mask && iter->__group < ngroups)
+			iter->__mask = __group_match_full(tags + iter->__group++ * __thashtbl_group_width);
+		if (0 != iter->__mask) {
+			char *pair = NULL;
+
+			iter->__loc = (iter->__group - 1) * __thashtbl_group_width + __ctz(iter->__mask);
+			iter->__mask &= iter->__mask - 1;
+			pair = (char *) tds_array_get(slots->__pairs, iter->__loc);
+			if (NULL != tbl->__arena)
+				return pair + sizeof(struct __thashtbl_sref);
+			return pair;
+		}
+		if (iter->__old)
+			return NULL;  /* the end */
+		iter->__old = 1;
+		iter->__group = 0;
+	}
+}
+
+const char *tds_hashtbl_iter_key(const tds_hashtbl *tbl, const tds_hashtbl_iter *iter, size_t *len)
+{
+	const struct tds_hashtbl_slots *slots = NULL;
+	const char *pair = NULL;
+	const struct __thashtbl_sref *sref = NULL;
+	assert(NULL != tbl);
+	assert(NULL != iter);
+	slots = iter->__old ? &tbl->__old : &tbl->__slots;
+	pair = (const char *) tds_array_get(slots->__pairs, iter->__loc);
+
+	if (NULL == tbl->__arena) {
+		if (NULL != len)
+			*len = tbl->__keysize;
+		return pair;
+	}
+	sref = (const struct __thashtbl_sref *) pair;
+	if (NULL != len)
+		*len = sref->__len;
+	return (const char *) tds_array_data(tbl->__arena) + sref->__off;
+}
+
+int tds_hashtbl_export(const tds_hashtbl *tbl, tds_arraylist *list)
+{
+	tds_hashtbl_iter iter;
+	const void *pair = NULL;
+	assert(NULL != tbl);
+	assert(NULL == tbl->__arena);
+	assert(NULL != list);
+
+	if (!tds_arraylist_reserve(list, tds_arraylist_len(list) + tbl->__usage)) {
+		printf("Error ... tds_hashtbl_export\n");
+		return 0;
+	}
+	tds_hashtbl_iter_begin(tbl, &iter);
+	while (NULL != (pair = tds_hashtbl_iter_next(tbl, &iter)))
+		tds_arraylist_pushback(list, pair);  /* never fails after the reserve */
+	return 1;
+}
+
+
+/******************************************************************************
+ * Part 9. On-disk format
+ *
+ * The file is a header followed by the images of the arrays (their header
+ * and data, as in memory), each one aligned to 64 bytes. A mapped array
+ * image is used as a `tds_array` directly.
+ *
+ * The format is native: the byte order and the size of `size_t` must be the
+ * same for the writer and the reader.
+ ******************************************************************************/
+
+#define __thashtbl_file_magic    "tdshtbl"
+#define __thashtbl_file_version  1
+#define __thashtbl_file_align    64
+
+struct __thashtbl_file {
+	char __magic[8];
+	uint64_t __version;
+	uint64_t __size;       /* total bytes of the file */
+	uint64_t __keysize;
+	uint64_t __usage;
+	uint64_t __tombs;
+	uint64_t __seed;
+	uint64_t __mode;
+	uint64_t __arena_len;
+	uint64_t __arena_garbage;
+	uint64_t __ctrl_off;   /* offsets of the array images, 0 if absent */
+	uint64_t __pairs_off;
+	uint64_t __codes_off;
+	uint64_t __arena_off;
+};
+
+static size_t __file_align(size_t off)
+{
+	return (off + __thashtbl_file_align - 1) / __thashtbl_file_align * __thashtbl_file_align;
+}
+
+/* Lay out an optional array image at `*off`, return its offset or 0
+ */
+static uint64_t __file_place(const tds_array *arr, size_t *off)
+{
+	size_t at = 0;
+
+	if (NULL == arr)
+		return 0;
+	at = __file_align(*off);
+	*off = at + __array_image_size(arr);
+	return at;
+}
+
+static int __file_write_at(FILE *fp, size_t *pos, size_t off, const void *data, size_t len)
+{
+	static const char zeros[__thashtbl_file_align] = {0};
+
+	while (*pos < off) {  /* padding */
+		size_t n = off - *pos < sizeof(zeros) ? off - *pos : sizeof(zeros);
+		if (n != fwrite(zeros, 1, n, fp))
+			return 0;
+		*pos += n;
+	}
+	if (len != fwrite(data, 1, len, fp))
+		return 0;
+	*pos += len;
+	return 1;
+}
+
+int tds_hashtbl_save(tds_hashtbl *tbl, const char *path)
+{
+	struct __thashtbl_file head;
+	size_t off = sizeof(struct __thashtbl_file);
+	size_t pos = 0;
+	FILE *fp = NULL;
+	int ok = 1;
+	assert(NULL != tbl);
+	assert(NULL != path);
+	tds_hashtbl_migrate(tbl, (size_t) -1);  /* finish the ongoing migration */
+
+	memset(&head, 0, sizeof(head));
+	memcpy(head.__magic, __thashtbl_file_magic, sizeof(__thashtbl_file_magic));
+	head.__version = __thashtbl_file_version;
+	head.__keysize = tbl->__keysize;
+	head.__usage = tbl->__usage;
+	head.__tombs = tbl->__tombs;
+	head.__seed = tbl->__seed;
+	head.__mode = (uint64_t) tbl->__mode;
+	head.__arena_len = tbl->__arena_len;
+	head.__arena_garbage = tbl->__arena_garbage;
+	head.__ctrl_off = __file_place(tbl->__slots.__ctrl, &off);
+	head.__pairs_off = __file_place(tbl->__slots.__pairs, &off);
+	head.__codes_off = __file_place(tbl->__slots.__codes, &off);
+	head.__arena_off = __file_place(tbl->__arena, &off);
+	head.__size = off;
+
+	if (NULL == (fp = fopen(path, "wb"))) {
+		printf("Error ... tds_hashtbl_save\n");
+		return 0;
+	}
+	ok = ok && __file_write_at(fp, &pos, 0, &head, sizeof(head));
+	ok = ok && __file_write_at(fp, &pos, head.__ctrl_off, \
+		tbl->__slots.__ctrl, __array_image_size(tbl->__slots.__ctrl));
+	ok = ok && __file_write_at(fp, &pos, head.__pairs_off, \
+		tbl->__slots.__pairs, __array_image_size(tbl->__slots.__pairs));
+	if (NULL != tbl->__slots.__codes)
+		ok = ok && __file_write_at(fp, &pos, head.__codes_off, \
+			tbl->__slots.__codes, __array_image_size(tbl->__slots.__codes));
+	if (NULL != tbl->__arena)
+		ok = ok && __file_write_at(fp, &pos, head.__arena_off, \
+			tbl->__arena, __array_image_size(tbl->__arena));
+	if (0 != fclose(fp))
+		ok = 0;
+	if (!ok)
+		printf("Error ... tds_hashtbl_save\n");
+	return ok;
+}
+
+/* Map the whole file read-only, or read it into memory if `mmap` is not
+ * available
+ */
+static void *__file_map(const char *path, size_t *len)
+{
+#ifdef __thashtbl_mmap
+	struct stat st;
+	void *map = NULL;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return NULL;
+	if (0 != fstat(fd, &st) || st.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+	*len = (size_t) st.st_size;
+	map = mmap(NULL, *len, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	return MAP_FAILED == map ? NULL : map;
+#else
+	FILE *fp = fopen(path, "rb");
+	char *buf = NULL;
+	long size = 0;
+
+	if (NULL == fp)
+		return NULL;
+	if (0 != fseek(fp, 0, SEEK_END) || (size = ftell(fp)) <= 0
+	 || 0 != fseek(fp, 0, SEEK_SET) || NULL == (buf = (char *) malloc((size_t) size))) {
+		fclose(fp);
+		return NULL;
+	}
+	*len = (size_t) size;
+	if (*len != fread(buf, 1, *len, fp)) {
+		free(buf);
+		buf = NULL;
+	}
+	fclose(fp);
+	return buf;
+#endif
+}
+
+static void __tds_hashtbl_unmap(tds_hashtbl *tbl)
+{
+#ifdef __thashtbl_mmap
+	munmap(tbl->__map, tbl->__map_len);
+#else
+	free(tbl->__map);
+#endif
+	tbl->__map = NULL;
+}
+
+/* Return the array image at `off` if it fits in the file and has the
+ * expected element size and capacity, `NULL` otherwise
+ *
+ * The sizes read from the file are compared with what is left of it, never
+ * added or multiplied, so that no value of the file overflows the checks
+ */
+static tds_array *__file_array(void *map, size_t len, uint64_t off, size_t elesize, size_t capacity)
+{
+	tds_array *arr = NULL;
+	size_t header = 0;
+
+	if (0 == off || off % __thashtbl_file_align != 0 || off > len || 2 * sizeof(size_t) > len - off)
+		return NULL;
+	arr = (tds_array *) ((char *) map + off);
+	if (tds_array_elesize(arr) != elesize || (0 != capacity && tds_array_capacity(arr) != capacity))
+		return NULL;
+	header = (size_t) ((const char *) tds_array_data(arr) - (const char *) arr);
+	if (header > len - off)
+		return NULL;
+	if (0 != elesize && tds_array_capacity(arr) > (len - off - header) / elesize)
+		return NULL;
+	return arr;
+}
+
+/* Check the slots of a mapped table: the probing needs an empty slot to
+ * stop, the number of pairs must be the one of the header, and the key of
+ * each pair in the string-key mode must lie in the used part of the arena
+ */
+static int __file_check_slots(const tds_hashtbl *tbl)
+{
+	const uint8_t *tags = __ctrl_data(tbl->__slots.__ctrl);
+	size_t capacity = tds_array_capacity(tbl->__slots.__ctrl);
+	size_t nfull = 0;
+	int has_empty = 0;
+	size_t loc = 0;
+
+	for (loc = 0; loc < capacity; loc++) {
+		const struct __thashtbl_sref *sref = NULL;
+
+		if (__thashtbl_ctrl_empty == tags[loc])
+			has_empty = 1;
+		if (tags[loc] & 0x80)  /* empty or deleted */
+			continue;
+		nfull++;
+		if (NULL == tbl->__arena)
+			continue;
+		sref = (const struct __thashtbl_sref *) tds_array_get(tbl->__slots.__pairs, loc);
+		if (sref->__off > tbl->__arena_len || sref->__len > tbl->__arena_len - sref->__off)
+			return 0;
+	}
+	return has_empty && nfull == tbl->__usage;
+}
+
+tds_hashtbl *tds_hashtbl_open_mmap_h(const char *path, tds_fhash_t *_fhash)
+{
+	const struct __thashtbl_file *head = NULL;
+	tds_hashtbl *tbl = NULL;
+	void *map = NULL;
+	size_t len = 0;
+	size_t capacity = 0;
+	tds_array *pairs = NULL;
+	assert(NULL != path);
+	assert(NULL != _fhash);
+
+	if (NULL == (tbl = (tds_hashtbl *) calloc(1, sizeof(tds_hashtbl)))) {
+		printf("Error ... tds_hashtbl_open_mmap_h\n");
+		return NULL;
+	}
+	if (NULL == (map = __file_map(path, &len))) {
+		free(tbl);
+		printf("Error ... tds_hashtbl_open_mmap_h\n");
+		return NULL;
+	}
+	tbl->__map = map;
+	tbl->__map_len = len;
+	head = (const struct __thashtbl_file *) map;
+
+	if (len < sizeof(struct __thashtbl_file) || head->__size != len
+	 || 0 != memcmp(head->__magic, __thashtbl_file_magic, sizeof(__thashtbl_file_magic))
+	 || __thashtbl_file_version != head->__version)
+		goto invalid;
+	tbl->__slots.__ctrl = __file_array(map, len, head->__ctrl_off, 1, 0);
+	if (NULL == tbl->__slots.__ctrl)
+		goto invalid;
+	capacity = tds_array_capacity(tbl->__slots.__ctrl);
+	if (capacity < __thashtbl_group_width || 0 != (capacity & (capacity - 1)))
+		goto invalid;
+	if (head->__pairs_off % __thashtbl_file_align != 0 || head->__pairs_off > len \
+	 || 2 * sizeof(size_t) > len - head->__pairs_off)
+		goto invalid;
+	pairs = (tds_array *) ((char *) map + head->__pairs_off);
+	if (NULL == (tbl->__slots.__pairs = __file_array(map, len, \
+		head->__pairs_off, tds_array_elesize(pairs), capacity)))
+		goto invalid;
+	if (0 != head->__codes_off && NULL == (tbl->__slots.__codes = \
+		__file_array(map, len, head->__codes_off, sizeof(uint64_t), capacity)))
+		goto invalid;
+	if (0 != head->__arena_off) {
+		if (NULL == (tbl->__arena = __file_array(map, len, head->__arena_off, 1, 0))
+		 || head->__arena_len > tds_array_capacity(tbl->__arena)
+		 || NULL == tbl->__slots.__codes)
+			goto invalid;
+	}
+	tbl->__keysize = (size_t) head->__keysize;
+	tbl->__usage = (size_t) head->__usage;
+	tbl->__tombs = (size_t) head->__tombs;
+	tbl->__fhash = _fhash;
+	tbl->__seed = head->__seed;
+	tbl->__mode = (int) head->__mode;
+	tbl->__arena_len = (size_t) head->__arena_len;
+	tbl->__arena_garbage = (size_t) head->__arena_garbage;
+	if (tbl->__keysize > tds_array_elesize(tbl->__slots.__pairs) || tbl->__usage > capacity)
+		goto invalid;
+	if (NULL != tbl->__arena && tds_array_elesize(tbl->__slots.__pairs) < sizeof(struct __thashtbl_sref))
+		goto invalid;
+	if (!__file_check_slots(tbl))
+		goto invalid;
+#ifdef tds_hashtbl_with_stats
+	if (NULL == (tbl->__counters = (struct __thashtbl_counters *) \
+		calloc(1, sizeof(struct __thashtbl_counters))))
+		goto invalid;
+#endif
+	return tbl;
+
+invalid:
+	printf("Error ... tds_hashtbl_open_mmap_h\n");
+	tds_hashtbl_free(tbl);
+	return NULL;
+}
+
+tds_hashtbl *tds_hashtbl_open_mmap(const char *path)
+{
+	return tds_hashtbl_open_mmap_h(path, ta_hash_wy);
+}
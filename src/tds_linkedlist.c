@@ -3,6 +3,7 @@
  * License: MIT <https://opensource.org/licenses/MIT>
  */
 #include <tds/linkedlist.h>
+#include <tds/pool.h>
 
 #include <assert.h>
 #include <stdlib.h>
@@ -25,9 +26,11 @@ struct tds_linkedlist {
 	struct tds_linkedlist_node *__head;
 	struct tds_linkedlist_node *__tail;
 
-	/* buffer stack */
+	/* the nodes, and the buffer of the free ones */
 	size_t __buffer_limit;
-	struct tds_linkedlist_node *__buffer_head;  /* only pointer to next is valid */
+	tds_pool *__pool;
+
+	const tds_allocator *__alloc;
 };
 
 
@@ -38,11 +41,11 @@ struct tds_linkedlist {
 /* On success, return a linked list node whose pointer to `data` is valid
  * On failure, return `NULL` pointer
  */
-static struct tds_linkedlist_node *linkedlistnode_create(size_t elesize)
+static struct tds_linkedlist_node *linkedlistnode_create(tds_linkedlist *list)
 {
 	struct tds_linkedlist_node *node = NULL;
 
-	if (NULL == (node = malloc(elesize + tds_linkedlist_node_basic_size))) {
+	if (NULL == (node = (struct tds_linkedlist_node *) tds_pool_get(list->__pool))) {
 		printf("Error ... linkedlistnode_create\n");
 		return NULL;
 	}
@@ -54,56 +57,32 @@ static void *linkedlistnode_data(const struct tds_linkedlist_node *node)
 	return ((char *) node) + tds_linkedlist_node_basic_size;
 }
 
-
-/******************************************************************************
- * Part 2. Buffer related
- ******************************************************************************/
-
-/* If there is space, then store node to buffer
- * Otherwise, free the node
+/* The node goes to the free list of the pool, which keeps `buffer_limit` free
+ * nodes
  */
-static void store_linkedlistnode_to_buffer(struct tds_linkedlist_node *node, tds_linkedlist *list)
+static void linkedlistnode_free(tds_linkedlist *list, struct tds_linkedlist_node *node)
 {
-	if (tds_linkedlist_bufferlen(list) < list->__buffer_limit) {
-		node->__next = list->__buffer_head;  /* maintain the pointer to next, can be NULL */
-		list->__buffer_head = node;
-	} else
-		free(node);
-}
-
-/* First, checking the buffer stack.
- * If buffer stack is empty, try to create new node.
- * 	On failure, return `NULL` pointer.
- * If there is node in buffer, pop that node from buffer stack and return that node.
- */
-static struct tds_linkedlist_node *get_linkedlistnode_for_appending(tds_linkedlist *list)
-{
-	struct tds_linkedlist_node *node = NULL;
-
-	assert(NULL != list);
-
-	if (NULL == list->__buffer_head) {
-		if (NULL == (node = linkedlistnode_create(list->__elesize)))
-			printf("Error ... get_linkedlistnode_for_appending\n");
-	} else {
-		node = list->__buffer_head;
-		list->__buffer_head = node->__next;  /* pointer to next is valid */
-	}
-	return node;
+	tds_pool_put(list->__pool, node);
 }
 
 
 /******************************************************************************
- * Part 3. List creation & free
+ * Part 2. List creation & free
  ******************************************************************************/
 
-tds_linkedlist *tds_linkedlist_create_g(size_t elesize, size_t buffer_limit)
+tds_linkedlist *tds_linkedlist_create_g(size_t elesize, size_t buffer_limit, const tds_allocator *alloc)
 {
 	tds_linkedlist *list = NULL;
 
 	assert(elesize > 0);
 
-	if (NULL == (list = (tds_linkedlist *) malloc(sizeof(tds_linkedlist)))) {
+	if (NULL == (list = (tds_linkedlist *) tds_allocator_alloc(alloc, sizeof(tds_linkedlist)))) {
+		printf("Error ... tds_linkedlist_create_g\n");
+		return NULL;
+	}
+	if (NULL == (list->__pool = tds_pool_create_g(elesize + tds_linkedlist_node_basic_size, 0, \
+		buffer_limit, alloc))) {
+		tds_allocator_free(alloc, list, sizeof(tds_linkedlist));
 		printf("Error ... tds_linkedlist_create_g\n");
 		return NULL;
 	}
@@ -111,62 +90,59 @@ tds_linkedlist *tds_linkedlist_create_g(size_t elesize, size_t buffer_limit)
 	list->__tail = NULL;
 	list->__elesize = elesize;
 	list->__len = 0;
-	list->__buffer_head = NULL;
 	list->__buffer_limit = buffer_limit;
+	list->__alloc = alloc;
 	return list;
 }
 
 tds_linkedlist *tds_linkedlist_create(size_t elesize)
 {
-	return tds_linkedlist_create_g(elesize, tds_linkedlist_buffer_limit);
+	return tds_linkedlist_create_g(elesize, tds_linkedlist_buffer_limit, NULL);
 }
 
 void tds_linkedlist_prealloc(tds_linkedlist *list, size_t n)
 {
+	struct tds_linkedlist_node *nodes = NULL;  /* linked by `next` */
 	size_t idx = 0;
 	assert(n <= list->__buffer_limit);
 
 	for (idx = 0; idx < n; idx++) {
 		struct tds_linkedlist_node *node = NULL;
 
-		if (NULL == (node = linkedlistnode_create(list->__elesize))) {
+		if (NULL == (node = linkedlistnode_create(list))) {
 			printf("Error ... tds_linkedlist_prealloc\n");
 			break;
 		}
-		store_linkedlistnode_to_buffer(node, list);
+		node->__next = nodes;
+		nodes = node;
+	}
+	while (NULL != nodes) {
+		struct tds_linkedlist_node *node = nodes;
+		nodes = node->__next;
+		linkedlistnode_free(list, node);
 	}
 }
 
 void tds_linkedlist_free_buffer(tds_linkedlist *list)
 {
 	assert(NULL != list);
-
-	while (NULL != list->__buffer_head) {
-		struct tds_linkedlist_node *node = list->__buffer_head;
-		list->__buffer_head = node->__next;
-		free(node);  /* free the whole block */
-	}
+	tds_pool_trim(list->__pool);
 }
 
+/* The nodes are released with their slabs, not one by one
+ */
 void tds_linkedlist_free(tds_linkedlist *list)
 {
-	struct tds_linkedlist_node *node = NULL;
-
 	assert(NULL != list);
-	tds_linkedlist_free_buffer(list);
-	node = list->__head;
-
-	while (NULL != node) {
-		struct tds_linkedlist_node *tmp = node->__next;
-		free(node);
-		node = tmp;
-	}
-	free(list);
+	if (!tds_allocator_frees(list->__alloc))
+		return;  /* the nodes go with the allocator (an arena) */
+	tds_pool_free(list->__pool);
+	tds_allocator_free(list->__alloc, list, sizeof(tds_linkedlist));
 }
 
 
 /******************************************************************************
- * Part 4. Statistics
+ * Part 3. Statistics
  ******************************************************************************/
 
 size_t tds_linkedlist_len(const tds_linkedlist *list)
@@ -176,22 +152,13 @@ size_t tds_linkedlist_len(const tds_linkedlist *list)
 
 size_t tds_linkedlist_bufferlen(const tds_linkedlist *list)
 {
-	size_t len = 0;
-	struct tds_linkedlist_node *node = NULL;
-
 	assert(NULL != list);
-
-	node = list->__buffer_head;
-	while (NULL != node) {
-		node = node->__next;
-		len++;
-	}
-	return len;
+	return tds_pool_nfree(list->__pool);
 }
 
 
 /******************************************************************************
- * Part 5. Iteration
+ * Part 4. Iteration
  ******************************************************************************/
 
 tds_linkedlistiter *tds_linkedlistiter_head(const tds_linkedlist *list)
@@ -221,7 +188,7 @@ void *tds_linkedlistiter_data(const tds_linkedlistiter *iter)
 
 
 /******************************************************************************
- * Part 6. Change List
+ * Part 5. Change List
  ******************************************************************************/
 
 int tds_linkedlist_pushfront(tds_linkedlist *list, void *data)
@@ -231,7 +198,7 @@ int tds_linkedlist_pushfront(tds_linkedlist *list, void *data)
 	assert(NULL != list);
 	assert(NULL != data);
 
-	if (NULL == (node = get_linkedlistnode_for_appending(list))) {
+	if (NULL == (node = linkedlistnode_create(list))) {
 		printf("Error ... tds_linkedlist_pushfront\n");
 		return 0;  /* failure */
 	}
@@ -258,7 +225,7 @@ int tds_linkedlist_pushback(tds_linkedlist *list, void *data)
 	assert(NULL != list);
 	assert(NULL != data);
 
-	if (NULL == (node = get_linkedlistnode_for_appending(list))) {
+	if (NULL == (node = linkedlistnode_create(list))) {
 		printf("Error ... tds_linkedlist_pushback\n");
 		return 0;  /* failure */
 	}
@@ -295,7 +262,7 @@ void tds_linkedlist_popfront(tds_linkedlist *list)
 		list->__head = node->__next;  /* set the head pointer, cannot be NULL */
 		list->__head->__prev = NULL;
 	}
-	store_linkedlistnode_to_buffer(node, list);
+	linkedlistnode_free(list, node);
 }
 
 void tds_linkedlist_popback(tds_linkedlist *list)
@@ -315,7 +282,7 @@ void tds_linkedlist_popback(tds_linkedlist *list)
 		list->__tail = node->__prev;  /* set the last pointer, cannot be NULL */
 		list->__tail->__next = NULL;
 	}
-	store_linkedlistnode_to_buffer(node, list);
+	linkedlistnode_free(list, node);
 }
 
 int tds_linkedlist_insert(tds_linkedlist *list, void *data, size_t n)
@@ -340,7 +307,7 @@ int tds_linkedlist_insert(tds_linkedlist *list, void *data, size_t n)
 		node_post = node_post->__next;
 		idx++;
 	}
-	if (NULL == (node = get_linkedlistnode_for_appending(list))) {
+	if (NULL == (node = linkedlistnode_create(list))) {
 		printf("Error ... tds_linkedlist_insert\n");
 		return 0;  /* failure */
 	}
@@ -374,7 +341,7 @@ int tds_linkedlist_insert_before(tds_linkedlist *list, tds_linkedlistiter *iter,
 	assert(NULL != iter);
 	assert(NULL != data);
 
-	if (NULL == (node_new = linkedlistnode_create(list->__elesize))) {
+	if (NULL == (node_new = linkedlistnode_create(list))) {
 		printf("Error ... tds_linkedlist_insert_before\n");
 		return 0;  /* failure */
 	}
@@ -400,7 +367,7 @@ int tds_linkedlist_insert_after(tds_linkedlist *list, tds_linkedlistiter *iter,
 	assert(NULL != iter);
 	assert(NULL != data);
 
-	if (NULL == (node_new = linkedlistnode_create(list->__elesize))) {
+	if (NULL == (node_new = linkedlistnode_create(list))) {
 		printf("Error ... tds_linkedlist_insert_before\n");
 		return 0;  /* failure */
 	}
@@ -438,7 +405,7 @@ void tds_linkedlist_delete(tds_linkedlist *list, tds_linkedlistiter *iter)
 		iter->__next->__prev = iter->__prev;
 	if (NULL != iter->__prev)
 		iter->__prev->__next = iter->__next;
-	store_linkedlistnode_to_buffer(iter, list);
+	linkedlistnode_free(list, iter);
 }
 
 void tds_linkedlist_delete2(tds_linkedlist *list, size_t loc)
@@ -471,5 +438,5 @@ void tds_linkedlist_delete2(tds_linkedlist *list, size_t loc)
 		node->__next->__prev = node->__prev;
 	if (NULL != node->__prev)
 		node->__prev->__next = node->__next;
-	store_linkedlistnode_to_buffer(node, list);
+	linkedlistnode_free(list, node);
 }
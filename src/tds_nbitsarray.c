@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <tds/nbitsarray.h>
+#include <tds/bitarray.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(tds_no_simd) && defined(__AVX2__)
+#define __tnbitsarray_avx2
+#include <immintrin.h>
+#endif
+
+#define __tnbitsarray_init_capacity  16
+#define __tnbitsarray_avx2_max_nbits 25  /* a value and its shift fit 32 bits */
+
+/* The bit array holds one more word than the values, so that a value can
+ * always be read or written as two words
+ */
+struct tds_nbitsarray
+{
+	int __nbits;
+	uint64_t __mask;  /* the lowest `__nbits` bits */
+	size_t __len;
+	size_t __capacity;
+	tds_bitarray *__bits;
+	const tds_allocator *__alloc;
+};
+
+
+/******************************************************************************
+ * Part 1. Creation & Free
+ ******************************************************************************/
+
+static size_t __tds_nbitsarray_nbit(int nbits, size_t capacity)
+{
+	return capacity * (size_t) nbits + 64;
+}
+
+tds_nbitsarray *tds_nbitsarray_create_g(int nbits, size_t capacity, const tds_allocator *alloc)
+{
+	tds_nbitsarray *arr = NULL;
+	assert(1 <= nbits && nbits <= 32);
+
+	if (capacity < __tnbitsarray_init_capacity)
+		capacity = __tnbitsarray_init_capacity;
+	if (NULL == (arr = (tds_nbitsarray *) tds_allocator_alloc(alloc, sizeof(tds_nbitsarray)))) {
+		printf("Error ... tds_nbitsarray_create_g\n");
+		return NULL;
+	}
+	if (NULL == (arr->__bits = tds_bitarray_create_g(__tds_nbitsarray_nbit(nbits, capacity), alloc))) {
+		tds_allocator_free(alloc, arr, sizeof(tds_nbitsarray));
+		printf("Error ... tds_nbitsarray_create_g\n");
+		return NULL;
+	}
+	arr->__nbits = nbits;
+	arr->__mask = ((uint64_t) 1 << nbits) - 1;
+	arr->__len = 0;
+	arr->__alloc = alloc;
+	arr->__capacity = (tds_bitarray_capacity(arr->__bits) - 64) / (size_t) nbits;
+	return arr;
+}
+
+tds_nbitsarray *tds_nbitsarray_create(int nbits)
+{
+	return tds_nbitsarray_create_g(nbits, __tnbitsarray_init_capacity, NULL);
+}
+
+tds_nbitsarray *tds_nbitsarray_force_create_g(int nbits, size_t capacity, const tds_allocator *alloc)
+{
+	tds_nbitsarray *arr = tds_nbitsarray_create_g(nbits, capacity, alloc);
+
+	if (NULL == arr) {
+		printf("Error ... tds_nbitsarray_force_create_g\n");
+		exit(-1);
+	}
+	return arr;
+}
+
+tds_nbitsarray *tds_nbitsarray_force_create(int nbits)
+{
+	tds_nbitsarray *arr = tds_nbitsarray_create(nbits);
+
+	if (NULL == arr) {
+		printf("Error ... tds_nbitsarray_force_create\n");
+		exit(-1);
+	}
+	return arr;
+}
+
+void tds_nbitsarray_free(tds_nbitsarray *arr)
+{
+	assert(NULL != arr);
+	tds_bitarray_free(arr->__bits);
+	tds_allocator_free(arr->__alloc, arr, sizeof(tds_nbitsarray));
+}
+
+int tds_nbitsarray_nbits(const tds_nbitsarray *arr)
+{
+	assert(NULL != arr);
+	return arr->__nbits;
+}
+
+size_t tds_nbitsarray_len(const tds_nbitsarray *arr)
+{
+	assert(NULL != arr);
+	return arr->__len;
+}
+
+size_t tds_nbitsarray_capacity(const tds_nbitsarray *arr)
+{
+	assert(NULL != arr);
+	return arr->__capacity;
+}
+
+
+/******************************************************************************
+ * Part 2. Access
+ *
+ * The value at `loc` starts at the bit `s` of the word `w`. Its high part, if
+ * any, is the low bits of the word `w + 1`: shifting that word by `64 - s`
+ * is done as two shifts, so that `s` = 0 shifts it out instead of shifting
+ * by 64.
+ ******************************************************************************/
+
+static uint32_t __tds_nbitsarray_get(const tds_nbitsarray *arr, const uint64_t *words, size_t loc)
+{
+	size_t bit = loc * (size_t) arr->__nbits;
+	size_t w = bit / 64;
+	unsigned s = (unsigned) (bit % 64);
+
+	return (uint32_t) (((words[w] >> s) | ((words[w + 1] << 1) << (63 - s))) & arr->__mask);
+}
+
+static void __tds_nbitsarray_set(tds_nbitsarray *arr, uint64_t *words, size_t loc, uint32_t value)
+{
+	size_t bit = loc * (size_t) arr->__nbits;
+	size_t w = bit / 64;
+	unsigned s = (unsigned) (bit % 64);
+
+	words[w] = (words[w] & ~(arr->__mask << s)) | ((uint64_t) value << s);
+	words[w + 1] = (words[w + 1] & ~((arr->__mask >> 1) >> (63 - s))) | (((uint64_t) value >> 1) >> (63 - s));
+}
+
+uint32_t tds_nbitsarray_get(const tds_nbitsarray *arr, size_t loc)
+{
+	assert(NULL != arr);
+	assert(loc < arr->__len);
+	return __tds_nbitsarray_get(arr, (const uint64_t *) tds_bitarray_data(arr->__bits), loc);
+}
+
+void tds_nbitsarray_set(tds_nbitsarray *arr, size_t loc, uint32_t value)
+{
+	assert(NULL != arr);
+	assert(loc < arr->__len);
+	assert(value <= arr->__mask);
+	__tds_nbitsarray_set(arr, (uint64_t *) tds_bitarray_data(arr->__bits), loc, value);
+}
+
+int tds_nbitsarray_reserve(tds_nbitsarray *arr, size_t capacity)
+{
+	assert(NULL != arr);
+
+	if (capacity <= arr->__capacity)
+		return 1;
+	if (!tds_bitarray_resize(&arr->__bits, __tds_nbitsarray_nbit(arr->__nbits, capacity))) {
+		printf("Error ... tds_nbitsarray_reserve\n");
+		return 0;
+	}
+	arr->__capacity = (tds_bitarray_capacity(arr->__bits) - 64) / (size_t) arr->__nbits;
+	return 1;
+}
+
+int tds_nbitsarray_pushback(tds_nbitsarray *arr, uint32_t value)
+{
+	return tds_nbitsarray_append(arr, &value, 1);
+}
+
+int tds_nbitsarray_append(tds_nbitsarray *arr, const uint32_t *values, size_t n)
+{
+	uint64_t *words = NULL;
+	size_t idx = 0;
+	assert(NULL != arr);
+	assert(NULL != values || 0 == n);
+
+	if (!tds_nbitsarray_reserve(arr, arr->__len + n)) {
+		printf("Error ... tds_nbitsarray_append\n");
+		return 0;
+	}
+	words = (uint64_t *) tds_bitarray_data(arr->__bits);
+	for (idx = 0; idx < n; idx++) {
+		assert(values[idx] <= arr->__mask);
+		__tds_nbitsarray_set(arr, words, arr->__len + idx, values[idx]);
+	}
+	arr->__len += n;
+	return 1;
+}
+
+void tds_nbitsarray_force_pushback(tds_nbitsarray *arr, uint32_t value)
+{
+	if (!tds_nbitsarray_pushback(arr, value)) {
+		printf("Error ... tds_nbitsarray_force_pushback\n");
+		exit(-1);
+	}
+}
+
+void tds_nbitsarray_force_append(tds_nbitsarray *arr, const uint32_t *values, size_t n)
+{
+	if (!tds_nbitsarray_append(arr, values, n)) {
+		printf("Error ... tds_nbitsarray_force_append\n");
+		exit(-1);
+	}
+}
+
+void tds_nbitsarray_clear(tds_nbitsarray *arr)
+{
+	assert(NULL != arr);
+	arr->__len = 0;
+}
+
+
+/******************************************************************************
+ * Part 3. Decoding
+ *
+ * 8 consecutive values starting at a multiple of 8 take exactly `nbits`
+ * bytes, and start at a byte boundary. With AVX2, value `j` of such a group
+ * is read by a 32-bit gather at the byte `j * nbits / 8` of the group,
+ * shifted right by `j * nbits % 8` and masked.
+ ******************************************************************************/
+
+#if defined(__tnbitsarray_avx2)
+/* Decode the values [from, from + 8 * ngroup), `from` is a multiple of 8
+ */
+static void __tds_nbitsarray_decode_avx2(const tds_nbitsarray *arr, const uint64_t *words,
+	size_t from, size_t ngroup, uint32_t *out)
+{
+	const unsigned char *p = (const unsigned char *) words + from / 8 * (size_t) arr->__nbits;
+	int offsets[8];
+	int shifts[8];
+	__m256i voffsets, vshifts, vmask;
+	size_t g = 0;
+	int j = 0;
+
+	for (j = 0; j < 8; j++) {
+		offsets[j] = j * arr->__nbits / 8;
+		shifts[j] = j * arr->__nbits % 8;
+	}
+	voffsets = _mm256_loadu_si256((const __m256i *) offsets);
+	vshifts = _mm256_loadu_si256((const __m256i *) shifts);
+	vmask = _mm256_set1_epi32((int) arr->__mask);
+	for (g = 0; g < ngroup; g++) {
+		__m256i v = _mm256_i32gather_epi32((const int *) p, voffsets, 1);
+
+		v = _mm256_and_si256(_mm256_srlv_epi32(v, vshifts), vmask);
+		_mm256_storeu_si256((__m256i *) (out + 8 * g), v);
+		p += arr->__nbits;
+	}
+}
+#endif
+
+void tds_nbitsarray_decode(const tds_nbitsarray *arr, size_t from, size_t n, uint32_t *out)
+{
+	const uint64_t *words = NULL;
+	size_t idx = 0;
+	assert(NULL != arr);
+	assert(from + n <= arr->__len);
+	assert(NULL != out || 0 == n);
+
+	words = (const uint64_t *) tds_bitarray_data(arr->__bits);
+#if defined(__tnbitsarray_avx2)
+	if (arr->__nbits <= __tnbitsarray_avx2_max_nbits) {
+		size_t ngroup = 0;
+
+		for (; idx < n && 0 != (from + idx) % 8; idx++)  /* up to a group */
+			out[idx] = __tds_nbitsarray_get(arr, words, from + idx);
+		ngroup = (n - idx) / 8;
+		__tds_nbitsarray_decode_avx2(arr, words, from + idx, ngroup, out + idx);
+		idx += 8 * ngroup;
+	}
+#endif
+	for (; idx < n; idx++)
+		out[idx] = __tds_nbitsarray_get(arr, words, from + idx);
+}
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <tds/pool.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define __tpool_slab_bytes    4096  /* the size aimed at by the default `slab_len` */
+#define __tpool_slab_len_min  8
+#ifdef __cplusplus  /* built by the C++ benchmarks of `cmp` */
+#define __tpool_align         alignof(max_align_t)
+#else
+#define __tpool_align         _Alignof(max_align_t)
+#endif
+#define __tpool_round(size)   (((size) + __tpool_align - 1) & ~(__tpool_align - 1))
+#define __tpool_header        __tpool_round(sizeof(struct tds_pool_slab))
+
+struct tds_pool_slab {
+	struct tds_pool_slab *__next;
+	/* `slab_len` objects follow the header */
+};
+
+struct tds_pool {
+	void *__free;       /* the objects put back, linked by their first pointer */
+	size_t __nfree;
+	char *__bump;       /* the objects of the newest slab never taken */
+	size_t __nbump;
+	size_t __len;
+
+	struct tds_pool_slab *__slabs;
+	size_t __nslab;
+	size_t __objsize;   /* rounded up to the alignment */
+	size_t __slab_len;
+	size_t __keep;
+	size_t __trim_at;   /* `tds_pool_put` trims above this number of free objects */
+	const tds_allocator *__alloc;
+};
+
+
+/******************************************************************************
+ * Part 1. Slabs
+ ******************************************************************************/
+
+static size_t slab_size(const tds_pool *pool)
+{
+	return __tpool_header + pool->__objsize * pool->__slab_len;
+}
+
+static char *slab_data(const struct tds_pool_slab *slab)
+{
+	return ((char *) slab) + __tpool_header;
+}
+
+/* Return a bool indicating the success
+ */
+static int slab_create(tds_pool *pool)
+{
+	struct tds_pool_slab *slab = NULL;
+
+	if (NULL == (slab = (struct tds_pool_slab *) tds_allocator_alloc(pool->__alloc, slab_size(pool)))) {
+		printf("Error ... slab_create\n");
+		return 0;
+	}
+	slab->__next = pool->__slabs;
+	pool->__slabs = slab;
+	pool->__nslab++;
+	pool->__bump = slab_data(slab);
+	pool->__nbump = pool->__slab_len;
+	return 1;
+}
+
+static int slab_cmp(const void *a, const void *b)
+{
+	uintptr_t pa = (uintptr_t) *(struct tds_pool_slab * const *) a;
+	uintptr_t pb = (uintptr_t) *(struct tds_pool_slab * const *) b;
+
+	return (pa > pb) - (pa < pb);
+}
+
+/* The index of the slab holding `obj` in `slabs`, sorted by address
+ */
+static size_t slab_find(struct tds_pool_slab **slabs, size_t nslab, const void *obj)
+{
+	size_t lo = 0;
+	size_t hi = nslab;
+
+	while (hi - lo > 1) {  /* slabs[lo] <= obj < slabs[hi] */
+		size_t mid = lo + (hi - lo) / 2;
+
+		if ((uintptr_t) slabs[mid] <= (uintptr_t) obj)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Release the slabs whose objects are all free, as long as `keep` free
+ * objects are left
+ *
+ * The free objects are counted by slab, the slabs being sorted by address,
+ * and the free list is then rebuilt without the objects of the slabs
+ * released. Needs `nslab` pointers and counters of memory, nothing is
+ * released if they cannot be allocated.
+ */
+static size_t pool_trim(tds_pool *pool, size_t keep)
+{
+	struct tds_pool_slab **slabs = NULL;
+	struct tds_pool_slab *slab = NULL;
+	size_t *counts = NULL;
+	size_t nslab = pool->__nslab;
+	size_t tmp_size = nslab * (sizeof(struct tds_pool_slab *) + sizeof(size_t));
+	size_t nfree = pool->__nfree;
+	size_t nreleased = 0;
+	size_t ibump = (size_t) -1;
+	size_t idx = 0;
+	void **pos = NULL;
+
+	if (!tds_allocator_frees(pool->__alloc) || 0 == nslab)
+		return 0;
+	if (NULL == (slabs = (struct tds_pool_slab **) tds_allocator_alloc(pool->__alloc, tmp_size)))
+		return 0;
+	counts = (size_t *) (slabs + nslab);
+	for (slab = pool->__slabs, idx = 0; NULL != slab; slab = slab->__next, idx++) {
+		slabs[idx] = slab;
+		counts[idx] = 0;
+	}
+	qsort(slabs, nslab, sizeof(struct tds_pool_slab *), slab_cmp);
+	for (pos = (void **) pool->__free; NULL != pos; pos = (void **) *pos)
+		counts[slab_find(slabs, nslab, pos)]++;
+
+	if (pool->__nbump > 0)  /* the objects never taken are free too */
+		ibump = slab_find(slabs, nslab, pool->__bump);
+
+	/* `counts[idx]` is set to `(size_t) -1` for a slab to release */
+	for (idx = 0; idx < nslab; idx++) {
+		size_t nbump = idx == ibump ? pool->__nbump : 0;
+
+		if (counts[idx] + nbump == pool->__slab_len && nfree - counts[idx] >= keep) {
+			nfree -= counts[idx];
+			counts[idx] = (size_t) -1;
+			if (idx == ibump) {
+				pool->__bump = NULL;
+				pool->__nbump = 0;
+			}
+			nreleased++;
+		}
+	}
+	if (nreleased > 0) {
+		pos = &pool->__free;
+		while (NULL != *pos) {
+			if ((size_t) -1 == counts[slab_find(slabs, nslab, *pos)])
+				*pos = *(void **) *pos;  /* unlinked */
+			else
+				pos = (void **) *pos;
+		}
+		pool->__slabs = NULL;
+		for (idx = nslab; idx > 0; idx--) {  /* relinked by increasing address */
+			if ((size_t) -1 == counts[idx - 1])
+				tds_allocator_free(pool->__alloc, slabs[idx - 1], slab_size(pool));
+			else {
+				slabs[idx - 1]->__next = pool->__slabs;
+				pool->__slabs = slabs[idx - 1];
+			}
+		}
+		pool->__nfree = nfree;
+		pool->__nslab -= nreleased;
+	}
+	tds_allocator_free(pool->__alloc, slabs, tmp_size);
+	return nreleased;
+}
+
+
+/******************************************************************************
+ * Part 2. Creation & Free
+ ******************************************************************************/
+
+tds_pool *tds_pool_create_g(size_t objsize, size_t slab_len, size_t keep, const tds_allocator *alloc)
+{
+	tds_pool *pool = NULL;
+
+	assert(objsize > 0);
+	objsize = __tpool_round(objsize < sizeof(void *) ? sizeof(void *) : objsize);
+	if (0 == slab_len) {
+		slab_len = (__tpool_slab_bytes - __tpool_header) / objsize;
+		if (slab_len < __tpool_slab_len_min)
+			slab_len = __tpool_slab_len_min;
+	}
+	if (slab_len > ((size_t) -1 - __tpool_header) / objsize) {
+		printf("Error ... tds_pool_create_g\n");
+		return NULL;
+	}
+	if (NULL == (pool = (tds_pool *) tds_allocator_alloc(alloc, sizeof(tds_pool)))) {
+		printf("Error ... tds_pool_create_g\n");
+		return NULL;
+	}
+	pool->__free = NULL;
+	pool->__nfree = 0;
+	pool->__bump = NULL;
+	pool->__nbump = 0;
+	pool->__len = 0;
+	pool->__slabs = NULL;
+	pool->__nslab = 0;
+	pool->__objsize = objsize;
+	pool->__slab_len = slab_len;
+	pool->__keep = keep;
+	pool->__trim_at = keep;
+	pool->__alloc = alloc;
+	return pool;
+}
+
+tds_pool *tds_pool_create(size_t objsize)
+{
+	return tds_pool_create_g(objsize, 0, (size_t) -1, NULL);
+}
+
+tds_pool *tds_pool_force_create_g(size_t objsize, size_t slab_len, size_t keep, const tds_allocator *alloc)
+{
+	tds_pool *pool = tds_pool_create_g(objsize, slab_len, keep, alloc);
+
+	if (NULL == pool) {
+		printf("Error ... tds_pool_force_create_g\n");
+		exit(-1);
+	}
+	return pool;
+}
+
+tds_pool *tds_pool_force_create(size_t objsize)
+{
+	tds_pool *pool = tds_pool_create(objsize);
+
+	if (NULL == pool) {
+		printf("Error ... tds_pool_force_create\n");
+		exit(-1);
+	}
+	return pool;
+}
+
+void tds_pool_free(tds_pool *pool)
+{
+	assert(NULL != pool);
+
+	if (tds_allocator_frees(pool->__alloc)) {
+		while (NULL != pool->__slabs) {
+			struct tds_pool_slab *slab = pool->__slabs;
+			pool->__slabs = slab->__next;
+			tds_allocator_free(pool->__alloc, slab, slab_size(pool));
+		}
+	}
+	tds_allocator_free(pool->__alloc, pool, sizeof(tds_pool));
+}
+
+
+/******************************************************************************
+ * Part 3. Objects
+ ******************************************************************************/
+
+void *tds_pool_get(tds_pool *pool)
+{
+	void *obj = NULL;
+	assert(NULL != pool);
+
+	if (NULL != pool->__free) {
+		obj = pool->__free;
+		pool->__free = *(void **) obj;
+		pool->__nfree--;
+	} else {
+		if (0 == pool->__nbump && !slab_create(pool)) {
+			printf("Error ... tds_pool_get\n");
+			return NULL;
+		}
+		obj = pool->__bump;
+		pool->__bump += pool->__objsize;
+		pool->__nbump--;
+	}
+	pool->__len++;
+	return obj;
+}
+
+void tds_pool_put(tds_pool *pool, void *obj)
+{
+	assert(NULL != pool);
+	assert(NULL != obj);
+	assert(pool->__len > 0);
+
+	*(void **) obj = pool->__free;
+	pool->__free = obj;
+	pool->__nfree++;
+	pool->__len--;
+	if (pool->__nfree > pool->__trim_at) {
+		/* the next trim waits for the free objects to double, so that
+		 * the slabs in use are not scanned at every put */
+		pool_trim(pool, pool->__keep);
+		pool->__trim_at = pool->__nfree > (size_t) -1 / 2 ? (size_t) -1 : 2 * pool->__nfree;
+		if (pool->__trim_at < pool->__keep)
+			pool->__trim_at = pool->__keep;
+	}
+}
+
+size_t tds_pool_trim(tds_pool *pool)
+{
+	size_t nreleased = 0;
+	assert(NULL != pool);
+
+	nreleased = pool_trim(pool, 0);
+	pool->__trim_at = pool->__keep;
+	return nreleased;
+}
+
+size_t tds_pool_len(const tds_pool *pool)
+{
+	assert(NULL != pool);
+	return pool->__len;
+}
+
+size_t tds_pool_nfree(const tds_pool *pool)
+{
+	assert(NULL != pool);
+	return pool->__nfree;
+}
+
+size_t tds_pool_nslab(const tds_pool *pool)
+{
+	assert(NULL != pool);
+	return pool->__nslab;
+}
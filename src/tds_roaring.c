@@ -0,0 +1,1203 @@
+/*
+ * Copyright (C) 2024 Zhuang Linsheng <zhuanglinsheng@outlook.com>
+ * License: MIT <https://opensource.org/licenses/MIT>
+ */
+#include <tds.h>
+#include <tds/roaring.h>
+#include <tds/bitarray.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define __troaring_chunk_bits    65536
+#define __troaring_chunk_words   (__troaring_chunk_bits / 64)
+#define __troaring_array_max     4096  /* values of the largest array container */
+#define __troaring_init_capacity 4     /* containers, and values of a new array */
+
+/* Kinds of container
+ */
+#define __troaring_array   0
+#define __troaring_bitmap  1
+#define __troaring_run     2
+
+/* Set operations
+ */
+#define __troaring_op_and     0
+#define __troaring_op_or      1
+#define __troaring_op_xor     2
+#define __troaring_op_andnot  3
+
+/* Serialized form: the magic, the number of containers, the descriptors, then
+ * the containers
+ */
+#define __troaring_magic       "tdsroar1"
+#define __troaring_magic_size  8
+#define __troaring_desc_size   8
+
+/* A container of the values whose high 16 bits are `__key`
+ *
+ * 	- array:  `__data` holds `__n` >= `__card` sorted uint16_t
+ * 	- bitmap: `__data` is a `tds_bitarray` of 65536 bits
+ * 	- run:    `__data` holds `__n` pairs of uint16_t (start, length - 1),
+ * 	          sorted and neither overlapping nor adjacent
+ *
+ * A bitmap holds more than 4096 values, unless an allocation failed when it
+ * shrank. No container is empty.
+ */
+struct __troaring_cont {
+	uint16_t __key;
+	uint16_t __type;
+	uint32_t __card;
+	uint32_t __n;
+	void *__data;
+};
+
+struct tds_roaring {
+	size_t __ncont;
+	size_t __capacity;
+	struct __troaring_cont *__conts;  /* sorted by key */
+	const tds_allocator *__alloc;     /* of the containers too */
+};
+
+
+/******************************************************************************
+ * Part 1. Containers
+ ******************************************************************************/
+
+static void __cont_free(struct __troaring_cont *c, const tds_allocator *alloc)
+{
+	if (__troaring_bitmap == c->__type)
+		tds_bitarray_free((tds_bitarray *) c->__data);
+	else
+		tds_allocator_free(alloc, c->__data, (__troaring_array == c->__type ? 1 : 2) * c->__n * sizeof(uint16_t));
+	c->__data = NULL;
+}
+
+/* Index of the lowest set bit, `word` != 0
+ */
+static int __ctz64(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long idx;
+	_BitScanForward64(&idx, word);
+	return (int) idx;
+#else
+	int idx = 0;
+
+	while (0 == (word & 1)) {
+		word >>= 1;
+		idx++;
+	}
+	return idx;
+#endif
+}
+
+/* Location of the first value of `vals` not less than `low`
+ */
+static size_t __lower_bound(const uint16_t *vals, size_t n, uint16_t low)
+{
+	size_t lo = 0;
+	size_t hi = n;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (vals[mid] < low)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Index of the last run starting at or before `low`, or `nrun` if none does
+ */
+static size_t __run_find(const uint16_t *runs, size_t nrun, uint16_t low)
+{
+	size_t lo = 0;
+	size_t hi = nrun;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (runs[2 * mid] <= low)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return 0 == lo ? nrun : lo - 1;
+}
+
+static int __cont_contains(const struct __troaring_cont *c, uint16_t low)
+{
+	const uint16_t *vals = (const uint16_t *) c->__data;
+	size_t idx = 0;
+
+	switch (c->__type) {
+	case __troaring_array:
+		idx = __lower_bound(vals, c->__card, low);
+		return idx < c->__card && vals[idx] == low;
+	case __troaring_bitmap:
+		return tds_bitarray_get((const tds_bitarray *) c->__data, low);
+	default:
+		idx = __run_find(vals, c->__n, low);
+		return idx < c->__n && low - vals[2 * idx] <= vals[2 * idx + 1];
+	}
+}
+
+/* A new bitmap of the values of `c`, or NULL on failure
+ */
+static tds_bitarray *__cont_bitmap(const struct __troaring_cont *c, const tds_allocator *alloc)
+{
+	const uint16_t *vals = (const uint16_t *) c->__data;
+	tds_bitarray *bits = NULL;
+	size_t idx = 0;
+
+	if (NULL == (bits = tds_bitarray_create_g(__troaring_chunk_bits, alloc)))
+		return NULL;
+	switch (c->__type) {
+	case __troaring_array:
+		for (idx = 0; idx < c->__card; idx++)
+			tds_bitarray_set(bits, vals[idx], 1);
+		break;
+	case __troaring_bitmap:
+		memcpy(tds_bitarray_data(bits), tds_bitarray_data((const tds_bitarray *) c->__data),
+			__troaring_chunk_bits / 8);
+		break;
+	default:
+		for (idx = 0; idx < c->__n; idx++)
+			tds_bitarray_set_range(bits, vals[2 * idx], (size_t) vals[2 * idx] + vals[2 * idx + 1] + 1);
+		break;
+	}
+	return bits;
+}
+
+/* Make `c` hold the values of `bits`, as an array if they are few
+ *
+ * `c` takes `bits` over, its former data must have been released. If the
+ * array cannot be allocated, `c` stays a bitmap.
+ */
+static void __cont_from_bitmap(struct __troaring_cont *c, tds_bitarray *bits, const tds_allocator *alloc)
+{
+	const uint64_t *words = (const uint64_t *) tds_bitarray_data(bits);
+	size_t card = tds_bitarray_popcount(bits);
+	uint16_t *vals = NULL;
+	size_t idx = 0;
+	size_t w = 0;
+
+	c->__card = (uint32_t) card;
+	if (card <= __troaring_array_max
+	 && NULL != (vals = (uint16_t *) tds_allocator_alloc(alloc, tds_MAX(card, 1) * sizeof(uint16_t)))) {
+		for (w = 0; w < __troaring_chunk_words; w++) {
+			uint64_t word = words[w];
+
+			while (0 != word) {
+				vals[idx++] = (uint16_t) (64 * w + (size_t) __ctz64(word));
+				word &= word - 1;  /* clear the lowest set bit */
+			}
+		}
+		tds_bitarray_free(bits);
+		c->__type = __troaring_array;
+		c->__n = (uint32_t) tds_MAX(card, 1);
+		c->__data = vals;
+		return;
+	}
+	c->__type = __troaring_bitmap;
+	c->__n = 0;
+	c->__data = bits;
+}
+
+/* Return a bool indicating success
+ */
+static int __cont_copy(struct __troaring_cont *dst, const struct __troaring_cont *src, const tds_allocator *alloc)
+{
+	size_t nbytes = 0;
+
+	*dst = *src;
+	if (__troaring_bitmap == src->__type)
+		return NULL != (dst->__data = __cont_bitmap(src, alloc));
+	nbytes = (__troaring_array == src->__type ? 1 : 2) * src->__n * sizeof(uint16_t);
+	if (NULL == (dst->__data = tds_allocator_alloc(alloc, nbytes)))
+		return 0;
+	memcpy(dst->__data, src->__data, nbytes);
+	return 1;
+}
+
+/* Return a bool indicating success
+ */
+static int __cont_add(struct __troaring_cont *c, uint16_t low, const tds_allocator *alloc)
+{
+	uint16_t *vals = (uint16_t *) c->__data;
+	tds_bitarray *bits = NULL;
+	size_t idx = 0;
+
+	switch (c->__type) {
+	case __troaring_run:
+		if (__cont_contains(c, low))
+			return 1;
+		if (NULL == (bits = __cont_bitmap(c, alloc)))
+			return 0;
+		__cont_free(c, alloc);
+		__cont_from_bitmap(c, bits, alloc);
+		return __cont_add(c, low, alloc);
+	case __troaring_bitmap:
+		bits = (tds_bitarray *) c->__data;
+		if (!tds_bitarray_get(bits, low)) {
+			tds_bitarray_set(bits, low, 1);
+			c->__card++;
+		}
+		return 1;
+	default:
+		break;
+	}
+	idx = __lower_bound(vals, c->__card, low);
+	if (idx < c->__card && vals[idx] == low)
+		return 1;
+	if (__troaring_array_max == c->__card) {  /* becomes a bitmap */
+		if (NULL == (bits = __cont_bitmap(c, alloc)))
+			return 0;
+		__cont_free(c, alloc);
+		tds_bitarray_set(bits, low, 1);
+		c->__type = __troaring_bitmap;
+		c->__card++;
+		c->__n = 0;
+		c->__data = bits;
+		return 1;
+	}
+	if (c->__card == c->__n) {
+		size_t capacity = tds_MIN(2 * (size_t) c->__n, __troaring_array_max);
+
+		if (NULL == (vals = (uint16_t *) tds_allocator_realloc(alloc, vals, \
+			c->__n * sizeof(uint16_t), capacity * sizeof(uint16_t))))
+			return 0;
+		c->__data = vals;
+		c->__n = (uint32_t) capacity;
+	}
+	memmove(vals + idx + 1, vals + idx, (c->__card - idx) * sizeof(uint16_t));
+	vals[idx] = low;
+	c->__card++;
+	return 1;
+}
+
+/* `low` must be in `c`
+ * Return a bool indicating success
+ */
+static int __cont_remove(struct __troaring_cont *c, uint16_t low, const tds_allocator *alloc)
+{
+	uint16_t *vals = (uint16_t *) c->__data;
+	size_t idx = 0;
+	size_t start = 0;
+	size_t end = 0;
+
+	switch (c->__type) {
+	case __troaring_array:
+		idx = __lower_bound(vals, c->__card, low);
+		memmove(vals + idx, vals + idx + 1, (c->__card - idx - 1) * sizeof(uint16_t));
+		break;
+	case __troaring_bitmap:
+		tds_bitarray_set((tds_bitarray *) c->__data, low, 0);
+		if (__troaring_array_max == c->__card - 1)  /* becomes an array */
+			__cont_from_bitmap(c, (tds_bitarray *) c->__data, alloc);
+		else
+			c->__card--;
+		return 1;
+	default:
+		idx = __run_find(vals, c->__n, low);
+		start = vals[2 * idx];
+		end = start + vals[2 * idx + 1];
+		if (start == end && 1 == c->__n) {
+			break;  /* the container is erased with its only run */
+		} else if (start == end) {  /* into a smaller block, whose size the allocator is told */
+			uint16_t *runs = NULL;
+
+			if (NULL == (runs = (uint16_t *) tds_allocator_alloc(alloc, (c->__n - 1) * 2 * sizeof(uint16_t))))
+				return 0;
+			memcpy(runs, vals, idx * 2 * sizeof(uint16_t));
+			memcpy(runs + 2 * idx, vals + 2 * idx + 2, (c->__n - idx - 1) * 2 * sizeof(uint16_t));
+			__cont_free(c, alloc);
+			c->__data = runs;
+			c->__n--;
+		} else if (low == start) {
+			vals[2 * idx]++;
+			vals[2 * idx + 1]--;
+		} else if (low == end) {
+			vals[2 * idx + 1]--;
+		} else {  /* splits the run */
+			if (NULL == (vals = (uint16_t *) tds_allocator_realloc(alloc, vals, \
+				c->__n * 2 * sizeof(uint16_t), (c->__n + 1) * 2 * sizeof(uint16_t))))
+				return 0;
+			c->__data = vals;
+			memmove(vals + 2 * idx + 2, vals + 2 * idx, (c->__n - idx) * 2 * sizeof(uint16_t));
+			vals[2 * idx + 1] = (uint16_t) (low - start - 1);
+			vals[2 * idx + 2] = (uint16_t) (low + 1);
+			vals[2 * idx + 3] = (uint16_t) (end - low - 1);
+			c->__n++;
+		}
+		break;
+	}
+	c->__card--;
+	return 1;
+}
+
+/* Smallest value of `c` at or after `low`, or 65536
+ */
+static size_t __cont_next(const struct __troaring_cont *c, size_t low)
+{
+	const uint16_t *vals = (const uint16_t *) c->__data;
+	size_t idx = 0;
+
+	switch (c->__type) {
+	case __troaring_array:
+		idx = __lower_bound(vals, c->__card, (uint16_t) low);
+		return idx < c->__card ? vals[idx] : __troaring_chunk_bits;
+	case __troaring_bitmap:
+		return tds_bitarray_find_next_set((const tds_bitarray *) c->__data, low);
+	default:
+		idx = __run_find(vals, c->__n, (uint16_t) low);
+		if (idx < c->__n && low <= (size_t) vals[2 * idx] + vals[2 * idx + 1])
+			return low;
+		idx = idx < c->__n ? idx + 1 : 0;  /* the next run */
+		return idx < c->__n ? vals[2 * idx] : __troaring_chunk_bits;
+	}
+}
+
+/* Number of runs of consecutive values in `c`
+ */
+static size_t __cont_nrun(const struct __troaring_cont *c)
+{
+	const uint16_t *vals = (const uint16_t *) c->__data;
+	const uint64_t *words = NULL;
+	uint64_t prev = 0;
+	size_t nrun = 0;
+	size_t idx = 0;
+
+	switch (c->__type) {
+	case __troaring_array:
+		for (idx = 0; idx < c->__card; idx++)
+			nrun += 0 == idx || vals[idx] != vals[idx - 1] + 1;
+		return nrun;
+	case __troaring_bitmap:
+		/* a run starts at a bit set whose preceding bit is unset */
+		words = (const uint64_t *) tds_bitarray_data((const tds_bitarray *) c->__data);
+		for (idx = 0; idx < __troaring_chunk_words; idx++) {
+			uint64_t starts = words[idx] & ~((words[idx] << 1) | (prev >> 63));
+
+			while (0 != starts) {
+				starts &= starts - 1;
+				nrun++;
+			}
+			prev = words[idx];
+		}
+		return nrun;
+	default:
+		return c->__n;
+	}
+}
+
+/* Bytes of the data of `c`
+ */
+static size_t __cont_bytes(const struct __troaring_cont *c)
+{
+	switch (c->__type) {
+	case __troaring_array:
+		return c->__n * sizeof(uint16_t);
+	case __troaring_bitmap:
+		return __troaring_chunk_bits / 8 + sizeof(size_t);
+	default:
+		return 2 * c->__n * sizeof(uint16_t);
+	}
+}
+
+/* Convert `c` into runs
+ * Return a bool indicating success
+ */
+static int __cont_to_run(struct __troaring_cont *c, size_t nrun, const tds_allocator *alloc)
+{
+	uint16_t *runs = NULL;
+	tds_bitarray *bits = NULL;
+	size_t start = 0;
+	size_t end = 0;
+	size_t idx = 0;
+
+	if (NULL == (bits = __cont_bitmap(c, alloc)))
+		return 0;
+	if (NULL == (runs = (uint16_t *) tds_allocator_alloc(alloc, 2 * nrun * sizeof(uint16_t)))) {
+		tds_bitarray_free(bits);
+		return 0;
+	}
+	for (start = tds_bitarray_find_next_set(bits, 0); start < __troaring_chunk_bits;
+	     start = tds_bitarray_find_next_set(bits, end)) {
+		end = tds_bitarray_find_next_unset(bits, start);
+		runs[2 * idx] = (uint16_t) start;
+		runs[2 * idx + 1] = (uint16_t) (end - start - 1);
+		idx++;
+	}
+	tds_bitarray_free(bits);
+	__cont_free(c, alloc);
+	c->__type = __troaring_run;
+	c->__n = (uint32_t) nrun;
+	c->__data = runs;
+	return 1;
+}
+
+/* out = (array container `arr`) op (array container `other`)
+ */
+static int __cont_array_op(struct __troaring_cont *out, const struct __troaring_cont *arr,
+	const struct __troaring_cont *other, int op, const tds_allocator *alloc)
+{
+	const uint16_t *va = (const uint16_t *) arr->__data;
+	const uint16_t *vb = (const uint16_t *) other->__data;
+	size_t na = arr->__card;
+	size_t nb = other->__card;
+	size_t i = 0;
+	size_t j = 0;
+	size_t n = 0;
+	uint16_t *vals = NULL;
+
+	if (NULL == (vals = (uint16_t *) tds_allocator_alloc(alloc, tds_MAX(na + nb, 1) * sizeof(uint16_t))))
+		return 0;
+	while (i < na && j < nb) {
+		if (va[i] < vb[j]) {
+			if (__troaring_op_and != op)
+				vals[n++] = va[i];
+			i++;
+		} else if (va[i] > vb[j]) {
+			if (__troaring_op_or == op || __troaring_op_xor == op)
+				vals[n++] = vb[j];
+			j++;
+		} else {
+			if (__troaring_op_and == op || __troaring_op_or == op)
+				vals[n++] = va[i];
+			i++;
+			j++;
+		}
+	}
+	if (__troaring_op_and != op)
+		for (; i < na; i++)
+			vals[n++] = va[i];
+	if (__troaring_op_or == op || __troaring_op_xor == op)
+		for (; j < nb; j++)
+			vals[n++] = vb[j];
+	out->__type = __troaring_array;
+	out->__card = (uint32_t) n;
+	out->__n = (uint32_t) tds_MAX(na + nb, 1);
+	out->__data = vals;
+	return 1;
+}
+
+/* out = the values of the array container `arr` that are (`keep` = 1) or are
+ * not (`keep` = 0) in `other`
+ */
+static int __cont_array_filter(struct __troaring_cont *out, const struct __troaring_cont *arr,
+	const struct __troaring_cont *other, int keep, const tds_allocator *alloc)
+{
+	const uint16_t *va = (const uint16_t *) arr->__data;
+	uint16_t *vals = NULL;
+	size_t n = 0;
+	size_t idx = 0;
+
+	if (NULL == (vals = (uint16_t *) tds_allocator_alloc(alloc, tds_MAX(arr->__card, 1) * sizeof(uint16_t))))
+		return 0;
+	for (idx = 0; idx < arr->__card; idx++) {
+		if (keep == __cont_contains(other, va[idx]))
+			vals[n++] = va[idx];
+	}
+	out->__type = __troaring_array;
+	out->__card = (uint32_t) n;
+	out->__n = (uint32_t) tds_MAX(arr->__card, 1);
+	out->__data = vals;
+	return 1;
+}
+
+/* out = a op b, for containers of the same key, `out` may be empty
+ * Return a bool indicating success
+ *
+ * Arrays are merged or filtered, otherwise the operation runs on bitmaps.
+ */
+static int __cont_op(struct __troaring_cont *out, const struct __troaring_cont *a,
+	const struct __troaring_cont *b, int op, const tds_allocator *alloc)
+{
+	const uint16_t *vb = (const uint16_t *) b->__data;
+	const tds_bitarray *other = (const tds_bitarray *) b->__data;  /* `b` as a bitmap */
+	tds_bitarray *bits = NULL;
+	tds_bitarray *bits_b = NULL;  /* `b` decoded into a bitmap */
+	size_t idx = 0;
+
+	out->__key = a->__key;
+	if (__troaring_array == a->__type && __troaring_array == b->__type
+	 && (__troaring_op_and == op || __troaring_op_andnot == op
+	  || a->__card + b->__card <= __troaring_array_max))
+		return __cont_array_op(out, a, b, op, alloc);
+	if (__troaring_array == a->__type && (__troaring_op_and == op || __troaring_op_andnot == op))
+		return __cont_array_filter(out, a, b, __troaring_op_and == op, alloc);
+	if (__troaring_array == b->__type && __troaring_op_and == op)
+		return __cont_array_filter(out, b, a, 1, alloc);
+
+	if (__troaring_bitmap == a->__type && __troaring_bitmap == b->__type && __troaring_op_andnot != op) {
+		/* one pass over both bitmaps into a new one */
+		switch (op) {
+		case __troaring_op_and: bits = tds_bitarray_and((const tds_bitarray *) a->__data, other); break;
+		case __troaring_op_or:  bits = tds_bitarray_or((const tds_bitarray *) a->__data, other); break;
+		default:                bits = tds_bitarray_xor((const tds_bitarray *) a->__data, other); break;
+		}
+		if (NULL == bits)
+			return 0;
+		__cont_from_bitmap(out, bits, alloc);
+		return 1;
+	}
+	if (NULL == (bits = __cont_bitmap(a, alloc)))
+		return 0;
+	if (__troaring_array == b->__type) {
+		for (idx = 0; idx < b->__card; idx++) {
+			switch (op) {
+			case __troaring_op_or:  tds_bitarray_set(bits, vb[idx], 1); break;
+			case __troaring_op_xor: tds_bitarray_set(bits, vb[idx], !tds_bitarray_get(bits, vb[idx])); break;
+			default:                tds_bitarray_set(bits, vb[idx], 0); break;  /* andnot */
+			}
+		}
+	} else {
+		if (__troaring_bitmap != b->__type || __troaring_op_andnot == op) {
+			if (NULL == (bits_b = __cont_bitmap(b, alloc))) {
+				tds_bitarray_free(bits);
+				return 0;
+			}
+			other = bits_b;
+		}
+		if (__troaring_op_andnot == op)
+			tds_bitarray_not_inplace(bits_b);
+		switch (op) {
+		case __troaring_op_or:  tds_bitarray_or_inplace(bits, other); break;
+		case __troaring_op_xor: tds_bitarray_xor_inplace(bits, other); break;
+		default:                tds_bitarray_and_inplace(bits, other); break;  /* and, andnot */
+		}
+		if (NULL != bits_b)
+			tds_bitarray_free(bits_b);
+	}
+	__cont_from_bitmap(out, bits, alloc);
+	return 1;
+}
+
+
+/******************************************************************************
+ * Part 2. Creation & Free
+ ******************************************************************************/
+
+tds_roaring *tds_roaring_create_g(const tds_allocator *alloc)
+{
+	tds_roaring *r = NULL;
+
+	if (NULL == (r = (tds_roaring *) tds_allocator_alloc(alloc, sizeof(tds_roaring)))) {
+		printf("Error ... tds_roaring_create_g\n");
+		return NULL;
+	}
+	r->__conts = (struct __troaring_cont *) tds_allocator_alloc(alloc,
+		__troaring_init_capacity * sizeof(struct __troaring_cont));
+	if (NULL == r->__conts) {
+		tds_allocator_free(alloc, r, sizeof(tds_roaring));
+		printf("Error ... tds_roaring_create_g\n");
+		return NULL;
+	}
+	r->__ncont = 0;
+	r->__capacity = __troaring_init_capacity;
+	r->__alloc = alloc;
+	return r;
+}
+
+tds_roaring *tds_roaring_create(void)
+{
+	return tds_roaring_create_g(NULL);
+}
+
+tds_roaring *tds_roaring_force_create_g(const tds_allocator *alloc)
+{
+	tds_roaring *r = tds_roaring_create_g(alloc);
+
+	if (NULL == r) {
+		printf("Error ... tds_roaring_force_create_g\n");
+		exit(-1);
+	}
+	return r;
+}
+
+tds_roaring *tds_roaring_force_create(void)
+{
+	tds_roaring *r = tds_roaring_create();
+
+	if (NULL == r) {
+		printf("Error ... tds_roaring_force_create\n");
+		exit(-1);
+	}
+	return r;
+}
+
+void tds_roaring_free(tds_roaring *r)
+{
+	size_t idx = 0;
+	assert(NULL != r);
+
+	for (idx = 0; idx < r->__ncont; idx++)
+		__cont_free(r->__conts + idx, r->__alloc);
+	tds_allocator_free(r->__alloc, r->__conts, r->__capacity * sizeof(struct __troaring_cont));
+	tds_allocator_free(r->__alloc, r, sizeof(tds_roaring));
+}
+
+uint64_t tds_roaring_cardinality(const tds_roaring *r)
+{
+	uint64_t card = 0;
+	size_t idx = 0;
+	assert(NULL != r);
+
+	for (idx = 0; idx < r->__ncont; idx++)
+		card += r->__conts[idx].__card;
+	return card;
+}
+
+size_t tds_roaring_bytes(const tds_roaring *r)
+{
+	size_t nbytes = 0;
+	size_t idx = 0;
+	assert(NULL != r);
+
+	nbytes = sizeof(tds_roaring) + r->__capacity * sizeof(struct __troaring_cont);
+	for (idx = 0; idx < r->__ncont; idx++)
+		nbytes += __cont_bytes(r->__conts + idx);
+	return nbytes;
+}
+
+
+/******************************************************************************
+ * Part 3. Values
+ ******************************************************************************/
+
+/* Location of the first container whose key is not less than `key`
+ */
+static size_t __tds_roaring_locate(const tds_roaring *r, uint16_t key)
+{
+	size_t lo = 0;
+	size_t hi = r->__ncont;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (r->__conts[mid].__key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Insert the container `c` at the location `loc`
+ * Return a bool indicating success
+ */
+static int __tds_roaring_insert(tds_roaring *r, size_t loc, const struct __troaring_cont *c)
+{
+	if (r->__ncont == r->__capacity) {
+		size_t nbytes = r->__capacity * sizeof(struct __troaring_cont);
+		struct __troaring_cont *conts = (struct __troaring_cont *) tds_allocator_realloc(r->__alloc,
+			r->__conts, nbytes, 2 * nbytes);
+
+		if (NULL == conts)
+			return 0;
+		r->__conts = conts;
+		r->__capacity *= 2;
+	}
+	memmove(r->__conts + loc + 1, r->__conts + loc, (r->__ncont - loc) * sizeof(struct __troaring_cont));
+	r->__conts[loc] = *c;
+	r->__ncont++;
+	return 1;
+}
+
+static void __tds_roaring_erase(tds_roaring *r, size_t loc)
+{
+	__cont_free(r->__conts + loc, r->__alloc);
+	memmove(r->__conts + loc, r->__conts + loc + 1, (r->__ncont - loc - 1) * sizeof(struct __troaring_cont));
+	r->__ncont--;
+}
+
+int tds_roaring_contains(const tds_roaring *r, uint32_t value)
+{
+	uint16_t key = (uint16_t) (value >> 16);
+	size_t loc = 0;
+	assert(NULL != r);
+
+	loc = __tds_roaring_locate(r, key);
+	return loc < r->__ncont && key == r->__conts[loc].__key
+		&& __cont_contains(r->__conts + loc, (uint16_t) value);
+}
+
+int tds_roaring_add(tds_roaring *r, uint32_t value)
+{
+	struct __troaring_cont c;
+	uint16_t key = (uint16_t) (value >> 16);
+	size_t loc = 0;
+	assert(NULL != r);
+
+	loc = __tds_roaring_locate(r, key);
+	if (loc < r->__ncont && key == r->__conts[loc].__key) {
+		if (!__cont_add(r->__conts + loc, (uint16_t) value, r->__alloc)) {
+			printf("Error ... tds_roaring_add\n");
+			return 0;
+		}
+		return 1;
+	}
+	c.__key = key;
+	c.__type = __troaring_array;
+	c.__card = 1;
+	c.__n = __troaring_init_capacity;
+	if (NULL == (c.__data = tds_allocator_alloc(r->__alloc, __troaring_init_capacity * sizeof(uint16_t)))) {
+		printf("Error ... tds_roaring_add\n");
+		return 0;
+	}
+	((uint16_t *) c.__data)[0] = (uint16_t) value;
+	if (!__tds_roaring_insert(r, loc, &c)) {
+		__cont_free(&c, r->__alloc);
+		printf("Error ... tds_roaring_add\n");
+		return 0;
+	}
+	return 1;
+}
+
+void tds_roaring_force_add(tds_roaring *r, uint32_t value)
+{
+	if (!tds_roaring_add(r, value)) {
+		printf("Error ... tds_roaring_force_add\n");
+		exit(-1);
+	}
+}
+
+int tds_roaring_remove(tds_roaring *r, uint32_t value)
+{
+	uint16_t key = (uint16_t) (value >> 16);
+	size_t loc = 0;
+	assert(NULL != r);
+
+	loc = __tds_roaring_locate(r, key);
+	if (loc == r->__ncont || key != r->__conts[loc].__key
+	 || !__cont_contains(r->__conts + loc, (uint16_t) value))
+		return 1;  /* absent */
+	if (!__cont_remove(r->__conts + loc, (uint16_t) value, r->__alloc)) {
+		printf("Error ... tds_roaring_remove\n");
+		return 0;
+	}
+	if (0 == r->__conts[loc].__card)
+		__tds_roaring_erase(r, loc);
+	return 1;
+}
+
+void tds_roaring_force_remove(tds_roaring *r, uint32_t value)
+{
+	if (!tds_roaring_remove(r, value)) {
+		printf("Error ... tds_roaring_force_remove\n");
+		exit(-1);
+	}
+}
+
+/* The bytes of each kind are compared as serialized
+ */
+int tds_roaring_optimize(tds_roaring *r)
+{
+	size_t idx = 0;
+	assert(NULL != r);
+
+	for (idx = 0; idx < r->__ncont; idx++) {
+		struct __troaring_cont *c = r->__conts + idx;
+		size_t nrun = __cont_nrun(c);
+		size_t run_bytes = 4 * nrun;
+		size_t dense_bytes = c->__card <= __troaring_array_max ? 2 * (size_t) c->__card : __troaring_chunk_bits / 8;
+		tds_bitarray *bits = NULL;
+
+		if (run_bytes < dense_bytes) {
+			if (__troaring_run != c->__type && !__cont_to_run(c, nrun, r->__alloc)) {
+				printf("Error ... tds_roaring_optimize\n");
+				return 0;
+			}
+		} else if (__troaring_run == c->__type
+		        || (__troaring_bitmap == c->__type && c->__card <= __troaring_array_max)) {
+			if (NULL == (bits = __cont_bitmap(c, r->__alloc))) {
+				printf("Error ... tds_roaring_optimize\n");
+				return 0;
+			}
+			__cont_free(c, r->__alloc);
+			__cont_from_bitmap(c, bits, r->__alloc);
+		}
+	}
+	return 1;
+}
+
+
+/******************************************************************************
+ * Part 4. Set operations
+ ******************************************************************************/
+
+/* Containers are matched by key, the unmatched ones are copied if the
+ * operation keeps them
+ */
+static tds_roaring *__tds_roaring_op(const tds_roaring *r1, const tds_roaring *r2, int op)
+{
+	struct __troaring_cont out;
+	tds_roaring *r = NULL;
+	size_t i = 0;
+	size_t j = 0;
+	int success = 1;
+	assert(NULL != r1);
+	assert(NULL != r2);
+
+	if (NULL == (r = tds_roaring_create_g(r1->__alloc)))
+		return NULL;
+	while (success && (i < r1->__ncont || j < r2->__ncont)) {
+		const struct __troaring_cont *c1 = i < r1->__ncont ? r1->__conts + i : NULL;
+		const struct __troaring_cont *c2 = j < r2->__ncont ? r2->__conts + j : NULL;
+
+		out.__data = NULL;
+		if (NULL != c1 && (NULL == c2 || c1->__key < c2->__key)) {
+			i++;
+			if (__troaring_op_and == op)
+				continue;
+			success = __cont_copy(&out, c1, r->__alloc);
+		} else if (NULL == c1 || c2->__key < c1->__key) {
+			j++;
+			if (__troaring_op_and == op || __troaring_op_andnot == op)
+				continue;
+			success = __cont_copy(&out, c2, r->__alloc);
+		} else {
+			i++;
+			j++;
+			success = __cont_op(&out, c1, c2, op, r->__alloc);
+		}
+		if (success && 0 == out.__card) {
+			__cont_free(&out, r->__alloc);
+			continue;
+		}
+		if (success && !(success = __tds_roaring_insert(r, r->__ncont, &out)))
+			__cont_free(&out, r->__alloc);
+	}
+	if (!success) {
+		tds_roaring_free(r);
+		return NULL;
+	}
+	return r;
+}
+
+tds_roaring *tds_roaring_and(const tds_roaring *r1, const tds_roaring *r2)
+{
+	tds_roaring *r = __tds_roaring_op(r1, r2, __troaring_op_and);
+
+	if (NULL == r)
+		printf("Error ... tds_roaring_and\n");
+	return r;
+}
+
+tds_roaring *tds_roaring_or(const tds_roaring *r1, const tds_roaring *r2)
+{
+	tds_roaring *r = __tds_roaring_op(r1, r2, __troaring_op_or);
+
+	if (NULL == r)
+		printf("Error ... tds_roaring_or\n");
+	return r;
+}
+
+tds_roaring *tds_roaring_xor(const tds_roaring *r1, const tds_roaring *r2)
+{
+	tds_roaring *r = __tds_roaring_op(r1, r2, __troaring_op_xor);
+
+	if (NULL == r)
+		printf("Error ... tds_roaring_xor\n");
+	return r;
+}
+
+tds_roaring *tds_roaring_andnot(const tds_roaring *r1, const tds_roaring *r2)
+{
+	tds_roaring *r = __tds_roaring_op(r1, r2, __troaring_op_andnot);
+
+	if (NULL == r)
+		printf("Error ... tds_roaring_andnot\n");
+	return r;
+}
+
+
+/******************************************************************************
+ * Part 5. Iteration
+ ******************************************************************************/
+
+uint64_t tds_roaring_next(const tds_roaring *r, uint64_t from)
+{
+	size_t loc = 0;
+	assert(NULL != r);
+
+	if (from >= tds_roaring_end)
+		return tds_roaring_end;
+	for (loc = __tds_roaring_locate(r, (uint16_t) (from >> 16)); loc < r->__ncont; loc++) {
+		const struct __troaring_cont *c = r->__conts + loc;
+		size_t low = c->__key == from >> 16 ? (size_t) (from & 0xFFFF) : 0;
+
+		if ((low = __cont_next(c, low)) < __troaring_chunk_bits)
+			return ((uint64_t) c->__key << 16) | low;
+	}
+	return tds_roaring_end;
+}
+
+/* Context of the visits of a bitmap container by `tds_bitarray_foreach_set`
+ */
+struct __troaring_visit {
+	tds_roaring_fvisit_t *__visit;
+	void *__ctx;
+	uint32_t __high;
+	int __stopped;
+};
+
+static int __tds_roaring_visit_bit(size_t loc, void *ctx)
+{
+	struct __troaring_visit *v = (struct __troaring_visit *) ctx;
+
+	v->__stopped = !v->__visit(v->__high | (uint32_t) loc, v->__ctx);
+	return !v->__stopped;
+}
+
+void tds_roaring_foreach(const tds_roaring *r, tds_roaring_fvisit_t *visit, void *ctx)
+{
+	struct __troaring_visit v;
+	size_t loc = 0;
+	size_t idx = 0;
+	assert(NULL != r);
+	assert(NULL != visit);
+
+	v.__visit = visit;
+	v.__ctx = ctx;
+	v.__stopped = 0;
+	for (loc = 0; loc < r->__ncont; loc++) {
+		const struct __troaring_cont *c = r->__conts + loc;
+		const uint16_t *vals = (const uint16_t *) c->__data;
+
+		v.__high = (uint32_t) c->__key << 16;
+		switch (c->__type) {
+		case __troaring_array:
+			for (idx = 0; idx < c->__card; idx++)
+				if (!visit(v.__high | vals[idx], ctx))
+					return;
+			break;
+		case __troaring_bitmap:
+			tds_bitarray_foreach_set((const tds_bitarray *) c->__data, __tds_roaring_visit_bit, &v);
+			if (v.__stopped)
+				return;
+			break;
+		default:
+			for (idx = 0; idx < c->__n; idx++) {
+				size_t low = vals[2 * idx];
+				size_t end = low + vals[2 * idx + 1];
+
+				for (; low <= end; low++)
+					if (!visit(v.__high | (uint32_t) low, ctx))
+						return;
+			}
+			break;
+		}
+	}
+}
+
+
+/******************************************************************************
+ * Part 6. Serialization
+ ******************************************************************************/
+
+static void __put_le(unsigned char *p, uint64_t v, size_t nbytes)
+{
+	size_t idx = 0;
+
+	for (idx = 0; idx < nbytes; idx++)
+		p[idx] = (unsigned char) (v >> (8 * idx));
+}
+
+static uint64_t __get_le(const unsigned char *p, size_t nbytes)
+{
+	uint64_t v = 0;
+	size_t idx = 0;
+
+	for (idx = 0; idx < nbytes; idx++)
+		v |= (uint64_t) p[idx] << (8 * idx);
+	return v;
+}
+
+/* Serialized bytes of the values of `c`
+ */
+static size_t __cont_serialized_size(const struct __troaring_cont *c)
+{
+	switch (c->__type) {
+	case __troaring_array:
+		return 2 * (size_t) c->__card;
+	case __troaring_bitmap:
+		return __troaring_chunk_bits / 8;
+	default:
+		return 4 * (size_t) c->__n;
+	}
+}
+
+size_t tds_roaring_serialized_size(const tds_roaring *r)
+{
+	size_t nbytes = 0;
+	size_t idx = 0;
+	assert(NULL != r);
+
+	nbytes = __troaring_magic_size + 4 + r->__ncont * __troaring_desc_size;
+	for (idx = 0; idx < r->__ncont; idx++)
+		nbytes += __cont_serialized_size(r->__conts + idx);
+	return nbytes;
+}
+
+void tds_roaring_serialize(const tds_roaring *r, void *buf)
+{
+	unsigned char *p = (unsigned char *) buf;
+	size_t loc = 0;
+	size_t idx = 0;
+	assert(NULL != r);
+	assert(NULL != buf);
+
+	memcpy(p, __troaring_magic, __troaring_magic_size);
+	__put_le(p + __troaring_magic_size, r->__ncont, 4);
+	p += __troaring_magic_size + 4;
+	for (loc = 0; loc < r->__ncont; loc++) {
+		const struct __troaring_cont *c = r->__conts + loc;
+
+		__put_le(p, c->__key, 2);
+		__put_le(p + 2, c->__type, 2);
+		__put_le(p + 4, __troaring_run == c->__type ? c->__n : c->__card, 4);
+		p += __troaring_desc_size;
+	}
+	for (loc = 0; loc < r->__ncont; loc++) {
+		const struct __troaring_cont *c = r->__conts + loc;
+		const uint16_t *vals = (const uint16_t *) c->__data;
+		const uint64_t *words = NULL;
+
+		switch (c->__type) {
+		case __troaring_array:
+			for (idx = 0; idx < c->__card; idx++, p += 2)
+				__put_le(p, vals[idx], 2);
+			break;
+		case __troaring_bitmap:
+			words = (const uint64_t *) tds_bitarray_data((const tds_bitarray *) c->__data);
+			for (idx = 0; idx < __troaring_chunk_words; idx++, p += 8)
+				__put_le(p, words[idx], 8);
+			break;
+		default:
+			for (idx = 0; idx < 2 * (size_t) c->__n; idx++, p += 2)
+				__put_le(p, vals[idx], 2);
+			break;
+		}
+	}
+}
+
+/* Read the container `c` described by its key, kind and `n` from `p`
+ * Return a bool indicating whether it is a valid container
+ */
+static int __cont_deserialize(struct __troaring_cont *c, const unsigned char *p)
+{
+	uint16_t *vals = NULL;
+	uint64_t *words = NULL;
+	tds_bitarray *bits = NULL;
+	size_t idx = 0;
+
+	switch (c->__type) {
+	case __troaring_array:
+		if (NULL == (vals = (uint16_t *) malloc(c->__card * sizeof(uint16_t))))
+			return 0;
+		for (idx = 0; idx < c->__card; idx++, p += 2) {
+			vals[idx] = (uint16_t) __get_le(p, 2);
+			if (idx > 0 && vals[idx] <= vals[idx - 1]) {
+				free(vals);
+				return 0;
+			}
+		}
+		c->__n = c->__card;
+		c->__data = vals;
+		return 1;
+	case __troaring_bitmap:
+		if (NULL == (bits = tds_bitarray_create(__troaring_chunk_bits)))
+			return 0;
+		words = (uint64_t *) tds_bitarray_data(bits);
+		for (idx = 0; idx < __troaring_chunk_words; idx++, p += 8)
+			words[idx] = __get_le(p, 8);
+		if (tds_bitarray_popcount(bits) != c->__card) {
+			tds_bitarray_free(bits);
+			return 0;
+		}
+		c->__data = bits;
+		return 1;
+	default:
+		if (NULL == (vals = (uint16_t *) malloc(2 * c->__n * sizeof(uint16_t))))
+			return 0;
+		c->__card = 0;
+		for (idx = 0; idx < c->__n; idx++, p += 4) {
+			vals[2 * idx] = (uint16_t) __get_le(p, 2);
+			vals[2 * idx + 1] = (uint16_t) __get_le(p + 2, 2);
+			c->__card += vals[2 * idx + 1] + 1u;
+			if ((size_t) vals[2 * idx] + vals[2 * idx + 1] >= __troaring_chunk_bits
+			 || (idx > 0 && vals[2 * idx] <= (size_t) vals[2 * idx - 2] + vals[2 * idx - 1] + 1)) {
+				free(vals);
+				return 0;
+			}
+		}
+		c->__data = vals;
+		return 1;
+	}
+}
+
+tds_roaring *tds_roaring_deserialize(const void *buf, size_t len)
+{
+	const unsigned char *p = (const unsigned char *) buf;
+	const unsigned char *desc = NULL;
+	tds_roaring *r = NULL;
+	size_t ncont = 0;
+	size_t offset = 0;
+	size_t loc = 0;
+	assert(NULL != buf);
+
+	if (len < __troaring_magic_size + 4 || 0 != memcmp(p, __troaring_magic, __troaring_magic_size))
+		goto invalid;
+	ncont = (size_t) __get_le(p + __troaring_magic_size, 4);
+	if (ncont > (len - __troaring_magic_size - 4) / __troaring_desc_size)
+		goto invalid;
+	desc = p + __troaring_magic_size + 4;
+	offset = __troaring_magic_size + 4 + ncont * __troaring_desc_size;
+	if (NULL == (r = tds_roaring_create()))
+		goto invalid;
+	for (loc = 0; loc < ncont; loc++, desc += __troaring_desc_size) {
+		struct __troaring_cont c;
+		uint64_t n = __get_le(desc + 4, 4);
+
+		c.__key = (uint16_t) __get_le(desc, 2);
+		c.__type = (uint16_t) __get_le(desc + 2, 2);
+		c.__card = (uint32_t) n;
+		c.__n = __troaring_run == c.__type ? (uint32_t) n : 0;
+		if ((loc > 0 && c.__key <= r->__conts[loc - 1].__key)
+		 || (__troaring_array == c.__type && (n < 1 || n > __troaring_array_max))
+		 || (__troaring_bitmap == c.__type && (n < 1 || n > __troaring_chunk_bits))
+		 || (__troaring_run == c.__type && (n < 1 || n > __troaring_chunk_bits / 2))
+		 || c.__type > __troaring_run
+		 || __cont_serialized_size(&c) > len - offset
+		 || !__cont_deserialize(&c, p + offset))
+			goto invalid;
+		offset += __cont_serialized_size(&c);
+		if (!__tds_roaring_insert(r, r->__ncont, &c)) {
+			__cont_free(&c, r->__alloc);
+			goto invalid;
+		}
+	}
+	if (offset != len)
+		goto invalid;
+	return r;
+
+invalid:
+	if (NULL != r)
+		tds_roaring_free(r);
+	printf("Error ... tds_roaring_deserialize\n");
+	return NULL;
+}
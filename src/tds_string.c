@@ -13,9 +13,10 @@
 
 struct tds_string
 {
-	char *__data;       /* created by malloc */
+	char *__data;       /* created by the allocator */
 	size_t __capacity;
 	size_t __len;
+	const tds_allocator *__alloc;
 };
 
 
@@ -23,12 +24,12 @@ struct tds_string
  * Create tds_string
  *****************************************************************************/
 
-tds_string *tds_string_create_g(size_t buffersize)
+tds_string *tds_string_create_g(size_t buffersize, const tds_allocator *alloc)
 {
 	tds_string * str = NULL;
 	char *data;
 	size_t c_str_cap = tds_string_initlen;
-	str = (tds_string *) malloc(sizeof(tds_string));
+	str = (tds_string *) tds_allocator_alloc(alloc, sizeof(tds_string));
 
 	if (NULL == str) {
 		printf("Error ... tds_string_create\n");
@@ -36,23 +37,24 @@ tds_string *tds_string_create_g(size_t buffersize)
 	}
 	while (c_str_cap < buffersize)  /* get `c_str_cap` that covers buffersize */
 		c_str_cap *= 2;
-	data = (char *) malloc(c_str_cap);
-	memset(data, '\0', c_str_cap);
+	data = (char *) tds_allocator_alloc(alloc, c_str_cap);
 
 	if (NULL == data) {
-		free(str);
+		tds_allocator_free(alloc, str, sizeof(tds_string));
 		printf("Error ... tds_string_create\n");
 		exit(-1);
 	}
+	memset(data, '\0', c_str_cap);
 	str->__data = data;
 	str->__capacity = c_str_cap;
 	str->__len = 0;
+	str->__alloc = alloc;
 	return str;
 }
 
 tds_string *tds_string_create(void)
 {
-	return tds_string_create_g(tds_string_initlen);
+	return tds_string_create_g(tds_string_initlen, NULL);
 }
 
 tds_string *tds_string_create_substr(const tds_string *tstr, size_t pos, size_t n)
@@ -63,7 +65,7 @@ tds_string *tds_string_create_substr(const tds_string *tstr, size_t pos, size_t
 	assert(NULL != tstr);
 	assert(pos <= tstr->__len);
 
-	if (NULL == (substr = tds_string_create()))
+	if (NULL == (substr = tds_string_create_g(tds_string_initlen, tstr->__alloc)))
 		return NULL;
 	cstr = tds_string_cstr(tstr);
 	tds_string_force_append_cstr(substr, cstr + pos, n);
@@ -154,8 +156,8 @@ void tds_string_free(tds_string *tstr)
 {
 	assert(NULL != tstr);
 
-	free(tstr->__data);
-	free(tstr);
+	tds_allocator_free(tstr->__alloc, tstr->__data, tstr->__capacity);
+	tds_allocator_free(tstr->__alloc, tstr, sizeof(tds_string));
 }
 
 void tds_string_clear(tds_string *tstr)
@@ -250,7 +252,8 @@ void tds_string_force_append_cstr(tds_string *tstr, const char *cstr, size_t len
 
 		while (tstr->__capacity * n < newlen)
 			n *= 2;
-		new_data = (char *) realloc(tstr->__data, tstr->__capacity * n);
+		new_data = (char *) tds_allocator_realloc(tstr->__alloc, tstr->__data, \
+			tstr->__capacity, tstr->__capacity * n);
 
 		if (NULL == new_data) {
 			tds_string_free(tstr);
@@ -0,0 +1,356 @@
+#include <tds/allocator.h>
+#include <tds/array.h>
+#include <tds/arraylist.h>
+#include <tds/linkedlist.h>
+#include <tds/avltree.h>
+#include <tds/deque.h>
+#include <tds/stack_arr.h>
+#include <tds/string.h>
+#include <tds/bytearray.h>
+#include <tds/bitarray.h>
+#include <tds/nbitsarray.h>
+#include <tds/cbitarray.h>
+#include <tds/bloom.h>
+#include <tds/roaring.h>
+#include <tds/hashtbl.h>
+#include <tds/hashset.h>
+#include <tds/cuckootbl.h>
+#include <tds/chashtbl.h>
+#include <ta/hash.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A tracking allocator: each block is preceded by its size, so that the size
+ * given back by the containers can be checked
+ */
+#define header_size  16
+
+struct tracker {
+	size_t nalloc;  /* blocks allocated */
+	size_t nlive;   /* blocks not released */
+	size_t bytes;   /* bytes not released */
+};
+
+static void *track_alloc(void *ctx, size_t size)
+{
+	struct tracker *t = (struct tracker *) ctx;
+	char *p = (char *) malloc(header_size + size);
+
+	if (NULL == p)
+		return NULL;
+	memcpy(p, &size, sizeof(size));
+	t->nalloc++;
+	t->nlive++;
+	t->bytes += size;
+	return p + header_size;
+}
+
+static void track_free(void *ctx, void *ptr, size_t size)
+{
+	struct tracker *t = (struct tracker *) ctx;
+	char *p = (char *) ptr - header_size;
+	size_t stored = 0;
+
+	memcpy(&stored, p, sizeof(stored));
+	assert(stored == size);
+	assert(t->nlive > 0 && t->bytes >= size);
+	t->nlive--;
+	t->bytes -= size;
+	free(p);
+}
+
+static void *track_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size)
+{
+	struct tracker *t = (struct tracker *) ctx;
+	char *p = NULL;
+	size_t stored = 0;
+
+	if (NULL == ptr)
+		return track_alloc(ctx, new_size);
+	memcpy(&stored, (char *) ptr - header_size, sizeof(stored));
+	assert(stored == old_size);
+	if (NULL == (p = (char *) realloc((char *) ptr - header_size, header_size + new_size)))
+		return NULL;
+	memcpy(p, &new_size, sizeof(new_size));
+	t->bytes = t->bytes - old_size + new_size;
+	return p + header_size;
+}
+
+static int int_cmp(const void *a, const void *b)
+{
+	return *(const int *) a - *(const int *) b;
+}
+
+/* Every block allocated is released, with its size
+ */
+static void check_released(const struct tracker *t)
+{
+	assert(t->nalloc > 0);
+	assert(0 == t->nlive);
+	assert(0 == t->bytes);
+}
+
+/* testing
+ * 	- tds_array_create_g
+ * 	- tds_array_resize_g
+ * 	- tds_array_free_g
+ * 	- tds_arraylist_force_create_g
+ * 	- tds_stack_arr_force_create_g
+ * 	- tds_string_create_g
+ * 	- tds_bytearray_force_create_g
+ */
+void test_arrays(const tds_allocator *alloc, struct tracker *t)
+{
+	tds_array *arr = tds_array_create_g(sizeof(int), 4, alloc);
+	tds_arraylist *list = tds_arraylist_force_create_g(sizeof(int), 1, alloc);
+	tds_stack_arr *stk = tds_stack_arr_force_create_g(sizeof(int), 1, alloc);
+	tds_string *tstr = tds_string_create_g(1, alloc);
+	tds_string *sub = NULL;
+	tds_bytearray *bytes = tds_bytearray_force_create_g(1, alloc);
+	int idx = 0;
+
+	assert(NULL != arr && NULL != tstr);
+	assert(1 == tds_array_resize_g(&arr, 1000, alloc));
+	for (idx = 0; idx < 1000; idx++) {
+		tds_array_set(arr, (size_t) idx, &idx);
+		tds_arraylist_force_pushback(list, &idx);
+		tds_stack_arr_pushfront(stk, &idx);
+		tds_string_force_append_int32(tstr, idx);
+		tds_bytearray_force_put_varint(bytes, (uint64_t) idx);
+	}
+	assert(999 == *(int *) tds_array_get(arr, 999));
+	assert(1000 == tds_arraylist_len(list));
+	sub = tds_string_force_create_substr(tstr, 10, 10);
+	assert(0 == strncmp(tds_string_cstr(sub), tds_string_cstr(tstr) + 10, 10));
+	tds_string_free(sub);
+	tds_array_free_g(arr, alloc);
+	tds_arraylist_free(list);
+	tds_stack_arr_free(stk);
+	tds_string_free(tstr);
+	tds_bytearray_free(bytes);
+	check_released(t);
+}
+
+/* testing
+ * 	- tds_linkedlist_create_g
+ * 	- tds_avltree_create_g
+ * 	- tds_deque_create_g
+ */
+void test_nodes(const tds_allocator *alloc, struct tracker *t)
+{
+	tds_linkedlist *list = tds_linkedlist_create_g(sizeof(int), 8, alloc);
+	tds_avltree *tree = tds_avltree_create_g(sizeof(int), 8, alloc);
+	tds_deque *q = tds_deque_create_g(sizeof(int), 16, 2, alloc);
+	int idx = 0;
+
+	assert(NULL != list && NULL != tree && NULL != q);
+	for (idx = 0; idx < 1000; idx++) {
+		int key = (idx * 7919) % 1000;
+
+		assert(1 == tds_linkedlist_pushback(list, &idx));
+		assert(1 == tds_avltree_insert(tree, &key, int_cmp));
+		assert(1 == tds_deque_pushfront(q, &idx));
+	}
+	for (idx = 0; idx < 500; idx++) {
+		tds_linkedlist_popfront(list);
+		tds_deque_popback(q);
+	}
+	assert(500 == tds_linkedlist_len(list));
+	assert(1000 == tds_avltree_len(tree));
+	assert(500 == tds_deque_len(q));
+	tds_linkedlist_free(list);
+	tds_avltree_free(tree);
+	tds_deque_free(q);
+	check_released(t);
+}
+
+/* testing
+ * 	- tds_bitarray_force_create_g
+ * 	- tds_nbitsarray_force_create_g
+ * 	- tds_cbitarray_force_create_g
+ * 	- tds_bloom_force_create_g
+ * 	- tds_roaring_force_create_g
+ */
+void test_bits(const tds_allocator *alloc, struct tracker *t)
+{
+	tds_bitarray *a = tds_bitarray_force_create_g(1000, alloc);
+	tds_bitarray *b = tds_bitarray_force_create_g(1000, alloc);
+	tds_bitarray *c = NULL;
+	tds_bitarray_index *index = NULL;
+	tds_nbitsarray *narr = tds_nbitsarray_force_create_g(13, 1, alloc);
+	tds_cbitarray *carr = tds_cbitarray_force_create_g(1000, alloc);
+	tds_bloom *bloom = tds_bloom_force_create_g(4096, 4, 1, alloc);
+	tds_roaring *r1 = tds_roaring_force_create_g(alloc);
+	tds_roaring *r2 = tds_roaring_force_create_g(alloc);
+	tds_roaring *r3 = NULL;
+	uint32_t idx = 0;
+
+	for (idx = 0; idx < 1000; idx++) {
+		tds_bitarray_set(idx % 3 ? a : b, idx, 1);
+		tds_nbitsarray_force_pushback(narr, idx);
+		tds_cbitarray_set(carr, idx, 1);
+		tds_bloom_insert(bloom, &idx, sizeof(idx));
+	}
+	assert(1 == tds_bitarray_resize(&a, 5000));
+	assert(1 == tds_bitarray_resize(&b, 5000));
+	assert(NULL != (c = tds_bitarray_or(a, b)));
+	assert(1000 == tds_bitarray_popcount(c));
+	index = tds_bitarray_force_index_create(c);
+	tds_bitarray_index_free(index);
+	assert(1000 == tds_nbitsarray_len(narr));
+
+	/* array, bitmap and run containers, converted back and forth */
+	for (idx = 0; idx < 70000; idx++)
+		tds_roaring_force_add(r1, idx % 5 ? idx : 3 * idx);
+	for (idx = 100; idx < 70000; idx += 7)
+		tds_roaring_force_remove(r1, idx);
+	for (idx = 0; idx < 300; idx++)
+		tds_roaring_force_add(r2, 65536 * (idx % 4) + 2 * idx);
+	for (idx = 0; idx < 1000; idx++)
+		tds_roaring_force_add(r2, 5 * 65536 + idx);
+	assert(1 == tds_roaring_optimize(r1));
+	assert(1 == tds_roaring_optimize(r2));
+	for (idx = 0; idx < 20; idx++)
+		tds_roaring_force_remove(r2, 2 * idx);
+	tds_roaring_force_remove(r2, 5 * 65536 + 500);  /* splits the run */
+	tds_roaring_force_remove(r2, 5 * 65536 + 498);
+	tds_roaring_force_remove(r2, 5 * 65536 + 499);  /* drops a run of one value */
+	assert(295 + 997 == tds_roaring_cardinality(r2));
+	assert(NULL != (r3 = tds_roaring_or(r1, r2)));
+	tds_roaring_free(r3);
+	assert(NULL != (r3 = tds_roaring_and(r1, r2)));
+	tds_roaring_free(r3);
+
+	tds_bitarray_free(a);
+	tds_bitarray_free(b);
+	tds_bitarray_free(c);
+	tds_nbitsarray_free(narr);
+	tds_cbitarray_free(carr);
+	tds_bloom_free(bloom);
+	tds_roaring_free(r1);
+	tds_roaring_free(r2);
+	check_released(t);
+}
+
+/* testing
+ * 	- tds_hashtbl_force_create_m
+ * 	- tds_hashtbl_force_create_g
+ * 	- tds_hashtbl_force_create_s_g
+ * 	- tds_hashset_force_create_g
+ * 	- tds_cuckootbl_force_create_g
+ * 	- tds_chashtbl_force_create_g
+ */
+void test_tables(const tds_allocator *alloc, struct tracker *t)
+{
+	const int modes[] = {0, tds_hashtbl_mode_incremental | tds_hashtbl_mode_storehash, tds_hashtbl_mode_robinhood};
+	tds_hashtbl *tbl = tds_hashtbl_force_create_g(2 * sizeof(size_t), sizeof(size_t), 0, alloc);
+	tds_hashset *set = tds_hashset_force_create_g(sizeof(size_t), 0, alloc);
+	tds_cuckootbl *ctbl = tds_cuckootbl_force_create_g(2 * sizeof(size_t), sizeof(size_t), 0, alloc);
+	tds_chashtbl *chtbl = tds_chashtbl_force_create_g(2 * sizeof(size_t), sizeof(size_t), 0, alloc);
+	size_t m = 0;
+	size_t idx = 0;
+
+	for (idx = 0; idx < 5000; idx++) {
+		size_t pair[2];
+
+		pair[0] = idx;
+		pair[1] = 2 * idx;
+		tds_hashtbl_force_set(tbl, pair);
+		tds_hashset_force_insert(set, &idx);
+		tds_cuckootbl_force_set(ctbl, pair);
+		tds_chashtbl_force_set(chtbl, pair);
+	}
+	tds_hashtbl_free(tbl);
+	tds_hashset_free(set);
+	tds_cuckootbl_free(ctbl);
+	tds_chashtbl_free(chtbl);
+
+	for (m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+		tbl = tds_hashtbl_force_create_m(2 * sizeof(size_t), sizeof(size_t), 0, ta_hash_wy, modes[m], alloc);
+		for (idx = 0; idx < 5000; idx++) {
+			size_t pair[2];
+
+			pair[0] = idx;
+			pair[1] = idx;
+			tds_hashtbl_force_set(tbl, pair);
+			if (0 == idx % 3)
+				tds_hashtbl_rm(tbl, pair);
+		}
+		tds_hashtbl_free(tbl);  /* possibly while migrating */
+	}
+
+	/* string keys, the key arena being grown */
+	for (m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+		size_t nalloc = t->nalloc;
+
+		tbl = tds_hashtbl_force_create_s_g(sizeof(size_t), 0, modes[m], alloc);
+		assert(t->nalloc > nalloc);
+		for (idx = 0; idx < 5000; idx++) {
+			char key[32];
+			size_t len = (size_t) sprintf(key, "string key %lu", (unsigned long) idx);
+
+			tds_hashtbl_force_sset(tbl, key, len, &idx);
+			if (0 == idx % 3)
+				assert(1 == tds_hashtbl_srm(tbl, key, len));
+		}
+		assert(1 == tds_hashtbl_compact(tbl));
+		tds_hashtbl_free(tbl);
+	}
+	check_released(t);
+}
+
+/* testing
+ * 	- tds_allocator_libc
+ * 	- tds_allocator_realloc, without `frealloc`
+ * 	- tds_allocator_free, without `ffree`
+ */
+void test_defaults(void)
+{
+	tds_arraylist *list = tds_arraylist_force_create_g(sizeof(int), 1, tds_allocator_libc());
+	tds_allocator noop = {NULL, NULL, NULL, NULL};
+	struct tracker t = {0, 0, 0};
+	char *p = NULL;
+	int idx = 0;
+
+	for (idx = 0; idx < 1000; idx++)
+		tds_arraylist_force_pushback(list, &idx);
+	assert(999 == *(int *) tds_arraylist_get(list, 999));
+	tds_arraylist_free(list);
+
+	/* `ffree` NULL: nothing released by the allocator */
+	noop.falloc = track_alloc;
+	noop.ctx = &t;
+	p = (char *) tds_allocator_alloc(&noop, 8);
+	tds_allocator_free(&noop, p, 8);
+	assert(1 == t.nlive);
+	track_free(&t, p, 8);
+
+	/* NULL allocator: the C library */
+	p = (char *) tds_allocator_calloc(NULL, 64);
+	assert(0 == p[63]);
+	p = (char *) tds_allocator_realloc(NULL, p, 64, 128);
+	tds_allocator_free(NULL, p, 128);
+}
+
+int main(void)
+{
+	struct tracker t = {0, 0, 0};
+	tds_allocator tracking = {track_alloc, track_realloc, track_free, NULL};
+	tds_allocator copying = {track_alloc, NULL, track_free, NULL};  /* realloc by copies */
+
+	tracking.ctx = &t;
+	copying.ctx = &t;
+	test_arrays(&tracking, &t);
+	test_nodes(&tracking, &t);
+	test_bits(&tracking, &t);
+	test_tables(&tracking, &t);
+	test_arrays(&copying, &t);
+	test_bits(&copying, &t);
+	test_tables(&copying, &t);
+	test_defaults();
+	return 0;
+}
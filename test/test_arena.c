@@ -0,0 +1,193 @@
+#include <tds/arena.h>
+#include <tds/arraylist.h>
+#include <tds/string.h>
+#include <tds/linkedlist.h>
+#include <tds/avltree.h>
+#include <tds/deque.h>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The chunks come from a counting allocator
+ */
+struct counter {
+	size_t nlive;
+	size_t bytes;
+};
+
+static void *count_alloc(void *ctx, size_t size)
+{
+	struct counter *c = (struct counter *) ctx;
+
+	c->nlive++;
+	c->bytes += size;
+	return malloc(size);
+}
+
+static void count_free(void *ctx, void *ptr, size_t size)
+{
+	struct counter *c = (struct counter *) ctx;
+
+	assert(c->nlive > 0 && c->bytes >= size);
+	c->nlive--;
+	c->bytes -= size;
+	free(ptr);
+}
+
+int cmp_int(const void *a, const void *b)
+{
+	return *(const int *) a - *(const int *) b;
+}
+
+/* testing
+ * 	- tds_arena_create_g
+ * 	- tds_arena_alloc
+ * 	- tds_arena_used
+ * 	- tds_arena_capacity
+ * 	- tds_arena_reset
+ * 	- tds_arena_free
+ */
+void test_arena(void)
+{
+	struct counter c = {0, 0};
+	tds_allocator chunks = {count_alloc, NULL, count_free, NULL};
+	tds_arena *arena = NULL;
+	char *blocks[100];
+	char *large = NULL;
+	size_t capacity = 0;
+	size_t idx = 0;
+
+	chunks.ctx = &c;
+	arena = tds_arena_force_create_g(1024, &chunks);
+	assert(1 == c.nlive);  /* the arena itself */
+	assert(0 == tds_arena_used(arena));
+	assert(0 == tds_arena_capacity(arena));
+
+	for (idx = 0; idx < 100; idx++) {
+		blocks[idx] = (char *) tds_arena_alloc(arena, 1 + idx);
+		assert(NULL != blocks[idx]);
+		assert(0 == (uintptr_t) blocks[idx] % _Alignof(max_align_t));
+		memset(blocks[idx], (int) idx, 1 + idx);
+	}
+	for (idx = 0; idx < 100; idx++)
+		assert((char) idx == blocks[idx][idx]);
+	assert(tds_arena_used(arena) >= 100 * 101 / 2);
+	assert(tds_arena_capacity(arena) >= tds_arena_used(arena));
+
+	/* larger than a chunk */
+	large = (char *) tds_arena_alloc(arena, 10000);
+	assert(NULL != large);
+	memset(large, 1, 10000);
+	assert(tds_arena_capacity(arena) >= 10000 + 100 * 101 / 2);
+
+	/* the chunks are kept, and used again */
+	capacity = tds_arena_capacity(arena);
+	tds_arena_reset(arena);
+	assert(0 == tds_arena_used(arena));
+	assert(capacity == tds_arena_capacity(arena));
+	for (idx = 0; idx < 100; idx++)
+		assert(NULL != tds_arena_alloc(arena, 1 + idx));
+	assert(NULL != tds_arena_alloc(arena, 10000));
+	assert(capacity == tds_arena_capacity(arena));
+
+	tds_arena_free(arena);
+	assert(0 == c.nlive && 0 == c.bytes);
+}
+
+/* testing
+ * 	- tds_arena_mark
+ * 	- tds_arena_rewind
+ * 	- tds_arena_realloc
+ */
+void test_mark(void)
+{
+	tds_arena *arena = tds_arena_force_create_g(256, NULL);
+	tds_arenamark empty = tds_arena_mark(arena);
+	tds_arenamark mark;
+	char *keep = NULL;
+	char *ptr = NULL;
+	char *moved = NULL;
+	size_t used = 0;
+	size_t idx = 0;
+
+	keep = (char *) tds_arena_alloc(arena, 8);
+	memcpy(keep, "persist", 8);
+	mark = tds_arena_mark(arena);
+	used = tds_arena_used(arena);
+	for (idx = 0; idx < 50; idx++)  /* over several chunks */
+		assert(NULL != tds_arena_alloc(arena, 100));
+	tds_arena_rewind(arena, mark);
+	assert(used == tds_arena_used(arena));
+	assert(0 == strcmp(keep, "persist"));
+
+	/* the last block grows in place while the chunk has room */
+	ptr = (char *) tds_arena_alloc(arena, 16);
+	memcpy(ptr, "abcdefghijklmno", 16);
+	assert(ptr == tds_arena_realloc(arena, ptr, 16, 64));
+	assert(ptr == tds_arena_realloc(arena, ptr, 64, 8));
+	moved = (char *) tds_arena_realloc(arena, ptr, 8, 1000);
+	assert(NULL != moved && ptr != moved);
+	assert(0 == memcmp(moved, "abcdefgh", 8));
+	assert(keep == tds_arena_realloc(arena, keep, 8, 4));  /* not the last */
+
+	tds_arena_rewind(arena, empty);
+	assert(0 == tds_arena_used(arena));
+	tds_arena_free(arena);
+}
+
+/* testing
+ * 	- tds_arena_allocator
+ * 	- the containers created in an arena
+ */
+void test_containers(void)
+{
+	tds_arena *arena = tds_arena_force_create();
+	const tds_allocator *alloc = tds_arena_allocator(arena);
+	size_t round = 0;
+	int idx = 0;
+
+	assert(!tds_allocator_frees(alloc));
+	for (round = 0; round < 3; round++) {
+		tds_arraylist *list = tds_arraylist_force_create_g(sizeof(int), 4, alloc);
+		tds_string *str = tds_string_create_g(8, alloc);
+		tds_linkedlist *llist = tds_linkedlist_create_g(sizeof(int), 16, alloc);
+		tds_avltree *tree = tds_avltree_create_g(sizeof(int), 16, alloc);
+		tds_deque *deq = tds_deque_create_g(sizeof(int), 8, 2, alloc);
+
+		assert(NULL != str && NULL != llist && NULL != tree && NULL != deq);
+		for (idx = 0; idx < 1000; idx++) {
+			int key = (idx * 7919) % 1000;
+
+			tds_arraylist_force_pushback(list, &idx);
+			tds_string_force_append_c(str, (char) ('a' + idx % 26));
+			assert(1 == tds_linkedlist_pushback(llist, &idx));
+			assert(1 == tds_avltree_insert(tree, &key, cmp_int));
+			assert(1 == tds_deque_pushback(deq, &idx));
+		}
+		assert(1000 == tds_arraylist_len(list));
+		assert(1000 == tds_string_len(str));
+		assert(0 == strncmp(tds_string_cstr(str), "abcdefghijklmnopqrstuvwxyz", 26));
+		assert(1000 == tds_linkedlist_len(llist));
+		assert(1000 == tds_avltree_len(tree));
+		assert(1000 == tds_deque_len(deq));
+
+		/* freeing is optional, and does not walk the nodes */
+		tds_linkedlist_free(llist);
+		tds_avltree_free(tree);
+		tds_deque_free(deq);
+		tds_arena_reset(arena);
+	}
+	tds_arena_free(arena);
+}
+
+int main(void)
+{
+	test_arena();
+	test_mark();
+	test_containers();
+	return 0;
+}
@@ -21,7 +21,7 @@ void test_worst(void)
 {
 	/* Creation
 	 */
-	tds_avltree *tree = tds_avltree_create_g(sizeof(int), 1);
+	tds_avltree *tree = tds_avltree_create_g(sizeof(int), 1, NULL);
 	tds_avltreeiter *iter = NULL;
 	int data = 0;
 
@@ -187,9 +187,48 @@ void test_best(void)
 	tds_avltree_free(tree);
 }
 
+/* testing
+ * 	- tds_avltree_delete, and insertions into deleted nodes
+ * 	- tds_avltree_free_buffer
+ */
+void test_reuse(void)
+{
+	tds_avltree *tree = tds_avltree_create(sizeof(int));
+	tds_avltreeiter *iter = NULL;
+	int data = 0;
+	int prev = -1;
+	int idx = 0;
+
+	for (idx = 0; idx < 1000; idx++) {
+		data = (idx * 7919) % 1000;
+		assert(1 == tds_avltree_insert(tree, &data, cmp_int));
+	}
+	for (data = 0; data < 500; data++)
+		assert(1 == tds_avltree_delete(tree, &data, cmp_int));
+	assert(500 == tds_avltree_len(tree));
+	for (data = 0; data < 250; data++)
+		assert(1 == tds_avltree_insert(tree, &data, cmp_int));
+	assert(750 == tds_avltree_len(tree));
+	assert(tds_avltree_height(tree) <= 14);  /* 1.44 * log2(750) */
+
+	iter = tds_avltreeiter_front(tree);
+	for (idx = 0; NULL != iter; idx++) {
+		data = *(int *) tds_avltreeiter_data(iter);
+		assert(data > prev);
+		assert(data < 250 || data >= 500);
+		prev = data;
+		iter = tds_avltreeiter_next(iter);
+	}
+	assert(750 == idx);
+
+	tds_avltree_free_buffer(tree);
+	tds_avltree_free(tree);
+}
+
 int main(void)
 {
 	test_worst();
 	test_best();
+	test_reuse();
 	return 0;
 }
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 
 /* testing
@@ -109,10 +110,202 @@ void test_3(void)
 	tds_bitarray_free(arr_2);
 }
 
+/* testing
+ * 	- tds_bitarray_init
+ * 	- tds_bitarray_and_inplace
+ * 	- tds_bitarray_or_inplace
+ * 	- tds_bitarray_xor_inplace
+ * 	- tds_bitarray_not_inplace
+ * 	- tds_bitarray_force_resize (new bits are 0)
+ */
+void test_inplace(void)
+{
+	size_t arr_size = 64 * 7;  /* not a multiple of the SIMD width */
+	size_t idx = 0;
+
+	tds_bitarray *arr_1 = tds_bitarray_force_create(arr_size);
+	tds_bitarray *arr_2 = tds_bitarray_force_create(arr_size);
+	tds_bitarray *arr = tds_bitarray_force_create(arr_size);
+
+	assert(arr_size == tds_bitarray_capacity(arr));
+	for (idx = 0; idx < arr_size; idx++) {
+		tds_bitarray_set(arr_1, idx, 0 == idx % 3);
+		tds_bitarray_set(arr_2, idx, 0 == idx % 5);
+	}
+
+	tds_bitarray_init(arr, 1);
+	tds_bitarray_and_inplace(arr, arr_1);
+	tds_bitarray_and_inplace(arr, arr_2);
+	for (idx = 0; idx < arr_size; idx++)
+		assert(tds_bitarray_get(arr, idx) == (0 == idx % 15));
+
+	tds_bitarray_init(arr, 0);
+	tds_bitarray_or_inplace(arr, arr_1);
+	tds_bitarray_or_inplace(arr, arr_2);
+	for (idx = 0; idx < arr_size; idx++)
+		assert(tds_bitarray_get(arr, idx) == (0 == idx % 3 || 0 == idx % 5));
+
+	tds_bitarray_xor_inplace(arr, arr_1);  /* (a | b) ^ a = b & ~a */
+	for (idx = 0; idx < arr_size; idx++)
+		assert(tds_bitarray_get(arr, idx) == (0 != idx % 3 && 0 == idx % 5));
+
+	tds_bitarray_not_inplace(arr);
+	for (idx = 0; idx < arr_size; idx++)
+		assert(tds_bitarray_get(arr, idx) == (0 == idx % 3 || 0 != idx % 5));
+
+	tds_bitarray_force_resize(&arr, 3 * arr_size);
+	assert(tds_bitarray_capacity(arr) >= 3 * arr_size);
+	for (idx = 0; idx < arr_size; idx++)
+		assert(tds_bitarray_get(arr, idx) == (0 == idx % 3 || 0 != idx % 5));
+	for (; idx < tds_bitarray_capacity(arr); idx++)
+		assert(0 == tds_bitarray_get(arr, idx));
+
+	tds_bitarray_free(arr);
+	tds_bitarray_free(arr_1);
+	tds_bitarray_free(arr_2);
+}
+
+/* testing
+ * 	- tds_bitarray_popcount
+ * 	- tds_bitarray_index_create
+ * 	- tds_bitarray_rank1
+ * 	- tds_bitarray_select1
+ * 	- tds_bitarray_index_free
+ */
+void test_rank_select(void)
+{
+	size_t arr_size = 300000;  /* several superblocks, a partial block at the end */
+	size_t idx = 0;
+	size_t count = 0;
+	tds_bitarray *arr = tds_bitarray_force_create(arr_size);
+	tds_bitarray_index *index = NULL;
+
+	srand(7);
+	for (idx = 0; idx < arr_size; idx++)
+		tds_bitarray_set(arr, idx, idx >= 140000 && idx < 200000 ? 1 : 0 == rand() % 7);
+	arr_size = tds_bitarray_capacity(arr);
+	index = tds_bitarray_force_index_create(arr);
+
+	for (idx = 0; idx < arr_size; idx++) {
+		if (0 == idx % 997)
+			assert(count == tds_bitarray_rank1(arr, NULL, idx));
+		assert(count == tds_bitarray_rank1(arr, index, idx));
+		if (tds_bitarray_get(arr, idx)) {
+			assert(idx == tds_bitarray_select1(arr, index, count));
+			if (0 == count % 997)
+				assert(idx == tds_bitarray_select1(arr, NULL, count));
+			count++;
+		}
+	}
+	assert(count == tds_bitarray_popcount(arr));
+	assert(count == tds_bitarray_rank1(arr, index, arr_size));
+	assert(arr_size == tds_bitarray_select1(arr, index, count));
+	assert(arr_size == tds_bitarray_select1(arr, NULL, count));
+	tds_bitarray_index_free(index);
+
+	tds_bitarray_init(arr, 0);
+	index = tds_bitarray_force_index_create(arr);
+	assert(0 == tds_bitarray_rank1(arr, index, arr_size));
+	assert(arr_size == tds_bitarray_select1(arr, index, 0));
+	tds_bitarray_index_free(index);
+	tds_bitarray_free(arr);
+}
+
+static int collect(size_t loc, void *ctx)
+{
+	size_t *locs = (size_t *) ctx;
+
+	locs[++locs[0]] = loc;  /* locs[0] counts the visits */
+	return locs[0] < 100;
+}
+
+/* testing
+ * 	- tds_bitarray_find_next_set
+ * 	- tds_bitarray_find_next_unset
+ * 	- tds_bitarray_foreach_set
+ */
+void test_find(void)
+{
+	size_t arr_size = 1000;
+	size_t idx = 0;
+	size_t loc = 0;
+	size_t count = 0;
+	size_t locs[101];
+	tds_bitarray *arr = tds_bitarray_force_create(arr_size);
+
+	arr_size = tds_bitarray_capacity(arr);
+	assert(arr_size == tds_bitarray_find_next_set(arr, 0));
+	assert(0 == tds_bitarray_find_next_unset(arr, 0));
+	assert(arr_size == tds_bitarray_find_next_set(arr, arr_size));
+
+	for (idx = 3; idx < arr_size; idx += 7)
+		tds_bitarray_set(arr, idx, 1);
+	for (loc = tds_bitarray_find_next_set(arr, 0); loc < arr_size; loc = tds_bitarray_find_next_set(arr, loc + 1)) {
+		assert(3 == loc % 7);
+		count++;
+	}
+	assert(count == tds_bitarray_popcount(arr));
+	assert(3 == tds_bitarray_find_next_set(arr, 3));
+	assert(10 == tds_bitarray_find_next_set(arr, 4));
+	assert(4 == tds_bitarray_find_next_unset(arr, 3));
+
+	locs[0] = 0;
+	tds_bitarray_foreach_set(arr, collect, locs);
+	assert(100 == locs[0]);  /* stopped */
+	for (idx = 1; idx <= 100; idx++)
+		assert(locs[idx] == 3 + 7 * (idx - 1));
+
+	tds_bitarray_init(arr, 1);
+	assert(arr_size == tds_bitarray_find_next_unset(arr, 0));
+	tds_bitarray_set(arr, arr_size - 1, 0);
+	assert(arr_size - 1 == tds_bitarray_find_next_unset(arr, 5));
+	tds_bitarray_free(arr);
+}
+
+/* testing
+ * 	- tds_bitarray_set_range
+ * 	- tds_bitarray_clear_range
+ * 	- tds_bitarray_count_range
+ */
+void test_range(void)
+{
+	size_t ranges[][2] = {{0, 0}, {5, 6}, {3, 64}, {64, 128}, {60, 70}, {1, 639}, {130, 500}, {0, 640}};
+	size_t nrange = sizeof(ranges) / sizeof(ranges[0]);
+	size_t r = 0;
+	size_t idx = 0;
+	tds_bitarray *arr = tds_bitarray_force_create(640);
+
+	for (r = 0; r < nrange; r++) {
+		size_t from = ranges[r][0];
+		size_t to = ranges[r][1];
+
+		tds_bitarray_init(arr, 0);
+		tds_bitarray_set_range(arr, from, to);
+		for (idx = 0; idx < 640; idx++)
+			assert(tds_bitarray_get(arr, idx) == (from <= idx && idx < to));
+		assert(to - from == tds_bitarray_count_range(arr, from, to));
+		assert(to - from == tds_bitarray_popcount(arr));
+		if (from > 0 && to < 640)
+			assert(to - from == tds_bitarray_count_range(arr, from - 1, to + 1));
+
+		tds_bitarray_init(arr, 1);
+		tds_bitarray_clear_range(arr, from, to);
+		for (idx = 0; idx < 640; idx++)
+			assert(tds_bitarray_get(arr, idx) == (idx < from || to <= idx));
+		assert(0 == tds_bitarray_count_range(arr, from, to));
+		assert(640 - (to - from) == tds_bitarray_count_range(arr, 0, 640));
+	}
+	tds_bitarray_free(arr);
+}
+
 int main(void)
 {
 	test_worst();
 	test_best();
 	test_3();
+	test_inplace();
+	test_rank_select();
+	test_find();
+	test_range();
 	return 0;
 }
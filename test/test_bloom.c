@@ -0,0 +1,153 @@
+#include <tds/bloom.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* testing
+ * 	- tds_bloom_force_create
+ * 	- tds_bloom_free
+ *
+ * 	- tds_bloom_insert
+ * 	- tds_bloom_query
+ * 	- tds_bloom_clear
+ * 	- no false negative, false positive rate near the target
+ */
+void test_bloom(void)
+{
+	size_t nkeys = 100000;
+	size_t idx = 0;
+	size_t nfalse = 0;
+	tds_bloom *bloom = tds_bloom_force_create(nkeys, 0.01);
+
+	assert(tds_bloom_nbits(bloom) >= 9 * nkeys);
+	assert(7 == tds_bloom_nhashes(bloom));
+	for (idx = 0; idx < nkeys; idx++)
+		tds_bloom_insert(bloom, &idx, sizeof(idx));
+	for (idx = 0; idx < nkeys; idx++)
+		assert(1 == tds_bloom_query(bloom, &idx, sizeof(idx)));
+	for (idx = nkeys; idx < 11 * nkeys; idx++)
+		nfalse += tds_bloom_query(bloom, &idx, sizeof(idx));
+	assert((double) nfalse / (10 * nkeys) < 0.02);
+
+	tds_bloom_clear(bloom);
+	for (idx = 0; idx < nkeys; idx++)
+		assert(0 == tds_bloom_query(bloom, &idx, sizeof(idx)));
+	tds_bloom_insert(bloom, "", 0);  /* the empty key */
+	assert(1 == tds_bloom_query(bloom, "", 0));
+	tds_bloom_free(bloom);
+}
+
+/* testing
+ * 	- tds_bloom_insert_batch
+ * 	- tds_bloom_query_batch
+ * 	- tds_bloom_union
+ */
+void test_bloom_batch(void)
+{
+	size_t nkeys = 10000;
+	size_t idx = 0;
+	size_t *keys = (size_t *) malloc(2 * nkeys * sizeof(size_t));
+	int *out = (int *) malloc(2 * nkeys * sizeof(int));
+	tds_bloom *a = tds_bloom_force_create(2 * nkeys, 0.01);
+	tds_bloom *b = tds_bloom_force_create(2 * nkeys, 0.01);
+	tds_bloom *other = tds_bloom_force_create_g(tds_bloom_nbits(a), tds_bloom_nhashes(a), 1, NULL);
+
+	for (idx = 0; idx < 2 * nkeys; idx++)
+		keys[idx] = idx;
+	tds_bloom_insert_batch(a, keys, sizeof(size_t), nkeys);
+	tds_bloom_insert_batch(b, keys + nkeys, sizeof(size_t), nkeys);
+	tds_bloom_query_batch(a, keys, sizeof(size_t), 2 * nkeys, out);
+	for (idx = 0; idx < 2 * nkeys; idx++) {
+		assert(out[idx] == tds_bloom_query(a, keys + idx, sizeof(size_t)));
+		if (idx < nkeys)
+			assert(1 == out[idx]);
+	}
+
+	assert(1 == tds_bloom_union(a, b));
+	assert(0 == tds_bloom_union(a, other));  /* another seed */
+	tds_bloom_query_batch(a, keys, sizeof(size_t), 2 * nkeys, out);
+	for (idx = 0; idx < 2 * nkeys; idx++)
+		assert(1 == out[idx]);
+	free(keys);
+	free(out);
+	tds_bloom_free(a);
+	tds_bloom_free(b);
+	tds_bloom_free(other);
+}
+
+/* testing
+ * 	- tds_bloom_serialized_size
+ * 	- tds_bloom_serialize
+ * 	- tds_bloom_deserialize
+ */
+void test_bloom_serialize(void)
+{
+	size_t idx = 0;
+	size_t len = 0;
+	char *buf = NULL;
+	tds_bloom *bloom = tds_bloom_force_create(1000, 0.05);
+	tds_bloom *copy = NULL;
+
+	for (idx = 0; idx < 1000; idx += 2)
+		tds_bloom_insert(bloom, &idx, sizeof(idx));
+	len = tds_bloom_serialized_size(bloom);
+	buf = (char *) malloc(len);
+	tds_bloom_serialize(bloom, buf);
+
+	assert(NULL != (copy = tds_bloom_deserialize(buf, len)));
+	assert(tds_bloom_nbits(copy) == tds_bloom_nbits(bloom));
+	assert(tds_bloom_nhashes(copy) == tds_bloom_nhashes(bloom));
+	for (idx = 0; idx < 10000; idx++)
+		assert(tds_bloom_query(copy, &idx, sizeof(idx)) == tds_bloom_query(bloom, &idx, sizeof(idx)));
+	assert(1 == tds_bloom_union(copy, bloom));
+
+	assert(NULL == tds_bloom_deserialize(buf, len - 1));  /* truncated */
+	buf[0] = 'x';
+	assert(NULL == tds_bloom_deserialize(buf, len));  /* bad magic */
+	free(buf);
+	tds_bloom_free(bloom);
+	tds_bloom_free(copy);
+}
+
+/* testing
+ * 	- tds_bloom_serialize, the exact bytes of an empty filter
+ */
+void test_bloom_serialize_bytes(void)
+{
+	const unsigned char head[32] = {
+		't', 'd', 's', 'b', 'l', 'o', 'o', 'm',          /* magic */
+		1, 0, 0, 0,                                      /* version */
+		3, 0, 0, 0,                                      /* k */
+		2, 0, 0, 0, 0, 0, 0, 0,                          /* blocks */
+		0x2A, 0, 0, 0, 0, 0, 0, 0,                       /* seed */
+	};
+	const uint32_t one = 1;
+	unsigned char buf[32 + 2 * tds_bloom_block_bits / 8 + 1];
+	tds_bloom *bloom = tds_bloom_force_create_g(2 * tds_bloom_block_bits, 3, 0x2A, NULL);
+	size_t idx = 0;
+
+	assert(sizeof(buf) - 1 == tds_bloom_serialized_size(bloom));
+	memset(buf, 0xAB, sizeof(buf));
+	tds_bloom_serialize(bloom, buf);
+	if (1 == *(const unsigned char *) &one)  /* the header is in the byte order of the machine */
+		assert(0 == memcmp(buf, head, sizeof(head)));
+	else
+		assert(0 == memcmp(buf, head, 8));
+	for (idx = sizeof(head); idx < sizeof(buf) - 1; idx++)
+		assert(0 == buf[idx]);
+	assert(0xAB == buf[sizeof(buf) - 1]);  /* nothing written past the end */
+	tds_bloom_free(bloom);
+}
+
+int main(void)
+{
+	test_bloom();
+	test_bloom_batch();
+	test_bloom_serialize();
+	test_bloom_serialize_bytes();
+	return 0;
+}
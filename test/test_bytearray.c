@@ -0,0 +1,158 @@
+#include <tds/bytearray.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* testing
+ * 	- tds_bytearray_force_create
+ * 	- tds_bytearray_force_append
+ * 	- tds_bytearray_force_extend
+ * 	- tds_bytearray_reserve
+ * 	- tds_bytearray_len
+ * 	- tds_bytearray_capacity
+ * 	- tds_bytearray_data
+ * 	- tds_bytearray_clear
+ * 	- tds_bytearray_free
+ */
+void test_bytearray(void)
+{
+	const char bin[] = {'a', '\0', 'b', '\0', '\0', 'c'};
+	tds_bytearray *arr = tds_bytearray_force_create();
+	unsigned char *bytes = NULL;
+	size_t idx = 0;
+
+	assert(0 == tds_bytearray_len(arr));
+	for (idx = 0; idx < 1000; idx++)
+		tds_bytearray_force_append(arr, bin, sizeof(bin));
+	assert(6000 == tds_bytearray_len(arr));
+	assert(6000 <= tds_bytearray_capacity(arr));
+	for (idx = 0; idx < 1000; idx++)
+		assert(0 == memcmp(tds_bytearray_data(arr) + 6 * idx, bin, sizeof(bin)));
+	tds_bytearray_force_append(arr, NULL, 0);
+	assert(6000 == tds_bytearray_len(arr));
+
+	bytes = tds_bytearray_force_extend(arr, 3);
+	memcpy(bytes, "xyz", 3);
+	assert(6003 == tds_bytearray_len(arr));
+	assert(0 == memcmp(tds_bytearray_data(arr) + 6000, "xyz", 3));
+
+	tds_bytearray_clear(arr);
+	assert(0 == tds_bytearray_len(arr));
+	assert(1 == tds_bytearray_reserve(arr, 100000));
+	assert(100000 <= tds_bytearray_capacity(arr));
+	tds_bytearray_free(arr);
+}
+
+/* testing
+ * 	- tds_bytearray_force_put_le
+ * 	- tds_bytearray_force_put_be
+ * 	- tds_bytearray_set_le
+ * 	- tds_bytearray_set_be
+ * 	- tds_bytearray_slice
+ * 	- tds_byteslice_get_le
+ * 	- tds_byteslice_get_be
+ */
+void test_endian(void)
+{
+	const unsigned char expected[] = {
+		0x01, 0x02, 0x03, 0x04,  /* 0x04030201 LE */
+		0x04, 0x03, 0x02, 0x01,  /* 0x04030201 BE */
+		0xAB,                    /* 1 byte */
+		0x00, 0x00, 0x00,        /* 24-bit BE length, set below */
+	};
+	tds_bytearray *arr = tds_bytearray_force_create_g(4, NULL);
+	tds_byteslice s;
+	uint64_t value = 0x0102030405060708ULL;
+	size_t nbytes = 0;
+
+	tds_bytearray_force_put_le(arr, 0x04030201, 4);
+	tds_bytearray_force_put_be(arr, 0x04030201, 4);
+	tds_bytearray_force_put_le(arr, 0x12AB, 1);  /* the lowest byte */
+	tds_bytearray_force_put_be(arr, 0, 3);
+	assert(sizeof(expected) == tds_bytearray_len(arr));
+	tds_bytearray_set_be(arr, 9, 0x123456, 3);
+	assert(0 == memcmp(tds_bytearray_data(arr), expected, 9));
+	assert(0x12 == tds_bytearray_data(arr)[9]);
+
+	s = tds_bytearray_slice(arr, 0, tds_bytearray_len(arr));
+	assert(0x04030201 == tds_byteslice_get_le(s, 0, 4));
+	assert(0x01020304 == tds_byteslice_get_be(s, 0, 4));
+	assert(0x04030201 == tds_byteslice_get_be(s, 4, 4));
+	assert(0x123456 == tds_byteslice_get_be(s, 9, 3));
+	assert(0x563412 == tds_byteslice_get_le(s, 9, 3));
+
+	/* every width, both orders */
+	tds_bytearray_clear(arr);
+	for (nbytes = 1; nbytes <= 8; nbytes++) {
+		tds_bytearray_force_put_le(arr, value, nbytes);
+		tds_bytearray_force_put_be(arr, value, nbytes);
+	}
+	s = tds_bytearray_slice(arr, 0, tds_bytearray_len(arr));
+	for (nbytes = 1; nbytes <= 8; nbytes++) {
+		uint64_t low = nbytes < 8 ? value & (((uint64_t) 1 << (8 * nbytes)) - 1) : value;
+		size_t pos = nbytes * (nbytes - 1);  /* 2 * (1 + ... + nbytes - 1) */
+
+		assert(low == tds_byteslice_get_le(s, pos, nbytes));
+		assert(low == tds_byteslice_get_be(s, pos + nbytes, nbytes));
+	}
+	tds_bytearray_set_le(arr, 0, 0xFF, 1);
+	assert(0xFF == tds_bytearray_data(arr)[0]);
+	tds_bytearray_free(arr);
+}
+
+/* testing
+ * 	- tds_bytearray_force_put_varint
+ * 	- tds_bytearray_force_put_svarint
+ * 	- tds_byteslice_get_varint
+ * 	- tds_byteslice_get_svarint
+ */
+void test_varint(void)
+{
+	const uint64_t values[] = {0, 1, 127, 128, 300, 16383, 16384, 0xFFFFFFFFULL,
+		0x7FFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL};
+	const size_t lens[] = {1, 1, 1, 2, 2, 2, 3, 5, 9, 10};
+	const int64_t svalues[] = {0, -1, 1, -64, 64, INT64_MIN, INT64_MAX};
+	const size_t slens[] = {1, 1, 1, 1, 2, 10, 10};
+	const unsigned char overflow[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x02};
+	tds_bytearray *arr = tds_bytearray_force_create();
+	tds_byteslice s;
+	size_t pos = 0;
+	size_t idx = 0;
+	uint64_t value = 0;
+	int64_t svalue = 0;
+
+	for (idx = 0; idx < sizeof(values) / sizeof(values[0]); idx++)
+		tds_bytearray_force_put_varint(arr, values[idx]);
+	for (idx = 0; idx < sizeof(svalues) / sizeof(svalues[0]); idx++)
+		tds_bytearray_force_put_svarint(arr, svalues[idx]);
+	s = tds_bytearray_slice(arr, 0, tds_bytearray_len(arr));
+	for (idx = 0; idx < sizeof(values) / sizeof(values[0]); idx++) {
+		assert(lens[idx] == tds_byteslice_get_varint(s, pos, &value));
+		assert(values[idx] == value);
+		pos += lens[idx];
+	}
+	for (idx = 0; idx < sizeof(svalues) / sizeof(svalues[0]); idx++) {
+		assert(slens[idx] == tds_byteslice_get_svarint(s, pos, &svalue));
+		assert(svalues[idx] == svalue);
+		pos += slens[idx];
+	}
+	assert(pos == s.len);
+	assert(0 == tds_byteslice_get_varint(s, pos, &value));  /* at the end */
+
+	/* 128 truncated after its first byte */
+	assert(0 == tds_byteslice_get_varint(tds_byteslice_sub(s, 3, 1), 0, &value));
+	assert(0 == tds_byteslice_get_varint(tds_byteslice_make(overflow, sizeof(overflow)), 0, &value));
+	assert(0 == tds_byteslice_get_varint(tds_byteslice_make(overflow, 9), 0, &value));
+	tds_bytearray_free(arr);
+}
+
+int main(void)
+{
+	test_bytearray();
+	test_endian();
+	test_varint();
+	return 0;
+}
@@ -0,0 +1,190 @@
+#include <tds/cbitarray.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NTHREAD  8
+#define NSLOT    1000  /* slots claimed by each thread */
+
+/* testing
+ * 	- tds_cbitarray_force_create
+ * 	- tds_cbitarray_capacity
+ * 	- tds_cbitarray_get
+ * 	- tds_cbitarray_set
+ * 	- tds_cbitarray_test_and_set
+ * 	- tds_cbitarray_test_and_clear
+ * 	- tds_cbitarray_load_word
+ * 	- tds_cbitarray_fetch_or
+ * 	- tds_cbitarray_fetch_and
+ * 	- tds_cbitarray_popcount
+ * 	- tds_cbitarray_free
+ */
+void test_cbitarray(void)
+{
+	tds_cbitarray *arr = tds_cbitarray_force_create(100);
+
+	assert(128 == tds_cbitarray_capacity(arr));
+	assert(0 == tds_cbitarray_popcount(arr));
+
+	tds_cbitarray_set(arr, 3, 1);
+	assert(1 == tds_cbitarray_get(arr, 3));
+	assert(0 == tds_cbitarray_get(arr, 4));
+	tds_cbitarray_set(arr, 3, 0);
+	assert(0 == tds_cbitarray_get(arr, 3));
+
+	assert(0 == tds_cbitarray_test_and_set(arr, 70));
+	assert(1 == tds_cbitarray_test_and_set(arr, 70));
+	assert(1 == tds_cbitarray_test_and_clear(arr, 70));
+	assert(0 == tds_cbitarray_test_and_clear(arr, 70));
+
+	assert(0 == tds_cbitarray_fetch_or(arr, 1, 0xF0));
+	assert(0xF0 == tds_cbitarray_fetch_or(arr, 1, 0x0F));
+	assert(0xFF == tds_cbitarray_fetch_and(arr, 1, 0x3C));
+	assert(0x3C == tds_cbitarray_load_word(arr, 1));
+	assert(1 == tds_cbitarray_get(arr, 64 + 2));
+	assert(4 == tds_cbitarray_popcount(arr));
+	tds_cbitarray_free(arr);
+}
+
+/* testing
+ * 	- tds_cbitarray_claim
+ * 	- tds_cbitarray_release
+ */
+void test_claim(void)
+{
+	tds_cbitarray *arr = tds_cbitarray_force_create(130);
+	size_t loc = 0;
+
+	for (loc = 0; loc < 192; loc++)
+		assert(loc == tds_cbitarray_claim(arr));
+	assert(192 == tds_cbitarray_claim(arr));  /* full */
+
+	/* the search wraps around after the word of the last claim */
+	tds_cbitarray_release(arr, 5);
+	tds_cbitarray_release(arr, 150);
+	assert(150 == tds_cbitarray_claim(arr));
+	assert(5 == tds_cbitarray_claim(arr));
+	assert(192 == tds_cbitarray_claim(arr));
+	assert(192 == tds_cbitarray_popcount(arr));
+	tds_cbitarray_free(arr);
+}
+
+struct pool {
+	tds_cbitarray *used;
+	int owner[NTHREAD * NSLOT];  /* written by the thread holding the slot */
+	size_t won[NTHREAD];         /* bits cleared by each thread */
+};
+
+struct worker {
+	struct pool *pool;
+	int id;
+};
+
+/* Claim slots, check that no other thread holds them, release half of them
+ * and claim again
+ */
+static void *claim_worker(void *ctx)
+{
+	struct worker *w = (struct worker *) ctx;
+	struct pool *pool = w->pool;
+	size_t mine[NSLOT];
+	size_t idx = 0;
+	int round = 0;
+
+	for (round = 0; round < 20; round++) {
+		for (idx = round ? NSLOT / 2 : 0; idx < NSLOT; idx++) {
+			mine[idx] = tds_cbitarray_claim(pool->used);
+			assert(mine[idx] < NTHREAD * NSLOT);
+			assert(0 == pool->owner[mine[idx]]);
+			pool->owner[mine[idx]] = w->id;
+		}
+		for (idx = NSLOT / 2; idx < NSLOT; idx++) {
+			assert(w->id == pool->owner[mine[idx]]);
+			pool->owner[mine[idx]] = 0;
+			tds_cbitarray_release(pool->used, mine[idx]);
+		}
+	}
+	return NULL;
+}
+
+/* Every thread sets its own bits of every word
+ */
+static void *set_worker(void *ctx)
+{
+	struct worker *w = (struct worker *) ctx;
+	size_t capacity = tds_cbitarray_capacity(w->pool->used);
+	size_t loc = 0;
+
+	for (loc = (size_t) (w->id - 1); loc < capacity; loc += NTHREAD)
+		tds_cbitarray_set(w->pool->used, loc, 1);
+	return NULL;
+}
+
+/* Every thread races for every bit, each bit is won by a single thread
+ */
+static void *clear_worker(void *ctx)
+{
+	struct worker *w = (struct worker *) ctx;
+	size_t capacity = tds_cbitarray_capacity(w->pool->used);
+	size_t loc = 0;
+
+	for (loc = 0; loc < capacity; loc++)
+		w->pool->won[w->id - 1] += (size_t) tds_cbitarray_test_and_clear(w->pool->used, loc);
+	return NULL;
+}
+
+static void run(struct pool *pool, void *(*fn)(void *))
+{
+	pthread_t threads[NTHREAD];
+	struct worker workers[NTHREAD];
+	int idx = 0;
+
+	for (idx = 0; idx < NTHREAD; idx++) {
+		workers[idx].pool = pool;
+		workers[idx].id = idx + 1;
+		assert(0 == pthread_create(&threads[idx], NULL, fn, &workers[idx]));
+	}
+	for (idx = 0; idx < NTHREAD; idx++)
+		assert(0 == pthread_join(threads[idx], NULL));
+}
+
+/* testing
+ * 	- tds_cbitarray_claim, concurrent
+ * 	- tds_cbitarray_release, concurrent
+ * 	- tds_cbitarray_set, concurrent
+ * 	- tds_cbitarray_test_and_clear, concurrent
+ */
+void test_threads(void)
+{
+	struct pool *pool = (struct pool *) calloc(1, sizeof(struct pool));
+	size_t won = 0;
+	int idx = 0;
+
+	pool->used = tds_cbitarray_force_create(NTHREAD * NSLOT);
+	run(pool, claim_worker);
+	assert(NTHREAD * NSLOT / 2 == tds_cbitarray_popcount(pool->used));
+	tds_cbitarray_free(pool->used);
+
+	/* no update of a shared word is lost */
+	pool->used = tds_cbitarray_force_create(NTHREAD * NSLOT);
+	run(pool, set_worker);
+	assert(tds_cbitarray_capacity(pool->used) == tds_cbitarray_popcount(pool->used));
+	run(pool, clear_worker);
+	assert(0 == tds_cbitarray_popcount(pool->used));
+	for (idx = 0; idx < NTHREAD; idx++)
+		won += pool->won[idx];
+	assert(tds_cbitarray_capacity(pool->used) == won);
+	tds_cbitarray_free(pool->used);
+	free(pool);
+}
+
+int main(void)
+{
+	test_cbitarray();
+	test_claim();
+	test_threads();
+	return 0;
+}
@@ -0,0 +1,216 @@
+#include <tds/chashtbl.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* key, value and a check word that must always be `~value` */
+struct pair {
+	size_t __key;
+	size_t __value;
+	size_t __check;
+};
+
+static struct pair make_pair(size_t key, size_t value)
+{
+	struct pair p;
+	p.__key = key;
+	p.__value = value;
+	p.__check = ~value;
+	return p;
+}
+
+/* All keys land on the same segment and slot
+ */
+uint64_t fconst(const void *key, size_t len, uint64_t seed)
+{
+	return 42;
+}
+
+/* testing
+ * 	- tds_chashtbl_force_create
+ * 	- tds_chashtbl_force_set
+ * 	- tds_chashtbl_get
+ * 	- tds_chashtbl_contains
+ * 	- tds_chashtbl_rm
+ * 	- tds_chashtbl_usage
+ */
+void test_chashtbl(void)
+{
+	size_t npairs = 100000;
+	size_t idx = 0;
+	struct pair p;
+	tds_chashtbl *tbl = tds_chashtbl_force_create(sizeof(struct pair), sizeof(size_t));
+
+	for (idx = 0; idx < npairs; idx++) {
+		p = make_pair(idx, idx);
+		tds_chashtbl_force_set(tbl, &p);
+	}
+	for (idx = 0; idx < npairs; idx += 3) {  /* update */
+		p = make_pair(idx, idx + 1);
+		tds_chashtbl_force_set(tbl, &p);
+	}
+	assert(tds_chashtbl_usage(tbl) == npairs);
+	assert(tds_chashtbl_load_factor(tbl) <= 0.75);
+
+	for (idx = 0; idx < npairs; idx += 2)
+		assert(1 == tds_chashtbl_rm(tbl, &idx));
+	assert(0 == tds_chashtbl_rm(tbl, &npairs));
+	assert(tds_chashtbl_usage(tbl) == npairs / 2);
+
+	for (idx = 0; idx < npairs; idx++) {
+		if (idx % 2 == 0) {
+			assert(!tds_chashtbl_contains(tbl, &idx));
+			continue;
+		}
+		assert(1 == tds_chashtbl_get(tbl, &idx, &p));
+		assert(p.__key == idx && p.__value == (idx % 3 == 0 ? idx + 1 : idx));
+	}
+	tds_chashtbl_free(tbl);
+}
+
+/* testing
+ * 	- tds_chashtbl_force_create_h
+ * 	- tombstones and their reuse inside one cluster
+ */
+void test_chashtbl_cluster(void)
+{
+	size_t npairs = 200;
+	size_t idx = 0;
+	size_t round = 0;
+	size_t capacity = 0;
+	struct pair p;
+	tds_chashtbl *tbl = tds_chashtbl_force_create_h(sizeof(struct pair), sizeof(size_t), 0, fconst, NULL);
+
+	for (idx = 0; idx < npairs; idx++) {
+		p = make_pair(idx, idx);
+		tds_chashtbl_force_set(tbl, &p);
+	}
+	for (round = 0; round < 4; round++) {  /* erase from the middle, then the head */
+		for (idx = round * npairs / 4 + 1; idx < (round + 1) * npairs / 4; idx += 2)
+			assert(1 == tds_chashtbl_rm(tbl, &idx));
+		idx = round * npairs / 4;
+		assert(1 == tds_chashtbl_rm(tbl, &idx));
+	}
+	for (idx = 0; idx < npairs; idx++) {
+		int removed = idx % (npairs / 4) == 0 || idx % 2 == 1;
+		assert(removed == !tds_chashtbl_get(tbl, &idx, &p));
+		assert(removed || p.__value == idx);
+	}
+	capacity = tds_chashtbl_capacity(tbl);
+	for (idx = 0; idx < npairs; idx++) {  /* refill the tombstones */
+		p = make_pair(idx, idx + 1);
+		tds_chashtbl_force_set(tbl, &p);
+	}
+	assert(tds_chashtbl_capacity(tbl) == capacity);
+	assert(tds_chashtbl_usage(tbl) == npairs);
+	for (idx = 0; idx < npairs; idx++) {
+		assert(1 == tds_chashtbl_get(tbl, &idx, &p));
+		assert(p.__key == idx && p.__value == idx + 1);
+	}
+	tds_chashtbl_free(tbl);
+}
+
+/* testing
+ * 	- resizing that only drops the tombstones
+ */
+void test_chashtbl_churn(void)
+{
+	size_t nlive = 1000;
+	size_t nrounds = 200;
+	size_t idx = 0;
+	struct pair p;
+	tds_chashtbl *tbl = tds_chashtbl_force_create(sizeof(struct pair), sizeof(size_t));
+
+	for (idx = 0; idx < nlive; idx++) {
+		p = make_pair(idx, idx);
+		tds_chashtbl_force_set(tbl, &p);
+	}
+	for (idx = nlive; idx < nlive * nrounds; idx++) {  /* a sliding window of keys */
+		size_t old = idx - nlive;
+		p = make_pair(idx, idx);
+		tds_chashtbl_force_set(tbl, &p);
+		assert(1 == tds_chashtbl_rm(tbl, &old));
+	}
+	assert(tds_chashtbl_usage(tbl) == nlive);
+	assert(tds_chashtbl_capacity(tbl) <= 16 * nlive);  /* not following the keys ever set */
+	for (idx = nlive * (nrounds - 1); idx < nlive * nrounds; idx++) {
+		assert(1 == tds_chashtbl_get(tbl, &idx, &p));
+		assert(p.__key == idx && p.__value == idx);
+	}
+	tds_chashtbl_free(tbl);
+}
+
+#define nthreads  4
+#define nkeys     20000
+
+struct worker {
+	tds_chashtbl *__tbl;
+	size_t __id;
+	size_t __torn;
+};
+
+/* Each worker owns the keys `k` with `k % nthreads == id`, it inserts,
+ * updates and removes them while reading the keys of the other workers
+ */
+static void *work(void *_arg)
+{
+	struct worker *w = (struct worker *) _arg;
+	size_t round = 0;
+	size_t key = 0;
+	struct pair p;
+
+	for (round = 0; round < 4; round++) {
+		for (key = w->__id; key < nkeys; key += nthreads) {
+			size_t other = (key + 1) % nkeys;
+			p = make_pair(key, key + round);
+			tds_chashtbl_force_set(w->__tbl, &p);
+			if (round < 3 && key % 5 == 0)
+				tds_chashtbl_rm(w->__tbl, &key);
+			if (tds_chashtbl_get(w->__tbl, &other, &p)
+			 && (p.__key != other || p.__check != ~p.__value))
+				w->__torn++;
+		}
+	}
+	return NULL;
+}
+
+/* testing
+ * 	- concurrent set, get and rm with segment growth
+ */
+void test_chashtbl_threads(void)
+{
+	pthread_t threads[nthreads];
+	struct worker workers[nthreads];
+	tds_chashtbl *tbl = tds_chashtbl_force_create(sizeof(struct pair), sizeof(size_t));
+	size_t idx = 0;
+	struct pair p;
+
+	for (idx = 0; idx < nthreads; idx++) {
+		workers[idx].__tbl = tbl;
+		workers[idx].__id = idx;
+		workers[idx].__torn = 0;
+		assert(0 == pthread_create(threads + idx, NULL, work, workers + idx));
+	}
+	for (idx = 0; idx < nthreads; idx++) {
+		pthread_join(threads[idx], NULL);
+		assert(0 == workers[idx].__torn);
+	}
+	assert(tds_chashtbl_usage(tbl) == nkeys);
+	for (idx = 0; idx < nkeys; idx++) {
+		assert(1 == tds_chashtbl_get(tbl, &idx, &p));
+		assert(p.__value == idx + 3);
+	}
+	tds_chashtbl_free(tbl);
+}
+
+int main(void)
+{
+	test_chashtbl();
+	test_chashtbl_cluster();
+	test_chashtbl_churn();
+	test_chashtbl_threads();
+	return 0;
+}
@@ -0,0 +1,135 @@
+#include <tds/cuckootbl.h>
+#include <ta/hash.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* testing
+ * 	- tds_cuckootbl_force_create_w
+ * 	- tds_cuckootbl_free
+ *
+ * 	- tds_cuckootbl_force_set
+ * 	- tds_cuckootbl_get
+ * 	- tds_cuckootbl_contains
+ * 	- tds_cuckootbl_rm
+ * 	- tds_cuckootbl_load_factor
+ */
+void test_cuckootbl(void)
+{
+	int ways[2] = {4, 8};
+	size_t npairs = 200000;
+	size_t idx = 0;
+	size_t pair[2];
+	int w = 0;
+
+	for (w = 0; w < 2; w++) {
+		double max_load = 0;
+		tds_cuckootbl *tbl = tds_cuckootbl_force_create_w(sizeof(pair), sizeof(size_t), \
+			0, ta_hash_wy, ways[w], NULL);
+
+		for (idx = 0; idx < npairs; idx++) {
+			pair[0] = idx;  /* the first key is all-zero */
+			pair[1] = idx;
+			tds_cuckootbl_force_set(tbl, pair);
+			if (tds_cuckootbl_load_factor(tbl) > max_load)
+				max_load = tds_cuckootbl_load_factor(tbl);
+		}
+		assert(max_load > 0.9);
+		assert(tds_cuckootbl_usage(tbl) == npairs);
+		for (idx = 0; idx < npairs; idx += 3) {  /* update */
+			pair[0] = idx;
+			pair[1] = idx + 1;
+			tds_cuckootbl_force_set(tbl, pair);
+		}
+		assert(tds_cuckootbl_usage(tbl) == npairs);
+		for (idx = 0; idx < npairs; idx += 2) {
+			assert(1 == tds_cuckootbl_rm(tbl, &idx));
+			assert(0 == tds_cuckootbl_rm(tbl, &idx));
+		}
+		assert(tds_cuckootbl_usage(tbl) == npairs / 2);
+		for (idx = 0; idx < 2 * npairs; idx++) {
+			size_t *value_p = (size_t *) tds_cuckootbl_get(tbl, &idx);
+			if (idx >= npairs || idx % 2 == 0) {
+				assert(NULL == value_p);
+				assert(!tds_cuckootbl_contains(tbl, &idx));
+			} else
+				assert(NULL != value_p && value_p[1] == (idx % 3 == 0 ? idx + 1 : idx));
+		}
+		tds_cuckootbl_free(tbl);
+	}
+}
+
+uint64_t fconst(const void *key, size_t len, uint64_t seed)
+{
+	return 42;
+}
+
+/* testing
+ * 	- tds_cuckootbl_stash_usage
+ * 	- failure of tds_cuckootbl_set when all keys collide
+ */
+void test_cuckootbl_stash(void)
+{
+	size_t idx = 0;
+	size_t pair[2];
+	tds_cuckootbl *tbl = tds_cuckootbl_force_create_h(sizeof(pair), sizeof(size_t), 0, fconst, NULL);
+
+	/* two buckets of 4 slots, then the stash */
+	for (idx = 0; idx < 16; idx++) {
+		pair[0] = idx;
+		pair[1] = idx + 1;
+		assert(1 == tds_cuckootbl_set(tbl, pair));
+	}
+	assert(8 == tds_cuckootbl_stash_usage(tbl));
+	pair[1] = 16;
+	assert(1 == tds_cuckootbl_set(tbl, pair));  /* an update never fails */
+	pair[0] = 16;
+	assert(0 == tds_cuckootbl_set(tbl, pair));
+	assert(16 == tds_cuckootbl_usage(tbl));
+
+	for (idx = 0; idx < 16; idx++)
+		assert(idx + 1 == ((size_t *) tds_cuckootbl_get(tbl, &idx))[1]);
+	for (idx = 0; idx < 16; idx += 2)
+		assert(1 == tds_cuckootbl_rm(tbl, &idx));
+	for (idx = 0; idx < 16; idx++)
+		assert((idx % 2 == 0) == (NULL == tds_cuckootbl_get(tbl, &idx)));
+	tds_cuckootbl_free(tbl);
+}
+
+/* testing
+ * 	- a bucket of 64 bytes is one cache line: 8 ways of 7-byte pairs after
+ * 	  8 bytes of fingerprints
+ */
+void test_cuckootbl_lines(void)
+{
+	tds_cuckootbl *tbl = tds_cuckootbl_force_create_w(7, 4, 4096, ta_hash_wy, 8, NULL);
+	char pair[7];
+	uint32_t idx = 0;
+
+	for (idx = 0; idx < 1000; idx++) {
+		memcpy(pair, &idx, 4);
+		memset(pair + 4, (int) idx, 3);
+		tds_cuckootbl_force_set(tbl, pair);
+	}
+	assert(0 == tds_cuckootbl_stash_usage(tbl));
+	for (idx = 0; idx < 1000; idx++) {
+		const char *found = (const char *) tds_cuckootbl_get(tbl, &idx);
+		size_t offset = (size_t) ((uintptr_t) found % 64);
+
+		assert(NULL != found && (char) idx == found[6]);
+		assert(offset >= 8 && 0 == (offset - 8) % 7);
+	}
+	tds_cuckootbl_free(tbl);
+}
+
+int main(void)
+{
+	test_cuckootbl();
+	test_cuckootbl_stash();
+	test_cuckootbl_lines();
+	return 0;
+}
@@ -51,7 +51,7 @@ void test_worst(void)
  */
 void test_best(void)
 {
-	tds_deque *q = tds_deque_create_g(sizeof(size_t), 16, 8);
+	tds_deque *q = tds_deque_create_g(sizeof(size_t), 16, 8, NULL);
 	size_t idx = 0;
 	size_t idx_front = 0;
 	size_t idx_back = 0;
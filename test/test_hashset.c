@@ -0,0 +1,138 @@
+#include <tds/hashset.h>
+#include <ta/hash.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct key24 {
+	uint64_t __a;
+	uint64_t __b;
+	uint64_t __c;
+};
+
+
+/* testing
+ * 	- tds_hashset_force_create
+ * 	- tds_hashset_free
+ *
+ * 	- tds_hashset_force_insert
+ * 	- tds_hashset_contains
+ * 	- tds_hashset_erase
+ * 	- tds_hashset_next
+ * 	- word keys of 4 and 8 bytes, memcmp keys of 24 bytes
+ */
+void test_hashset(void)
+{
+	size_t nkeys = 100000;
+	size_t idx = 0;
+	size_t loc = 0;
+	size_t count = 0;
+	const void *key = NULL;
+	tds_hashset *set32 = tds_hashset_force_create(sizeof(uint32_t));
+	tds_hashset *set64 = tds_hashset_force_create(sizeof(uint64_t));
+	tds_hashset *set24 = tds_hashset_force_create(sizeof(struct key24));
+
+	for (idx = 0; idx < nkeys; idx++) {
+		uint32_t k32 = (uint32_t) idx;  /* the first key is zero */
+		uint64_t k64 = (uint64_t) idx << 32;
+		struct key24 k24 = {0, 0, 0};
+		k24.__c = idx;
+		tds_hashset_force_insert(set32, &k32);
+		tds_hashset_force_insert(set64, &k64);
+		tds_hashset_force_insert(set24, &k24);
+		tds_hashset_force_insert(set24, &k24);  /* existing */
+	}
+	assert(nkeys == tds_hashset_usage(set32));
+	assert(nkeys == tds_hashset_usage(set64));
+	assert(nkeys == tds_hashset_usage(set24));
+
+	for (idx = 0; idx < nkeys; idx += 2) {
+		uint32_t k32 = (uint32_t) idx;
+		uint64_t k64 = (uint64_t) idx << 32;
+		struct key24 k24 = {0, 0, 0};
+		k24.__c = idx;
+		assert(1 == tds_hashset_erase(set32, &k32));
+		assert(0 == tds_hashset_erase(set32, &k32));
+		assert(1 == tds_hashset_erase(set64, &k64));
+		assert(1 == tds_hashset_erase(set24, &k24));
+	}
+	for (idx = 0; idx < 2 * nkeys; idx++) {
+		uint32_t k32 = (uint32_t) idx;
+		uint64_t k64 = (uint64_t) idx << 32;
+		struct key24 k24 = {0, 0, 0};
+		int expected = idx < nkeys && idx % 2 == 1;
+		k24.__c = idx;
+		assert(expected == tds_hashset_contains(set32, &k32));
+		assert(expected == tds_hashset_contains(set64, &k64));
+		assert(expected == tds_hashset_contains(set24, &k24));
+	}
+
+	while (NULL != (key = tds_hashset_next(set32, &loc))) {
+		uint32_t k32 = 0;
+		memcpy(&k32, key, sizeof(k32));
+		assert(k32 % 2 == 1);
+		count++;
+	}
+	assert(nkeys / 2 == count);
+	tds_hashset_free(set32);
+	tds_hashset_free(set64);
+	tds_hashset_free(set24);
+}
+
+/* testing
+ * 	- tds_hashset_union
+ * 	- tds_hashset_intersection
+ * 	- tds_hashset_difference
+ */
+void test_hashset_algebra(void)
+{
+	size_t n = 30000;
+	size_t idx = 0;
+	int op = 0;
+
+	for (op = 0; op < 4; op++) {
+		tds_hashset *a = tds_hashset_force_create(sizeof(size_t));
+		tds_hashset *b = tds_hashset_force_create(sizeof(size_t));
+
+		/* a: multiples of 2, b: multiples of 3 */
+		for (idx = 0; idx < n; idx += 2)
+			tds_hashset_force_insert(a, &idx);
+		for (idx = 0; idx < n; idx += 3)
+			tds_hashset_force_insert(b, &idx);
+
+		if (0 == op)
+			assert(1 == tds_hashset_union(a, b));  /* iterate `b`, insert into `a` */
+		else if (1 == op)
+			tds_hashset_intersection(a, b);  /* filter `a` by membership in `b` */
+		else if (2 == op)
+			tds_hashset_difference(a, b);  /* iterate `b`, the smaller, erase from `a` */
+		else {
+			tds_hashset_force_insert(b, &n);
+			tds_hashset_difference(b, a);  /* filter `b`, the smaller, by membership in `a` */
+		}
+		for (idx = 0; idx < n; idx++) {
+			int in_a = idx % 2 == 0;
+			int in_b = idx % 3 == 0;
+			if (0 == op)
+				assert((in_a || in_b) == tds_hashset_contains(a, &idx));
+			else if (1 == op)
+				assert((in_a && in_b) == tds_hashset_contains(a, &idx));
+			else if (2 == op)
+				assert((in_a && !in_b) == tds_hashset_contains(a, &idx));
+			else
+				assert((in_b && !in_a) == tds_hashset_contains(b, &idx));
+		}
+		tds_hashset_free(a);
+		tds_hashset_free(b);
+	}
+}
+
+int main(void)
+{
+	test_hashset();
+	test_hashset_algebra();
+	return 0;
+}
@@ -1,8 +1,11 @@
 #include <tds/hashtbl.h>
+#include <tds/arraylist.h>
 #include <tds/string.h>
+#include <ta/hash.h>
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define buffersize 16
@@ -30,13 +33,9 @@ void test_hashtable(void)
 	size_t npairs = 1000;  /* number of pairs */
 	size_t idx = 0;
 
-	tds_string *key_tstr = tds_string_create_g(buffersize);
-	tds_hashtbl *tbl = tds_hashtbl_force_create_g(sizeof(struct pair), buffersize, npairs / 10);
+	tds_string *key_tstr = tds_string_create_g(buffersize, NULL);
+	tds_hashtbl *tbl = tds_hashtbl_force_create_g(sizeof(struct pair), buffersize, npairs / 10, NULL);
 
-#ifdef __tds_debug
-	printf("Number of conflictions = %lu / %lu\n", __tds_hashtbl_get_n_conflicts(tbl), npairs);
-	__tds_hashtbl_reset_n_conflicts(tbl);
-#endif
 	for (idx = 0; idx < npairs; idx++) {
 		const char *key_cstr;
 		struct pair p;
@@ -49,10 +48,6 @@ void test_hashtable(void)
 		tds_hashtbl_force_set(tbl, &p);
 		tds_string_clear(key_tstr);
 	}
-#ifdef __tds_debug
-	printf("Number of conflictions = %lu / %lu\n", __tds_hashtbl_get_n_conflicts(tbl), npairs);
-	__tds_hashtbl_reset_n_conflicts(tbl);
-#endif
 	printf("\nCapacity = %lu\n", tds_hashtbl_capacity(tbl));
 	printf("Load factor = %f\n", tds_hashtbl_load_factor(tbl));
 	assert(tds_hashtbl_usage(tbl) == npairs);
@@ -61,7 +56,7 @@ void test_hashtable(void)
 	tds_string_force_append_cstr(key_tstr, __base, 7);
 	tds_string_force_append_int64(key_tstr, 0);
 	assert(1 == tds_hashtbl_rm(tbl, tds_string_cstr(key_tstr)));
-	assert(tds_hashtbl_usage(tbl) == npairs);
+	assert(tds_hashtbl_usage(tbl) == npairs - 1);
 	tds_string_clear(key_tstr);
 
 	/* test get */
@@ -76,15 +71,809 @@ void test_hashtable(void)
 		assert(idx == value_p->__data);
 		tds_string_clear(key_tstr);
 	}
-#ifdef __tds_debug
-	printf("Number of conflictions = %lu / %lu\n", __tds_hashtbl_get_n_conflicts(tbl), npairs);
-	__tds_hashtbl_reset_n_conflicts(tbl);
-#endif
+	tds_hashtbl_free(tbl);
+	tds_string_free(key_tstr);
+}
+
+/* FNV-1a, a user defined hash function
+ */
+uint64_t fnv1a(const void *key, size_t len, uint64_t seed)
+{
+	uint64_t code = 0xcbf29ce484222325ull ^ seed;
+	const unsigned char *p = (const unsigned char *) key;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		code ^= p[i];
+		code *= 0x100000001b3ull;
+	}
+	return code;
+}
+
+/* testing
+ * 	- tds_hashtbl_force_create_h
+ * 	- tds_hashtbl_seed
+ * 	- tds_hashtbl_force_set
+ * 	- tds_hashtbl_get
+ */
+void test_hashtable_fhash(void)
+{
+	size_t npairs = 1000;
+	size_t idx = 0;
+	tds_hashtbl *tbl = tds_hashtbl_force_create_h(sizeof(struct pair), buffersize, 0, fnv1a, NULL);
+	tds_hashtbl *tbl2 = tds_hashtbl_force_create(sizeof(struct pair), buffersize);
+
+	/* seeds are drawn independently */
+	assert(tds_hashtbl_seed(tbl) != tds_hashtbl_seed(tbl2));
+
+	for (idx = 0; idx < npairs; idx++) {
+		struct pair p;
+		memset(p.__key, 0, buffersize);
+		sprintf(p.__key, "%s%lu", __base, (unsigned long) idx);
+		p.__data = idx;
+		tds_hashtbl_force_set(tbl, &p);
+	}
+	assert(tds_hashtbl_usage(tbl) == npairs);
+
+	for (idx = 0; idx < npairs; idx++) {
+		char key[buffersize];
+		struct pair *value_p;
+		memset(key, 0, buffersize);
+		sprintf(key, "%s%lu", __base, (unsigned long) idx);
+		value_p = (struct pair *) tds_hashtbl_get(tbl, key);
+		assert(NULL != value_p);
+		assert(idx == value_p->__data);
+		assert(NULL == tds_hashtbl_get(tbl2, key));
+	}
+	tds_hashtbl_free(tbl);
+	tds_hashtbl_free(tbl2);
+}
+
+/* testing
+ * 	- ta_hash_poly
+ * 	- ta_hash_wy
+ * 	- ta_hash_u64
+ */
+void test_hash_fn(void)
+{
+	const char *key = "abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	uint64_t x = 123456789;
+	size_t len = 0;
+
+	assert(ta_hash_poly(key, 16, ta_hash_poly_base) == ta_hash_poly(key, 16, ta_hash_poly_base));
+
+	for (len = 0; len <= 62; len++) {
+		/* deterministic */
+		assert(ta_hash_wy(key, len, 7) == ta_hash_wy(key, len, 7));
+		/* sensitive to seed and length */
+		assert(ta_hash_wy(key, len, 7) != ta_hash_wy(key, len, 8));
+		if (len > 0)
+			assert(ta_hash_wy(key, len, 7) != ta_hash_wy(key, len - 1, 7));
+	}
+	assert(ta_hash_u64(x, 1) == ta_hash_u64(x, 1));
+	assert(ta_hash_u64(x, 1) != ta_hash_u64(x + 1, 1));
+	assert(ta_hash_u64(x, 1) != ta_hash_u64(x, 2));
+}
+
+/* The worst hash function, all keys collide
+ */
+uint64_t fconst(const void *key, size_t len, uint64_t seed)
+{
+	return 42;
+}
+
+/* testing
+ * 	- all-zero keys
+ * 	- set again after tds_hashtbl_rm
+ * 	- probing across groups when all keys collide
+ */
+void test_hashtable_ctrl(void)
+{
+	size_t npairs = 100;
+	size_t idx = 0;
+	size_t key = 0;
+	size_t pair[2];
+	tds_hashtbl *tbl = tds_hashtbl_force_create_h(sizeof(pair), sizeof(size_t), 0, fconst, NULL);
+
+	for (idx = 0; idx < npairs; idx++) {
+		pair[0] = idx;  /* the first key is all-zero */
+		pair[1] = idx + 1;
+		tds_hashtbl_force_set(tbl, pair);
+	}
+	for (idx = 0; idx < npairs; idx++) {
+		size_t *value_p = (size_t *) tds_hashtbl_get(tbl, &idx);
+		assert(NULL != value_p);
+		assert(value_p[1] == idx + 1);
+	}
+	assert(1 == tds_hashtbl_rm(tbl, &key));
+	assert(0 == tds_hashtbl_rm(tbl, &key));
+	assert(NULL == tds_hashtbl_get(tbl, &key));
+	pair[0] = 0;
+	pair[1] = 7;
+	tds_hashtbl_force_set(tbl, pair);
+	assert(7 == ((size_t *) tds_hashtbl_get(tbl, &key))[1]);
+	tds_hashtbl_free(tbl);
+}
+
+/* testing
+ * 	- tds_hashtbl_rm
+ * 	- tds_hashtbl_tombstones
+ * 	- tds_hashtbl_compact
+ */
+void test_hashtable_churn(void)
+{
+	size_t window = 1000;
+	size_t nrounds = 100000;
+	size_t idx = 0;
+	size_t capacity = 0;
+	tds_hashtbl *tbl = tds_hashtbl_force_create(sizeof(size_t), sizeof(size_t));
+
+	for (idx = 0; idx < window; idx++)
+		tds_hashtbl_force_set(tbl, &idx);
+	capacity = tds_hashtbl_capacity(tbl);
+
+	/* a sliding window of keys: insert one, delete the oldest */
+	for (idx = window; idx < nrounds; idx++) {
+		size_t old = idx - window;
+		tds_hashtbl_force_set(tbl, &idx);
+		assert(1 == tds_hashtbl_rm(tbl, &old));
+		assert(tds_hashtbl_usage(tbl) == window);
+	}
+	/* flat footprint: at most one expansion */
+	assert(tds_hashtbl_capacity(tbl) <= 2 * capacity);
+	for (idx = nrounds - window; idx < nrounds; idx++)
+		assert(NULL != tds_hashtbl_get(tbl, &idx));
+
+	/* shrink after mass deletion */
+	for (idx = nrounds - window; idx < nrounds - 10; idx++)
+		assert(1 == tds_hashtbl_rm(tbl, &idx));
+	assert(1 == tds_hashtbl_compact(tbl));
+	assert(0 == tds_hashtbl_tombstones(tbl));
+	assert(16 == tds_hashtbl_capacity(tbl));
+	assert(10 == tds_hashtbl_usage(tbl));
+	for (idx = nrounds - 10; idx < nrounds; idx++)
+		assert(NULL != tds_hashtbl_get(tbl, &idx));
+	tds_hashtbl_free(tbl);
+}
+
+/* testing
+ * 	- tds_hashtbl_force_create_m
+ * 	- tds_hashtbl_migrating
+ * 	- tds_hashtbl_migration_progress
+ * 	- tds_hashtbl_migrate
+ * 	- set, get and rm while migrating
+ */
+void test_hashtable_incremental(void)
+{
+	size_t npairs = 100000;
+	size_t idx = 0;
+	size_t nmigrating = 0;
+	size_t pair[2];
+	tds_hashtbl *tbl = tds_hashtbl_force_create_m(sizeof(pair), sizeof(size_t), \
+		0, ta_hash_wy, tds_hashtbl_mode_incremental, NULL);
+
+	for (idx = 0; idx < npairs; idx++) {
+		pair[0] = idx;
+		pair[1] = idx;
+		tds_hashtbl_force_set(tbl, pair);
+		assert(tds_hashtbl_migration_progress(tbl) >= 0.0);
+		assert(tds_hashtbl_migration_progress(tbl) <= 1.0);
+
+		if (tds_hashtbl_migrating(tbl)) {
+			size_t key = idx / 2;
+			nmigrating++;
+			/* pairs are reachable from both the old and new slots */
+			assert(key == ((size_t *) tds_hashtbl_get(tbl, &key))[0]);
+			assert(idx == ((size_t *) tds_hashtbl_get(tbl, &idx))[1]);
+		}
+		if (idx % 3 == 0) {  /* update */
+			pair[1] = idx + 1;
+			tds_hashtbl_force_set(tbl, pair);
+		}
+	}
+	assert(nmigrating > 0);
+	assert(tds_hashtbl_usage(tbl) == npairs);
+
+	for (idx = 0; idx < npairs; idx += 2) {
+		assert(1 == tds_hashtbl_rm(tbl, &idx));
+		assert(NULL == tds_hashtbl_get(tbl, &idx));  /* no stale copy */
+	}
+	assert(tds_hashtbl_usage(tbl) == npairs / 2);
+
+	while (0 != tds_hashtbl_migrate(tbl, 100))
+		;
+	assert(!tds_hashtbl_migrating(tbl));
+	for (idx = 0; idx < npairs; idx++) {
+		size_t *value_p = (size_t *) tds_hashtbl_get(tbl, &idx);
+		if (idx % 2 == 0)
+			assert(NULL == value_p);
+		else
+			assert(NULL != value_p && value_p[1] == (idx % 3 == 0 ? idx + 1 : idx));
+	}
+	tds_hashtbl_free(tbl);
+}
+
+static size_t __n_hashed = 0;
+
+uint64_t fcount(const void *key, size_t len, uint64_t seed)
+{
+	__n_hashed++;
+	return ta_hash_wy(key, len, seed);
+}
+
+/* testing
+ * 	- tds_hashtbl_mode_storehash, alone and with incremental resizing
+ * 	- resizing does not hash the keys again
+ */
+void test_hashtable_storehash(void)
+{
+	int modes[2] = {tds_hashtbl_mode_storehash, \
+		tds_hashtbl_mode_storehash | tds_hashtbl_mode_incremental};
+	size_t npairs = 20000;
+	size_t idx = 0;
+	int m = 0;
+	char pair[72];  /* 64-byte key + 8-byte value */
+
+	for (m = 0; m < 2; m++) {
+		tds_hashtbl *tbl = tds_hashtbl_force_create_m(sizeof(pair), 64, 0, fcount, modes[m], NULL);
+
+		__n_hashed = 0;
+		for (idx = 0; idx < npairs; idx++) {
+			memset(pair, 0, sizeof(pair));
+			sprintf(pair, "a rather long key of 64 bytes %lu", (unsigned long) idx);
+			memcpy(pair + 64, &idx, sizeof(size_t));
+			tds_hashtbl_force_set(tbl, pair);
+		}
+		assert(__n_hashed == npairs);  /* once per `set`, never by resizing */
+		assert(tds_hashtbl_usage(tbl) == npairs);
+
+		for (idx = 0; idx < npairs; idx += 2) {
+			memset(pair, 0, sizeof(pair));
+			sprintf(pair, "a rather long key of 64 bytes %lu", (unsigned long) idx);
+			assert(1 == tds_hashtbl_rm(tbl, pair));
+		}
+		assert(1 == tds_hashtbl_compact(tbl));
+		while (0 != tds_hashtbl_migrate(tbl, 100))
+			;
+		for (idx = 0; idx < npairs; idx++) {
+			char *found = NULL;
+			memset(pair, 0, sizeof(pair));
+			sprintf(pair, "a rather long key of 64 bytes %lu", (unsigned long) idx);
+			found = (char *) tds_hashtbl_get(tbl, pair);
+			if (idx % 2 == 0)
+				assert(NULL == found);
+			else
+				assert(NULL != found && 0 == memcmp(found + 64, &idx, sizeof(size_t)));
+		}
+		tds_hashtbl_free(tbl);
+	}
+}
+
+/* testing
+ * 	- tds_hashtbl_set_batch
+ * 	- tds_hashtbl_get_batch
+ */
+void test_hashtable_batch(void)
+{
+	size_t npairs = 10007;  /* not a multiple of the batch */
+	size_t idx = 0;
+	size_t *pairs = (size_t *) malloc(2 * npairs * sizeof(size_t));
+	size_t *keys = (size_t *) malloc(2 * npairs * sizeof(size_t));
+	void **out = (void **) malloc(2 * npairs * sizeof(void *));
+	tds_hashtbl *tbl = tds_hashtbl_force_create_m(2 * sizeof(size_t), sizeof(size_t), \
+		0, ta_hash_wy, tds_hashtbl_mode_incremental, NULL);
+
+	for (idx = 0; idx < npairs; idx++) {
+		pairs[2 * idx] = idx;
+		pairs[2 * idx + 1] = idx * 10;
+	}
+	tds_hashtbl_force_set_batch(tbl, pairs, npairs);
+	tds_hashtbl_force_set_batch(tbl, pairs, 1);  /* update */
+	assert(tds_hashtbl_usage(tbl) == npairs);
+	tds_hashtbl_get_batch(tbl, keys, 0, out);
+
+	for (idx = 0; idx < 2 * npairs; idx++)
+		keys[idx] = 2 * npairs - 1 - idx;  /* half of them are absent */
+	tds_hashtbl_get_batch(tbl, keys, 2 * npairs, out);
+	for (idx = 0; idx < 2 * npairs; idx++) {
+		if (keys[idx] < npairs)
+			assert(out[idx] == tds_hashtbl_get(tbl, &keys[idx])
+			    && ((size_t *) out[idx])[1] == keys[idx] * 10);
+		else
+			assert(NULL == out[idx]);
+	}
+	tds_hashtbl_free(tbl);
+	free(pairs);
+	free(keys);
+	free(out);
+}
+
+/* The decimal `idx` padded by `idx % 200` letters, return the length
+ */
+static size_t make_skey(char *key, size_t idx)
+{
+	size_t len = (size_t) sprintf(key, "%lu", (unsigned long) idx);
+	memset(key + len, 'a' + idx % 26, idx % 200 + 1);
+	return len + idx % 200;
+}
+
+/* testing
+ * 	- tds_hashtbl_force_create_s
+ * 	- tds_hashtbl_force_sset
+ * 	- tds_hashtbl_sset_tstr
+ * 	- tds_hashtbl_sget
+ * 	- tds_hashtbl_sget_tstr
+ * 	- tds_hashtbl_scontains
+ * 	- tds_hashtbl_srm
+ * 	- keys of any length, including the empty one
+ */
+void test_hashtable_strkey(void)
+{
+	int modes[2] = {0, tds_hashtbl_mode_incremental};
+	size_t npairs = 5000;
+	size_t idx = 0;
+	size_t round = 0;
+	int m = 0;
+	char key[256];
+	tds_string *key_tstr = tds_string_create();
+
+	for (m = 0; m < 2; m++) {
+		tds_hashtbl *tbl = tds_hashtbl_force_create_s(sizeof(size_t), 0, modes[m]);
+
+		/* the lengths of keys vary from 1 to 204 bytes */
+		for (round = 0; round < 3; round++) {
+			for (idx = 0; idx < npairs; idx++) {
+				size_t len = make_skey(key, idx);
+				size_t value = idx + round;
+				tds_hashtbl_force_sset(tbl, key, len, &value);
+			}
+			for (idx = round; idx < npairs; idx += 3) {  /* recycled in the arena */
+				size_t len = make_skey(key, idx);
+				assert(1 == tds_hashtbl_srm(tbl, key, len));
+				assert(0 == tds_hashtbl_srm(tbl, key, len));
+			}
+		}
+		assert(tds_hashtbl_usage(tbl) == npairs - npairs / 3);
+		assert(1 == tds_hashtbl_compact(tbl));
+
+		for (idx = 0; idx < npairs; idx++) {
+			size_t len = make_skey(key, idx);
+			size_t *value_p = NULL;
+			value_p = (size_t *) tds_hashtbl_sget(tbl, key, len);
+			if (idx % 3 == 2)
+				assert(NULL == value_p);
+			else
+				assert(NULL != value_p && *value_p == idx + 2);
+			assert(NULL == tds_hashtbl_sget(tbl, key, len + 1));  /* a prefix is not a match */
+		}
+
+		/* the empty key and `tds_string` */
+		idx = 42;
+		assert(!tds_hashtbl_scontains(tbl, "", 0));
+		tds_hashtbl_force_sset(tbl, "", 0, &idx);
+		assert(42 == *(size_t *) tds_hashtbl_sget(tbl, NULL, 0));
+		tds_string_force_append_cstr(key_tstr, "a key of tds_string", 19);
+		assert(1 == tds_hashtbl_sset_tstr(tbl, key_tstr, &idx));
+		assert(42 == *(size_t *) tds_hashtbl_sget_tstr(tbl, key_tstr));
+		assert(42 == *(size_t *) tds_hashtbl_sget(tbl, "a key of tds_string", 19));
+		tds_string_clear(key_tstr);
+		tds_hashtbl_free(tbl);
+	}
+	tds_string_free(key_tstr);
+}
+
+/* testing
+ * 	- tds_hashtbl_iter_begin
+ * 	- tds_hashtbl_iter_next
+ * 	- tds_hashtbl_iter_key
+ * 	- tds_hashtbl_export
+ * 	- each live pair is visited once, including while migrating
+ */
+void test_hashtable_iter(void)
+{
+	int modes[2] = {0, tds_hashtbl_mode_incremental};
+	size_t npairs = 3000;
+	size_t idx = 0;
+	size_t count = 0;
+	size_t pair[2];
+	size_t *pair_p = NULL;
+	size_t nkeys = 0;
+	char *seen = (char *) calloc(4 * npairs, 1);
+	tds_hashtbl_iter iter;
+	int m = 0;
+
+	for (m = 0; m < 2; m++) {
+		tds_hashtbl *tbl = tds_hashtbl_force_create_m(sizeof(pair), sizeof(size_t), 0, ta_hash_wy, modes[m], NULL);
+		tds_arraylist *list = tds_arraylist_force_create(sizeof(pair));
+
+		tds_hashtbl_iter_begin(tbl, &iter);
+		assert(NULL == tds_hashtbl_iter_next(tbl, &iter));
+		/* in the incremental mode, stop in the middle of a migration */
+		for (idx = 0; idx < npairs || (m == 1 && !tds_hashtbl_migrating(tbl)); idx++) {
+			pair[0] = idx;
+			pair[1] = idx * 2;
+			tds_hashtbl_force_set(tbl, pair);
+			if (idx % 4 == 0)
+				tds_hashtbl_rm(tbl, &idx);
+		}
+		nkeys = idx;
+
+		memset(seen, 0, 4 * npairs);
+		count = 0;
+		tds_hashtbl_iter_begin(tbl, &iter);
+		while (NULL != (pair_p = (size_t *) tds_hashtbl_iter_next(tbl, &iter))) {
+			assert(pair_p[0] < nkeys && pair_p[0] % 4 != 0 && !seen[pair_p[0]]);
+			assert(pair_p[1] == pair_p[0] * 2);
+			assert((const char *) pair_p == tds_hashtbl_iter_key(tbl, &iter, NULL));
+			seen[pair_p[0]] = 1;
+			count++;
+		}
+		assert(count == tds_hashtbl_usage(tbl));
+
+		assert(1 == tds_hashtbl_export(tbl, list));
+		assert(tds_arraylist_len(list) == count);
+		for (idx = 0; idx < count; idx++) {
+			pair_p = (size_t *) tds_arraylist_get(list, idx);
+			assert(pair_p[1] == ((size_t *) tds_hashtbl_get(tbl, pair_p))[1]);
+		}
+
+		if (m == 0) {  /* eviction sweep */
+			tds_hashtbl_iter_begin(tbl, &iter);
+			while (NULL != (pair_p = (size_t *) tds_hashtbl_iter_next(tbl, &iter)))
+				if (pair_p[0] % 2 == 1)
+					assert(1 == tds_hashtbl_rm(tbl, pair_p));
+			assert(tds_hashtbl_usage(tbl) == nkeys / 4);
+		}
+		tds_arraylist_free(list);
+		tds_hashtbl_free(tbl);
+	}
+
+	{  /* string-key mode */
+		tds_hashtbl *tbl = tds_hashtbl_force_create_s(sizeof(size_t), 0, 0);
+		const char *key = NULL;
+		size_t len = 0;
+
+		for (idx = 0; idx < 100; idx++) {
+			char buf[32];
+			size_t n = (size_t) sprintf(buf, "key %lu", (unsigned long) idx);
+			tds_hashtbl_force_sset(tbl, buf, n, &idx);
+		}
+		count = 0;
+		tds_hashtbl_iter_begin(tbl, &iter);
+		while (NULL != (pair_p = (size_t *) tds_hashtbl_iter_next(tbl, &iter))) {
+			char buf[32];
+			key = tds_hashtbl_iter_key(tbl, &iter, &len);
+			assert(len == (size_t) sprintf(buf, "key %lu", (unsigned long) *pair_p));
+			assert(0 == memcmp(key, buf, len));
+			count++;
+		}
+		assert(100 == count);
+		tds_hashtbl_free(tbl);
+	}
+	free(seen);
+}
+
+/* Read or overwrite `len` bytes at `off` of the file `path`
+ */
+static void file_read(const char *path, long off, void *data, size_t len)
+{
+	FILE *fp = fopen(path, "rb");
+
+	assert(NULL != fp && 0 == fseek(fp, off, SEEK_SET));
+	assert(len == fread(data, 1, len, fp));
+	fclose(fp);
+}
+
+static void file_write(const char *path, long off, const void *data, size_t len)
+{
+	FILE *fp = fopen(path, "r+b");
+
+	assert(NULL != fp && 0 == fseek(fp, off, SEEK_SET));
+	assert(len == fwrite(data, 1, len, fp));
+	fclose(fp);
+}
+
+/* testing
+ * 	- tds_hashtbl_save
+ * 	- tds_hashtbl_open_mmap
+ * 	- tds_hashtbl_open_mmap_h
+ * 	- the mapped table is read-only
+ * 	- invalid files are rejected
+ */
+void test_hashtable_mmap(void)
+{
+	const char *path = "test_hashtbl_mmap.tds";
+	size_t npairs = 20000;
+	size_t idx = 0;
+	size_t pair[2];
+	size_t *pair_p = NULL;
+	tds_hashtbl_iter iter;
+	FILE *fp = NULL;
+	uint64_t bad_off = (uint64_t) -8;  /* `bad_off + 16` wraps around */
+	uint64_t ctrl_off = 0;
+	uint64_t pairs_off = 0;
+	size_t capacity = 0;
+	size_t sref[2];
+	size_t bad_sref[2];
+	unsigned char *tags = NULL;
+	tds_hashtbl *tbl = tds_hashtbl_force_create_m(sizeof(pair), sizeof(size_t), \
+		0, fnv1a, tds_hashtbl_mode_incremental, NULL);
+	tds_hashtbl *mapped = NULL;
+
+	for (idx = 0; idx < npairs; idx++) {
+		pair[0] = idx;
+		pair[1] = idx * 7;
+		tds_hashtbl_force_set(tbl, pair);
+		if (idx % 5 == 0)
+			tds_hashtbl_rm(tbl, &idx);
+	}
+	assert(1 == tds_hashtbl_save(tbl, path));
+	assert(!tds_hashtbl_migrating(tbl));
+	assert(NULL != (mapped = tds_hashtbl_open_mmap_h(path, fnv1a)));
+	assert(tds_hashtbl_usage(mapped) == tds_hashtbl_usage(tbl));
+	assert(tds_hashtbl_capacity(mapped) == tds_hashtbl_capacity(tbl));
+	assert(tds_hashtbl_seed(mapped) == tds_hashtbl_seed(tbl));
+	for (idx = 0; idx < npairs + 10; idx++) {
+		pair_p = (size_t *) tds_hashtbl_get(mapped, &idx);
+		if (idx % 5 == 0 || idx >= npairs)
+			assert(NULL == pair_p);
+		else
+			assert(NULL != pair_p && pair_p[1] == idx * 7);
+	}
+	tds_hashtbl_iter_begin(mapped, &iter);
+	for (idx = 0; NULL != tds_hashtbl_iter_next(mapped, &iter); idx++)
+		;
+	assert(idx == tds_hashtbl_usage(mapped));
+	pair[0] = 1;
+	assert(0 == tds_hashtbl_set(mapped, pair));
+	assert(0 == tds_hashtbl_rm(mapped, &pair[0]));
+	assert(0 == tds_hashtbl_compact(mapped));
+	tds_hashtbl_free(mapped);
+	tds_hashtbl_free(tbl);
+
+	/* string-key mode */
+	tbl = tds_hashtbl_force_create_s(sizeof(size_t), 0, 0);
+	for (idx = 0; idx < 1000; idx++) {
+		char key[32];
+		size_t len = (size_t) sprintf(key, "string key %lu", (unsigned long) idx);
+		tds_hashtbl_force_sset(tbl, key, len, &idx);
+	}
+	assert(1 == tds_hashtbl_save(tbl, path));
+	tds_hashtbl_free(tbl);
+	assert(NULL != (mapped = tds_hashtbl_open_mmap(path)));
+	for (idx = 0; idx < 1000; idx++) {
+		char key[32];
+		size_t len = (size_t) sprintf(key, "string key %lu", (unsigned long) idx);
+		assert(idx == *(size_t *) tds_hashtbl_sget(mapped, key, len));
+	}
+	assert(0 == tds_hashtbl_sset(mapped, "x", 1, &idx));
+	tds_hashtbl_free(mapped);
+
+	/* the slots: a key outside the arena, no empty slot; the array images
+	 * are [capacity][element size][data] */
+	file_read(path, 8 + 9 * sizeof(uint64_t), &ctrl_off, sizeof(uint64_t));
+	file_read(path, 8 + 10 * sizeof(uint64_t), &pairs_off, sizeof(uint64_t));
+	file_read(path, (long) ctrl_off, &capacity, sizeof(size_t));
+	tags = (unsigned char *) malloc(capacity);
+	file_read(path, (long) ctrl_off + 2 * sizeof(size_t), tags, capacity);
+	for (idx = 0; tags[idx] & 0x80; idx++)
+		;
+	file_read(path, (long) (pairs_off + 2 * sizeof(size_t) + idx * 3 * sizeof(size_t)), sref, sizeof(sref));
+	bad_sref[0] = sref[0];
+	bad_sref[1] = (size_t) -1 - sref[0];
+	file_write(path, (long) (pairs_off + 2 * sizeof(size_t) + idx * 3 * sizeof(size_t)), bad_sref, sizeof(bad_sref));
+	assert(NULL == tds_hashtbl_open_mmap(path));
+	file_write(path, (long) (pairs_off + 2 * sizeof(size_t) + idx * 3 * sizeof(size_t)), sref, sizeof(sref));
+	assert(NULL != (mapped = tds_hashtbl_open_mmap(path)));
+	tds_hashtbl_free(mapped);
+	memset(tags, 0x01, capacity);
+	file_write(path, (long) ctrl_off + 2 * sizeof(size_t), tags, capacity);
+	assert(NULL == tds_hashtbl_open_mmap(path));
+	free(tags);
+
+	/* an offset of the pairs that wraps around when added to */
+	file_write(path, 8 + 10 * sizeof(uint64_t), &bad_off, sizeof(uint64_t));
+	assert(NULL == tds_hashtbl_open_mmap(path));
+
+	/* truncated or not a table */
+	fp = fopen(path, "wb");
+	fputs("not a hash table", fp);
+	fclose(fp);
+	assert(NULL == tds_hashtbl_open_mmap(path));
+	assert(0 == remove(path));
+	assert(NULL == tds_hashtbl_open_mmap(path));
+}
+
+/* testing
+ * 	- tds_hashtbl_stats
+ * 	- tds_hashtbl_reset_stats
+ */
+void test_hashtable_stats(void)
+{
+	size_t npairs = 10000;
+	size_t idx = 0;
+	size_t nlookups = 0;
+	size_t pair[2];
+	struct tds_hashtbl_stats stats;
+	tds_hashtbl *tbl = tds_hashtbl_force_create(sizeof(pair), sizeof(size_t));
+
+	tds_hashtbl_stats(tbl, &stats);
+	assert(0 == stats.usage && 0 == stats.nresizes && 0 == stats.nlookups);
+	for (idx = 0; idx < npairs; idx++) {
+		pair[0] = idx;
+		pair[1] = idx;
+		tds_hashtbl_force_set(tbl, pair);
+	}
+	for (idx = 0; idx < npairs; idx += 2)
+		tds_hashtbl_rm(tbl, &idx);
+	for (idx = 0; idx < npairs; idx++)
+		tds_hashtbl_get(tbl, &idx);
+
+	tds_hashtbl_stats(tbl, &stats);
+	assert(stats.usage == npairs / 2);
+	assert(stats.capacity == tds_hashtbl_capacity(tbl));
+	assert(stats.tombstones == tds_hashtbl_tombstones(tbl));
+	assert(stats.nresizes > 0);
+	assert(stats.bytes > stats.capacity * sizeof(pair));
+	for (idx = 0; idx < tds_hashtbl_stats_nbins; idx++)
+		nlookups += stats.probe_hist[idx];
+	assert(nlookups == stats.nlookups);
+	if (0 != stats.nlookups) {  /* built with `tds_hashtbl_with_stats` */
+		assert(stats.nlookups >= 2 * npairs + npairs / 2);
+		assert(stats.max_probe >= 1);
+		assert(stats.probe_hist[0] > stats.nlookups / 2);  /* mostly in the home group */
+	}
+	printf("\nprobes: %lu lookups, max %lu groups, %lu resizes (%f s)\n", \
+		(unsigned long) stats.nlookups, (unsigned long) stats.max_probe, \
+		(unsigned long) stats.nresizes, stats.resize_seconds);
+
+	tds_hashtbl_reset_stats(tbl);
+	tds_hashtbl_stats(tbl, &stats);
+	assert(0 == stats.nresizes && 0 == stats.nlookups && 0 == stats.max_probe);
+	tds_hashtbl_free(tbl);
+}
+
+/* testing
+ * 	- tds_hashtbl_mode_robinhood, alone and with the other modes
+ * 	- no tombstone after tds_hashtbl_rm
+ * 	- load factor above 0.75
+ * 	- distances beyond the tag range when all keys collide
+ * 	- removing the pair just returned by tds_hashtbl_iter_next
+ */
+void test_hashtable_robinhood(void)
+{
+	int modes[3] = {0, tds_hashtbl_mode_storehash, tds_hashtbl_mode_incremental};
+	size_t npairs = 50000;
+	size_t idx = 0;
+	size_t pair[2];
+	double max_load = 0;
+	int m = 0;
+	tds_hashtbl *tbl = NULL;
+
+	for (m = 0; m < 3; m++) {
+		tbl = tds_hashtbl_force_create_m(sizeof(pair), sizeof(size_t), \
+			0, ta_hash_wy, tds_hashtbl_mode_robinhood | modes[m], NULL);
+		max_load = 0;
+		for (idx = 0; idx < npairs; idx++) {
+			pair[0] = idx;
+			pair[1] = idx;
+			tds_hashtbl_force_set(tbl, pair);
+			if (tds_hashtbl_load_factor(tbl) > max_load)
+				max_load = tds_hashtbl_load_factor(tbl);
+		}
+		assert(max_load > 0.85);
+		for (idx = 0; idx < npairs; idx += 3) {
+			pair[0] = idx;
+			pair[1] = idx + 1;
+			tds_hashtbl_force_set(tbl, pair);
+		}
+		assert(tds_hashtbl_usage(tbl) == npairs);
+		for (idx = 0; idx < npairs; idx += 2) {
+			assert(1 == tds_hashtbl_rm(tbl, &idx));
+			assert(0 == tds_hashtbl_rm(tbl, &idx));
+		}
+		while (0 != tds_hashtbl_migrate(tbl, 100))
+			;
+		assert(0 == tds_hashtbl_tombstones(tbl));
+		assert(tds_hashtbl_usage(tbl) == npairs / 2);
+		for (idx = 0; idx < npairs; idx++) {
+			size_t *value_p = (size_t *) tds_hashtbl_get(tbl, &idx);
+			if (idx % 2 == 0)
+				assert(NULL == value_p);
+			else
+				assert(NULL != value_p && value_p[1] == (idx % 3 == 0 ? idx + 1 : idx));
+		}
+		tds_hashtbl_free(tbl);
+	}
+
+	/* a single cluster of 300 pairs */
+	tbl = tds_hashtbl_force_create_m(sizeof(pair), sizeof(size_t), 0, fconst, tds_hashtbl_mode_robinhood, NULL);
+	for (idx = 0; idx < 300; idx++) {
+		pair[0] = idx;
+		pair[1] = idx + 1;
+		tds_hashtbl_force_set(tbl, pair);
+	}
+	for (idx = 0; idx < 300; idx += 2)
+		assert(1 == tds_hashtbl_rm(tbl, &idx));
+	for (idx = 0; idx < 300; idx++) {
+		size_t *value_p = (size_t *) tds_hashtbl_get(tbl, &idx);
+		if (idx % 2 == 0)
+			assert(NULL == value_p);
+		else
+			assert(NULL != value_p && value_p[1] == idx + 1);
+	}
+	tds_hashtbl_free(tbl);
+
+	/* removing while iterating: every pair visited once, also in one cluster */
+	for (m = 0; m < 2; m++) {
+		tds_hashtbl_iter iter;
+		size_t *pair_p = NULL;
+		size_t nkeys = 0 == m ? 1000 : 300;
+		size_t nseen = 0;
+		size_t nremoved = 0;
+		char seen[1000] = {0};
+
+		tbl = tds_hashtbl_force_create_m(sizeof(pair), sizeof(size_t), 0, \
+			0 == m ? ta_hash_wy : fconst, tds_hashtbl_mode_robinhood, NULL);
+		for (idx = 0; idx < nkeys; idx++) {
+			pair[0] = idx;
+			pair[1] = idx + 1;
+			tds_hashtbl_force_set(tbl, pair);
+		}
+		tds_hashtbl_iter_begin(tbl, &iter);
+		while (NULL != (pair_p = (size_t *) tds_hashtbl_iter_next(tbl, &iter))) {
+			assert(pair_p[0] < nkeys && !seen[pair_p[0]]);
+			assert(pair_p[1] == pair_p[0] + 1);
+			seen[pair_p[0]] = 1;
+			nseen++;
+			if (0 == pair_p[0] % 2) {
+				assert(1 == tds_hashtbl_rm(tbl, pair_p));
+				nremoved++;
+			}
+		}
+		assert(nkeys == nseen);
+		assert(nkeys / 2 == nremoved);
+		assert(nkeys / 2 == tds_hashtbl_usage(tbl));
+		for (idx = 0; idx < nkeys; idx++)
+			assert((0 == idx % 2) == (NULL == tds_hashtbl_get(tbl, &idx)));
+		tds_hashtbl_free(tbl);
+	}
+
+	/* string keys */
+	tbl = tds_hashtbl_force_create_s(sizeof(size_t), 0, tds_hashtbl_mode_robinhood);
+	for (idx = 0; idx < 1000; idx++) {
+		char key[256];
+		size_t len = make_skey(key, idx);
+		tds_hashtbl_force_sset(tbl, key, len, &idx);
+	}
+	for (idx = 0; idx < 1000; idx += 2) {
+		char key[256];
+		size_t len = make_skey(key, idx);
+		assert(1 == tds_hashtbl_srm(tbl, key, len));
+	}
+	for (idx = 0; idx < 1000; idx++) {
+		char key[256];
+		size_t len = make_skey(key, idx);
+		size_t *value_p = (size_t *) tds_hashtbl_sget(tbl, key, len);
+		assert(idx % 2 == 0 ? NULL == value_p : *value_p == idx);
+	}
 	tds_hashtbl_free(tbl);
 }
 
 int main(void)
 {
 	test_hashtable();
+	test_hashtable_fhash();
+	test_hash_fn();
+	test_hashtable_ctrl();
+	test_hashtable_churn();
+	test_hashtable_incremental();
+	test_hashtable_storehash();
+	test_hashtable_batch();
+	test_hashtable_strkey();
+	test_hashtable_iter();
+	test_hashtable_mmap();
+	test_hashtable_stats();
+	test_hashtable_robinhood();
 	return 0;
 }
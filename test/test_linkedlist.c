@@ -79,7 +79,7 @@ void test_worst(void)
 void test_best(void)
 {
 	size_t bufferlen = 100;
-	tds_linkedlist *list = tds_linkedlist_create_g(sizeof(long), bufferlen);
+	tds_linkedlist *list = tds_linkedlist_create_g(sizeof(long), bufferlen, NULL);
 	tds_linkedlistiter *iter = NULL;
 	long idx = 0;
 
@@ -0,0 +1,114 @@
+#include <tds/nbitsarray.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N  1000
+
+static uint32_t random_value(int nbits)
+{
+	uint32_t v = ((uint32_t) rand() << 16) ^ (uint32_t) rand();
+
+	return nbits < 32 ? v & (((uint32_t) 1 << nbits) - 1) : v;
+}
+
+/* testing
+ * 	- tds_nbitsarray_force_create
+ * 	- tds_nbitsarray_force_pushback
+ * 	- tds_nbitsarray_get
+ * 	- tds_nbitsarray_set
+ * 	- tds_nbitsarray_len
+ * 	- tds_nbitsarray_capacity
+ * 	- tds_nbitsarray_free
+ */
+void test_get_set(void)
+{
+	uint32_t ref[N];
+	int nbits = 0;
+
+	for (nbits = 1; nbits <= 32; nbits++) {
+		tds_nbitsarray *arr = tds_nbitsarray_force_create(nbits);
+		size_t idx = 0;
+
+		srand(nbits);
+		assert(nbits == tds_nbitsarray_nbits(arr));
+		for (idx = 0; idx < N; idx++) {
+			ref[idx] = random_value(nbits);
+			tds_nbitsarray_force_pushback(arr, ref[idx]);
+		}
+		assert(N == tds_nbitsarray_len(arr));
+		assert(N <= tds_nbitsarray_capacity(arr));
+		for (idx = 0; idx < N; idx++)
+			assert(ref[idx] == tds_nbitsarray_get(arr, idx));
+
+		/* overwriting a value keeps its neighbours */
+		for (idx = 0; idx < 4 * N; idx++) {
+			size_t loc = (size_t) rand() % N;
+
+			ref[loc] = random_value(nbits);
+			tds_nbitsarray_set(arr, loc, ref[loc]);
+		}
+		for (idx = 0; idx < N; idx++)
+			assert(ref[idx] == tds_nbitsarray_get(arr, idx));
+		tds_nbitsarray_free(arr);
+	}
+}
+
+/* testing
+ * 	- tds_nbitsarray_force_create_g
+ * 	- tds_nbitsarray_reserve
+ * 	- tds_nbitsarray_force_append
+ * 	- tds_nbitsarray_decode
+ * 	- tds_nbitsarray_clear
+ */
+void test_append_decode(void)
+{
+	uint32_t ref[N];
+	uint32_t out[N];
+	int nbits = 0;
+
+	for (nbits = 1; nbits <= 32; nbits++) {
+		tds_nbitsarray *arr = tds_nbitsarray_force_create_g(nbits, 10, NULL);
+		size_t from = 0;
+		size_t n = 0;
+		size_t idx = 0;
+
+		srand(100 + nbits);
+		for (idx = 0; idx < N; idx++)
+			ref[idx] = random_value(nbits);
+		tds_nbitsarray_force_append(arr, ref, 7);
+		tds_nbitsarray_force_append(arr, ref + 7, 0);
+		tds_nbitsarray_force_append(arr, ref + 7, N - 7);
+		assert(N == tds_nbitsarray_len(arr));
+
+		/* every alignment of the start and the end around a group of 8 */
+		for (from = 0; from < 20; from++) {
+			for (n = 0; n <= N - from; n += (n < 40 ? 1 : 97)) {
+				tds_nbitsarray_decode(arr, from, n, out);
+				for (idx = 0; idx < n; idx++)
+					assert(ref[from + idx] == out[idx]);
+			}
+		}
+		tds_nbitsarray_decode(arr, N - 1, 1, out);
+		assert(ref[N - 1] == out[0]);
+
+		tds_nbitsarray_clear(arr);
+		assert(0 == tds_nbitsarray_len(arr));
+		assert(1 == tds_nbitsarray_reserve(arr, 3 * N));
+		assert(3 * N <= tds_nbitsarray_capacity(arr));
+		tds_nbitsarray_force_append(arr, ref + 1, N - 1);
+		tds_nbitsarray_decode(arr, 0, N - 1, out);
+		for (idx = 0; idx < N - 1; idx++)
+			assert(ref[idx + 1] == out[idx]);
+		tds_nbitsarray_free(arr);
+	}
+}
+
+int main(void)
+{
+	test_get_set();
+	test_append_decode();
+	return 0;
+}
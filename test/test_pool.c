@@ -0,0 +1,142 @@
+#include <tds/pool.h>
+#include <tds/arena.h>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The slabs come from a counting allocator
+ */
+struct counter {
+	size_t nalloc;
+	size_t nlive;
+};
+
+static void *count_alloc(void *ctx, size_t size)
+{
+	struct counter *c = (struct counter *) ctx;
+
+	c->nalloc++;
+	c->nlive++;
+	return malloc(size);
+}
+
+static void count_free(void *ctx, void *ptr, size_t size)
+{
+	struct counter *c = (struct counter *) ctx;
+
+	(void) size;
+	assert(c->nlive > 0);
+	c->nlive--;
+	free(ptr);
+}
+
+/* testing
+ * 	- tds_pool_force_create_g
+ * 	- tds_pool_get
+ * 	- tds_pool_put
+ * 	- tds_pool_len
+ * 	- tds_pool_nfree
+ * 	- tds_pool_nslab
+ * 	- tds_pool_trim
+ * 	- tds_pool_free
+ */
+void test_pool(void)
+{
+	struct counter c = {0, 0};
+	tds_allocator alloc = {count_alloc, NULL, count_free, NULL};
+	tds_pool *pool = NULL;
+	char *objs[1000];
+	size_t idx = 0;
+
+	alloc.ctx = &c;
+	pool = tds_pool_force_create_g(24, 100, (size_t) -1, &alloc);
+	for (idx = 0; idx < 1000; idx++) {
+		objs[idx] = (char *) tds_pool_get(pool);
+		assert(NULL != objs[idx]);
+		assert(0 == (uintptr_t) objs[idx] % _Alignof(max_align_t));
+		memset(objs[idx], (int) idx, 24);
+	}
+	assert(1000 == tds_pool_len(pool));
+	assert(10 == tds_pool_nslab(pool));
+	assert(11 == c.nalloc);  /* the pool and its slabs */
+	for (idx = 1; idx < 100; idx++)  /* packed in the first slab */
+		assert(objs[idx] - objs[idx - 1] == objs[1] - objs[0]);
+	for (idx = 0; idx < 1000; idx++)
+		assert((char) idx == objs[idx][23]);
+
+	/* the objects put back are taken first */
+	tds_pool_put(pool, objs[500]);
+	tds_pool_put(pool, objs[7]);
+	assert(2 == tds_pool_nfree(pool));
+	assert(objs[7] == tds_pool_get(pool));
+	assert(objs[500] == tds_pool_get(pool));
+	assert(0 == tds_pool_nfree(pool));
+
+	/* the slabs of the even hundreds, and a half slab, are emptied */
+	for (idx = 0; idx < 1000; idx++) {
+		if (0 == (idx / 100) % 2 || idx >= 950)
+			tds_pool_put(pool, objs[idx]);
+	}
+	assert(550 == tds_pool_nfree(pool));
+	assert(5 == tds_pool_trim(pool));
+	assert(5 == tds_pool_nslab(pool));
+	assert(50 == tds_pool_nfree(pool));
+	assert(450 == tds_pool_len(pool));
+	assert(6 == c.nlive);
+	for (idx = 0; idx < 950; idx++) {
+		if (1 == (idx / 100) % 2)
+			assert((char) idx == objs[idx][23]);
+	}
+	tds_pool_free(pool);
+	assert(0 == c.nlive);
+}
+
+/* testing
+ * 	- tds_pool_put, above `keep` free objects
+ * 	- tds_pool_create_g with an arena
+ */
+void test_keep(void)
+{
+	struct counter c = {0, 0};
+	tds_allocator alloc = {count_alloc, NULL, count_free, NULL};
+	tds_pool *pool = NULL;
+	tds_arena *arena = NULL;
+	void *objs[64];
+	size_t idx = 0;
+
+	alloc.ctx = &c;
+	pool = tds_pool_force_create_g(sizeof(double), 8, 8, &alloc);
+	for (idx = 0; idx < 64; idx++)
+		objs[idx] = tds_pool_get(pool);
+	assert(8 == tds_pool_nslab(pool));
+	for (idx = 0; idx < 64; idx++)
+		tds_pool_put(pool, objs[idx]);
+	assert(0 == tds_pool_len(pool));
+	assert(tds_pool_nfree(pool) >= 8);
+	assert(tds_pool_nslab(pool) < 8);
+	tds_pool_free(pool);
+	assert(0 == c.nlive);
+
+	/* in an arena, nothing is released but with the arena */
+	arena = tds_arena_force_create();
+	pool = tds_pool_force_create_g(100, 0, 0, tds_arena_allocator(arena));
+	for (idx = 0; idx < 64; idx++)
+		objs[idx] = tds_pool_get(pool);
+	for (idx = 0; idx < 64; idx++)
+		tds_pool_put(pool, objs[idx]);
+	assert(0 == tds_pool_trim(pool));
+	assert(64 == tds_pool_nfree(pool));
+	tds_pool_free(pool);
+	tds_arena_free(arena);
+}
+
+int main(void)
+{
+	test_pool();
+	test_keep();
+	return 0;
+}
@@ -0,0 +1,299 @@
+#include <tds.h>
+#include <tds/roaring.h>
+#include <tds/bitarray.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The values are drawn from a few chunks, the reference bit array holds bit
+ * `i` for the value `value_of(i)`
+ */
+static const uint32_t chunks[] = {0, 1, 5, 0xC0, 0xC1, 0x8000, 0xFFFF};
+#define nchunk  (sizeof(chunks) / sizeof(chunks[0]))
+
+static uint32_t value_of(size_t loc)
+{
+	return (chunks[loc >> 16] << 16) | (uint32_t) (loc & 0xFFFF);
+}
+
+/* A sparse chunk, a dense chunk, a chunk of runs, random chunks, and chunks
+ * filled by a single seed
+ */
+static void fill(tds_roaring *r, tds_bitarray *ref, int seed)
+{
+	size_t loc = 0;
+
+	srand(seed);
+	for (loc = 0; loc < nchunk * 65536; loc++) {
+		int in = 0;
+
+		switch (loc >> 16) {
+		case 0:  in = 0 == rand() % 100; break;
+		case 1:  in = 0 != rand() % 3; break;
+		case 2:  in = (loc & 0xFFFF) % 1000 < 300 + seed; break;
+		case 3:  in = 3 == seed && 0 == rand() % 50; break;
+		case 4:  in = 200 == seed && 0 != rand() % 3; break;
+		default: in = 0 == rand() % (1 + seed); break;
+		}
+		if (in) {
+			tds_roaring_force_add(r, value_of(loc));
+			tds_bitarray_set(ref, loc, 1);
+		}
+	}
+}
+
+struct values {
+	uint32_t *values;
+	size_t n;
+	size_t limit;  /* stop after `limit` values */
+};
+
+static int collect(uint32_t value, void *ctx)
+{
+	struct values *v = (struct values *) ctx;
+
+	v->values[v->n++] = value;
+	return v->n < v->limit;
+}
+
+/* Compare `r` with the reference by every query and by both iterations
+ */
+static void check(const tds_roaring *r, const tds_bitarray *ref)
+{
+	struct values values;
+	uint64_t v = 0;
+	size_t loc = 0;
+	size_t count = 0;
+
+	assert(tds_bitarray_popcount(ref) == tds_roaring_cardinality(r));
+	for (loc = 0; loc < nchunk * 65536; loc++)
+		assert(tds_bitarray_get(ref, loc) == tds_roaring_contains(r, value_of(loc)));
+	assert(0 == tds_roaring_contains(r, 0x00020000));
+
+	loc = tds_bitarray_find_next_set(ref, 0);
+	for (v = tds_roaring_next(r, 0); v != tds_roaring_end; v = tds_roaring_next(r, v + 1)) {
+		assert(v == value_of(loc));
+		loc = tds_bitarray_find_next_set(ref, loc + 1);
+		count++;
+	}
+	assert(count == tds_bitarray_popcount(ref));
+
+	values.values = (uint32_t *) malloc((count + 1) * sizeof(uint32_t));
+	values.n = 0;
+	values.limit = count + 1;
+	tds_roaring_foreach(r, collect, &values);
+	assert(count == values.n);
+	loc = tds_bitarray_find_next_set(ref, 0);
+	for (count = 0; count < values.n; count++) {
+		assert(values.values[count] == value_of(loc));
+		loc = tds_bitarray_find_next_set(ref, loc + 1);
+	}
+	if (values.n > 10) {
+		values.n = 0;
+		values.limit = 10;  /* stopped */
+		tds_roaring_foreach(r, collect, &values);
+		assert(10 == values.n);
+	}
+	free(values.values);
+}
+
+/* testing
+ * 	- tds_roaring_force_create
+ * 	- tds_roaring_force_add
+ * 	- tds_roaring_force_remove
+ * 	- tds_roaring_contains
+ * 	- tds_roaring_cardinality
+ * 	- tds_roaring_next
+ * 	- tds_roaring_foreach
+ * 	- tds_roaring_optimize
+ * 	- tds_roaring_free
+ */
+void test_roaring(void)
+{
+	size_t loc = 0;
+	tds_roaring *r = tds_roaring_force_create();
+	tds_bitarray *ref = tds_bitarray_force_create(nchunk * 65536);
+
+	assert(0 == tds_roaring_cardinality(r));
+	assert(tds_roaring_end == tds_roaring_next(r, 0));
+	fill(r, ref, 3);
+	check(r, ref);
+
+	/* removal from runs: the first, a middle and the last value of a run, and
+	 * a run of a single value */
+	assert(1 == tds_roaring_optimize(r));
+	check(r, ref);
+	for (loc = 2 * 65536; loc < 3 * 65536; loc += 1000) {
+		size_t removed[] = {0, 150, 152, 151, 302};
+		size_t idx = 0;
+
+		for (idx = 0; idx < sizeof(removed) / sizeof(removed[0]); idx++) {
+			tds_roaring_force_remove(r, value_of(loc + removed[idx]));
+			tds_bitarray_set(ref, loc + removed[idx], 0);
+		}
+	}
+	check(r, ref);
+
+	/* removal across the array / bitmap threshold, and runs split until they
+	 * are decoded by the optimization */
+	srand(11);
+	for (loc = 0; loc < nchunk * 65536; loc++) {
+		if (0 == rand() % 2) {
+			tds_roaring_force_remove(r, value_of(loc));
+			tds_bitarray_set(ref, loc, 0);
+		}
+	}
+	check(r, ref);
+	assert(1 == tds_roaring_optimize(r));
+	check(r, ref);
+
+	/* adding into runs */
+	for (loc = 3 * 65536 + 10000; loc < 3 * 65536 + 20000; loc++) {
+		tds_roaring_force_add(r, value_of(loc));
+		tds_bitarray_set(ref, loc, 1);
+	}
+	assert(1 == tds_roaring_optimize(r));
+	for (loc = 3 * 65536; loc < 4 * 65536; loc += 7) {
+		tds_roaring_force_add(r, value_of(loc));
+		tds_bitarray_set(ref, loc, 1);
+	}
+	check(r, ref);
+
+	for (loc = 0; loc < nchunk * 65536; loc++)
+		tds_roaring_force_remove(r, value_of(loc));
+	assert(0 == tds_roaring_cardinality(r));
+	assert(tds_roaring_end == tds_roaring_next(r, 0));
+
+	tds_roaring_force_add(r, 0xFFFFFFFF);
+	assert(1 == tds_roaring_contains(r, 0xFFFFFFFF));
+	assert(0xFFFFFFFF == tds_roaring_next(r, 0));
+	assert(tds_roaring_end == tds_roaring_next(r, tds_roaring_end));
+	tds_roaring_free(r);
+	tds_bitarray_free(ref);
+}
+
+/* testing
+ * 	- tds_roaring_and
+ * 	- tds_roaring_or
+ * 	- tds_roaring_xor
+ * 	- tds_roaring_andnot
+ */
+void test_roaring_op(void)
+{
+	int optimized = 0;
+
+	for (optimized = 0; optimized < 4; optimized++) {
+		tds_roaring *r1 = tds_roaring_force_create();
+		tds_roaring *r2 = tds_roaring_force_create();
+		tds_roaring *r = NULL;
+		tds_bitarray *ref1 = tds_bitarray_force_create(nchunk * 65536);
+		tds_bitarray *ref2 = tds_bitarray_force_create(nchunk * 65536);
+		tds_bitarray *ref = NULL;
+
+		fill(r1, ref1, 3);
+		fill(r2, ref2, 200);
+		if (optimized & 1)
+			tds_roaring_optimize(r1);
+		if (optimized & 2)
+			tds_roaring_optimize(r2);
+
+		assert(NULL != (r = tds_roaring_and(r1, r2)));
+		ref = tds_bitarray_and(ref1, ref2);
+		check(r, ref);
+		tds_roaring_free(r);
+		tds_bitarray_free(ref);
+
+		assert(NULL != (r = tds_roaring_or(r1, r2)));
+		ref = tds_bitarray_or(ref1, ref2);
+		check(r, ref);
+		tds_roaring_free(r);
+		tds_bitarray_free(ref);
+
+		assert(NULL != (r = tds_roaring_xor(r1, r2)));
+		ref = tds_bitarray_xor(ref1, ref2);
+		check(r, ref);
+		tds_roaring_free(r);
+		tds_bitarray_free(ref);
+
+		assert(NULL != (r = tds_roaring_andnot(r1, r2)));
+		ref = tds_bitarray_not(ref2);
+		tds_bitarray_and_inplace(ref, ref1);
+		check(r, ref);
+		tds_roaring_free(r);
+		tds_bitarray_free(ref);
+
+		/* the other way around, so that each kind of container is on both sides */
+		assert(NULL != (r = tds_roaring_and(r2, r1)));
+		ref = tds_bitarray_and(ref1, ref2);
+		check(r, ref);
+		tds_roaring_free(r);
+		tds_bitarray_free(ref);
+
+		assert(NULL != (r = tds_roaring_andnot(r2, r1)));
+		ref = tds_bitarray_not(ref1);
+		tds_bitarray_and_inplace(ref, ref2);
+		check(r, ref);
+		tds_roaring_free(r);
+		tds_bitarray_free(ref);
+
+		assert(NULL != (r = tds_roaring_xor(r1, r1)));
+		assert(0 == tds_roaring_cardinality(r));
+		tds_roaring_free(r);
+
+		tds_roaring_free(r1);
+		tds_roaring_free(r2);
+		tds_bitarray_free(ref1);
+		tds_bitarray_free(ref2);
+	}
+}
+
+/* testing
+ * 	- tds_roaring_serialized_size
+ * 	- tds_roaring_serialize
+ * 	- tds_roaring_deserialize
+ * 	- tds_roaring_bytes
+ */
+void test_roaring_serialize(void)
+{
+	size_t len = 0;
+	size_t idx = 0;
+	unsigned char *buf = NULL;
+	tds_roaring *r = tds_roaring_force_create();
+	tds_roaring *copy = NULL;
+	tds_bitarray *ref = tds_bitarray_force_create(nchunk * 65536);
+
+	fill(r, ref, 3);
+	tds_roaring_optimize(r);  /* all three kinds of container */
+	len = tds_roaring_serialized_size(r);
+	buf = (unsigned char *) malloc(len);
+	tds_roaring_serialize(r, buf);
+	assert(NULL != (copy = tds_roaring_deserialize(buf, len)));
+	check(copy, ref);
+	assert(tds_roaring_bytes(r) + 12 >= len);
+	tds_roaring_free(copy);
+
+	assert(NULL == tds_roaring_deserialize(buf, len - 1));  /* truncated */
+	buf[0] = 'x';
+	assert(NULL == tds_roaring_deserialize(buf, len));  /* bad magic */
+	free(buf);
+	tds_roaring_free(r);
+
+	/* 1000 values scattered over the 32-bit universe */
+	r = tds_roaring_force_create();
+	for (idx = 0; idx < 1000; idx++)
+		tds_roaring_force_add(r, (uint32_t) (idx * 4294967u));
+	assert(1000 == tds_roaring_cardinality(r));
+	assert(tds_roaring_bytes(r) < 64 * 1024);
+	tds_roaring_free(r);
+	tds_bitarray_free(ref);
+}
+
+int main(void)
+{
+	test_roaring();
+	test_roaring_op();
+	test_roaring_serialize();
+	return 0;
+}